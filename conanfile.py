@@ -15,12 +15,16 @@ class AmbaTlmRecipe(ConanFile):
 
     options = {
         "shared": [True, False],
-        "fPIC": [True, False]
+        "fPIC": [True, False],
+        "thread_safe": [True, False],
+        "socket_stats": [True, False]
     }
 
     default_options = {
         "shared": False,
         "fPIC": True,
+        "thread_safe": False,
+        "socket_stats": False,
 
         "systemc/2.3.3:fPIC": True,
         "systemc/2.3.3:shared": False,
@@ -45,6 +49,8 @@ class AmbaTlmRecipe(ConanFile):
 
     def generate(self):
         tc = CMakeToolchain(self)
+        tc.variables["ARM_TLM_THREAD_SAFE"] = bool(self.options.thread_safe)
+        tc.variables["ARM_TLM_SOCKET_STATS"] = bool(self.options.socket_stats)
         tc.generate()
 
         deps = CMakeDeps(self)
@@ -68,3 +74,12 @@ class AmbaTlmRecipe(ConanFile):
     def package_info(self):
         self.cpp_info.components["armtlmaxi4"].libs = ["armtlmaxi4"]
         self.cpp_info.components["armtlmchi"].libs = ["armtlmchi"]
+
+        # Options changing the libraries' code must be seen by their users too.
+        for component in ("armtlmaxi4", "armtlmchi"):
+            if self.options.thread_safe:
+                self.cpp_info.components[component].defines.append("ARM_TLM_THREAD_SAFE")
+                if self.settings.os in ("Linux", "FreeBSD"):
+                    self.cpp_info.components[component].system_libs.append("pthread")
+            if self.options.socket_stats:
+                self.cpp_info.components[component].defines.append("ARM_TLM_SOCKET_STATS")
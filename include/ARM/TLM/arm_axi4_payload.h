@@ -41,6 +41,7 @@
 #include <iostream>
 
 #include "arm_tlm_helpers.h"
+#include "arm_tlm_payload_pool.h"
 
 namespace ARM
 {
@@ -537,7 +538,7 @@ private:
      * unref is called on a payload with refcount == 1, the payload will be
      * returned to the payload pool.
      */
-    mutable unsigned refcount;
+    mutable TLM::PoolRefCount refcount;
 
 public:
     /**
@@ -1070,8 +1071,14 @@ public:
      * memory problems.
      */
     static void debug_payload_pool(std::ostream& stream);
+
+    /** Get allocation statistics for the payload pool. */
+    static TLM::PoolStatistics get_payload_pool_statistics();
 };
 
+/** Intrusive reference counting handle to a Payload. */
+typedef TLM::PayloadRef<Payload> PayloadRef;
+
 /**
  * Base class of a PayloadExtensionManageer. This provides the functionality
  * of creating, copying and destroying extensions on payloads. The get_size
@@ -36,6 +36,9 @@
 #ifndef ARM_AXI4_SOCKET_H
 #define ARM_AXI4_SOCKET_H
 
+#include <algorithm>
+#include <stdint.h>
+
 #include "arm_axi4_payload.h"
 #include "arm_axi4_phase.h"
 #include "arm_tlm_socket.h"
@@ -70,6 +73,36 @@ public:
         TLM::Protocol protocol_, unsigned width_) :
         TLM::SimpleInitiatorSocket <Module, Types>(name_, t, bw, protocol_, width_)
     {}
+
+    SimpleInitiatorSocket(const char* name_, Module& t,
+        typename BaseType::TimedNBFunc bw,
+        TLM::Protocol protocol_, unsigned width_) :
+        TLM::SimpleInitiatorSocket <Module, Types>(name_, t, bw, protocol_, width_)
+    {}
+};
+
+/**
+ * ARM::TLM::StaticInitiatorSocket specialised for AXI4 payloads/phases. PeerFw
+ * must be accessible where the socket is declared, i.e. a public member of
+ * PeerModule or one PeerModule grants Module friendship to.
+ */
+template <typename Module, typename PeerModule,
+    tlm::tlm_sync_enum (PeerModule::* PeerFw)(Payload&, Phase&)>
+class StaticInitiatorSocket :
+    public ARM::TLM::StaticInitiatorSocket<Module, PeerModule, ProtocolType,
+        PeerFw>
+{
+private:
+    typedef typename ARM::TLM::SimpleInitiatorSocket<Module, ProtocolType>
+        BaseType;
+
+public:
+    StaticInitiatorSocket(const char* name_, Module& t,
+        typename BaseType::NBFunc bw,
+        TLM::Protocol protocol_, unsigned width_) :
+        TLM::StaticInitiatorSocket<Module, PeerModule, ProtocolType, PeerFw>(
+            name_, t, bw, protocol_, width_)
+    {}
 };
 
 /** ARM::TLM::SimpleTargetSocket specialised for AXI4 payloads/phases. */
@@ -87,6 +120,299 @@ public:
         TLM::SimpleTargetSocket <Module, Types>(name_, t, fw,
             protocol_, width_, dbg)
     {}
+
+    SimpleTargetSocket(const char* name_, Module& t,
+        typename BaseType::TimedNBFunc fw,
+        TLM::Protocol protocol_, unsigned width_,
+        typename BaseType::DebugFunc dbg = nullptr) :
+        TLM::SimpleTargetSocket <Module, Types>(name_, t, fw,
+            protocol_, width_, dbg)
+    {}
+};
+
+/** ARM::TLM::MultiInitiatorSocket specialised for AXI4 payloads/phases. */
+template <typename Module, typename Types = ProtocolType>
+class MultiInitiatorSocket : public ARM::TLM::MultiInitiatorSocket <Module, Types>
+{
+private:
+    typedef typename ARM::TLM::MultiInitiatorSocket<Module, Types> BaseType;
+
+public:
+    MultiInitiatorSocket(const char* name_, Module& t,
+        typename BaseType::NBFunc bw,
+        TLM::Protocol protocol_, unsigned width_) :
+        TLM::MultiInitiatorSocket <Module, Types>(name_, t, bw, protocol_, width_)
+    {}
+};
+
+/** ARM::TLM::MultiTargetSocket specialised for AXI4 payloads/phases. */
+template <typename Module, typename Types = ProtocolType>
+class MultiTargetSocket : public ARM::TLM::MultiTargetSocket <Module, Types>
+{
+private:
+    typedef typename ARM::TLM::MultiTargetSocket<Module, Types> BaseType;
+
+public:
+    MultiTargetSocket(const char* name_, Module& t,
+        typename BaseType::NBFunc fw,
+        TLM::Protocol protocol_, unsigned width_,
+        typename BaseType::DebugFunc dbg = nullptr) :
+        TLM::MultiTargetSocket <Module, Types>(name_, t, fw,
+            protocol_, width_, dbg)
+    {}
+};
+
+/**
+ * Choose the largest INCR burst starting at address and covering no more
+ * than length bytes that a debug access over a port port_width bits wide can
+ * use. Bursts use the widest aligned beat the port carries and do not cross
+ * 4KB boundaries. Returns the number of bytes the burst covers.
+ */
+inline unsigned debug_burst(uint64_t address, unsigned length,
+    unsigned port_width, Size& size, uint8_t& len)
+{
+    unsigned size_log2 = SIZE_128;
+    while (size_log2 > 0 && (1u << size_log2) * 8 > port_width)
+        size_log2--;
+
+    while (size_log2 > 0 &&
+        ((address & ((1u << size_log2) - 1)) != 0 ||
+            (1u << size_log2) > length))
+    {
+        size_log2--;
+    }
+
+    const unsigned beat_bytes = 1u << size_log2;
+    const unsigned boundary_bytes = 0x1000 - unsigned(address & 0xfff);
+    const unsigned beats = std::min(256u,
+        std::min(length, boundary_bytes) / beat_bytes);
+
+    size = SizeEnum(size_log2);
+    len = uint8_t(beats - 1);
+
+    return beats * beat_bytes;
+}
+
+/**
+ * Read length bytes from address using the debug transport of socket (an
+ * initiator socket, or any other port providing the fw interface and its
+ * port_width). Large reads are split into the fewest bursts debug_burst
+ * allows. Returns the number of bytes read, which is less than length if the
+ * target stopped accepting bursts.
+ */
+template <typename Socket>
+unsigned debug_read(Socket& socket, uint64_t address, uint8_t* data,
+    unsigned length)
+{
+    unsigned done = 0;
+
+    while (done < length)
+    {
+        Size size;
+        uint8_t len;
+        unsigned burst_bytes = debug_burst(address + done, length - done,
+            socket.port_width, size, len);
+
+        PayloadRef payload(Payload::new_payload(COMMAND_READ, address + done,
+            size, len), TLM::ADOPT_REF);
+
+        if (socket->transport_dbg(*payload) < burst_bytes)
+            break;
+
+        payload->read_out(data + done);
+        done += burst_bytes;
+    }
+
+    return done;
+}
+
+/**
+ * Write length bytes to address using the debug transport of socket. Large
+ * writes are split as for debug_read. Returns the number of bytes written.
+ */
+template <typename Socket>
+unsigned debug_write(Socket& socket, uint64_t address, const uint8_t* data,
+    unsigned length)
+{
+    unsigned done = 0;
+
+    while (done < length)
+    {
+        Size size;
+        uint8_t len;
+        unsigned burst_bytes = debug_burst(address + done, length - done,
+            socket.port_width, size, len);
+
+        PayloadRef payload(Payload::new_payload(COMMAND_WRITE, address + done,
+            size, len), TLM::ADOPT_REF);
+        payload->write_in(data + done);
+
+        if (socket->transport_dbg(*payload) < burst_bytes)
+            break;
+
+        done += burst_bytes;
+    }
+
+    return done;
+}
+
+}
+
+namespace TLM
+{
+
+/**
+ * Allow b_transport to drive AXI4 targets which only implement
+ * nb_transport_fw. Reads are offered on AR and complete on the R beat with
+ * RLAST. Writes are offered on AW followed by each W beat and complete on
+ * the B response carrying BCOMP. Full ACE ports also receive RACK/WACK.
+ */
+template <>
+class BlockingAdapterPolicy<AXI4::ProtocolType>
+{
+public:
+    static const bool supported = true;
+
+    static unsigned request_phase_count(const AXI4::Payload& trans)
+    {
+        if (trans.get_command() == AXI4::COMMAND_WRITE)
+            return 1 + trans.get_beat_count();
+        else
+            return 1;
+    }
+
+    static AXI4::Phase request_phase(const AXI4::Payload& trans,
+        unsigned index)
+    {
+        if (trans.get_command() != AXI4::COMMAND_WRITE)
+            return AXI4::AR_VALID;
+        else if (index == 0)
+            return AXI4::AW_VALID;
+        else if (index == trans.get_beat_count())
+            return AXI4::W_VALID_LAST;
+        else
+            return AXI4::W_VALID;
+    }
+
+    static bool is_request_ready(const AXI4::Phase& request,
+        const AXI4::Phase& reply)
+    {
+        switch (request)
+        {
+        case AXI4::AW_VALID:
+            return reply == AXI4::AW_READY;
+        case AXI4::W_VALID:
+        case AXI4::W_VALID_LAST:
+            return reply == AXI4::W_READY;
+        case AXI4::AR_VALID:
+            return reply == AXI4::AR_READY;
+        default:
+            return false;
+        }
+    }
+
+    static bool accept_response(const AXI4::Payload&, AXI4::Phase& phase)
+    {
+        switch (AXI4::phase_get_channel(phase))
+        {
+        case AXI4::CHANNEL_R:
+        {
+            bool last = AXI4::phase_strip(phase) == AXI4::R_VALID_LAST;
+            phase = AXI4::R_READY;
+            return last;
+        }
+        case AXI4::CHANNEL_B:
+        {
+            /* Phase bit [8] is set on B responses without BCOMP. */
+            bool comp = (phase & 0x100) == 0;
+            phase = AXI4::B_READY;
+            return comp;
+        }
+        default:
+            return false;
+        }
+    }
+
+    static bool completion_ack(const AXI4::Payload& trans, Protocol protocol,
+        AXI4::Phase& ack)
+    {
+        if (protocol != PROTOCOL_ACE && protocol != PROTOCOL_ACE5)
+            return false;
+
+        ack = trans.get_command() == AXI4::COMMAND_WRITE ?
+            AXI4::WACK : AXI4::RACK;
+        return true;
+    }
+};
+
+/**
+ * Socket statistics for AXI4. Phases are classed by channel and VALID/READY.
+ * Transactions begin on AW/AR VALID and end on RLAST or a B response with
+ * BCOMP. W and R VALID phases are data beats.
+ */
+template <>
+class SocketStatsPolicy<AXI4::ProtocolType>
+{
+public:
+    static const unsigned phase_class_count =
+        2 * (AXI4::CHANNEL_RQOSACCEPT + 1);
+
+    static unsigned phase_class(const AXI4::Phase& phase)
+    {
+        return 2 * AXI4::phase_get_channel(phase) + (phase & 1);
+    }
+
+    static const char* phase_class_name(unsigned phase_class)
+    {
+        static const char* const names[phase_class_count] = {
+            "UNINITIALIZED", nullptr,
+            "AW_VALID", "AW_READY",
+            "W_VALID", "W_READY",
+            "B_VALID", "B_READY",
+            "AR_VALID", "AR_READY",
+            "R_VALID", "R_READY",
+            "AC_VALID", "AC_READY",
+            "CR_VALID", "CR_READY",
+            "CD_VALID", "CD_READY",
+            "WACK", nullptr,
+            "RACK", nullptr,
+            "WQOSACCEPT", nullptr,
+            "RQOSACCEPT", nullptr
+        };
+        return phase_class < phase_class_count ? names[phase_class] : nullptr;
+    }
+
+    static unsigned events(const AXI4::Payload& trans,
+        const AXI4::Phase& phase, unsigned /* port_width */)
+    {
+        if (phase & 1)
+            return STATS_EVENT_NONE;
+
+        switch (AXI4::phase_get_channel(phase))
+        {
+        case AXI4::CHANNEL_AW:
+        case AXI4::CHANNEL_AR:
+            return STATS_EVENT_BEGIN;
+        case AXI4::CHANNEL_W:
+            return STATS_EVENT_BEAT;
+        case AXI4::CHANNEL_R:
+            /* Atomics also get a B response, which ends them instead. */
+            return AXI4::phase_strip(phase) == AXI4::R_VALID_LAST &&
+                trans.atop == AXI4::ATOP_NON_ATOMIC ?
+                (STATS_EVENT_BEAT | STATS_EVENT_END) : STATS_EVENT_BEAT;
+        case AXI4::CHANNEL_B:
+            /* Phase bit [8] is set on B responses without BCOMP. */
+            return (phase & 0x100) == 0 ? STATS_EVENT_END : STATS_EVENT_NONE;
+        default:
+            return STATS_EVENT_NONE;
+        }
+    }
+
+    static unsigned beat_count(const AXI4::Payload& trans,
+        unsigned /* port_width */)
+    {
+        return trans.get_beat_count();
+    }
 };
 
 }
@@ -0,0 +1,282 @@
+/*
+ * The Clear BSD License
+ *
+ * Copyright (c) 2015-2021 Arm Limited.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *      * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *
+ *      * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *      * Neither the name of the copyright holder nor the names of its
+ *      contributors may be used to endorse or promote products derived from
+ *      this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ARM_CHI_BRIDGE_H
+#define ARM_CHI_BRIDGE_H
+
+#include <sched.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <atomic>
+#include <cstddef>
+#include <new>
+
+#include <ARM/TLM/arm_chi_flit.h>
+#include <ARM/TLM/arm_chi_link.h>
+
+namespace ARM
+{
+namespace CHI
+{
+
+/*
+ * A BridgeLink is shared between processes, so its atomics must work on
+ * memory mapped into more than one of them.
+ */
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_BOOL_LOCK_FREE == 2,
+    "BridgeLink needs lock-free atomics");
+
+/** Flits each direction of a BridgeLink can hold. */
+static const std::size_t BRIDGE_QUEUE_DEPTH = 256;
+
+/** Alignment keeping the two ends of a BridgeQueue off each other's lines. */
+static const std::size_t BRIDGE_CACHE_LINE_BYTES = 64;
+
+/** A packed flit crossing a BridgeLink. */
+struct BridgeFlit
+{
+    /** Cycle of the receiving side the flit is delivered in. */
+    uint64_t due;
+
+    Channel channel;
+
+    /** The flit, packed by a FlitCodec. */
+    uint64_t words[FLIT_MAX_WORDS];
+};
+
+/**
+ * Fixed capacity lock-free queue of BridgeFlits with a single producer and a
+ * single consumer, which may be in different processes sharing the memory
+ * the queue is in.
+ *
+ * The producer fills back() and then calls push(); the consumer reads
+ * front() and then calls pop(). The flit is only handed over by the second
+ * call, so neither side copies it through a temporary.
+ */
+class BridgeQueue
+{
+private:
+    /** Next flit to pop, written by the consumer. */
+    alignas(BRIDGE_CACHE_LINE_BYTES) std::atomic<uint64_t> head;
+
+    /** Next flit to push, written by the producer. */
+    alignas(BRIDGE_CACHE_LINE_BYTES) std::atomic<uint64_t> tail;
+
+    alignas(BRIDGE_CACHE_LINE_BYTES) BridgeFlit flits[BRIDGE_QUEUE_DEPTH];
+
+    BridgeQueue(const BridgeQueue&);
+    BridgeQueue& operator=(const BridgeQueue&);
+
+public:
+    BridgeQueue() : head(0), tail(0) {}
+
+    /** Number of flits that can be pushed. Producer only. */
+    std::size_t space() const
+    {
+        return BRIDGE_QUEUE_DEPTH - std::size_t(
+            tail.load(std::memory_order_relaxed) -
+            head.load(std::memory_order_acquire));
+    }
+
+    /** The flit the next push() hands over. Producer only. */
+    BridgeFlit& back()
+    {
+        return flits[tail.load(std::memory_order_relaxed) %
+            BRIDGE_QUEUE_DEPTH];
+    }
+
+    /** Hand back() over to the consumer. Producer only. */
+    void push()
+    {
+        link_assert(space() != 0, "push to a full BridgeQueue");
+
+        tail.store(tail.load(std::memory_order_relaxed) + 1,
+            std::memory_order_release);
+    }
+
+    /** Consumer only. */
+    bool empty() const
+    {
+        return head.load(std::memory_order_relaxed) ==
+            tail.load(std::memory_order_acquire);
+    }
+
+    /** Oldest flit pushed. Consumer only. */
+    const BridgeFlit& front() const
+    {
+        return flits[head.load(std::memory_order_relaxed) %
+            BRIDGE_QUEUE_DEPTH];
+    }
+
+    /** Release front() back to the producer. Consumer only. */
+    void pop()
+    {
+        link_assert(!empty(), "pop from an empty BridgeQueue");
+
+        head.store(head.load(std::memory_order_relaxed) + 1,
+            std::memory_order_release);
+    }
+};
+
+/** The two ends of a BridgeLink. */
+enum BridgeSide
+{
+    /** Facing a requester: receives REQ and sends SNP flits. */
+    BRIDGE_SIDE_REQUESTER = 0,
+
+    /** Facing a home node: sends REQ and receives SNP flits. */
+    BRIDGE_SIDE_HOME = 1
+};
+
+/**
+ * Link between two parts of a platform simulated by separate SystemC
+ * kernels, each in its own process, joined at a CHI requester to home node
+ * link. Stock SystemC runs one kernel per process, so a BridgeLink lives in
+ * memory shared by the two processes: create_shared() maps it so that it is
+ * inherited across fork(), after which each process elaborates and runs its
+ * part of the platform. Payloads cannot be shared between processes, so
+ * flits cross the link packed by a FlitCodec and each side decodes them into
+ * its own Payloads.
+ *
+ * Each side sends flits on a BridgeQueue to the other. Synchronisation is
+ * conservative, counted in cycles of a clock both sides run at the same
+ * rate: a flit sent in cycle c is delivered in cycle c + latency, so before
+ * simulating cycle c a side waits until its peer has completed cycle
+ * c - latency and so has sent every flit due by then. latency is the
+ * lookahead each side may run ahead of the other, and must be at least one
+ * cycle.
+ *
+ * A side which stops simulating closes its end of the link, after which its
+ * peer no longer waits for it.
+ */
+class BridgeLink
+{
+private:
+    struct SideState
+    {
+        /** Cycles the side has completed. */
+        alignas(BRIDGE_CACHE_LINE_BYTES) std::atomic<uint64_t> cycles;
+
+        std::atomic<bool> closed;
+
+        SideState() : cycles(0), closed(false) {}
+    };
+
+    const unsigned latency;
+
+    SideState sides[2];
+
+    /** Flits sent by each side. */
+    BridgeQueue queues[2];
+
+    BridgeLink(const BridgeLink&);
+    BridgeLink& operator=(const BridgeLink&);
+
+public:
+    explicit BridgeLink(unsigned latency_) : latency(latency_)
+    {
+        link_assert(latency != 0, "BridgeLink latency must be non-zero");
+    }
+
+    /**
+     * Make a link in anonymous shared memory, which is shared with the
+     * processes fork()ed after it is made. Returns null if the memory cannot
+     * be mapped.
+     */
+    static BridgeLink* create_shared(unsigned latency)
+    {
+        void* const memory = mmap(nullptr, sizeof(BridgeLink),
+            PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED)
+            return nullptr;
+
+        return new (memory) BridgeLink(latency);
+    }
+
+    /** Unmap a link made with create_shared(), in each process using it. */
+    static void destroy_shared(BridgeLink* link)
+    {
+        if (!link)
+            return;
+
+        link->~BridgeLink();
+        munmap(link, sizeof(BridgeLink));
+    }
+
+    unsigned get_latency() const { return latency; }
+
+    /** Queue of flits sent by 'side'. */
+    BridgeQueue& tx_queue(BridgeSide side) { return queues[side]; }
+
+    /** Queue of flits sent to 'side'. */
+    BridgeQueue& rx_queue(BridgeSide side) { return queues[side ^ 1]; }
+
+    /** Record that 'side' has completed 'cycles' cycles. */
+    void publish(BridgeSide side, uint64_t cycles)
+    {
+        sides[side].cycles.store(cycles, std::memory_order_release);
+    }
+
+    /** 'side' has stopped simulating. */
+    void close(BridgeSide side)
+    {
+        sides[side].closed.store(true, std::memory_order_release);
+    }
+
+    /**
+     * Have all flits due at 'side' by cycle 'cycle' been sent? True once the
+     * peer has completed cycle - latency, or closed.
+     */
+    bool is_ready(BridgeSide side, uint64_t cycle) const
+    {
+        const SideState& peer = sides[side ^ 1];
+
+        return cycle < latency ||
+            peer.cycles.load(std::memory_order_acquire) > cycle - latency ||
+            peer.closed.load(std::memory_order_acquire);
+    }
+
+    /** Wait until is_ready(side, cycle). */
+    void wait_ready(BridgeSide side, uint64_t cycle) const
+    {
+        while (!is_ready(side, cycle))
+            sched_yield();
+    }
+};
+
+}
+}
+
+#endif /* ARM_CHI_BRIDGE_H */
@@ -0,0 +1,235 @@
+/*
+ * The Clear BSD License
+ *
+ * Copyright (c) 2015-2021 Arm Limited.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *      * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *
+ *      * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *      * Neither the name of the copyright holder nor the names of its
+ *      contributors may be used to endorse or promote products derived from
+ *      this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ARM_CHI_FLIT_H
+#define ARM_CHI_FLIT_H
+
+#include <stdint.h>
+#include <vector>
+
+#include <ARM/TLM/arm_chi_payload.h>
+#include <ARM/TLM/arm_chi_phase.h>
+
+namespace ARM
+{
+namespace CHI
+{
+
+/**
+ * Bit-level encoding and decoding of (Payload, Phase) pairs to and from the
+ * packed REQ, RSP, SNP and DAT flit formats used by RTL implementations of
+ * CHI.
+ *
+ * Flits are held as little-endian arrays of 64 bit words: bit 0 of a flit is
+ * bit 0 of word 0. Fields are packed from bit 0 upwards in the order given by
+ * the flit field tables of the CHI specification for the selected issue.
+ *
+ * Fields which have no equivalent in Payload or Phase (TraceTag and Poison)
+ * are encoded as 0 and ignored on decode. DataCheck, when present, is
+ * generated as odd byte parity on encode and ignored on decode.
+ */
+
+/** CHI specification issues with distinct flit layouts. */
+enum FlitIssue
+{
+    FLIT_ISSUE_B = 0,
+    FLIT_ISSUE_C = 1,
+    FLIT_ISSUE_D = 2,
+    FLIT_ISSUE_E = 3
+};
+
+/** Maximum number of 64 bit words in a flit of any supported format. */
+static const unsigned FLIT_MAX_WORDS = 13;
+
+/** Interface parameters which select a flit layout. */
+class FlitFormat
+{
+public:
+    /** Specification issue of the interface. */
+    FlitIssue issue;
+
+    /** Width of NodeID fields: 7 to 11 bits. */
+    unsigned node_id_width;
+
+    /** Width of the REQ Addr field: 44 to 52 bits. */
+    unsigned req_addr_width;
+
+    /** Width of the DAT Data field: 128, 256 or 512 bits. */
+    unsigned data_width;
+
+    /** Width of the REQ and DAT RSVDC fields: 0 to 32 bits. */
+    unsigned req_rsvdc_width;
+    unsigned dat_rsvdc_width;
+
+    /** Include the optional MPAM fields (issue D onwards). */
+    bool mpam;
+
+    /** Include the optional DataCheck and Poison fields. */
+    bool data_check;
+    bool poison;
+
+    explicit FlitFormat(FlitIssue issue_ = FLIT_ISSUE_E,
+            unsigned node_id_width_ = 7, unsigned data_width_ = 128,
+            unsigned req_addr_width_ = 48) :
+        issue(issue_),
+        node_id_width(node_id_width_),
+        req_addr_width(req_addr_width_),
+        data_width(data_width_),
+        req_rsvdc_width(0),
+        dat_rsvdc_width(0),
+        mpam(false),
+        data_check(false),
+        poison(false)
+    {}
+};
+
+/**
+ * Encoder and decoder for one FlitFormat. The field layout of each channel is
+ * computed once on construction so encoding and decoding are straight walks
+ * over a table of (field, offset, width) entries.
+ */
+class FlitCodec
+{
+public:
+    /** Layout entry for one field of a flit. */
+    struct Field
+    {
+        uint16_t id;
+        uint16_t width;
+        uint16_t offset;
+    };
+
+private:
+    FlitFormat format;
+
+    /** Field layouts indexed by Channel. */
+    std::vector<Field> layouts[4];
+
+    /** Flit widths in bits indexed by Channel. */
+    unsigned widths[4];
+
+    void add_field(Channel channel, unsigned id, unsigned width);
+
+public:
+    explicit FlitCodec(const FlitFormat& format_);
+
+    const FlitFormat& get_format() const { return format; }
+
+    /** Width in bits of flits on the given channel. */
+    unsigned get_flit_width(Channel channel) const { return widths[channel]; }
+
+    /** Number of 64 bit words needed to hold flits on the given channel. */
+    unsigned get_flit_words(Channel channel) const
+    {
+        return (widths[channel] + 63) / 64;
+    }
+
+    /** Field layout of the given channel. */
+    const std::vector<Field>& get_layout(Channel channel) const
+    {
+        return layouts[channel];
+    }
+
+    /**
+     * Encode the flit for payload and phase on phase.channel into flit which
+     * must hold at least get_flit_words(phase.channel) words. For DAT flits,
+     * only the data, byte enables and tags of the beat selected by
+     * phase.data_id are encoded.
+     */
+    void encode(const Payload& payload, const Phase& phase,
+        uint64_t* flit) const;
+
+    /**
+     * Decode flit on the given channel into payload and phase. Payload fields
+     * not carried by the channel are left unchanged. For DAT flits, only the
+     * data, byte enables and tags of the beat selected by the DataID field are
+     * written.
+     */
+    void decode(Channel channel, const uint64_t* flit, Payload& payload,
+        Phase& phase) const;
+
+    /**
+     * Decode only the opcode and TxnID of a flit on the given channel into
+     * phase, to find the payload the whole flit belongs to.
+     */
+    void decode_header(Channel channel, const uint64_t* flit,
+        Phase& phase) const;
+};
+
+/** Insert the low width bits of value into a flit at bit offset. */
+inline void flit_insert_bits(uint64_t* flit, unsigned offset, unsigned width,
+    uint64_t value)
+{
+    if (width == 0)
+        return;
+
+    const uint64_t mask = width >= 64 ?
+        ~uint64_t(0) : (uint64_t(1) << width) - 1;
+    const unsigned word = offset / 64;
+    const unsigned shift = offset % 64;
+
+    value &= mask;
+    flit[word] = (flit[word] & ~(mask << shift)) | value << shift;
+    if (shift + width > 64)
+    {
+        const unsigned low_bits = 64 - shift;
+        flit[word + 1] = (flit[word + 1] & ~(mask >> low_bits)) |
+            value >> low_bits;
+    }
+}
+
+/** Extract width bits from a flit at bit offset. */
+inline uint64_t flit_extract_bits(const uint64_t* flit, unsigned offset,
+    unsigned width)
+{
+    if (width == 0)
+        return 0;
+
+    const uint64_t mask = width >= 64 ?
+        ~uint64_t(0) : (uint64_t(1) << width) - 1;
+    const unsigned word = offset / 64;
+    const unsigned shift = offset % 64;
+
+    uint64_t value = flit[word] >> shift;
+    if (shift + width > 64)
+        value |= flit[word + 1] << (64 - shift);
+
+    return value & mask;
+}
+
+}
+}
+
+#endif /* ARM_CHI_FLIT_H */
@@ -0,0 +1,340 @@
+/*
+ * The Clear BSD License
+ *
+ * Copyright (c) 2015-2021 Arm Limited.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *      * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *
+ *      * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *      * Neither the name of the copyright holder nor the names of its
+ *      contributors may be used to endorse or promote products derived from
+ *      this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef ARM_CHI_LINK_H
+#define ARM_CHI_LINK_H
+
+#include <stdint.h>
+#include <cassert>
+#include <stdexcept>
+#include <utility>
+
+#include <ARM/TLM/arm_chi_payload.h>
+#include <ARM/TLM/arm_chi_phase.h>
+#include <ARM/TLM/arm_tlm_ring_buffer.h>
+
+namespace ARM
+{
+namespace CHI
+{
+
+/**
+ * Report a link configuration error. This follows the libraries'
+ * runtime_error_assert behaviour: throw a std::runtime_error unless
+ * ARM_TLM_ERRORS_WITH_ASSERT is defined.
+ */
+inline void link_assert(bool cond, const char* message)
+{
+#ifdef ARM_TLM_ERRORS_WITH_ASSERT
+    assert(cond && message);
+    (void) cond;
+    (void) message;
+#else
+    if (!cond)
+        throw std::runtime_error(message);
+#endif
+}
+
+/** Maximum number of link credits a CHI receiver may issue. */
+static const unsigned LINK_MAX_CREDITS = 15;
+
+/** Maximum number of flits a LinkChannel can move per cycle. */
+static const unsigned LINK_MAX_LANES = 32;
+
+/**
+ * Capacity of each of a LinkChannel's queues, and so the largest credit depth
+ * it supports.
+ */
+static const std::size_t LINK_QUEUE_DEPTH = 64;
+
+/**
+ * A payload and phase travelling over a link, holding a reference to the
+ * payload.
+ */
+struct LinkFlit
+{
+    LinkFlit(Payload& payload_, const Phase& phase_) :
+        payload(payload_),
+        phase(phase_)
+    {}
+
+    LinkFlit(PayloadRef payload_, const Phase& phase_) :
+        payload(std::move(payload_)),
+        phase(phase_)
+    {}
+
+    PayloadRef payload;
+    Phase phase;
+};
+
+/** Parameters of one direction of a link channel. */
+class LinkConfig
+{
+public:
+    /**
+     * Flits, and link credits, that can be sent per cycle. Each is carried in
+     * a lane of the cycle.
+     */
+    unsigned flits_per_cycle;
+
+    /**
+     * Link credits issued to the peer, and so the depth of the receive queue.
+     * The CHI architecture limits this to LINK_MAX_CREDITS but wider emulated
+     * links may use up to LINK_QUEUE_DEPTH.
+     */
+    unsigned credit_depth;
+
+    /**
+     * Credits freed by consuming received flits are held until this many can
+     * be returned together.
+     */
+    unsigned credit_return_batch;
+
+    /**
+     * Steer DAT flits to lanes by the parity of DataID[1], i.e. by which half
+     * of the cache line they carry: the lower half uses even lanes and the
+     * upper half odd lanes. A flit with no lane free this cycle waits, and so
+     * do the flits queued behind it. Needs at least two flits per cycle.
+     */
+    bool lane_parity;
+
+    explicit LinkConfig(unsigned flits_per_cycle_ = 1,
+            unsigned credit_depth_ = LINK_MAX_CREDITS) :
+        flits_per_cycle(flits_per_cycle_),
+        credit_depth(credit_depth_),
+        credit_return_batch(1),
+        lane_parity(false)
+    {}
+};
+
+/**
+ * Credited flow control over one CHI channel between two nodes, as seen from
+ * one of them. A node keeps a LinkChannel per channel, queues flits to send
+ * with push_tx and calls send_flits once per cycle. Flits received through
+ * nb_transport are passed to receive_flit, and the node takes them from the
+ * receive queue with rx_front and pop_rx. Popping a flit frees the credit
+ * it used, so the receive queue never holds more than credit_depth flits.
+ *
+ * send_flits moves up to flits_per_cycle flits and flits_per_cycle credit
+ * returns in one call, so a wide link needs no faster clock.
+ *
+ * Both queues are fixed capacity ring buffers within the LinkChannel. The
+ * transmit queue holds up to LINK_QUEUE_DEPTH flits; producers check tx_space
+ * before queueing and hold back further work while it is full.
+ */
+class LinkChannel
+{
+private:
+    LinkConfig config;
+
+    TLM::RingBuffer<LinkFlit, LINK_QUEUE_DEPTH> tx_queue;
+    TLM::RingBuffer<LinkFlit, LINK_QUEUE_DEPTH> rx_queue;
+
+    /** Link credits issued to us by our peer that we can use. */
+    unsigned tx_credits;
+
+    /** Credits freed to issue to our peer. */
+    unsigned rx_credits_pending;
+
+    /** Returning pending credits, having reached a batch. */
+    bool returning_credits;
+
+    /** Receiving is enabled, and credits have been issued. */
+    bool rx_enabled;
+
+public:
+    explicit LinkChannel(const LinkConfig& config_ = LinkConfig()) :
+        tx_credits(0),
+        rx_credits_pending(0),
+        returning_credits(false),
+        rx_enabled(false)
+    {
+        configure(config_);
+    }
+
+    /**
+     * Change the link parameters. This must be done before receiving is
+     * enabled.
+     */
+    void configure(const LinkConfig& config_)
+    {
+        link_assert(!rx_enabled, "LinkChannel configured after enable_rx");
+        link_assert(config_.flits_per_cycle >= 1 &&
+            config_.flits_per_cycle <= LINK_MAX_LANES,
+            "LinkChannel flits_per_cycle out of range");
+        link_assert(config_.credit_depth >= 1 &&
+            config_.credit_depth <= LINK_QUEUE_DEPTH,
+            "LinkChannel credit_depth out of range");
+        link_assert(config_.credit_return_batch >= 1 &&
+            config_.credit_return_batch <= config_.credit_depth,
+            "LinkChannel credit_return_batch out of range");
+        link_assert(!config_.lane_parity || config_.flits_per_cycle >= 2,
+            "LinkChannel lane_parity needs at least two flits per cycle");
+
+        config = config_;
+    }
+
+    const LinkConfig& get_config() const { return config; }
+
+    /**
+     * Enable receiving on this channel. The full credit_depth of credits is
+     * issued to the peer over the following cycles.
+     */
+    void enable_rx()
+    {
+        configure(config);
+
+        rx_enabled = true;
+        rx_credits_pending = config.credit_depth;
+        returning_credits = true;
+    }
+
+    bool is_rx_enabled() const { return rx_enabled; }
+
+    /** Queue a flit to be sent once a credit is available. */
+    void push_tx(LinkFlit&& flit) { tx_queue.push_back(std::move(flit)); }
+
+    void push_tx(const PayloadRef& payload, const Phase& phase)
+    {
+        tx_queue.emplace_back(payload, phase);
+    }
+
+    bool tx_empty() const { return tx_queue.empty(); }
+    bool tx_full() const { return tx_queue.full(); }
+    std::size_t tx_size() const { return tx_queue.size(); }
+
+    /** Number of flits that can be queued with push_tx. */
+    std::size_t tx_space() const { return LINK_QUEUE_DEPTH - tx_queue.size(); }
+
+    bool rx_empty() const { return rx_queue.empty(); }
+    std::size_t rx_size() const { return rx_queue.size(); }
+
+    /** Oldest received flit. */
+    LinkFlit& rx_front() { return rx_queue.front(); }
+
+    /** Consume the oldest received flit, freeing its credit. */
+    void pop_rx()
+    {
+        rx_queue.pop_front();
+        rx_credits_pending++;
+
+        if (rx_credits_pending >= config.credit_return_batch)
+            returning_credits = true;
+    }
+
+    /**
+     * Take a flit or link credit from the peer. Returns false for a flit on
+     * a channel which is not enabled to receive.
+     */
+    bool receive_flit(Payload& payload, const Phase& phase)
+    {
+        if (phase.lcrd)
+        {
+            tx_credits++;
+            return true;
+        }
+
+        if (!rx_enabled)
+            return false;
+
+        link_assert(rx_queue.size() < config.credit_depth,
+            "LinkChannel flit received without a link credit");
+
+        rx_queue.emplace_back(payload, phase);
+        return true;
+    }
+
+    /**
+     * Send one cycle's worth of credit returns and flits to the peer through
+     * nb_transporter(Payload&, Phase&).
+     */
+    template <typename F>
+    void send_flits(const Channel channel, F nb_transporter)
+    {
+        if (returning_credits)
+        {
+            unsigned credits = rx_credits_pending < config.flits_per_cycle ?
+                rx_credits_pending : config.flits_per_cycle;
+
+            rx_credits_pending -= credits;
+            if (rx_credits_pending == 0)
+                returning_credits = false;
+
+            for (; credits > 0; credits--)
+            {
+                Phase phase;
+
+                phase.channel = channel;
+                phase.lcrd = true;
+
+                nb_transporter(*Payload::get_dummy(), phase);
+            }
+        }
+
+        uint32_t lanes_used = 0;
+
+        for (unsigned sent = 0; sent < config.flits_per_cycle &&
+            !tx_queue.empty() && tx_credits > 0; sent++)
+        {
+            unsigned lane = sent;
+
+            if (config.lane_parity && channel == CHANNEL_DAT)
+            {
+                lane = (tx_queue.front().phase.data_id >> 1) & 1;
+                while (lane < config.flits_per_cycle &&
+                    (lanes_used >> lane & 1))
+                {
+                    lane += 2;
+                }
+
+                if (lane >= config.flits_per_cycle)
+                    break;
+            }
+
+            lanes_used |= uint32_t(1) << lane;
+
+            LinkFlit flit = tx_queue.take_front();
+
+            tx_credits--;
+            nb_transporter(*flit.payload, flit.phase);
+        }
+    }
+};
+
+}
+}
+
+#endif /* ARM_CHI_LINK_H */
@@ -41,13 +41,14 @@
 #include <iostream>
 
 #include <ARM/TLM/arm_tlm_helpers.h>
+#include <ARM/TLM/arm_tlm_payload_pool.h>
 
 namespace ARM
 {
 namespace CHI
 {
 
-#define ARM_CHI_TLM_API_VERSION ARM_CHI_TLM_API_1
+#define ARM_CHI_TLM_API_VERSION ARM_CHI_TLM_API_2
 struct ARM_CHI_TLM_API_VERSION{ARM_CHI_TLM_API_VERSION();};
 static ARM_CHI_TLM_API_VERSION api_version_check;
 
@@ -90,6 +91,21 @@ enum MemAttrBitEnum
     MEM_ATTR_ALLOCATE        = 8
 };
 
+/**
+ * Placement of the cold data/tag block of Payloads. The block can either
+ * trail each Payload object (after any extensions) on its own cache line or be
+ * allocated out-of-line from a separate pool of data blocks. Out-of-line
+ * placement keeps Payload objects themselves compact which suits
+ * systems where most payloads never carry data (e.g. dataless requests),
+ * particularly when those are made with new_dataless_payload so that they
+ * take no data block at all.
+ */
+enum DataPlacement
+{
+    DATA_PLACEMENT_TRAILING    = 0,
+    DATA_PLACEMENT_OUT_OF_LINE = 1
+};
+
 /** CHI DataPull field. */
 enum DataPullEnum
 {
@@ -137,7 +153,7 @@ private:
      * unref is called on a payload with refcount == 1, the payload will be
      * returned to the payload pool.
      */
-    mutable unsigned refcount;
+    mutable TLM::PoolRefCount refcount;
 
 public:
     /**
@@ -155,7 +171,12 @@ public:
      */
     Payload* const parent;
 
-public:
+    /*
+     * Request path ('hot') fields. These are grouped at the start of the
+     * Payload so that they, together with the extension area which directly
+     * follows the Payload object, occupy the leading cache lines of each
+     * allocated payload.
+     */
     uint64_t address;
     Size size;
     MemAttr mem_attr;
@@ -166,6 +187,9 @@ public:
         uint8_t stash_group_id;
         uint8_t tag_group_id;
     };
+    DataPull data_pull;
+    uint8_t data_source;
+    uint8_t tu;
 
     bool exclusive         : 1;
     bool snoop_me          : 1;
@@ -178,23 +202,41 @@ public:
     bool do_not_go_to_sd   : 1;
     bool do_not_data_pull  : 1;
 
+    /**
+     * Debug transport only: write the enabled bytes of data rather than read
+     * the cache line.
+     */
+    bool debug_write       : 1;
+
     uint32_t rsvdc;
-    DataPull data_pull;
-    uint8_t data_source;
     Mpam mpam;
 
-    uint8_t tu;
-    uint8_t tag[4];
-
-    uint8_t data[64];
     uint64_t byte_enable;
 
+    /*
+     * Data ('cold') fields. data points to a cache line of DATA_BYTES bytes of
+     * data and tag to TAG_BYTES bytes of tags. Both live in a separate block
+     * placed according to the DataPlacement selected with set_data_placement.
+     * Both are null for Payloads made with new_dataless_payload and their
+     * descendants.
+     *
+     * NB: data and tag were arrays before the data block was split out, so
+     * sizeof(payload.data) is now the size of a pointer. Use DATA_BYTES and
+     * TAG_BYTES for the sizes of the data and tags.
+     */
+    uint8_t* const data;
+    uint8_t* const tag;
+
+    /** Number of bytes of data and of tags in a Payload's data block. */
+    static const std::size_t DATA_BYTES = 64;
+    static const std::size_t TAG_BYTES = 4;
+
 private:
     /** Create a payload, Called by new_payload. */
-    explicit Payload(uint64_t uid_);
+    explicit Payload(uint64_t uid_, uint8_t* data_block);
 
     /** Create a payload with a parent. Called by descend. */
-    explicit Payload(Payload* parent_, uint64_t uid_);
+    explicit Payload(Payload* parent_, uint64_t uid_, uint8_t* data_block);
 
     /** Forbid copy construction. */
     Payload(const Payload&);
@@ -215,14 +257,40 @@ public:
     /** Decrement reference count. */
     void unref() const;
 
+    /**
+     * Get data to write to. Unlike using data directly this reports an error
+     * for a dataless payload rather than handing out a null pointer.
+     */
+    uint8_t* get_data() const
+    {
+        TLM::pool_assert(data != nullptr, "data written to a dataless payload");
+        return data;
+    }
+
+    /** Get tags to write to, reporting an error for a dataless payload. */
+    uint8_t* get_tag() const
+    {
+        TLM::pool_assert(tag != nullptr, "tags written to a dataless payload");
+        return tag;
+    }
+
     /**
      * Create a new payload without a parent. All data members are reset to 0.
      */
     static Payload* new_payload();
 
+    /**
+     * Create a new payload without a parent or data block, for transactions
+     * which never carry data (e.g. dataless requests). Its data and tag are
+     * null, so no data block is taken or cleared. All other data members are
+     * reset to 0.
+     */
+    static Payload* new_dataless_payload();
+
     /**
      * Create a new payload setting the parent to 'this'. All data members are
-     * copied from the parent.
+     * copied from the parent. A descendant of a dataless payload is also
+     * dataless.
      */
     Payload* descend();
 
@@ -254,11 +322,204 @@ public:
     static std::size_t register_extension(const char* name,
         PayloadExtensionManager* manager);
 
+    /**
+     * Select where the data/tag block of Payloads is placed. This function can
+     * only be called before any Payloads are made in a system.
+     */
+    static void set_data_placement(DataPlacement placement);
+
     /**
      * Print debugging information for the payload pool. Useful for debugging
      * memory problems.
      */
     static void debug_payload_pool(std::ostream& stream);
+
+    /** Get allocation statistics for the payload pool. */
+    static TLM::PoolStatistics get_payload_pool_statistics();
+};
+
+/** Intrusive reference counting handle to a Payload. */
+typedef TLM::PayloadRef<Payload> PayloadRef;
+
+/** Number of bytes in a cache line and so the maximum transaction size. */
+static const unsigned CACHE_LINE_BYTES = 64;
+
+/** Number of bytes of cache line covered by each DataID value. */
+static const unsigned DATA_ID_BYTES = 16;
+
+/**
+ * Calculate a mask of the bytes of the cache line that may be transferred by a
+ * transaction. Device transactions start at the given address rather than the
+ * size aligned address.
+ */
+constexpr uint64_t transaction_valid_bytes_mask(uint64_t address,
+    SizeEnum size, bool device)
+{
+    const uint64_t align_mask = (uint64_t(1) << size) - 1;
+
+    const unsigned first_byte = (device ? address : address & ~align_mask) &
+        (CACHE_LINE_BYTES - 1);
+    const unsigned last_byte = (address & (CACHE_LINE_BYTES - 1)) | align_mask;
+
+    return ~uint64_t(0) >> (63 - last_byte) & ~uint64_t(0) << first_byte;
+}
+
+/**
+ * Calculate a mask of the bytes of the cache line that may be transferred by
+ * payload.
+ */
+inline uint64_t transaction_valid_bytes_mask(const Payload& payload)
+{
+    return transaction_valid_bytes_mask(payload.address, payload.size,
+            (payload.mem_attr & MEM_ATTR_DEVICE) != 0);
+}
+
+/**
+ * Calculate a mask of the bytes of the cache line carried by a data flit with
+ * the given DataID on an interface of the given data width.
+ */
+constexpr uint64_t data_id_byte_mask(unsigned data_id,
+    unsigned data_width_bytes)
+{
+    return (data_width_bytes >= CACHE_LINE_BYTES ? ~uint64_t(0) :
+        (uint64_t(1) << data_width_bytes) - 1) << (data_id * DATA_ID_BYTES);
+}
+
+/**
+ * Offset into the cache line of the data carried by a data flit with the
+ * given DataID.
+ */
+constexpr unsigned data_id_byte_offset(unsigned data_id)
+{
+    return data_id * DATA_ID_BYTES;
+}
+
+/**
+ * Range of DataIDs of the data flits of a transaction. This can be used in a
+ * range based for loop without allocating:
+ *
+ * for (unsigned data_id : transaction_data_ids(payload, data_width_bytes))
+ */
+class DataIdRange
+{
+public:
+    class Iterator
+    {
+    private:
+        unsigned data_id;
+        unsigned increment;
+
+    public:
+        constexpr Iterator(unsigned data_id_, unsigned increment_) :
+            data_id(data_id_),
+            increment(increment_)
+        {}
+
+        constexpr unsigned operator* () const { return data_id; }
+
+        constexpr Iterator& operator++ ()
+        {
+            data_id += increment;
+            return *this;
+        }
+
+        constexpr bool operator== (const Iterator& rhs) const
+        { return data_id == rhs.data_id; }
+        constexpr bool operator!= (const Iterator& rhs) const
+        { return data_id != rhs.data_id; }
+    };
+
+private:
+    unsigned first;
+    unsigned increment;
+    unsigned count;
+
+public:
+    constexpr DataIdRange(unsigned first_, unsigned increment_,
+        unsigned count_) :
+        first(first_),
+        increment(increment_),
+        count(count_)
+    {}
+
+    constexpr Iterator begin() const { return Iterator(first, increment); }
+    constexpr Iterator end() const
+    { return Iterator(first + increment * count, increment); }
+
+    /** Number of data flits in the transaction. */
+    constexpr unsigned size() const { return count; }
+
+    /** DataID of the first data flit. */
+    constexpr unsigned front() const { return first; }
+
+    /** DataID of the last data flit. */
+    constexpr unsigned back() const
+    { return first + increment * (count - 1); }
+};
+
+/**
+ * Generate the DataIDs that will be seen in a transaction on an interface of
+ * the given data width.
+ */
+constexpr DataIdRange transaction_data_ids(uint64_t address, SizeEnum size,
+    unsigned data_width_bytes)
+{
+    const unsigned size_bytes = 1u << size;
+    const uint64_t align_mask = size_bytes - 1;
+
+    const unsigned aligned_offset = address & ~align_mask &
+        (CACHE_LINE_BYTES - 1);
+
+    const unsigned increment = data_width_bytes / DATA_ID_BYTES;
+    const unsigned count = size_bytes <= data_width_bytes ? 1 :
+        size_bytes / data_width_bytes;
+    const unsigned first = (aligned_offset / DATA_ID_BYTES) &
+        ~(increment - 1);
+
+    return DataIdRange(first, increment, count);
+}
+
+/** Generate the DataIDs that will be seen in payload's transaction. */
+inline DataIdRange transaction_data_ids(const Payload& payload,
+    unsigned data_width_bytes)
+{
+    return transaction_data_ids(payload.address, payload.size,
+        data_width_bytes);
+}
+
+/**
+ * Data width specialised forms of the DataID and byte mask helpers for models
+ * with a data width fixed at compile time.
+ */
+template <unsigned DataWidthBits>
+class DataWidth
+{
+public:
+    static_assert(DataWidthBits == 128 || DataWidthBits == 256 ||
+        DataWidthBits == 512, "CHI data width must be 128, 256 or 512 bits");
+
+    static constexpr unsigned bytes() { return DataWidthBits / 8; }
+
+    /** Number of data flits in a transaction of the given size. */
+    static constexpr unsigned beat_count(SizeEnum size)
+    {
+        return (1u << size) <= bytes() ? 1 : (1u << size) / bytes();
+    }
+
+    static constexpr DataIdRange data_ids(uint64_t address, SizeEnum size)
+    {
+        return transaction_data_ids(address, size, bytes());
+    }
+
+    static DataIdRange data_ids(const Payload& payload)
+    {
+        return transaction_data_ids(payload, bytes());
+    }
+
+    static constexpr uint64_t byte_mask(unsigned data_id)
+    {
+        return data_id_byte_mask(data_id, bytes());
+    }
 };
 
 /**
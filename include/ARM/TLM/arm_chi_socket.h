@@ -37,6 +37,9 @@
 #define ARM_CHI_SOCKET_H
 
 #include <ARM/TLM/arm_tlm_socket.h>
+#include <algorithm>
+#include <cstring>
+#include <stdint.h>
 
 #include "arm_chi_payload.h"
 #include "arm_chi_phase.h"
@@ -70,6 +73,36 @@ public:
         TLM::Protocol protocol_, unsigned width_) :
         TLM::SimpleInitiatorSocket <Module, Types>(name_, t, bw, protocol_, width_)
     {}
+
+    SimpleInitiatorSocket(const char* name_, Module& t,
+        typename BaseType::TimedNBFunc bw,
+        TLM::Protocol protocol_, unsigned width_) :
+        TLM::SimpleInitiatorSocket <Module, Types>(name_, t, bw, protocol_, width_)
+    {}
+};
+
+/**
+ * ARM::TLM::StaticInitiatorSocket specialised for CHI payloads/phases. PeerFw
+ * must be accessible where the socket is declared, i.e. a public member of
+ * PeerModule or one PeerModule grants Module friendship to.
+ */
+template <typename Module, typename PeerModule,
+    tlm::tlm_sync_enum (PeerModule::* PeerFw)(Payload&, Phase&)>
+class StaticInitiatorSocket :
+    public ARM::TLM::StaticInitiatorSocket<Module, PeerModule, ProtocolType,
+        PeerFw>
+{
+private:
+    typedef typename ARM::TLM::SimpleInitiatorSocket<Module, ProtocolType>
+        BaseType;
+
+public:
+    StaticInitiatorSocket(const char* name_, Module& t,
+        typename BaseType::NBFunc bw,
+        TLM::Protocol protocol_, unsigned width_) :
+        TLM::StaticInitiatorSocket<Module, PeerModule, ProtocolType, PeerFw>(
+            name_, t, bw, protocol_, width_)
+    {}
 };
 
 /** ARM::TLM::SimpleTargetSocket specialised for CHI payloads/phases. */
@@ -87,6 +120,203 @@ public:
         TLM::SimpleTargetSocket <Module, Types>(name_, t, fw,
             protocol_, width_, dbg)
     {}
+
+    SimpleTargetSocket(const char* name_, Module& t,
+        typename BaseType::TimedNBFunc fw,
+        TLM::Protocol protocol_, unsigned width_,
+        typename BaseType::DebugFunc dbg = nullptr) :
+        TLM::SimpleTargetSocket <Module, Types>(name_, t, fw,
+            protocol_, width_, dbg)
+    {}
+};
+
+/** ARM::TLM::MultiInitiatorSocket specialised for CHI payloads/phases. */
+template <typename Module, typename Types = ProtocolType>
+class MultiInitiatorSocket : public ARM::TLM::MultiInitiatorSocket<Module, Types>
+{
+private:
+    typedef typename ARM::TLM::MultiInitiatorSocket<Module, Types> BaseType;
+
+public:
+    MultiInitiatorSocket(const char* name_, Module& t,
+        typename BaseType::NBFunc bw,
+        TLM::Protocol protocol_, unsigned width_) :
+        TLM::MultiInitiatorSocket <Module, Types>(name_, t, bw, protocol_, width_)
+    {}
+};
+
+/** ARM::TLM::MultiTargetSocket specialised for CHI payloads/phases. */
+template <typename Module, typename Types = ProtocolType>
+class MultiTargetSocket : public ARM::TLM::MultiTargetSocket<Module, Types>
+{
+private:
+    typedef typename ARM::TLM::MultiTargetSocket<Module, Types> BaseType;
+
+public:
+    MultiTargetSocket(const char* name_, Module& t,
+        typename BaseType::NBFunc fw,
+        TLM::Protocol protocol_, unsigned width_,
+        typename BaseType::DebugFunc dbg = nullptr) :
+        TLM::MultiTargetSocket <Module, Types>(name_, t, fw,
+            protocol_, width_, dbg)
+    {}
+};
+
+/**
+ * Debug transport on CHI carries a single cache line. As the request opcode
+ * travels in the Phase rather than the Payload, debug_write selects the
+ * direction: for a read the target fills data with the whole line containing
+ * address, for a write the bytes of data set in byte_enable are written.
+ * Targets return the number of bytes in the line they accessed, or 0 if the
+ * address is not theirs.
+ */
+
+/**
+ * Read length bytes from address using the debug transport of socket (an
+ * initiator socket or any other port providing the fw interface), one cache
+ * line at a time. Returns the number of bytes read.
+ */
+template <typename Socket>
+unsigned debug_read(Socket& socket, uint64_t address, uint8_t* data,
+    unsigned length)
+{
+    unsigned done = 0;
+
+    /* One payload carries every line of the access. */
+    PayloadRef payload(Payload::new_payload(), TLM::ADOPT_REF);
+    payload->size = SIZE_64;
+
+    while (done < length)
+    {
+        const unsigned offset =
+            unsigned(address + done) & (CACHE_LINE_BYTES - 1);
+        const unsigned line_bytes = std::min(length - done,
+            unsigned(CACHE_LINE_BYTES) - offset);
+
+        payload->address = address + done;
+
+        if (socket->transport_dbg(*payload) == 0)
+            break;
+
+        std::memcpy(data + done, payload->data + offset, line_bytes);
+        done += line_bytes;
+    }
+
+    return done;
+}
+
+/**
+ * Write length bytes to address using the debug transport of socket, one
+ * cache line at a time. Returns the number of bytes written.
+ */
+template <typename Socket>
+unsigned debug_write(Socket& socket, uint64_t address, const uint8_t* data,
+    unsigned length)
+{
+    unsigned done = 0;
+
+    PayloadRef payload(Payload::new_payload(), TLM::ADOPT_REF);
+    payload->size = SIZE_64;
+    payload->debug_write = true;
+
+    while (done < length)
+    {
+        const unsigned offset =
+            unsigned(address + done) & (CACHE_LINE_BYTES - 1);
+        const unsigned line_bytes = std::min(length - done,
+            unsigned(CACHE_LINE_BYTES) - offset);
+
+        payload->address = address + done;
+        payload->byte_enable =
+            (~uint64_t(0) >> (CACHE_LINE_BYTES - line_bytes)) << offset;
+        std::memcpy(payload->get_data() + offset, data + done, line_bytes);
+
+        if (socket->transport_dbg(*payload) == 0)
+            break;
+
+        done += line_bytes;
+    }
+
+    return done;
+}
+
+}
+
+namespace TLM
+{
+
+/**
+ * Socket statistics for CHI. Flits are classed by channel, with link credit
+ * returns counted separately. Transactions begin on a request flit and end
+ * on a completion (Comp, CompDBIDResp, CompCMO, CompPersist, CompStashDone,
+ * RetryAck) or the final CompData flit. DAT flits are data beats.
+ */
+template <>
+class SocketStatsPolicy<CHI::ProtocolType>
+{
+public:
+    static const unsigned phase_class_count = 2 * (CHI::CHANNEL_DAT + 1);
+
+    static unsigned phase_class(const CHI::Phase& phase)
+    {
+        return 2 * phase.channel + phase.lcrd;
+    }
+
+    static const char* phase_class_name(unsigned phase_class)
+    {
+        static const char* const names[phase_class_count] = {
+            "REQ", "REQ_LCRD",
+            "SNP", "SNP_LCRD",
+            "RSP", "RSP_LCRD",
+            "DAT", "DAT_LCRD"
+        };
+        return phase_class < phase_class_count ? names[phase_class] : nullptr;
+    }
+
+    static unsigned events(const CHI::Payload& trans, const CHI::Phase& phase,
+        unsigned port_width)
+    {
+        if (phase.lcrd)
+            return STATS_EVENT_NONE;
+
+        switch (phase.channel)
+        {
+        case CHI::CHANNEL_REQ:
+            return phase.req_opcode == CHI::REQ_OPCODE_REQ_LCRD_RETURN ||
+                phase.req_opcode == CHI::REQ_OPCODE_PCRD_RETURN ?
+                STATS_EVENT_NONE : STATS_EVENT_BEGIN;
+        case CHI::CHANNEL_RSP:
+            switch (phase.rsp_opcode)
+            {
+            case CHI::RSP_OPCODE_COMP:
+            case CHI::RSP_OPCODE_COMP_DBID_RESP:
+            case CHI::RSP_OPCODE_COMP_CMO:
+            case CHI::RSP_OPCODE_COMP_PERSIST:
+            case CHI::RSP_OPCODE_COMP_STASH_DONE:
+            case CHI::RSP_OPCODE_RETRY_ACK:
+                return STATS_EVENT_END;
+            default:
+                return STATS_EVENT_NONE;
+            }
+        case CHI::CHANNEL_DAT:
+            if (phase.dat_opcode == CHI::DAT_OPCODE_DAT_LCRD_RETURN)
+                return STATS_EVENT_NONE;
+            if (phase.dat_opcode == CHI::DAT_OPCODE_COMP_DATA &&
+                phase.data_id == CHI::transaction_data_ids(trans,
+                    port_width / 8).back())
+            {
+                return STATS_EVENT_BEAT | STATS_EVENT_END;
+            }
+            return STATS_EVENT_BEAT;
+        default:
+            return STATS_EVENT_NONE;
+        }
+    }
+
+    static unsigned beat_count(const CHI::Payload& trans, unsigned port_width)
+    {
+        return CHI::transaction_data_ids(trans, port_width / 8).size();
+    }
 };
 
 }
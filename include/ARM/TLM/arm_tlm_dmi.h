@@ -0,0 +1,129 @@
+/*
+ * The Clear BSD License
+ *
+ * Copyright (c) 2015-2021 Arm Limited.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *      * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *
+ *      * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *      * Neither the name of the copyright holder nor the names of its
+ *      contributors may be used to endorse or promote products derived from
+ *      this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ARM_TLM_DMI_H
+#define ARM_TLM_DMI_H
+
+#include <tlm.h>
+#include <utility>
+#include <vector>
+
+namespace ARM
+{
+namespace TLM
+{
+
+/**
+ * Cache of DMI regions granted to an initiator. Regions are kept most
+ * recently used first so that repeated accesses to the same region (e.g.
+ * instruction fetch) hit on the first comparison.
+ */
+class DMICache
+{
+protected:
+    std::vector<tlm::tlm_dmi> regions;
+
+    static bool overlaps(const tlm::tlm_dmi& dmi,
+        sc_dt::uint64 start, sc_dt::uint64 end)
+    {
+        return dmi.get_start_address() <= end &&
+            start <= dmi.get_end_address();
+    }
+
+public:
+    /**
+     * Add a newly granted region. Any cached regions it overlaps are
+     * discarded as the target's latest grant supersedes them.
+     */
+    void insert(const tlm::tlm_dmi& dmi)
+    {
+        invalidate(dmi.get_start_address(), dmi.get_end_address());
+        regions.insert(regions.begin(), dmi);
+    }
+
+    /**
+     * Find a region covering all of [address, address + length) with at
+     * least 'access' permissions. Returns nullptr if there is none.
+     */
+    const tlm::tlm_dmi* find(sc_dt::uint64 address, unsigned length,
+        tlm::tlm_dmi::dmi_access_e access)
+    {
+        if (length == 0)
+            return nullptr;
+
+        const sc_dt::uint64 last = address + length - 1;
+
+        for (std::size_t i = 0; i < regions.size(); i++)
+        {
+            const tlm::tlm_dmi& dmi = regions[i];
+
+            if (dmi.get_start_address() <= address &&
+                last <= dmi.get_end_address() &&
+                (dmi.get_granted_access() & access) == access)
+            {
+                if (i != 0)
+                    std::swap(regions[0], regions[i]);
+                return &regions[0];
+            }
+        }
+
+        return nullptr;
+    }
+
+    /** Remove all regions overlapping [start, end] (inclusive). */
+    void invalidate(sc_dt::uint64 start, sc_dt::uint64 end)
+    {
+        std::size_t kept = 0;
+
+        for (std::size_t i = 0; i < regions.size(); i++)
+        {
+            if (!overlaps(regions[i], start, end))
+                regions[kept++] = regions[i];
+        }
+
+        regions.resize(kept);
+    }
+
+    /** Remove all regions. */
+    void clear() { regions.clear(); }
+
+    /** Is the cache empty? */
+    bool empty() const { return regions.empty(); }
+};
+
+}
+}
+
+#endif /* ARM_TLM_DMI_H */
@@ -154,6 +154,114 @@ public:
     BitEnumWrapper mask(BitEnum rhs) { return value & rhs; }
 };
 
+/** Tag selecting PayloadRef's adoption constructor. */
+enum AdoptRefEnum
+{
+    ADOPT_REF
+};
+
+/**
+ * Intrusive reference counting handle to a Payload type with ref() and unref()
+ * members. Copying a PayloadRef takes a new reference; moving a PayloadRef
+ * transfers its reference without touching the Payload's reference count.
+ *
+ * A PayloadRef constructed from a raw pointer takes a new reference to the
+ * Payload. Payloads freshly made by new_payload, clone or descend already
+ * carry a reference for their creator which can be adopted with:
+ *
+ * PayloadRef ref(Payload::new_payload(...), ADOPT_REF);
+ *
+ * Moves are noexcept so that containers of PayloadRefs move rather than copy
+ * them when they grow.
+ */
+template <typename PayloadType>
+class PayloadRef
+{
+private:
+    PayloadType* payload;
+
+public:
+    /** Null reference. */
+    PayloadRef() noexcept : payload(nullptr) {}
+
+    /** Take a new reference to payload_. */
+    explicit PayloadRef(PayloadType* payload_) : payload(payload_)
+    {
+        if (payload)
+            payload->ref();
+    }
+
+    /** Take a new reference to payload_. */
+    explicit PayloadRef(PayloadType& payload_) : payload(&payload_)
+    {
+        payload->ref();
+    }
+
+    /** Adopt a reference already held by the caller. */
+    PayloadRef(PayloadType* payload_, AdoptRefEnum) : payload(payload_) {}
+
+    PayloadRef(const PayloadRef& other) : payload(other.payload)
+    {
+        if (payload)
+            payload->ref();
+    }
+
+    PayloadRef(PayloadRef&& other) noexcept : payload(other.payload)
+    {
+        other.payload = nullptr;
+    }
+
+    ~PayloadRef()
+    {
+        if (payload)
+            payload->unref();
+    }
+
+    PayloadRef& operator= (const PayloadRef& other)
+    {
+        PayloadRef(other).swap(*this);
+        return *this;
+    }
+
+    PayloadRef& operator= (PayloadRef&& other) noexcept
+    {
+        PayloadRef(static_cast<PayloadRef&&>(other)).swap(*this);
+        return *this;
+    }
+
+    void swap(PayloadRef& other) noexcept
+    {
+        PayloadType* tmp = payload;
+        payload = other.payload;
+        other.payload = tmp;
+    }
+
+    /** Drop the held reference, leaving a null reference. */
+    void reset() { PayloadRef().swap(*this); }
+
+    /**
+     * Give up ownership of the held reference without unref-ing the Payload.
+     * The caller becomes responsible for the reference.
+     */
+    PayloadType* release() noexcept
+    {
+        PayloadType* released = payload;
+        payload = nullptr;
+        return released;
+    }
+
+    PayloadType* get() const { return payload; }
+    PayloadType& operator* () const { return *payload; }
+    PayloadType* operator-> () const { return payload; }
+
+    explicit operator bool () const { return payload != nullptr; }
+
+    bool operator== (const PayloadRef& rhs) const
+    { return payload == rhs.payload; }
+    bool operator!= (const PayloadRef& rhs) const
+    { return payload != rhs.payload; }
+};
+
 }
 }
 
@@ -0,0 +1,656 @@
+/*
+ * The Clear BSD License
+ *
+ * Copyright (c) 2015-2021 Arm Limited.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *      * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *
+ *      * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *      * Neither the name of the copyright holder nor the names of its
+ *      contributors may be used to endorse or promote products derived from
+ *      this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ARM_TLM_MEMORY_H
+#define ARM_TLM_MEMORY_H
+
+#include <stdint.h>
+#include <cassert>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ARM_TLM_MEMORY_MMAP
+#endif
+
+namespace ARM
+{
+namespace TLM
+{
+
+/**
+ * Report a memory configuration error. This follows the libraries'
+ * runtime_error_assert behaviour: throw a std::runtime_error unless
+ * ARM_TLM_ERRORS_WITH_ASSERT is defined.
+ */
+inline void memory_assert(bool cond, const char* message)
+{
+#ifdef ARM_TLM_ERRORS_WITH_ASSERT
+    assert(cond && message);
+    (void) cond;
+    (void) message;
+#else
+    if (!cond)
+    {
+        std::ostringstream stream;
+        stream << "Sparse memory error: " << message;
+        throw std::runtime_error(stream.str());
+    }
+#endif
+}
+
+/**
+ * Sparse backing store covering the whole 64-bit address space. Pages are
+ * allocated the first time they are written (or their address is taken) and
+ * are filled with a fill pattern, so untouched memory reads as the pattern
+ * without costing anything.
+ *
+ * Pages are found through a multi-level page table of fixed depth, fronted by
+ * a direct-mapped translation cache so that the hot read/write paths usually
+ * resolve a page with a single comparison. Pages never move once allocated,
+ * so pointers to them (e.g. for DMI) stay valid until the store is cleared.
+ *
+ * With huge page backing, pages are carved out of huge page aligned blocks
+ * which (on Linux) are advised to be backed by transparent huge pages. This
+ * trades memory granularity for fewer TLB misses in the host.
+ *
+ * Ranges of the address space can be backed by memory-mapped image files:
+ * privately (copy-on-write, so the image file is never modified) or shared
+ * (writes persist to the file). Mapping is immediate whatever the image size
+ * as the host only reads in the parts of the file which are touched.
+ *
+ * A snapshot saves every page which differs from its initial contents: all
+ * allocated pages and the written pages of private file regions. A page
+ * counts as written once it has been installed in the page table, which
+ * happens on its first write access. Shared file regions persist by
+ * themselves so are not included.
+ */
+class SparseMemory
+{
+protected:
+    /** Bits of page number resolved by each level of the page table. */
+    static const unsigned LEVEL_BITS = 9;
+    static const unsigned LEVEL_ENTRIES = 1u << LEVEL_BITS;
+
+    /** Entries in the direct-mapped translation cache. */
+    static const unsigned TLB_ENTRIES = 64;
+
+    /** Block size used for huge page backing. */
+    static const std::size_t HUGE_PAGE_SIZE = std::size_t(2) << 20;
+
+    struct TLBEntry
+    {
+        uint64_t page_number;
+        uint8_t* page;
+
+        /* The page is installed in the page table so may be written. */
+        bool installed;
+    };
+
+    /** A file mapped into the address space. */
+    struct Region
+    {
+        uint64_t start;
+        uint64_t end;
+        uint8_t* data;
+        int fd;
+        bool shared;
+    };
+
+    /** Snapshot file header, followed by (address, page data) records. */
+    struct SnapshotHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t page_shift;
+    };
+
+    const unsigned page_shift;
+    const std::size_t page_size;
+
+    /** Levels of page table needed to resolve a whole page number. */
+    const unsigned levels;
+
+    const uint8_t fill;
+    const bool huge_pages;
+
+    void** root;
+
+    /** Translation cache. */
+    TLBEntry tlb[TLB_ENTRIES];
+
+    /** Blocks of page storage, and the unused tail of the latest block. */
+    std::vector<void*> blocks;
+    uint8_t* block_free;
+    std::size_t block_remaining;
+
+    std::size_t page_count;
+
+    std::vector<Region> regions;
+
+    static const char* snapshot_magic() { return "ARMTLMSM"; }
+
+    static unsigned log2_page_size(std::size_t size)
+    {
+        unsigned shift = 0;
+        while ((std::size_t(1) << shift) < size)
+            shift++;
+
+        memory_assert((std::size_t(1) << shift) == size && shift >= 6 &&
+            shift < 32, "page size must be a power of two from 64 bytes");
+        return shift;
+    }
+
+    static void** new_node()
+    {
+        void** node = static_cast<void**>(
+            std::calloc(LEVEL_ENTRIES, sizeof(void*)));
+        if (!node)
+            throw std::bad_alloc();
+        return node;
+    }
+
+    void delete_node(void** node, unsigned level)
+    {
+        if (level + 1 < levels)
+        {
+            for (unsigned i = 0; i < LEVEL_ENTRIES; i++)
+            {
+                if (node[i])
+                    delete_node(static_cast<void**>(node[i]), level + 1);
+            }
+        }
+
+        std::free(node);
+    }
+
+    void* new_block(std::size_t size)
+    {
+#if defined(__linux__)
+        if (huge_pages)
+        {
+            void* block;
+            if (posix_memalign(&block, HUGE_PAGE_SIZE, size) != 0)
+                throw std::bad_alloc();
+
+            madvise(block, size, MADV_HUGEPAGE);
+            return block;
+        }
+#endif
+        void* block = std::malloc(size);
+        if (!block)
+            throw std::bad_alloc();
+        return block;
+    }
+
+    uint8_t* new_page()
+    {
+        if (block_remaining < page_size)
+        {
+            std::size_t block_size = page_size;
+            if (huge_pages && block_size < HUGE_PAGE_SIZE)
+                block_size = HUGE_PAGE_SIZE;
+
+            blocks.push_back(new_block(block_size));
+            block_free = static_cast<uint8_t*>(blocks.back());
+            block_remaining = block_size;
+        }
+
+        uint8_t* page = block_free;
+        block_free += page_size;
+        block_remaining -= page_size;
+
+        std::memset(page, fill, page_size);
+        page_count++;
+
+        return page;
+    }
+
+    unsigned level_index(uint64_t page_number, unsigned level) const
+    {
+        return static_cast<unsigned>(
+            (page_number >> ((levels - 1 - level) * LEVEL_BITS)) &
+            (LEVEL_ENTRIES - 1));
+    }
+
+    /** Page of a file region backing the page number, if any. */
+    uint8_t* find_region_page(uint64_t page_number,
+        bool shared_only = false) const
+    {
+        const uint64_t address = page_number << page_shift;
+
+        for (std::size_t i = 0; i < regions.size(); i++)
+        {
+            const Region& region = regions[i];
+            if (region.start <= address && address < region.end &&
+                (region.shared || !shared_only))
+            {
+                return region.data + (address - region.start);
+            }
+        }
+
+        return nullptr;
+    }
+
+    /**
+     * Walk the page table. A write installs the page, allocating missing
+     * levels and (unless a file region backs it) the page itself. 'installed'
+     * is set if the returned page is installed.
+     */
+    uint8_t* walk(uint64_t page_number, bool write, bool& installed)
+    {
+        void** node = root;
+        installed = false;
+
+        for (unsigned level = 0; level + 1 < levels; level++)
+        {
+            void*& next = node[level_index(page_number, level)];
+            if (!next)
+            {
+                if (!write)
+                    return find_region_page(page_number);
+                next = new_node();
+            }
+
+            node = static_cast<void**>(next);
+        }
+
+        void*& page = node[level_index(page_number, levels - 1)];
+        if (!page)
+        {
+            uint8_t* region_page = find_region_page(page_number);
+            if (!write)
+                return region_page;
+
+            page = region_page ? region_page : new_page();
+        }
+
+        installed = true;
+        return static_cast<uint8_t*>(page);
+    }
+
+    /** Find a page through the translation cache. */
+    uint8_t* lookup(uint64_t address, bool write)
+    {
+        const uint64_t page_number = address >> page_shift;
+        TLBEntry& entry = tlb[page_number % TLB_ENTRIES];
+
+        if (entry.page && entry.page_number == page_number &&
+            (entry.installed || !write))
+        {
+            return entry.page;
+        }
+
+        bool installed;
+        uint8_t* page = walk(page_number, write, installed);
+        if (page)
+        {
+            entry.page_number = page_number;
+            entry.page = page;
+            entry.installed = installed;
+        }
+
+        return page;
+    }
+
+    /** Write out the installed pages below a page table node. */
+    bool save_node(std::FILE* file, void** node, unsigned level,
+        uint64_t page_number) const
+    {
+        for (unsigned i = 0; i < LEVEL_ENTRIES; i++)
+        {
+            if (!node[i])
+                continue;
+
+            const uint64_t number = (page_number << LEVEL_BITS) | i;
+
+            if (level + 1 < levels)
+            {
+                if (!save_node(file, static_cast<void**>(node[i]), level + 1,
+                    number))
+                {
+                    return false;
+                }
+            }
+            else if (!find_region_page(number, true))
+            {
+                const uint64_t address = number << page_shift;
+
+                if (std::fwrite(&address, sizeof(address), 1, file) != 1 ||
+                    std::fwrite(node[i], 1, page_size, file) != page_size)
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+private:
+    /** Forbid copying: pages are owned by the store. */
+    SparseMemory(const SparseMemory&);
+    SparseMemory& operator= (const SparseMemory&);
+
+public:
+    /**
+     * Make an empty store. 'page_size' is a power of two of at least 64 bytes
+     * and untouched memory reads as 'fill'.
+     */
+    explicit SparseMemory(std::size_t page_size_ = 4096, uint8_t fill_ = 0,
+        bool huge_pages_ = false) :
+        page_shift(log2_page_size(page_size_)),
+        page_size(page_size_),
+        levels((64 - page_shift + LEVEL_BITS - 1) / LEVEL_BITS),
+        fill(fill_),
+        huge_pages(huge_pages_),
+        root(new_node()),
+        block_free(nullptr),
+        block_remaining(0),
+        page_count(0)
+    {
+        std::memset(tlb, 0, sizeof(tlb));
+    }
+
+    ~SparseMemory()
+    {
+        delete_node(root, 0);
+
+        for (std::size_t i = 0; i < blocks.size(); i++)
+            std::free(blocks[i]);
+
+#ifdef ARM_TLM_MEMORY_MMAP
+        for (std::size_t i = 0; i < regions.size(); i++)
+        {
+            munmap(regions[i].data, regions[i].end - regions[i].start);
+            close(regions[i].fd);
+        }
+#endif
+    }
+
+    std::size_t get_page_size() const { return page_size; }
+
+    /** Number of pages allocated so far (excluding file region pages). */
+    std::size_t get_page_count() const { return page_count; }
+
+    /** Address of the first byte of the page containing 'address'. */
+    uint64_t get_page_base(uint64_t address) const
+    {
+        return address & ~static_cast<uint64_t>(page_size - 1);
+    }
+
+    /**
+     * Get the page containing 'address' for writing, installing (and if need
+     * be allocating) it.
+     */
+    uint8_t* get_page(uint64_t address)
+    {
+        return lookup(address, true);
+    }
+
+    /**
+     * Get the page containing 'address' for reading if it is allocated or
+     * file-backed, otherwise nullptr.
+     */
+    const uint8_t* find_page(uint64_t address) const
+    {
+        /* Only the translation cache is updated, which is not observable. */
+        return const_cast<SparseMemory*>(this)->lookup(address, false);
+    }
+
+    /**
+     * Get a pointer to [address, address + length) for writing if it lies
+     * within one page (installing the page), otherwise nullptr.
+     */
+    uint8_t* get_span(uint64_t address, std::size_t length)
+    {
+        const std::size_t offset = address & (page_size - 1);
+        if (offset + length > page_size)
+            return nullptr;
+
+        return get_page(address) + offset;
+    }
+
+    /**
+     * Get a pointer to [address, address + length) for reading if it lies
+     * within one allocated or file-backed page, otherwise nullptr.
+     */
+    const uint8_t* find_span(uint64_t address, std::size_t length) const
+    {
+        const std::size_t offset = address & (page_size - 1);
+        if (offset + length > page_size)
+            return nullptr;
+
+        const uint8_t* page = find_page(address);
+        return page ? page + offset : nullptr;
+    }
+
+    /** Copy out 'length' bytes from 'address'. Untouched bytes read as fill. */
+    void read(uint64_t address, uint8_t* data, std::size_t length) const
+    {
+        while (length != 0)
+        {
+            const std::size_t offset = address & (page_size - 1);
+            std::size_t chunk = page_size - offset;
+            if (chunk > length)
+                chunk = length;
+
+            const uint8_t* page = find_page(address);
+            if (page)
+                std::memcpy(data, page + offset, chunk);
+            else
+                std::memset(data, fill, chunk);
+
+            address += chunk;
+            data += chunk;
+            length -= chunk;
+        }
+    }
+
+    /** Copy in 'length' bytes to 'address'. */
+    void write(uint64_t address, const uint8_t* data, std::size_t length)
+    {
+        while (length != 0)
+        {
+            const std::size_t offset = address & (page_size - 1);
+            std::size_t chunk = page_size - offset;
+            if (chunk > length)
+                chunk = length;
+
+            std::memcpy(get_page(address) + offset, data, chunk);
+
+            address += chunk;
+            data += chunk;
+            length -= chunk;
+        }
+    }
+
+    /**
+     * Return the store to its initial state: allocated pages are freed and
+     * private file regions lose their modifications. Pointers to allocated
+     * pages are invalid afterwards.
+     */
+    void clear()
+    {
+        delete_node(root, 0);
+        root = new_node();
+
+        for (std::size_t i = 0; i < blocks.size(); i++)
+            std::free(blocks[i]);
+
+        blocks.clear();
+        block_free = nullptr;
+        block_remaining = 0;
+        page_count = 0;
+
+        std::memset(tlb, 0, sizeof(tlb));
+
+#ifdef ARM_TLM_MEMORY_MMAP
+        /* Mapping the file again in place drops the copy-on-write pages. */
+        for (std::size_t i = 0; i < regions.size(); i++)
+        {
+            const Region& region = regions[i];
+            if (region.shared)
+                continue;
+
+            void* data = mmap(region.data, region.end - region.start,
+                PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, region.fd, 0);
+            memory_assert(data == region.data, "cannot remap file region");
+        }
+#endif
+    }
+
+    /**
+     * Back [address, address + file size) with the contents of the file at
+     * 'path'. 'address' must be page aligned and the file a whole number of
+     * pages long. A private mapping leaves the file untouched; a shared one
+     * writes changes through to it. Map files before accessing their range:
+     * pages already installed there take precedence. Returns false if the
+     * file cannot be mapped.
+     */
+    bool map_file(uint64_t address, const char* path, bool shared = false)
+    {
+        memory_assert((address & (page_size - 1)) == 0,
+            "file regions must start on a page boundary");
+
+#ifdef ARM_TLM_MEMORY_MMAP
+        int fd = open(path, shared ? O_RDWR : O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat status;
+        if (fstat(fd, &status) != 0 || status.st_size <= 0 ||
+            (static_cast<uint64_t>(status.st_size) & (page_size - 1)) != 0)
+        {
+            close(fd);
+            return false;
+        }
+
+        const uint64_t length = static_cast<uint64_t>(status.st_size);
+        for (std::size_t i = 0; i < regions.size(); i++)
+        {
+            memory_assert(address + length <= regions[i].start ||
+                regions[i].end <= address, "file regions must not overlap");
+        }
+
+        void* data = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+            shared ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            close(fd);
+            return false;
+        }
+
+        Region region = { address, address + length,
+            static_cast<uint8_t*>(data), fd, shared };
+        regions.push_back(region);
+
+        return true;
+#else
+        (void) path;
+        (void) shared;
+        return false;
+#endif
+    }
+
+    /**
+     * Save every page differing from its initial contents to the file at
+     * 'path' (in host byte order). Returns false on an I/O error.
+     */
+    bool save_snapshot(const char* path) const
+    {
+        std::FILE* file = std::fopen(path, "wb");
+        if (!file)
+            return false;
+
+        SnapshotHeader header;
+        std::memcpy(header.magic, snapshot_magic(), sizeof(header.magic));
+        header.version = 1;
+        header.page_shift = page_shift;
+
+        bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+            save_node(file, root, 0, 0);
+
+        return std::fclose(file) == 0 && ok;
+    }
+
+    /**
+     * Clear the store and restore a snapshot saved from a store with the same
+     * page size and file regions. Returns false if the file cannot be read or
+     * is not a matching snapshot, in which case the store may be partially
+     * restored.
+     */
+    bool restore_snapshot(const char* path)
+    {
+        std::FILE* file = std::fopen(path, "rb");
+        if (!file)
+            return false;
+
+        SnapshotHeader header;
+        if (std::fread(&header, sizeof(header), 1, file) != 1 ||
+            std::memcmp(header.magic, snapshot_magic(),
+                sizeof(header.magic)) != 0 ||
+            header.version != 1 || header.page_shift != page_shift)
+        {
+            std::fclose(file);
+            return false;
+        }
+
+        clear();
+
+        bool ok = true;
+        uint64_t address;
+        while (ok && std::fread(&address, sizeof(address), 1, file) == 1)
+            ok = std::fread(get_page(address), 1, page_size, file) == page_size;
+
+        std::fclose(file);
+        return ok;
+    }
+};
+
+}
+}
+
+#endif /* ARM_TLM_MEMORY_H */
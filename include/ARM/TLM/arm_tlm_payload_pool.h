@@ -0,0 +1,714 @@
+/*
+ * The Clear BSD License
+ *
+ * Copyright (c) 2015-2021 Arm Limited.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *      * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *
+ *      * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *      * Neither the name of the copyright holder nor the names of its
+ *      contributors may be used to endorse or promote products derived from
+ *      this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ARM_TLM_PAYLOAD_POOL_H
+#define ARM_TLM_PAYLOAD_POOL_H
+
+#include <stdint.h>
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef ARM_TLM_THREAD_SAFE
+#include <atomic>
+#include <mutex>
+#endif
+
+#ifdef ARM_TLM_ENABLE_VALGRIND
+#include <valgrind/memcheck.h>
+#endif
+
+namespace ARM
+{
+namespace TLM
+{
+
+/**
+ * Pool core shared by the AXI4 and CHI payload libraries. The pieces here are
+ * protocol independent: ObjectPool manages fixed size objects carved from
+ * cache line aligned arenas, ExtensionTable manages the layout of extensions
+ * appended to Payload objects and PayloadPoolCore combines the two with
+ * unique ID issue for a protocol's Payload type.
+ *
+ * The allocation debug modes are selected by the ARM_TLM_DEBUG_ALLOC
+ * environment variable:
+ *
+ * UNIQUE      - Objects are never recycled so each new object has a unique
+ *               address.
+ * ALWAYS_FREE - Objects are individually heap allocated and freed when
+ *               returned to the pool. Useful with Valgrind or address
+ *               sanitizers.
+ *
+ * Pools and Payload reference counts are not thread safe unless the
+ * libraries are built with the ARM_TLM_THREAD_SAFE option, which defines
+ * ARM_TLM_THREAD_SAFE for them and their users. Pools are then locked and
+ * reference counts are atomic, so Payloads may be created, shared and
+ * released by threads other than the SystemC kernel's.
+ */
+
+/** Cache line size used to align pool arenas and pooled objects. */
+static const std::size_t POOL_CACHE_LINE_BYTES = 64;
+
+#ifdef ARM_TLM_THREAD_SAFE
+/** Payload reference count. */
+typedef std::atomic<unsigned> PoolRefCount;
+
+/** Counter for unique IDs. */
+typedef std::atomic<uint64_t> PoolCounter;
+
+/** Flag set once by one thread and read by any. */
+typedef std::atomic<bool> PoolFlag;
+
+/** Lock protecting a pool's free list and statistics. */
+typedef std::mutex PoolMutex;
+typedef std::lock_guard<std::mutex> PoolLock;
+#else
+typedef unsigned PoolRefCount;
+typedef uint64_t PoolCounter;
+typedef bool PoolFlag;
+
+/** Single threaded builds don't lock pools. */
+class PoolMutex {};
+
+class PoolLock
+{
+public:
+    explicit PoolLock(PoolMutex&) {}
+};
+#endif
+
+/** Round size up to a whole number of cache lines. */
+inline std::size_t pool_cache_line_round_up(std::size_t size)
+{
+    return (size + POOL_CACHE_LINE_BYTES - 1) & ~(POOL_CACHE_LINE_BYTES - 1);
+}
+
+/**
+ * Report a pool usage error. This follows the libraries' runtime_error_assert
+ * behaviour: throw a std::runtime_error unless ARM_TLM_ERRORS_WITH_ASSERT is
+ * defined.
+ */
+inline void pool_assert(bool cond, const char* message)
+{
+#ifdef ARM_TLM_ERRORS_WITH_ASSERT
+    assert(cond && message);
+    (void) cond;
+    (void) message;
+#else
+    if (!cond)
+    {
+        std::ostringstream stream;
+        stream << "Payload pool error: " << message;
+        throw std::runtime_error(stream.str());
+    }
+#endif
+}
+
+/**
+ * Functions through which pools get and return their memory. They may be
+ * changed to route allocations elsewhere, but only before the first
+ * allocation.
+ */
+class PoolAllocator
+{
+public:
+    void* (*local_malloc)(size_t size);
+    void (*local_free)(void* ptr);
+
+    PoolAllocator() :
+        local_malloc(std::malloc),
+        local_free(std::free)
+    {}
+};
+
+/**
+ * Allocate cache line aligned memory with allocator. The offset from the raw
+ * allocation is stored in the byte before the returned pointer.
+ */
+inline void* pool_aligned_malloc(const PoolAllocator& allocator,
+    std::size_t size)
+{
+    char* raw = reinterpret_cast<char*>(
+        allocator.local_malloc(size + POOL_CACHE_LINE_BYTES));
+    if (!raw)
+        throw std::bad_alloc();
+
+    std::size_t offset = POOL_CACHE_LINE_BYTES -
+        (reinterpret_cast<uintptr_t>(raw) & (POOL_CACHE_LINE_BYTES - 1));
+    char* aligned = raw + offset;
+
+    aligned[-1] = static_cast<char>(offset);
+    return aligned;
+}
+
+/** Free memory allocated with pool_aligned_malloc. */
+inline void pool_aligned_free(const PoolAllocator& allocator, void* ptr)
+{
+    char* aligned = reinterpret_cast<char*>(ptr);
+    allocator.local_free(aligned - static_cast<unsigned char>(aligned[-1]));
+}
+
+/** Allocation debug modes. See ARM_TLM_DEBUG_ALLOC above. */
+enum PoolDebugMode
+{
+    POOL_DEBUG_NONE        = 0,
+    POOL_DEBUG_UNIQUE      = 1,
+    POOL_DEBUG_ALWAYS_FREE = 2
+};
+
+/** Read the allocation debug mode from ARM_TLM_DEBUG_ALLOC. */
+inline PoolDebugMode pool_debug_mode_from_env()
+{
+    const char* env_val = std::getenv("ARM_TLM_DEBUG_ALLOC");
+
+    if (env_val)
+    {
+        if (std::string(env_val) == "UNIQUE")
+            return POOL_DEBUG_UNIQUE;
+        if (std::string(env_val) == "ALWAYS_FREE")
+            return POOL_DEBUG_ALWAYS_FREE;
+    }
+    return POOL_DEBUG_NONE;
+}
+
+/** Statistics gathered by an ObjectPool. */
+struct PoolStatistics
+{
+    /** Number of objects allocated from arenas or the heap in existence. */
+    std::size_t allocated;
+
+    /** Number of objects on the free list. */
+    std::size_t free_objects;
+
+    /**
+     * Number of objects currently handed out. This is allocated - free except
+     * in POOL_DEBUG_UNIQUE mode, where released objects are not freed.
+     */
+    std::size_t in_use;
+
+    /** Largest value in_use has reached. */
+    std::size_t peak_in_use;
+
+    /** Bytes of arena memory reserved. */
+    std::size_t arena_bytes;
+
+    /** Number of objects requested from the pool. */
+    uint64_t requests;
+
+    /** Number of requests satisfied from the free list. */
+    uint64_t recycled;
+
+    PoolStatistics() :
+        allocated(0),
+        free_objects(0),
+        in_use(0),
+        peak_in_use(0),
+        arena_bytes(0),
+        requests(0),
+        recycled(0)
+    {}
+};
+
+/**
+ * Pool of fixed size objects. Objects are carved from cache line aligned
+ * arenas which grow geometrically and are recycled through a LIFO free list.
+ * The object size may be changed until the first object is allocated after
+ * which it is fixed.
+ *
+ * ObjectPool deals only in raw memory: objects must be placement constructed
+ * by the caller after allocate() and destructed before release(). Arenas,
+ * and objects in POOL_DEBUG_ALWAYS_FREE mode, are allocated through the
+ * PoolAllocator given on construction, which must outlive the pool.
+ */
+class ObjectPool
+{
+private:
+    /** Source of arena memory. */
+    const PoolAllocator& allocator;
+
+    /** Size of each object including padding to a cache line multiple. */
+    std::size_t stride;
+
+    /** Set to true once the first object is allocated. */
+    bool fixed;
+
+    PoolDebugMode debug_mode;
+
+    /** LIFO free list of released objects. */
+    std::vector<void*> free_list;
+
+    /** All arenas allocated by this pool. */
+    std::vector<void*> arenas;
+
+    /** Unused part of the current arena. */
+    char* arena_next;
+    char* arena_end;
+
+    /** Number of objects in the next arena to be allocated. */
+    std::size_t next_arena_objects;
+
+    PoolStatistics stats;
+
+    /** Lock for all of the above once the pool is in use. */
+    mutable PoolMutex mutex;
+
+    /** Arena sizes grow from min to max objects. */
+    static const std::size_t MIN_ARENA_OBJECTS = 16;
+    static const std::size_t MAX_ARENA_OBJECTS = 4096;
+
+    /** Take a new object from the current arena, growing if necessary. */
+    void* carve()
+    {
+        if (arena_next == arena_end)
+        {
+            std::size_t arena_size = next_arena_objects * stride;
+
+            arena_next = reinterpret_cast<char*>(
+                pool_aligned_malloc(allocator, arena_size));
+            arena_end = arena_next + arena_size;
+            arenas.push_back(arena_next);
+            stats.arena_bytes += arena_size;
+
+            if (next_arena_objects < MAX_ARENA_OBJECTS)
+                next_arena_objects *= 2;
+        }
+
+        void* object = arena_next;
+        arena_next += stride;
+        return object;
+    }
+
+    /* Pools own their arenas and so can't be copied. */
+    ObjectPool(const ObjectPool&);
+    ObjectPool& operator= (const ObjectPool&);
+
+public:
+    ObjectPool(const PoolAllocator& allocator_, std::size_t size,
+        PoolDebugMode debug_mode_ = POOL_DEBUG_NONE) :
+        allocator(allocator_),
+        stride(pool_cache_line_round_up(size)),
+        fixed(false),
+        debug_mode(debug_mode_),
+        arena_next(nullptr),
+        arena_end(nullptr),
+        next_arena_objects(MIN_ARENA_OBJECTS)
+    {}
+
+    ~ObjectPool()
+    {
+        for (std::size_t i = 0; i < arenas.size(); i++)
+            pool_aligned_free(allocator, arenas[i]);
+    }
+
+    /** Change the object size. Only valid before the first allocation. */
+    void set_size(std::size_t size)
+    {
+        pool_assert(!fixed, "object size changed after first allocation");
+        stride = pool_cache_line_round_up(size);
+    }
+
+    /** Change the debug mode. Only valid before the first allocation. */
+    void set_debug_mode(PoolDebugMode debug_mode_)
+    {
+        pool_assert(!fixed, "debug mode changed after first allocation");
+        debug_mode = debug_mode_;
+    }
+
+    std::size_t get_size() const { return stride; }
+
+    /** Get uninitialised memory for one object. */
+    void* allocate()
+    {
+        void* object;
+        PoolLock lock(mutex);
+
+        stats.requests++;
+        if (free_list.empty())
+        {
+            fixed = true;
+            if (debug_mode == POOL_DEBUG_ALWAYS_FREE)
+                object = pool_aligned_malloc(allocator, stride);
+            else
+                object = carve();
+            stats.allocated++;
+        } else
+        {
+            object = free_list.back();
+            free_list.pop_back();
+            stats.recycled++;
+        }
+
+        stats.in_use++;
+        if (stats.in_use > stats.peak_in_use)
+            stats.peak_in_use = stats.in_use;
+
+#ifdef ARM_TLM_ENABLE_VALGRIND
+        VALGRIND_CREATE_MEMPOOL(object, 0, 0);
+        VALGRIND_MEMPOOL_ALLOC(object, object, stride);
+#endif
+        return object;
+    }
+
+    /** Return an object's memory to the pool. */
+    void release(void* object)
+    {
+#ifdef ARM_TLM_ENABLE_VALGRIND
+        VALGRIND_MEMPOOL_FREE(object, object);
+        VALGRIND_DESTROY_MEMPOOL(object);
+#endif
+        PoolLock lock(mutex);
+
+        /*
+         * Objects are not recycled in POOL_DEBUG_UNIQUE mode but are no longer
+         * in use.
+         */
+        stats.in_use--;
+
+        if (debug_mode == POOL_DEBUG_ALWAYS_FREE)
+        {
+            pool_aligned_free(allocator, object);
+            stats.allocated--;
+        } else if (debug_mode != POOL_DEBUG_UNIQUE)
+        {
+            free_list.push_back(object);
+        }
+    }
+
+    /** Get a snapshot of the pool's statistics. */
+    PoolStatistics get_statistics() const
+    {
+        PoolLock lock(mutex);
+        PoolStatistics snapshot = stats;
+
+        snapshot.free_objects = free_list.size();
+        return snapshot;
+    }
+
+    /** Print a one line summary of the pool's use. */
+    void debug(std::ostream& stream, const char* name) const
+    {
+        PoolStatistics snapshot = get_statistics();
+
+        stream << name << " free/allocated/in use: "
+            << snapshot.free_objects
+            << '/' << snapshot.allocated
+            << '/' << snapshot.in_use
+            << " peak/requests/recycled: "
+            << snapshot.peak_in_use
+            << '/' << snapshot.requests
+            << '/' << snapshot.recycled
+            << " arena bytes: " << snapshot.arena_bytes << '\n';
+    }
+};
+
+/**
+ * Table of extensions appended to Payload objects. Extensions are registered
+ * by name into a map but, once frozen, creation, copying and destruction of
+ * extensions walk a flat vector of entries rather than the map.
+ *
+ * Manager is the protocol's PayloadExtensionManager type.
+ */
+template <typename Manager>
+class ExtensionTable
+{
+public:
+    /** Offset of an extension within a Payload and its manager. */
+    class Entry
+    {
+    public:
+        std::size_t offset;
+        Manager* manager;
+        Entry(std::size_t offset_, Manager* manager_) :
+            offset(offset_),
+            manager(manager_)
+        {}
+    };
+
+private:
+    /** Map of extension names to indices in entries. */
+    std::map<std::string, std::size_t> names;
+
+    /** Extensions in registration order. */
+    std::vector<Entry> entries;
+
+    /** Size of a Payload with all registered extensions. */
+    std::size_t object_size;
+
+    /** Set once extension registration is closed. */
+    bool frozen;
+
+public:
+    explicit ExtensionTable(std::size_t base_size) :
+        object_size(base_size),
+        frozen(false)
+    {}
+
+    /** Close registration. */
+    void freeze() { frozen = true; }
+
+    bool is_frozen() const { return frozen; }
+
+    std::size_t get_object_size() const { return object_size; }
+
+    const std::vector<Entry>& get_entries() const { return entries; }
+
+    /** Find a registered extension's offset. Returns 0 if not found. */
+    std::size_t find(const char* name) const
+    {
+        std::map<std::string, std::size_t>::const_iterator it =
+            names.find(name);
+        if (it == names.end())
+            return 0;
+        return entries[it->second].offset;
+    }
+
+    /**
+     * Register an extension of the given size, growing object_size. Returns
+     * the offset of the extension within Payload objects. Registering the
+     * same name again replaces the earlier registration.
+     */
+    std::size_t add(const char* name, Manager* manager, std::size_t size)
+    {
+        pool_assert(!frozen, "extension registered after first allocation");
+        /* 32 bit align the extension. */
+        std::size_t offset = (object_size + 3) & ~static_cast<std::size_t>(3);
+
+        std::map<std::string, std::size_t>::iterator it = names.find(name);
+        if (it == names.end())
+        {
+            names[name] = entries.size();
+            entries.push_back(Entry(offset, manager));
+        } else
+        {
+            entries[it->second] = Entry(offset, manager);
+        }
+        object_size = offset + size;
+
+        return offset;
+    }
+
+    /** Default construct all extensions of object. */
+    void create_all(void* object) const
+    {
+        char* base = reinterpret_cast<char*>(object);
+
+        for (std::size_t i = 0; i < entries.size(); i++)
+            entries[i].manager->create(base + entries[i].offset);
+    }
+
+    /** Copy construct all extensions of dst from src. */
+    void copy_all(void* dst, const void* src) const
+    {
+        char* dst_base = reinterpret_cast<char*>(dst);
+        const char* src_base = reinterpret_cast<const char*>(src);
+
+        for (std::size_t i = 0; i < entries.size(); i++)
+        {
+            entries[i].manager->copy(dst_base + entries[i].offset,
+                src_base + entries[i].offset);
+        }
+    }
+
+    /** Destroy all extensions of object. */
+    void destroy_all(void* object) const
+    {
+        char* base = reinterpret_cast<char*>(object);
+
+        for (std::size_t i = 0; i < entries.size(); i++)
+            entries[i].manager->destroy(base + entries[i].offset);
+    }
+};
+
+/**
+ * Core of a protocol's PayloadPool. PayloadPoolCore issues unique IDs, owns
+ * the extension table and allocates Payload objects (with their extensions
+ * and an optional trailing area) from an ObjectPool.
+ *
+ * PayloadType is the protocol's Payload class and Manager its
+ * PayloadExtensionManager. All of the pool's memory, and any other
+ * allocations made on its behalf, come from its local_malloc and local_free.
+ */
+template <typename PayloadType, typename Manager>
+class PayloadPoolCore : public PoolAllocator
+{
+protected:
+    /** The unique ID of the next Payload to be created. */
+    PoolCounter next_uid;
+
+    /** Allocation debug mode read from ARM_TLM_DEBUG_ALLOC. */
+    PoolDebugMode debug_mode;
+
+    /** Extensions appended to each Payload. */
+    ExtensionTable<Manager> extensions;
+
+    /**
+     * Size of an area following the extensions of each Payload. The area
+     * starts on a cache line boundary at trailing_offset.
+     */
+    std::size_t trailing_size;
+    std::size_t trailing_offset;
+
+    /** Storage for Payloads. */
+    ObjectPool payloads;
+
+    /**
+     * Set once the layout is fixed. Fixing the layout and registering
+     * extensions are serialised by layout_mutex so that threads making their
+     * first Payloads at once fix it exactly once.
+     */
+    PoolFlag fixed;
+    mutable PoolMutex layout_mutex;
+
+    /**
+     * Fix the layout of Payloads. Called with layout_mutex held on the first
+     * Payload allocation once all extensions have been registered.
+     */
+    void fix_layout()
+    {
+        extensions.freeze();
+
+        std::size_t size = extensions.get_object_size();
+        if (trailing_size != 0)
+        {
+            trailing_offset = pool_cache_line_round_up(size);
+            size = trailing_offset + trailing_size;
+        }
+        payloads.set_size(size);
+    }
+
+public:
+    PayloadPoolCore() :
+        next_uid(1),
+        debug_mode(pool_debug_mode_from_env()),
+        /* The Payload size will grow as extensions are added. */
+        extensions(sizeof(PayloadType)),
+        trailing_size(0),
+        trailing_offset(0),
+        payloads(*this, sizeof(PayloadType), debug_mode),
+        fixed(false)
+    {}
+
+    /** Return the next unique ID and advance next_id. */
+    uint64_t get_uid() { return next_uid++; }
+
+    PoolDebugMode get_debug_mode() const { return debug_mode; }
+
+    bool is_fixed() const { return fixed; }
+
+    /**
+     * Reserve an area of the given size after the extensions of each
+     * Payload. Only valid before the first Payload is allocated.
+     */
+    void set_trailing_size(std::size_t size)
+    {
+        pool_assert(!is_fixed(),
+            "payload layout changed after first allocation");
+        trailing_size = size;
+    }
+
+    /** Get the trailing area of a Payload allocated by this pool. */
+    char* get_trailing(PayloadType* payload) const
+    {
+        return reinterpret_cast<char*>(payload) + trailing_offset;
+    }
+
+    /**
+     * Create a new Payload either by allocating a new object or recycling a
+     * Payload from the payload free list. Extensions are copied from parent
+     * if given or default constructed.
+     *
+     * The created payload must still be placement constructed to initialize
+     * its required data members.
+     */
+    PayloadType* new_payload(const PayloadType* parent = nullptr)
+    {
+        if (!fixed)
+        {
+            PoolLock lock(layout_mutex);
+            if (!fixed)
+            {
+                fix_layout();
+                fixed = true;
+            }
+        }
+
+        PayloadType* payload =
+            reinterpret_cast<PayloadType*>(payloads.allocate());
+
+        if (parent)
+            extensions.copy_all(payload, parent);
+        else
+            extensions.create_all(payload);
+
+        return payload;
+    }
+
+    /** Return a Payload to the payload free list destroying its extensions. */
+    void free_payload(PayloadType* payload)
+    {
+        extensions.destroy_all(payload);
+        payloads.release(payload);
+    }
+
+    /**
+     * Register an extension's byte offset within Payload objects. This can
+     * only be called before the first Payload is allocated.
+     */
+    std::size_t register_extension(const char* name, Manager* manager)
+    {
+        PoolLock lock(layout_mutex);
+        return extensions.add(name, manager, manager->get_size());
+    }
+
+    /** Find a registered extension's offset. Returns 0 if not found. */
+    std::size_t get_extension_offset(const char* name) const
+    {
+        PoolLock lock(layout_mutex);
+        return extensions.find(name);
+    }
+
+    PoolStatistics get_statistics() const { return payloads.get_statistics(); }
+};
+
+}
+}
+
+#endif /* ARM_TLM_PAYLOAD_POOL_H */
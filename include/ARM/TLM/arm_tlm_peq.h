@@ -0,0 +1,196 @@
+/*
+ * The Clear BSD License
+ *
+ * Copyright (c) 2015-2021 Arm Limited.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *      * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *
+ *      * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *      * Neither the name of the copyright holder nor the names of its
+ *      contributors may be used to endorse or promote products derived from
+ *      this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ARM_TLM_PEQ_H
+#define ARM_TLM_PEQ_H
+
+#include <tlm.h>
+#include <algorithm>
+#include <stdint.h>
+#include <vector>
+
+#include "arm_tlm_helpers.h"
+
+namespace ARM
+{
+namespace TLM
+{
+
+/**
+ * Payload event queue for AT models using ARM payloads. Phases notified
+ * with a delay, typically the timing annotation of a timed nb_transport
+ * call, are handed to a callback of Module at their due time. Phases due
+ * at the same time are delivered in the order they were notified.
+ *
+ * The queue holds a reference to each Payload until its phase has been
+ * delivered, so a model needn't keep its own reference meanwhile. Only one
+ * kernel wakeup is scheduled at a time, for the earliest pending phase, so
+ * a model driven by a PayloadEventQueue needs no per-cycle processes.
+ */
+template <typename Module, typename Types>
+class PayloadEventQueue : public sc_core::sc_module
+{
+public:
+    typedef typename Types::tlm_payload_type PayloadType;
+    typedef typename Types::tlm_phase_type PhaseType;
+
+    /** Function called with each phase at its due time. */
+    typedef void (Module::* Callback)(PayloadType&, PhaseType&);
+
+protected:
+    SC_HAS_PROCESS(PayloadEventQueue);
+
+    class Entry
+    {
+    public:
+        PayloadRef<PayloadType> payload;
+        PhaseType phase;
+        sc_core::sc_time time;
+
+        /** Notification order, to break ties between equal times. */
+        uint64_t sequence;
+
+        Entry(PayloadType& payload_, const PhaseType& phase_,
+            const sc_core::sc_time& time_, uint64_t sequence_) :
+            payload(payload_), phase(phase_), time(time_), sequence(sequence_)
+        {}
+
+        /*
+         * sc_time's copy is not declared noexcept, so moves are spelled out
+         * for the heap's vector to move entries rather than copy them.
+         */
+        Entry(Entry&& other) noexcept :
+            payload(static_cast<PayloadRef<PayloadType>&&>(other.payload)),
+            phase(other.phase), time(other.time), sequence(other.sequence)
+        {}
+
+        Entry& operator= (Entry&& other) noexcept
+        {
+            payload = static_cast<PayloadRef<PayloadType>&&>(other.payload);
+            phase = other.phase;
+            time = other.time;
+            sequence = other.sequence;
+            return *this;
+        }
+
+        /** Heap order: the earliest entry is the greatest. */
+        bool operator< (const Entry& rhs) const
+        {
+            if (time != rhs.time)
+                return time > rhs.time;
+            return sequence > rhs.sequence;
+        }
+    };
+
+    Module& owner;
+    Callback callback;
+
+    /** Pending phases as a heap with the earliest first. */
+    std::vector<Entry> entries;
+
+    uint64_t next_sequence;
+
+    /** Notified for the earliest pending phase. */
+    sc_core::sc_event event;
+
+    void deliver()
+    {
+        const sc_core::sc_time now = sc_core::sc_time_stamp();
+
+        /* Phases notified by the callback wait for the next activation. */
+        const uint64_t sequence_limit = next_sequence;
+
+        while (!entries.empty() && entries.front().time <= now &&
+            entries.front().sequence < sequence_limit)
+        {
+            std::pop_heap(entries.begin(), entries.end());
+            Entry entry(static_cast<Entry&&>(entries.back()));
+            entries.pop_back();
+
+            (owner.*callback)(*entry.payload, entry.phase);
+        }
+
+        if (!entries.empty())
+            event.notify(entries.front().time - now);
+    }
+
+public:
+    PayloadEventQueue(sc_core::sc_module_name name_, Module& owner_,
+        Callback callback_) :
+        sc_core::sc_module(name_),
+        owner(owner_),
+        callback(callback_),
+        next_sequence(0)
+    {
+        SC_METHOD(deliver);
+        sensitive << event;
+        dont_initialize();
+    }
+
+    /** Deliver phase for payload delay after the current time. */
+    void notify(PayloadType& payload, const PhaseType& phase,
+        const sc_core::sc_time& delay)
+    {
+        const sc_core::sc_time time = sc_core::sc_time_stamp() + delay;
+
+        /* sc_event keeps the earlier of its pending and new notifications. */
+        if (entries.empty() || time < entries.front().time)
+            event.notify(delay);
+
+        entries.push_back(Entry(payload, phase, time, next_sequence++));
+        std::push_heap(entries.begin(), entries.end());
+    }
+
+    /** Deliver phase for payload in the next delta cycle. */
+    void notify(PayloadType& payload, const PhaseType& phase)
+    {
+        notify(payload, phase, sc_core::SC_ZERO_TIME);
+    }
+
+    /** Number of phases waiting to be delivered. */
+    std::size_t size() const { return entries.size(); }
+
+    /** Drop all pending phases. */
+    void cancel_all()
+    {
+        entries.clear();
+        event.cancel();
+    }
+};
+
+}
+}
+
+#endif /* ARM_TLM_PEQ_H */
@@ -0,0 +1,184 @@
+/*
+ * The Clear BSD License
+ *
+ * Copyright (c) 2015-2021 Arm Limited.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *      * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *
+ *      * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *      * Neither the name of the copyright holder nor the names of its
+ *      contributors may be used to endorse or promote products derived from
+ *      this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef ARM_TLM_RING_BUFFER_H
+#define ARM_TLM_RING_BUFFER_H
+
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include <ARM/TLM/arm_tlm_payload_pool.h>
+
+/*
+ * Over-aligned members are only honoured by operator new from C++17, and
+ * earlier compilers warn about them, so only cache-align where it will hold.
+ */
+#ifdef __cpp_aligned_new
+#define ARM_TLM_CACHE_ALIGNED alignas(ARM::TLM::POOL_CACHE_LINE_BYTES)
+#else
+#define ARM_TLM_CACHE_ALIGNED
+#endif
+
+namespace ARM
+{
+namespace TLM
+{
+
+/**
+ * Report a ring buffer overflow or underflow. This follows the libraries'
+ * runtime_error_assert behaviour: throw a std::runtime_error unless
+ * ARM_TLM_ERRORS_WITH_ASSERT is defined.
+ */
+inline void ring_buffer_assert(bool cond, const char* message)
+{
+#ifdef ARM_TLM_ERRORS_WITH_ASSERT
+    assert(cond && message);
+    (void) cond;
+    (void) message;
+#else
+    if (!cond)
+        throw std::runtime_error(message);
+#endif
+}
+
+/**
+ * Fixed capacity FIFO held entirely within the object, for queues whose depth
+ * is bounded by flow control (e.g. link credits). Entries are moved in and
+ * out so queueing a reference-holding entry such as a (PayloadRef, Phase)
+ * pair costs no reference count traffic and no allocation.
+ *
+ * Capacity must be a power of two. Pushing to a full buffer or popping an
+ * empty one is an error.
+ */
+template <typename T, std::size_t Capacity>
+class RingBuffer
+{
+private:
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+        "RingBuffer capacity must be a power of two");
+
+    ARM_TLM_CACHE_ALIGNED
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type slots[Capacity];
+
+    /** Free-running counts of entries pushed and popped. */
+    std::size_t head;
+    std::size_t tail;
+
+    T* slot(std::size_t index)
+    {
+        return reinterpret_cast<T*>(&slots[index & (Capacity - 1)]);
+    }
+
+    const T* slot(std::size_t index) const
+    {
+        return reinterpret_cast<const T*>(&slots[index & (Capacity - 1)]);
+    }
+
+    /* Entries may hold references so the buffer can't be copied. */
+    RingBuffer(const RingBuffer&);
+    RingBuffer& operator= (const RingBuffer&);
+
+public:
+    RingBuffer() : head(0), tail(0) {}
+
+    ~RingBuffer() { clear(); }
+
+    static std::size_t capacity() { return Capacity; }
+
+    std::size_t size() const { return tail - head; }
+    bool empty() const { return tail == head; }
+    bool full() const { return tail - head == Capacity; }
+
+    T& front()
+    {
+        ring_buffer_assert(!empty(), "RingBuffer front of empty buffer");
+        return *slot(head);
+    }
+
+    const T& front() const
+    {
+        ring_buffer_assert(!empty(), "RingBuffer front of empty buffer");
+        return *slot(head);
+    }
+
+    T& back()
+    {
+        ring_buffer_assert(!empty(), "RingBuffer back of empty buffer");
+        return *slot(tail - 1);
+    }
+
+    /** Construct an entry in place at the back. */
+    template <typename... Args>
+    void emplace_back(Args&&... args)
+    {
+        ring_buffer_assert(!full(), "RingBuffer push to full buffer");
+        new (slot(tail)) T(std::forward<Args>(args)...);
+        tail++;
+    }
+
+    void push_back(T&& item) { emplace_back(std::move(item)); }
+    void push_back(const T& item) { emplace_back(item); }
+
+    void pop_front()
+    {
+        ring_buffer_assert(!empty(), "RingBuffer pop from empty buffer");
+        slot(head)->~T();
+        head++;
+    }
+
+    /** Move the front entry out and pop it. */
+    T take_front()
+    {
+        T item(std::move(front()));
+        pop_front();
+        return item;
+    }
+
+    void clear()
+    {
+        while (!empty())
+            pop_front();
+    }
+};
+
+}
+}
+
+#endif /* ARM_TLM_RING_BUFFER_H */
@@ -37,18 +37,204 @@
 #define ARM_TLM_SOCKET_H
 
 #include <tlm.h>
+#include <tlm_utils/tlm_quantumkeeper.h>
+#include <algorithm>
+#include <cstring>
 #include <sstream>
+#include <stdint.h>
+#include <vector>
 
+#include "arm_tlm_dmi.h"
 #include "arm_tlm_protocol.h"
+#include "arm_tlm_stats.h"
 
 namespace ARM
 {
 namespace TLM
 {
 
+/**
+ * Protocol hooks used by SimpleTargetSocket to run a target which only
+ * implements nb_transport_fw through b_transport. A protocol supports this
+ * fallback by specialising BlockingAdapterPolicy for its Types. Without a
+ * specialisation, b_transport on a target with no registered blocking
+ * function is reported as an error.
+ */
+template <typename Types>
+class BlockingAdapterPolicy
+{
+public:
+    typedef typename Types::tlm_payload_type PayloadType;
+    typedef typename Types::tlm_phase_type PhaseType;
+
+    /** Can transactions be run through nb_transport_fw? */
+    static const bool supported = false;
+
+    /** Number of fw VALID phases needed to offer trans to the target. */
+    static unsigned request_phase_count(const PayloadType&) { return 0; }
+
+    /** The index'th fw VALID phase of trans. */
+    static PhaseType request_phase(const PayloadType&, unsigned)
+    { return PhaseType(); }
+
+    /** Is reply the READY for the fw VALID phase request? */
+    static bool is_request_ready(const PhaseType&, const PhaseType&)
+    { return false; }
+
+    /**
+     * Accept a bw VALID phase for trans, updating phase to its READY.
+     * Returns true when the phase completes the transaction.
+     */
+    static bool accept_response(const PayloadType&, PhaseType&)
+    { return false; }
+
+    /**
+     * Get a fw phase to send to the target after the transaction has
+     * completed. Returns false if protocol needs no such acknowledgement.
+     */
+    static bool completion_ack(const PayloadType&, Protocol, PhaseType&)
+    { return false; }
+};
+
 template <typename Types>
 class BaseInitiatorSocket;
 
+/**
+ * Protocol and port data width of the multi-bind sockets, allowing
+ * BaseTargetSocket/BaseInitiatorSocket to check binds against them.
+ */
+class SocketProtocol
+{
+public:
+    /* Protocol to test against other sockets when binding. */
+    const Protocol protocol;
+
+    /** Port data width to test against other sockets when binding. */
+    const unsigned port_width;
+
+public:
+    SocketProtocol(Protocol protocol_, unsigned port_width_) :
+        protocol(protocol_),
+        port_width(port_width_)
+    {}
+
+    virtual ~SocketProtocol() {}
+};
+
+/**
+ * Passive observer of the calls through a socket. Observers are attached to
+ * and detached from BaseTargetSocket/BaseInitiatorSocket, and the multi-bind
+ * sockets, at any time during simulation, allowing a link to be monitored
+ * without a pass-through module and only for the window of interest. A socket
+ * with no observers attached pays only the test of an empty list per call.
+ */
+template <typename Types>
+class SocketObserver
+{
+public:
+    typedef typename Types::tlm_payload_type PayloadType;
+    typedef typename Types::tlm_phase_type PhaseType;
+
+    virtual ~SocketObserver() {}
+
+    /**
+     * Called after each nb_transport call with the phase offered, the reply
+     * and the phase on return (only meaningful if reply is TLM_UPDATED).
+     * socket_name names the observed socket. fw is true for nb_transport_fw.
+     */
+    virtual void observe_nb_transport(const char* socket_name, bool fw,
+        const PayloadType& trans, const PhaseType& phase_before,
+        tlm::tlm_sync_enum reply, const PhaseType& phase_after) = 0;
+
+    /** Called after each b_transport call with the annotated delay. */
+    virtual void observe_b_transport(const char* /* socket_name */,
+        const PayloadType& /* trans */, const sc_core::sc_time& /* delay */)
+    {}
+};
+
+/**
+ * Observers attached to a socket. Observers may detach themselves, or
+ * others, from within their callbacks.
+ */
+template <typename Types>
+class SocketObserverList
+{
+private:
+    typedef typename Types::tlm_payload_type PayloadType;
+    typedef typename Types::tlm_phase_type PhaseType;
+
+    std::vector<SocketObserver<Types>*> observers;
+
+    /** Set while calling observers, when detach leaves holes to compact. */
+    bool notifying;
+    bool holes;
+
+    void compact()
+    {
+        observers.erase(std::remove(observers.begin(), observers.end(),
+            static_cast<SocketObserver<Types>*>(nullptr)), observers.end());
+        holes = false;
+    }
+
+public:
+    SocketObserverList() : notifying(false), holes(false) {}
+
+    bool empty() const { return observers.empty(); }
+
+    void attach(SocketObserver<Types>& observer)
+    {
+        observers.push_back(&observer);
+    }
+
+    void detach(SocketObserver<Types>& observer)
+    {
+        typename std::vector<SocketObserver<Types>*>::iterator found =
+            std::find(observers.begin(), observers.end(), &observer);
+        if (found == observers.end())
+            return;
+
+        *found = nullptr;
+        holes = true;
+        if (!notifying)
+            compact();
+    }
+
+    void notify_nb_transport(const char* socket_name, bool fw,
+        const PayloadType& trans, const PhaseType& phase_before,
+        tlm::tlm_sync_enum reply, const PhaseType& phase_after)
+    {
+        notifying = true;
+        /* Observers attached during the loop are first called next time. */
+        const std::size_t count = observers.size();
+        for (std::size_t i = 0; i < count; i++)
+        {
+            if (observers[i])
+            {
+                observers[i]->observe_nb_transport(socket_name, fw, trans,
+                    phase_before, reply, phase_after);
+            }
+        }
+        notifying = false;
+        if (holes)
+            compact();
+    }
+
+    void notify_b_transport(const char* socket_name, const PayloadType& trans,
+        const sc_core::sc_time& delay)
+    {
+        notifying = true;
+        const std::size_t count = observers.size();
+        for (std::size_t i = 0; i < count; i++)
+        {
+            if (observers[i])
+                observers[i]->observe_b_transport(socket_name, trans, delay);
+        }
+        notifying = false;
+        if (holes)
+            compact();
+    }
+};
+
 /** Base target socket implementing protocol/width checking. */
 template <typename Types>
 class BaseTargetSocket : public tlm::tlm_target_socket<0, Types>
@@ -60,6 +246,49 @@ public:
     /** Port data width to test against other sockets when binding. */
     const unsigned port_width;
 
+protected:
+    typedef typename Types::tlm_payload_type StatsPayloadType;
+    typedef typename Types::tlm_phase_type StatsPhaseType;
+
+    /** Counters of calls through this socket. See arm_tlm_stats.h. */
+    SocketStatistics stats;
+
+    /** Attached observers. */
+    SocketObserverList<Types> observers;
+
+    /**
+     * Count a nb_transport call of request answered with reply and pass it
+     * to any observers.
+     */
+    void record_nb_transport(SocketStatistics::Direction direction,
+        const StatsPayloadType& trans, const StatsPhaseType& request,
+        const StatsPhaseType& reply_phase, tlm::tlm_sync_enum reply)
+    {
+        socket_stats_record_nb_transport<Types>(stats, port_width, direction,
+            trans, request, reply_phase, reply);
+
+        if (!observers.empty())
+        {
+            observers.notify_nb_transport(this->name(),
+                direction == SocketStatistics::DIRECTION_FW, trans, request,
+                reply, reply_phase);
+        }
+    }
+
+    /** Count a b_transport call. */
+    void record_b_transport(const StatsPayloadType& trans)
+    {
+        socket_stats_record_b_transport<Types>(stats, port_width, trans);
+    }
+
+    /** Pass a completed b_transport call to any observers. */
+    void observe_b_transport(const StatsPayloadType& trans,
+        const sc_core::sc_time& delay)
+    {
+        if (!observers.empty())
+            observers.notify_b_transport(this->name(), trans, delay);
+    }
+
 public:
     BaseTargetSocket(const char* name_,
         Protocol protocol_, unsigned port_width_) :
@@ -68,6 +297,46 @@ public:
         port_width(port_width_)
     {}
 
+    /**
+     * Statistics of the calls through this socket. Only gathered when the
+     * libraries are built with the ARM_TLM_SOCKET_STATS option.
+     */
+    const SocketStatistics& get_statistics() const { return stats; }
+
+    /** Clear the socket's statistics. */
+    void reset_statistics() { stats.reset(); }
+
+    /** Print the socket's statistics. */
+    void print_statistics(std::ostream& stream) const
+    {
+        socket_stats_print<Types>(stream, this->name(), stats);
+    }
+
+    /** Start passing calls through this socket to observer. */
+    void attach_observer(SocketObserver<Types>& observer)
+    {
+        observers.attach(observer);
+    }
+
+    /** Stop passing calls to observer. */
+    void detach_observer(SocketObserver<Types>& observer)
+    {
+        observers.detach(observer);
+    }
+
+    /**
+     * Count, and pass to any observers, a nb_transport_fw call an initiator
+     * made to the module directly rather than through this socket (see
+     * StaticInitiatorSocket).
+     */
+    void record_direct_nb_transport_fw(const StatsPayloadType& trans,
+        const StatsPhaseType& request, const StatsPhaseType& reply_phase,
+        tlm::tlm_sync_enum reply)
+    {
+        record_nb_transport(SocketStatistics::DIRECTION_FW, trans, request,
+            reply_phase, reply);
+    }
+
     /*
      * Base types for sockets used in SystemC to define bind. These are needed
      * to match the type signature of bind correctly for the overrides below.
@@ -105,6 +374,49 @@ public:
     /** Port data width to test against other sockets when binding. */
     const unsigned port_width;
 
+protected:
+    typedef typename Types::tlm_payload_type StatsPayloadType;
+    typedef typename Types::tlm_phase_type StatsPhaseType;
+
+    /** Counters of calls through this socket. See arm_tlm_stats.h. */
+    SocketStatistics stats;
+
+    /** Attached observers. */
+    SocketObserverList<Types> observers;
+
+    /**
+     * Count a nb_transport call of request answered with reply and pass it
+     * to any observers.
+     */
+    void record_nb_transport(SocketStatistics::Direction direction,
+        const StatsPayloadType& trans, const StatsPhaseType& request,
+        const StatsPhaseType& reply_phase, tlm::tlm_sync_enum reply)
+    {
+        socket_stats_record_nb_transport<Types>(stats, port_width, direction,
+            trans, request, reply_phase, reply);
+
+        if (!observers.empty())
+        {
+            observers.notify_nb_transport(this->name(),
+                direction == SocketStatistics::DIRECTION_FW, trans, request,
+                reply, reply_phase);
+        }
+    }
+
+    /** Count a b_transport call. */
+    void record_b_transport(const StatsPayloadType& trans)
+    {
+        socket_stats_record_b_transport<Types>(stats, port_width, trans);
+    }
+
+    /** Pass a completed b_transport call to any observers. */
+    void observe_b_transport(const StatsPayloadType& trans,
+        const sc_core::sc_time& delay)
+    {
+        if (!observers.empty())
+            observers.notify_b_transport(this->name(), trans, delay);
+    }
+
 public:
     BaseInitiatorSocket(const char* name_,
         Protocol protocol_, unsigned port_width_) :
@@ -113,6 +425,33 @@ public:
         port_width(port_width_)
     {}
 
+    /**
+     * Statistics of the calls through this socket. Only gathered when the
+     * libraries are built with the ARM_TLM_SOCKET_STATS option.
+     */
+    const SocketStatistics& get_statistics() const { return stats; }
+
+    /** Clear the socket's statistics. */
+    void reset_statistics() { stats.reset(); }
+
+    /** Print the socket's statistics. */
+    void print_statistics(std::ostream& stream) const
+    {
+        socket_stats_print<Types>(stream, this->name(), stats);
+    }
+
+    /** Start passing calls through this socket to observer. */
+    void attach_observer(SocketObserver<Types>& observer)
+    {
+        observers.attach(observer);
+    }
+
+    /** Stop passing calls to observer. */
+    void detach_observer(SocketObserver<Types>& observer)
+    {
+        observers.detach(observer);
+    }
+
     /*
      * Base types for sockets used in SystemC to define bind. These are needed
      * to match the type signature of bind correctly for the overrides below.
@@ -190,11 +529,26 @@ void BaseTargetSocket<Types>::bind(base_initiator_socket& socket)
 {
     BaseInitiatorSocket<Types>* arm_base =
         dynamic_cast<BaseInitiatorSocket<Types>*>(&socket);
+    SocketProtocol* arm_multi = dynamic_cast<SocketProtocol*>(&socket);
 
     if (arm_base)
+    {
         protocol_check_bind(*arm_base);
-    else
-        tlm::tlm_target_socket<0, Types>::bind(socket);
+        return;
+    }
+
+    if (arm_multi && (arm_multi->protocol != protocol ||
+        arm_multi->port_width != port_width))
+    {
+        std::ostringstream message;
+        message << this->name() << ": Protocol/width mismatch on socket: "
+            << "(target) "
+            << protocol << '/' << port_width
+            << " <-> (multi initiator) "
+            << arm_multi->protocol << '/' << arm_multi->port_width;
+        SC_REPORT_ERROR("/ARM/TLM/BaseTargetSocket", message.str().c_str());
+    }
+    tlm::tlm_target_socket<0, Types>::bind(socket);
 }
 
 template <typename Types>
@@ -236,11 +590,26 @@ void BaseInitiatorSocket<Types>::bind(base_target_socket& socket)
 {
     BaseTargetSocket<Types>* arm_base =
         dynamic_cast<BaseTargetSocket<Types>*>(&socket);
+    SocketProtocol* arm_multi = dynamic_cast<SocketProtocol*>(&socket);
 
     if (arm_base)
+    {
         protocol_check_bind(*arm_base);
-    else
-        tlm::tlm_initiator_socket<0, Types>::bind(socket);
+        return;
+    }
+
+    if (arm_multi && (arm_multi->protocol != protocol ||
+        arm_multi->port_width != port_width))
+    {
+        std::ostringstream message;
+        message << this->name() << ": Protocol/width mismatch on socket: "
+            << "(initiator) "
+            << protocol << '/' << port_width
+            << " <-> (multi target) "
+            << arm_multi->protocol << '/' << arm_multi->port_width;
+        SC_REPORT_ERROR("/ARM/TLM/BaseInitiatorSocket", message.str().c_str());
+    }
+    tlm::tlm_initiator_socket<0, Types>::bind(socket);
 }
 
 template <typename Types>
@@ -259,6 +628,12 @@ void BaseInitiatorSocket<Types>::bind(base_initiator_socket& socket)
  * Simple target socket allowing a Module class to implement communication
  * functions as member functions and register them with the socket in the
  * same way at tlm_utils::simple_target_socket.
+ *
+ * b_transport calls are passed to a blocking transport function registered
+ * with register_b_transport. If none is registered, and the protocol has a
+ * BlockingAdapterPolicy, the transaction is instead run through the
+ * Module's nb_transport_fw and the socket's nb_transport_bw convenience
+ * function, blocking the calling thread until it completes.
  */
 template <typename Module, typename Types>
 class SimpleTargetSocket : public BaseTargetSocket<Types>
@@ -271,39 +646,73 @@ public:
     /** Non blocking transport function pointer. */
     typedef tlm::tlm_sync_enum (Module::* NBFunc)(PayloadType&, PhaseType&);
 
+    /**
+     * Non blocking transport function pointer taking the timing annotation.
+     * The phase takes effect delay after the current simulation time.
+     */
+    typedef tlm::tlm_sync_enum (Module::* TimedNBFunc)(PayloadType&,
+        PhaseType&, sc_core::sc_time&);
+
+    /** Blocking transport function pointer. */
+    typedef void (Module::* BFunc)(PayloadType&, sc_core::sc_time&);
+
     /** Debug transport function pointer. */
     typedef unsigned (Module::* DebugFunc)(PayloadType&);
 
+    /** DMI request function pointer. */
+    typedef bool (Module::* DMIFunc)(PayloadType&, tlm::tlm_dmi&);
+
 protected:
     /** Proxy object implementing the fw transport interface. */
     class Proxy : public tlm::tlm_fw_transport_if<Types>
     {
     public:
         /** Owner of the proxy. */
-        const SimpleTargetSocket<Module, Types>& owner;
+        SimpleTargetSocket<Module, Types>& owner;
 
-        /** Object and functions to which to defer interface calls. */
+        /**
+         * Object and functions to which to defer interface calls. Only one of
+         * fw and timed_fw is set.
+         */
         Module& t;
         NBFunc fw;
+        TimedNBFunc timed_fw;
+        BFunc b;
         DebugFunc dbg;
+        DMIFunc dmi;
 
-        Proxy(const SimpleTargetSocket<Module, Types>& owner_,
-            Module& t_, NBFunc fw_, DebugFunc dbg_) :
-            owner(owner_), t(t_), fw(fw_), dbg(dbg_)
+        Proxy(SimpleTargetSocket<Module, Types>& owner_,
+            Module& t_, NBFunc fw_, TimedNBFunc timed_fw_, DebugFunc dbg_) :
+            owner(owner_), t(t_), fw(fw_), timed_fw(timed_fw_), b(nullptr),
+            dbg(dbg_), dmi(nullptr)
         {}
 
         tlm::tlm_sync_enum nb_transport_fw(PayloadType& trans,
-            PhaseType& phase, sc_core::sc_time& /* delay */)
+            PhaseType& phase, sc_core::sc_time& delay)
         {
-            return (t.*fw)(trans, phase);
+            const PhaseType request = phase;
+            tlm::tlm_sync_enum reply;
+
+            if (timed_fw)
+                reply = (t.*timed_fw)(trans, phase, delay);
+            else
+                reply = (t.*fw)(trans, phase);
+
+            owner.record_nb_transport(SocketStatistics::DIRECTION_FW, trans,
+                request, phase, reply);
+            return reply;
         }
 
-        void b_transport(PayloadType&, sc_core::sc_time&)
+        void b_transport(PayloadType& trans, sc_core::sc_time& delay)
         {
-            std::ostringstream message;
-            message << owner.name() << ": b_transport not implemented";
-            SC_REPORT_ERROR("/ARM/TLM/SimpleTargetSocket",
-                message.str().c_str());
+            owner.record_b_transport(trans);
+
+            if (b)
+                (t.*b)(trans, delay);
+            else
+                owner.adapt_b_transport(trans, delay);
+
+            owner.observe_b_transport(trans, delay);
         }
 
         unsigned transport_dbg(PayloadType& trans)
@@ -314,86 +723,333 @@ protected:
                 return 0;
         }
 
-        bool get_direct_mem_ptr(PayloadType&, tlm::tlm_dmi&)
+        bool get_direct_mem_ptr(PayloadType& trans, tlm::tlm_dmi& dmi_data)
         {
-            return false;
+            if (dmi)
+                return (t.*dmi)(trans, dmi_data);
+            else
+                return false;
         }
     };
 
     Proxy proxy;
 
+    /** A b_transport call being run through nb_transport_fw. */
+    class AdaptedTransaction
+    {
+    public:
+        PayloadType& trans;
+
+        /** Last fw VALID phase offered and whether it has been accepted. */
+        PhaseType request;
+        bool request_ready;
+
+        /** Has the final response been received? */
+        bool done;
+
+        /** Notified on any change of state. */
+        sc_core::sc_event event;
+
+        explicit AdaptedTransaction(PayloadType& trans_) :
+            trans(trans_), request(), request_ready(false), done(false)
+        {}
+    };
+
+    /** Transactions currently blocked in adapt_b_transport. */
+    std::vector<AdaptedTransaction*> adapted;
+
+    /** Run a b_transport call through the nb_transport_fw function. */
+    void adapt_b_transport(PayloadType& trans, sc_core::sc_time& delay);
+
+    /** Handle a bw phase, effective after delay, for an adapted transaction. */
+    tlm::tlm_sync_enum adapted_nb_transport_bw(
+        AdaptedTransaction& adapted_trans, PhaseType& phase,
+        const sc_core::sc_time& delay);
+
 public:
     SimpleTargetSocket(const char* name_, Module& t, NBFunc fw,
         Protocol protocol_, unsigned port_width_, DebugFunc dbg = nullptr) :
         BaseTargetSocket<Types>(name_, protocol_, port_width_),
-        proxy(*this, t, fw, dbg)
+        proxy(*this, t, fw, nullptr, dbg)
     {
         this->bind(proxy);
     }
 
-    /** Convenience function for bw without time. */
-    tlm::tlm_sync_enum nb_transport_bw(PayloadType& trans, PhaseType& phase)
+    /**
+     * Construct a socket whose fw function receives the timing annotation
+     * of each nb_transport_fw call.
+     */
+    SimpleTargetSocket(const char* name_, Module& t, TimedNBFunc fw,
+        Protocol protocol_, unsigned port_width_, DebugFunc dbg = nullptr) :
+        BaseTargetSocket<Types>(name_, protocol_, port_width_),
+        proxy(*this, t, nullptr, fw, dbg)
     {
-        sc_core::sc_time delay = sc_core::SC_ZERO_TIME;
-        return (*this)->nb_transport_bw(trans, phase, delay);
+        this->bind(proxy);
     }
-};
 
-/**
- * Simple target socket allowing a Module class to implement communication
- * functions as member functions and register them with the socket in the
- * same way at tlm_utils::simple_initiator_socket.
- */
-template <typename Module, typename Types>
-class SimpleInitiatorSocket : public BaseInitiatorSocket<Types>
-{
-protected:
-    typedef typename Types::tlm_payload_type PayloadType;
-    typedef typename Types::tlm_phase_type PhaseType;
+    /** Module implementing this socket's functions. */
+    Module& get_module() const
+    {
+        return proxy.t;
+    }
 
-public:
-    /** Non blocking transport function pointer. */
-    typedef tlm::tlm_sync_enum (Module::* NBFunc)(PayloadType&, PhaseType&);
+    /** The non blocking transport function registered on construction. */
+    NBFunc get_nb_transport_fw() const
+    {
+        return proxy.fw;
+    }
 
-protected:
-    /** Proxy object implementing the bw transport interface. */
-    class Proxy : public tlm::tlm_bw_transport_if<Types>
+    /**
+     * Register a blocking transport function to handle b_transport calls in
+     * place of the nb_transport_fw adapter.
+     */
+    void register_b_transport(BFunc b)
     {
-    public:
-        /** Owner of the proxy. */
-        const SimpleInitiatorSocket<Module, Types>& owner;
+        proxy.b = b;
+    }
 
-        /** Object and function(s) to which to defer interface calls. */
-        Module& t;
-        NBFunc bw;
+    /**
+     * Register a debug transport function. Debug transactions access the
+     * target's state immediately, without consuming simulated time or
+     * passing through the timed protocol.
+     */
+    void register_transport_dbg(DebugFunc dbg)
+    {
+        proxy.dbg = dbg;
+    }
 
-        Proxy(const SimpleInitiatorSocket<Module, Types>& owner_,
-            Module& t_, NBFunc bw_) :
-            owner(owner_), t(t_), bw(bw_)
-        {}
+    /** Register a function to grant DMI regions to initiators. */
+    void register_get_direct_mem_ptr(DMIFunc dmi)
+    {
+        proxy.dmi = dmi;
+    }
 
-        tlm::tlm_sync_enum nb_transport_bw(PayloadType& trans,
-            PhaseType& phase, sc_core::sc_time& /* delay */)
-        {
-            return (t.*bw)(trans, phase);
-        }
+    /**
+     * Convenience function to revoke DMI regions overlapping [start, end]
+     * from the initiators bound to this socket.
+     */
+    void invalidate_direct_mem_ptr(sc_dt::uint64 start, sc_dt::uint64 end)
+    {
+        (*this)->invalidate_direct_mem_ptr(start, end);
+    }
+
+    /** Convenience function for bw without time. */
+    tlm::tlm_sync_enum nb_transport_bw(PayloadType& trans, PhaseType& phase)
+    {
+        sc_core::sc_time delay = sc_core::SC_ZERO_TIME;
+        return nb_transport_bw(trans, phase, delay);
+    }
+
+    /**
+     * Convenience function for bw with a timing annotation: the phase takes
+     * effect delay after the current simulation time.
+     */
+    tlm::tlm_sync_enum nb_transport_bw(PayloadType& trans, PhaseType& phase,
+        sc_core::sc_time& delay)
+    {
+        const PhaseType request = phase;
+        tlm::tlm_sync_enum reply = tlm::TLM_ACCEPTED;
+        bool is_adapted = false;
 
-        void invalidate_direct_mem_ptr(sc_dt::uint64, sc_dt::uint64)
+        for (AdaptedTransaction* adapted_trans : adapted)
         {
-            std::ostringstream message;
-            message << owner.name() << ": DMI not implemented";
-            SC_REPORT_ERROR("/ARM/TLM/SimpleInitiatorSocket",
-                message.str().c_str());
+            if (&adapted_trans->trans == &trans)
+            {
+                reply = adapted_nb_transport_bw(*adapted_trans, phase, delay);
+                is_adapted = true;
+                break;
+            }
         }
-    };
 
-    Proxy proxy;
+        if (!is_adapted)
+            reply = (*this)->nb_transport_bw(trans, phase, delay);
+
+        this->record_nb_transport(SocketStatistics::DIRECTION_BW, trans,
+            request, phase, reply);
+        return reply;
+    }
+};
+
+template <typename Module, typename Types>
+void SimpleTargetSocket<Module, Types>::adapt_b_transport(PayloadType& trans,
+    sc_core::sc_time& delay)
+{
+    typedef BlockingAdapterPolicy<Types> Policy;
+
+    if (!Policy::supported)
+    {
+        std::ostringstream message;
+        message << this->name() << ": b_transport not implemented";
+        SC_REPORT_ERROR("/ARM/TLM/SimpleTargetSocket", message.str().c_str());
+        return;
+    }
+
+    /* The nb target works in simulated time, so catch up with the caller. */
+    sc_core::wait(delay);
+    delay = sc_core::SC_ZERO_TIME;
+
+    AdaptedTransaction adapted_trans(trans);
+    adapted.push_back(&adapted_trans);
+
+    /* Offer each VALID phase once the previous one has been accepted. */
+    const unsigned request_count = Policy::request_phase_count(trans);
+    for (unsigned index = 0; index < request_count; index++)
+    {
+        PhaseType phase = Policy::request_phase(trans, index);
+
+        adapted_trans.request = phase;
+        adapted_trans.request_ready = false;
+
+        sc_core::sc_time phase_delay = sc_core::SC_ZERO_TIME;
+        tlm::tlm_sync_enum reply = proxy.nb_transport_fw(trans, phase,
+            phase_delay);
+        if (reply != tlm::TLM_ACCEPTED &&
+            Policy::is_request_ready(adapted_trans.request, phase))
+        {
+            sc_core::wait(phase_delay);
+            adapted_trans.request_ready = true;
+        }
+
+        while (!adapted_trans.request_ready)
+            sc_core::wait(adapted_trans.event);
+    }
+
+    while (!adapted_trans.done)
+        sc_core::wait(adapted_trans.event);
+
+    adapted.erase(std::find(adapted.begin(), adapted.end(), &adapted_trans));
+
+    PhaseType ack;
+    if (Policy::completion_ack(trans, this->protocol, ack))
+    {
+        sc_core::sc_time ack_delay = sc_core::SC_ZERO_TIME;
+        proxy.nb_transport_fw(trans, ack, ack_delay);
+    }
+}
+
+template <typename Module, typename Types>
+tlm::tlm_sync_enum SimpleTargetSocket<Module, Types>::adapted_nb_transport_bw(
+    AdaptedTransaction& adapted_trans, PhaseType& phase,
+    const sc_core::sc_time& delay)
+{
+    typedef BlockingAdapterPolicy<Types> Policy;
+
+    /* A deferred READY for the outstanding VALID. */
+    if (!adapted_trans.request_ready &&
+        Policy::is_request_ready(adapted_trans.request, phase))
+    {
+        adapted_trans.request_ready = true;
+        adapted_trans.event.notify(delay);
+        return tlm::TLM_ACCEPTED;
+    }
+
+    if (Policy::accept_response(adapted_trans.trans, phase))
+    {
+        adapted_trans.done = true;
+        adapted_trans.event.notify(delay);
+    }
+
+    return tlm::TLM_UPDATED;
+}
+
+/**
+ * Simple target socket allowing a Module class to implement communication
+ * functions as member functions and register them with the socket in the
+ * same way at tlm_utils::simple_initiator_socket.
+ */
+template <typename Module, typename Types>
+class SimpleInitiatorSocket : public BaseInitiatorSocket<Types>
+{
+protected:
+    typedef typename Types::tlm_payload_type PayloadType;
+    typedef typename Types::tlm_phase_type PhaseType;
+
+public:
+    /** Non blocking transport function pointer. */
+    typedef tlm::tlm_sync_enum (Module::* NBFunc)(PayloadType&, PhaseType&);
+
+    /**
+     * Non blocking transport function pointer taking the timing annotation.
+     * The phase takes effect delay after the current simulation time.
+     */
+    typedef tlm::tlm_sync_enum (Module::* TimedNBFunc)(PayloadType&,
+        PhaseType&, sc_core::sc_time&);
+
+    /** DMI invalidation function pointer. */
+    typedef void (Module::* InvalidateFunc)(sc_dt::uint64, sc_dt::uint64);
+
+protected:
+    /** Proxy object implementing the bw transport interface. */
+    class Proxy : public tlm::tlm_bw_transport_if<Types>
+    {
+    public:
+        /** Owner of the proxy. */
+        SimpleInitiatorSocket<Module, Types>& owner;
+
+        /**
+         * Object and function(s) to which to defer interface calls. Only one
+         * of bw and timed_bw is set.
+         */
+        Module& t;
+        NBFunc bw;
+        TimedNBFunc timed_bw;
+        InvalidateFunc inv;
+
+        Proxy(SimpleInitiatorSocket<Module, Types>& owner_,
+            Module& t_, NBFunc bw_, TimedNBFunc timed_bw_) :
+            owner(owner_), t(t_), bw(bw_), timed_bw(timed_bw_), inv(nullptr)
+        {}
+
+        tlm::tlm_sync_enum nb_transport_bw(PayloadType& trans,
+            PhaseType& phase, sc_core::sc_time& delay)
+        {
+            const PhaseType request = phase;
+            tlm::tlm_sync_enum reply;
+
+            if (timed_bw)
+                reply = (t.*timed_bw)(trans, phase, delay);
+            else
+                reply = (t.*bw)(trans, phase);
+
+            owner.record_nb_transport(SocketStatistics::DIRECTION_BW, trans,
+                request, phase, reply);
+            return reply;
+        }
+
+        void invalidate_direct_mem_ptr(sc_dt::uint64 start, sc_dt::uint64 end)
+        {
+            owner.dmi_cache.invalidate(start, end);
+
+            if (inv)
+                (t.*inv)(start, end);
+        }
+    };
+
+    Proxy proxy;
+
+    /** Local time offset of loosely-timed transactions on this socket. */
+    tlm_utils::tlm_quantumkeeper quantum_keeper;
+
+    /** DMI regions granted through get_direct_mem_ptr. */
+    DMICache dmi_cache;
 
 public:
     SimpleInitiatorSocket(const char* name_, Module& t, NBFunc bw,
         Protocol protocol_, unsigned port_width_) :
         BaseInitiatorSocket<Types>(name_, protocol_, port_width_),
-        proxy(*this, t, bw)
+        proxy(*this, t, bw, nullptr)
+    {
+        tlm::tlm_initiator_socket<0, Types>::bind(proxy);
+    }
+
+    /**
+     * Construct a socket whose bw function receives the timing annotation
+     * of each nb_transport_bw call.
+     */
+    SimpleInitiatorSocket(const char* name_, Module& t, TimedNBFunc bw,
+        Protocol protocol_, unsigned port_width_) :
+        BaseInitiatorSocket<Types>(name_, protocol_, port_width_),
+        proxy(*this, t, nullptr, bw)
     {
         tlm::tlm_initiator_socket<0, Types>::bind(proxy);
     }
@@ -402,7 +1058,743 @@ public:
     tlm::tlm_sync_enum nb_transport_fw(PayloadType& trans, PhaseType& phase)
     {
         sc_core::sc_time delay = sc_core::SC_ZERO_TIME;
-        return (*this)->nb_transport_fw(trans, phase, delay);
+        return nb_transport_fw(trans, phase, delay);
+    }
+
+    /**
+     * Convenience function for fw with a timing annotation: the phase takes
+     * effect delay after the current simulation time.
+     */
+    tlm::tlm_sync_enum nb_transport_fw(PayloadType& trans, PhaseType& phase,
+        sc_core::sc_time& delay)
+    {
+        const PhaseType request = phase;
+        tlm::tlm_sync_enum reply =
+            (*this)->nb_transport_fw(trans, phase, delay);
+
+        this->record_nb_transport(SocketStatistics::DIRECTION_FW, trans,
+            request, phase, reply);
+        return reply;
+    }
+
+    /**
+     * Convenience function for debug transport. Returns the number of bytes
+     * the target accessed, or 0 if it does not support debug transport.
+     */
+    unsigned transport_dbg(PayloadType& trans)
+    {
+        return (*this)->transport_dbg(trans);
+    }
+
+    /** Convenience function for b_transport with an explicit delay. */
+    void b_transport(PayloadType& trans, sc_core::sc_time& delay)
+    {
+        this->record_b_transport(trans);
+        (*this)->b_transport(trans, delay);
+        this->observe_b_transport(trans, delay);
+    }
+
+    /**
+     * Loosely-timed convenience function for b_transport. The transaction is
+     * issued at the quantum keeper's local time, which is advanced by the
+     * target's annotated delay. The calling thread only synchronises with
+     * SystemC once the global quantum has been used up.
+     */
+    void b_transport(PayloadType& trans)
+    {
+        sc_core::sc_time delay = quantum_keeper.get_local_time();
+        b_transport(trans, delay);
+        quantum_keeper.set(delay);
+
+        if (quantum_keeper.need_sync())
+            quantum_keeper.sync();
+    }
+
+    /**
+     * Quantum keeper used by b_transport(trans). Modules with other timed
+     * activity in the same thread should advance it with inc().
+     */
+    tlm_utils::tlm_quantumkeeper& get_quantum_keeper()
+    {
+        return quantum_keeper;
+    }
+
+    /**
+     * Register a function to be called when a target revokes DMI regions.
+     * The socket's own DMI cache is always invalidated first. A module
+     * forwarding DMI from a target socket should pass the call on.
+     */
+    void register_invalidate_direct_mem_ptr(InvalidateFunc inv)
+    {
+        proxy.inv = inv;
+    }
+
+    /**
+     * Request a DMI region covering trans's address. Granted regions are
+     * added to the socket's DMI cache for use by read_direct/write_direct.
+     */
+    bool get_direct_mem_ptr(PayloadType& trans, tlm::tlm_dmi& dmi)
+    {
+        if (!(*this)->get_direct_mem_ptr(trans, dmi))
+            return false;
+
+        dmi_cache.insert(dmi);
+        return true;
+    }
+
+    /**
+     * Find a cached DMI region covering [address, address + length) with
+     * at least 'access' permissions, or nullptr if there is none.
+     */
+    const tlm::tlm_dmi* find_direct_mem_ptr(sc_dt::uint64 address,
+        unsigned length, tlm::tlm_dmi::dmi_access_e access)
+    {
+        return dmi_cache.find(address, length, access);
+    }
+
+    /**
+     * Read length bytes at address through a cached DMI region, adding the
+     * region's read latency to delay. Returns false without accessing
+     * anything if no cached region covers the access.
+     */
+    bool read_direct(sc_dt::uint64 address, uint8_t* data, unsigned length,
+        sc_core::sc_time& delay)
+    {
+        const tlm::tlm_dmi* dmi = dmi_cache.find(address, length,
+            tlm::tlm_dmi::DMI_ACCESS_READ);
+        if (!dmi)
+            return false;
+
+        std::memcpy(data,
+            dmi->get_dmi_ptr() + (address - dmi->get_start_address()), length);
+        delay += dmi->get_read_latency();
+        return true;
+    }
+
+    /**
+     * Write length bytes at address through a cached DMI region, adding
+     * the region's write latency to delay. Returns false without accessing
+     * anything if no cached region covers the access.
+     */
+    bool write_direct(sc_dt::uint64 address, const uint8_t* data,
+        unsigned length, sc_core::sc_time& delay)
+    {
+        const tlm::tlm_dmi* dmi = dmi_cache.find(address, length,
+            tlm::tlm_dmi::DMI_ACCESS_WRITE);
+        if (!dmi)
+            return false;
+
+        std::memcpy(
+            dmi->get_dmi_ptr() + (address - dmi->get_start_address()), data,
+            length);
+        delay += dmi->get_write_latency();
+        return true;
+    }
+
+    /** Loosely-timed read_direct timed by the socket's quantum keeper. */
+    bool read_direct(sc_dt::uint64 address, uint8_t* data, unsigned length)
+    {
+        sc_core::sc_time delay = quantum_keeper.get_local_time();
+        if (!read_direct(address, data, length, delay))
+            return false;
+
+        quantum_keeper.set(delay);
+        if (quantum_keeper.need_sync())
+            quantum_keeper.sync();
+        return true;
+    }
+
+    /** Loosely-timed write_direct timed by the socket's quantum keeper. */
+    bool write_direct(sc_dt::uint64 address, const uint8_t* data,
+        unsigned length)
+    {
+        sc_core::sc_time delay = quantum_keeper.get_local_time();
+        if (!write_direct(address, data, length, delay))
+            return false;
+
+        quantum_keeper.set(delay);
+        if (quantum_keeper.need_sync())
+            quantum_keeper.sync();
+        return true;
+    }
+};
+
+/**
+ * Initiator socket for point-to-point links where the type of the target
+ * module, and the function it implements nb_transport_fw with, are known at
+ * compile time. Once bound directly to a SimpleTargetSocket<PeerModule,
+ * Types> registered with PeerFw, nb_transport_fw calls PeerFw on the peer
+ * module without the virtual interface calls or delay argument of the TLM
+ * path, allowing the compiler to inline it. Such calls are still counted by,
+ * and passed to the observers of, the peer socket as well as this one.
+ *
+ * Binding is protocol/width checked as for BaseInitiatorSocket. If bound to
+ * any other socket, nb_transport_fw uses the normal TLM path.
+ */
+template <typename Module, typename PeerModule, typename Types,
+    tlm::tlm_sync_enum (PeerModule::* PeerFw)(typename Types::tlm_payload_type&,
+        typename Types::tlm_phase_type&)>
+class StaticInitiatorSocket : public SimpleInitiatorSocket<Module, Types>
+{
+protected:
+    typedef typename Types::tlm_payload_type PayloadType;
+    typedef typename Types::tlm_phase_type PhaseType;
+
+    typedef typename BaseInitiatorSocket<Types>::base_target_socket
+        base_target_socket;
+
+    /**
+     * Peer module, and its socket, if bound to a matching SimpleTargetSocket.
+     */
+    PeerModule* peer;
+    SimpleTargetSocket<PeerModule, Types>* peer_socket;
+
+public:
+    StaticInitiatorSocket(const char* name_, Module& t,
+        typename SimpleInitiatorSocket<Module, Types>::NBFunc bw,
+        Protocol protocol_, unsigned port_width_) :
+        SimpleInitiatorSocket<Module, Types>(name_, t, bw, protocol_,
+            port_width_),
+        peer(nullptr),
+        peer_socket(nullptr)
+    {}
+
+    /** Is nb_transport_fw bound directly to the peer module? */
+    bool is_static_bound() const { return peer != nullptr; }
+
+    /* Use all other forms of bind from the parent. */
+    using SimpleInitiatorSocket<Module, Types>::bind;
+
+    /** Protocol checked bind, resolving the peer module if possible. */
+    void bind(base_target_socket& socket)
+    {
+        SimpleTargetSocket<PeerModule, Types>* peer_socket_ =
+            dynamic_cast<SimpleTargetSocket<PeerModule, Types>*>(&socket);
+
+        if (peer_socket_ && peer_socket_->get_nb_transport_fw() == PeerFw)
+        {
+            peer = &peer_socket_->get_module();
+            peer_socket = peer_socket_;
+        }
+
+        BaseInitiatorSocket<Types>::bind(socket);
+    }
+
+    /* The timed form is always dispatched through the bound interface. */
+    using SimpleInitiatorSocket<Module, Types>::nb_transport_fw;
+
+    /** Convenience function for fw without time, direct to the peer. */
+    tlm::tlm_sync_enum nb_transport_fw(PayloadType& trans, PhaseType& phase)
+    {
+        if (peer)
+        {
+            const PhaseType request = phase;
+            tlm::tlm_sync_enum reply = (peer->*PeerFw)(trans, phase);
+
+            this->record_nb_transport(SocketStatistics::DIRECTION_FW, trans,
+                request, phase, reply);
+            peer_socket->record_direct_nb_transport_fw(trans, request, phase,
+                reply);
+            return reply;
+        }
+
+        return SimpleInitiatorSocket<Module, Types>::nb_transport_fw(trans,
+            phase);
+    }
+};
+
+/**
+ * Target socket which may be bound to any number of initiators, allowing
+ * an interconnect to serve all of its upstream ports with one socket. The
+ * Module's functions receive the index of the binding a call arrived on,
+ * and replies are sent back on a binding with nb_transport_bw(port, ...).
+ * Binding indices count up from 0 in the order of binding.
+ *
+ * Each binding is protocol/width checked against the initiator. Multi-bind
+ * sockets may not be bound hierarchically.
+ *
+ * Observers see the calls on every binding. Statistics are not gathered.
+ * The Module's functions take no timing annotation, so nb_transport_fw
+ * calls with a non-zero delay are rejected.
+ */
+template <typename Module, typename Types>
+class MultiTargetSocket :
+    public tlm::tlm_target_socket<0, Types, 0, sc_core::SC_ZERO_OR_MORE_BOUND>,
+    public SocketProtocol
+{
+protected:
+    typedef typename Types::tlm_payload_type PayloadType;
+    typedef typename Types::tlm_phase_type PhaseType;
+
+    typedef tlm::tlm_target_socket<0, Types, 0, sc_core::SC_ZERO_OR_MORE_BOUND>
+        SocketType;
+
+public:
+    /** Non blocking transport function pointer. */
+    typedef tlm::tlm_sync_enum (Module::* NBFunc)(unsigned port,
+        PayloadType&, PhaseType&);
+
+    /** Blocking transport function pointer. */
+    typedef void (Module::* BFunc)(unsigned port, PayloadType&,
+        sc_core::sc_time&);
+
+    /** Debug transport function pointer. */
+    typedef unsigned (Module::* DebugFunc)(unsigned port, PayloadType&);
+
+    /** DMI request function pointer. */
+    typedef bool (Module::* DMIFunc)(unsigned port, PayloadType&,
+        tlm::tlm_dmi&);
+
+    typedef tlm::tlm_base_initiator_socket_b<0, tlm::tlm_fw_transport_if<Types>,
+        tlm::tlm_bw_transport_if<Types> > base_initiator_socket;
+
+protected:
+    /** Proxy object implementing the fw transport interface of one binding. */
+    class Proxy : public tlm::tlm_fw_transport_if<Types>
+    {
+    public:
+        /** Owner of the proxy. */
+        MultiTargetSocket<Module, Types>& owner;
+
+        /** Index of the binding. */
+        const unsigned port;
+
+        Proxy(MultiTargetSocket<Module, Types>& owner_, unsigned port_) :
+            owner(owner_), port(port_)
+        {}
+
+        tlm::tlm_sync_enum nb_transport_fw(PayloadType& trans,
+            PhaseType& phase, sc_core::sc_time& delay)
+        {
+            if (delay != sc_core::SC_ZERO_TIME)
+            {
+                std::ostringstream message;
+                message << owner.name() <<
+                    ": nb_transport_fw delay not supported";
+                SC_REPORT_ERROR("/ARM/TLM/MultiTargetSocket",
+                    message.str().c_str());
+            }
+
+            const PhaseType request = phase;
+            tlm::tlm_sync_enum reply = (owner.t.*owner.fw)(port, trans, phase);
+
+            if (!owner.observers.empty())
+            {
+                owner.observers.notify_nb_transport(owner.name(), true, trans,
+                    request, reply, phase);
+            }
+            return reply;
+        }
+
+        void b_transport(PayloadType& trans, sc_core::sc_time& delay)
+        {
+            if (owner.b)
+            {
+                (owner.t.*owner.b)(port, trans, delay);
+
+                if (!owner.observers.empty())
+                {
+                    owner.observers.notify_b_transport(owner.name(), trans,
+                        delay);
+                }
+            }
+            else
+            {
+                std::ostringstream message;
+                message << owner.name() << ": b_transport not implemented";
+                SC_REPORT_ERROR("/ARM/TLM/MultiTargetSocket",
+                    message.str().c_str());
+            }
+        }
+
+        unsigned transport_dbg(PayloadType& trans)
+        {
+            if (owner.dbg)
+                return (owner.t.*owner.dbg)(port, trans);
+            else
+                return 0;
+        }
+
+        bool get_direct_mem_ptr(PayloadType& trans, tlm::tlm_dmi& dmi_data)
+        {
+            if (owner.dmi)
+                return (owner.t.*owner.dmi)(port, trans, dmi_data);
+            else
+                return false;
+        }
+    };
+
+    /** Object and functions to which to defer interface calls. */
+    Module& t;
+    NBFunc fw;
+    BFunc b;
+    DebugFunc dbg;
+    DMIFunc dmi;
+
+    /** Attached observers. */
+    SocketObserverList<Types> observers;
+
+    /**
+     * The socket's own export must be bound, though calls only ever arrive
+     * through the per-binding proxies.
+     */
+    Proxy unbound_proxy;
+
+    /** One proxy per binding, indexed by port. */
+    std::vector<Proxy*> proxies;
+
+public:
+    MultiTargetSocket(const char* name_, Module& t_, NBFunc fw_,
+        Protocol protocol_, unsigned port_width_, DebugFunc dbg_ = nullptr) :
+        SocketType(name_),
+        SocketProtocol(protocol_, port_width_),
+        t(t_), fw(fw_), b(nullptr), dbg(dbg_), dmi(nullptr),
+        unbound_proxy(*this, ~0u)
+    {
+        SocketType::bind(unbound_proxy);
+    }
+
+    ~MultiTargetSocket()
+    {
+        for (Proxy* proxy : proxies)
+            delete proxy;
+    }
+
+    /** Create the proxy for a new binding. */
+    tlm::tlm_fw_transport_if<Types>& get_base_interface()
+    {
+        proxies.push_back(new Proxy(*this, unsigned(proxies.size())));
+        return *proxies.back();
+    }
+
+    /* Use all other forms of bind from the parent. */
+    using SocketType::bind;
+
+    /** Protocol checking bind to an initiator. */
+    void bind(base_initiator_socket& socket)
+    {
+        SocketProtocol* arm_socket = dynamic_cast<SocketProtocol*>(&socket);
+        BaseInitiatorSocket<Types>* arm_base =
+            dynamic_cast<BaseInitiatorSocket<Types>*>(&socket);
+
+        Protocol peer_protocol = protocol;
+        unsigned peer_width = port_width;
+        if (arm_socket)
+        {
+            peer_protocol = arm_socket->protocol;
+            peer_width = arm_socket->port_width;
+        }
+        else if (arm_base)
+        {
+            peer_protocol = arm_base->protocol;
+            peer_width = arm_base->port_width;
+        }
+
+        if (peer_protocol != protocol || peer_width != port_width)
+        {
+            std::ostringstream message;
+            message << this->name() << ": Protocol/width mismatch on socket: "
+                << "(multi target) "
+                << protocol << '/' << port_width
+                << " <-> (initiator) "
+                << peer_protocol << '/' << peer_width;
+            SC_REPORT_ERROR("/ARM/TLM/MultiTargetSocket",
+                message.str().c_str());
+        }
+        SocketType::bind(socket);
+    }
+
+    /** Number of initiators bound so far. */
+    unsigned get_port_count() const
+    {
+        return unsigned(proxies.size());
+    }
+
+    /** Register a blocking transport function. */
+    void register_b_transport(BFunc b_)
+    {
+        b = b_;
+    }
+
+    /** Register a debug transport function. */
+    void register_transport_dbg(DebugFunc dbg_)
+    {
+        dbg = dbg_;
+    }
+
+    /** Register a function to grant DMI regions to initiators. */
+    void register_get_direct_mem_ptr(DMIFunc dmi_)
+    {
+        dmi = dmi_;
+    }
+
+    /** Start passing calls through this socket to observer. */
+    void attach_observer(SocketObserver<Types>& observer)
+    {
+        observers.attach(observer);
+    }
+
+    /** Stop passing calls to observer. */
+    void detach_observer(SocketObserver<Types>& observer)
+    {
+        observers.detach(observer);
+    }
+
+    /** Convenience function for bw without time on one binding. */
+    tlm::tlm_sync_enum nb_transport_bw(unsigned port, PayloadType& trans,
+        PhaseType& phase)
+    {
+        const PhaseType request = phase;
+        sc_core::sc_time delay = sc_core::SC_ZERO_TIME;
+        tlm::tlm_sync_enum reply =
+            (*this)[port]->nb_transport_bw(trans, phase, delay);
+
+        if (!observers.empty())
+        {
+            observers.notify_nb_transport(this->name(), false, trans, request,
+                reply, phase);
+        }
+        return reply;
+    }
+
+    /** Revoke DMI regions overlapping [start, end] on one binding. */
+    void invalidate_direct_mem_ptr(unsigned port, sc_dt::uint64 start,
+        sc_dt::uint64 end)
+    {
+        (*this)[port]->invalidate_direct_mem_ptr(start, end);
+    }
+
+    /** Revoke DMI regions overlapping [start, end] on all bindings. */
+    void invalidate_direct_mem_ptr(sc_dt::uint64 start, sc_dt::uint64 end)
+    {
+        for (int port = 0; port < this->size(); port++)
+            (*this)[port]->invalidate_direct_mem_ptr(start, end);
+    }
+};
+
+/**
+ * Initiator socket which may be bound to any number of targets, allowing
+ * an interconnect to drive all of its downstream ports with one socket.
+ * Calls are made on a binding with nb_transport_fw(port, ...) and the
+ * Module's functions receive the index of the binding a bw call arrived on.
+ * Binding indices count up from 0 in the order of binding.
+ *
+ * Each binding is protocol/width checked against the target. Multi-bind
+ * sockets may not be bound hierarchically.
+ *
+ * Observers see the calls on every binding. Statistics are not gathered.
+ * The Module's functions take no timing annotation, so nb_transport_bw
+ * calls with a non-zero delay are rejected.
+ */
+template <typename Module, typename Types>
+class MultiInitiatorSocket :
+    public tlm::tlm_initiator_socket<0, Types, 0,
+        sc_core::SC_ZERO_OR_MORE_BOUND>,
+    public SocketProtocol
+{
+protected:
+    typedef typename Types::tlm_payload_type PayloadType;
+    typedef typename Types::tlm_phase_type PhaseType;
+
+    typedef tlm::tlm_initiator_socket<0, Types, 0,
+        sc_core::SC_ZERO_OR_MORE_BOUND> SocketType;
+
+public:
+    /** Non blocking transport function pointer. */
+    typedef tlm::tlm_sync_enum (Module::* NBFunc)(unsigned port,
+        PayloadType&, PhaseType&);
+
+    /** DMI invalidation function pointer. */
+    typedef void (Module::* InvalidateFunc)(unsigned port, sc_dt::uint64,
+        sc_dt::uint64);
+
+    typedef tlm::tlm_base_target_socket_b<0, tlm::tlm_fw_transport_if<Types>,
+        tlm::tlm_bw_transport_if<Types> > base_target_socket;
+
+protected:
+    /** Proxy object implementing the bw transport interface of one binding. */
+    class Proxy : public tlm::tlm_bw_transport_if<Types>
+    {
+    public:
+        /** Owner of the proxy. */
+        MultiInitiatorSocket<Module, Types>& owner;
+
+        /** Index of the binding. */
+        const unsigned port;
+
+        Proxy(MultiInitiatorSocket<Module, Types>& owner_, unsigned port_) :
+            owner(owner_), port(port_)
+        {}
+
+        tlm::tlm_sync_enum nb_transport_bw(PayloadType& trans,
+            PhaseType& phase, sc_core::sc_time& delay)
+        {
+            if (delay != sc_core::SC_ZERO_TIME)
+            {
+                std::ostringstream message;
+                message << owner.name() <<
+                    ": nb_transport_bw delay not supported";
+                SC_REPORT_ERROR("/ARM/TLM/MultiInitiatorSocket",
+                    message.str().c_str());
+            }
+
+            const PhaseType request = phase;
+            tlm::tlm_sync_enum reply = (owner.t.*owner.bw)(port, trans, phase);
+
+            if (!owner.observers.empty())
+            {
+                owner.observers.notify_nb_transport(owner.name(), false, trans,
+                    request, reply, phase);
+            }
+            return reply;
+        }
+
+        void invalidate_direct_mem_ptr(sc_dt::uint64 start, sc_dt::uint64 end)
+        {
+            if (owner.inv)
+                (owner.t.*owner.inv)(port, start, end);
+        }
+    };
+
+    /** Object and functions to which to defer interface calls. */
+    Module& t;
+    NBFunc bw;
+    InvalidateFunc inv;
+
+    /** Attached observers. */
+    SocketObserverList<Types> observers;
+
+    /**
+     * The socket's own export must be bound, though calls only ever arrive
+     * through the per-binding proxies.
+     */
+    Proxy unbound_proxy;
+
+    /** One proxy per binding, indexed by port. */
+    std::vector<Proxy*> proxies;
+
+public:
+    MultiInitiatorSocket(const char* name_, Module& t_, NBFunc bw_,
+        Protocol protocol_, unsigned port_width_) :
+        SocketType(name_),
+        SocketProtocol(protocol_, port_width_),
+        t(t_), bw(bw_), inv(nullptr),
+        unbound_proxy(*this, ~0u)
+    {
+        SocketType::bind(unbound_proxy);
+    }
+
+    ~MultiInitiatorSocket()
+    {
+        for (Proxy* proxy : proxies)
+            delete proxy;
+    }
+
+    /** Create the proxy for a new binding. */
+    tlm::tlm_bw_transport_if<Types>& get_base_interface()
+    {
+        proxies.push_back(new Proxy(*this, unsigned(proxies.size())));
+        return *proxies.back();
+    }
+
+    /* Use all other forms of bind from the parent. */
+    using SocketType::bind;
+
+    /** Protocol checking bind to a target. */
+    void bind(base_target_socket& socket)
+    {
+        SocketProtocol* arm_socket = dynamic_cast<SocketProtocol*>(&socket);
+        BaseTargetSocket<Types>* arm_base =
+            dynamic_cast<BaseTargetSocket<Types>*>(&socket);
+
+        Protocol peer_protocol = protocol;
+        unsigned peer_width = port_width;
+        if (arm_socket)
+        {
+            peer_protocol = arm_socket->protocol;
+            peer_width = arm_socket->port_width;
+        }
+        else if (arm_base)
+        {
+            peer_protocol = arm_base->protocol;
+            peer_width = arm_base->port_width;
+        }
+
+        if (peer_protocol != protocol || peer_width != port_width)
+        {
+            std::ostringstream message;
+            message << this->name() << ": Protocol/width mismatch on socket: "
+                << "(multi initiator) "
+                << protocol << '/' << port_width
+                << " <-> (target) "
+                << peer_protocol << '/' << peer_width;
+            SC_REPORT_ERROR("/ARM/TLM/MultiInitiatorSocket",
+                message.str().c_str());
+        }
+        SocketType::bind(socket);
+    }
+
+    /** Number of targets bound so far. */
+    unsigned get_port_count() const
+    {
+        return unsigned(proxies.size());
+    }
+
+    /** Register a function to be called when a target revokes DMI regions. */
+    void register_invalidate_direct_mem_ptr(InvalidateFunc inv_)
+    {
+        inv = inv_;
+    }
+
+    /** Start passing calls through this socket to observer. */
+    void attach_observer(SocketObserver<Types>& observer)
+    {
+        observers.attach(observer);
+    }
+
+    /** Stop passing calls to observer. */
+    void detach_observer(SocketObserver<Types>& observer)
+    {
+        observers.detach(observer);
+    }
+
+    /** Convenience function for fw without time on one binding. */
+    tlm::tlm_sync_enum nb_transport_fw(unsigned port, PayloadType& trans,
+        PhaseType& phase)
+    {
+        const PhaseType request = phase;
+        sc_core::sc_time delay = sc_core::SC_ZERO_TIME;
+        tlm::tlm_sync_enum reply =
+            (*this)[port]->nb_transport_fw(trans, phase, delay);
+
+        if (!observers.empty())
+        {
+            observers.notify_nb_transport(this->name(), true, trans, request,
+                reply, phase);
+        }
+        return reply;
+    }
+
+    /** Convenience function for b_transport on one binding. */
+    void b_transport(unsigned port, PayloadType& trans, sc_core::sc_time& delay)
+    {
+        (*this)[port]->b_transport(trans, delay);
+
+        if (!observers.empty())
+            observers.notify_b_transport(this->name(), trans, delay);
+    }
+
+    /** Convenience function for debug transport on one binding. */
+    unsigned transport_dbg(unsigned port, PayloadType& trans)
+    {
+        return (*this)[port]->transport_dbg(trans);
+    }
+
+    /** Convenience function to request DMI on one binding. */
+    bool get_direct_mem_ptr(unsigned port, PayloadType& trans,
+        tlm::tlm_dmi& dmi)
+    {
+        return (*this)[port]->get_direct_mem_ptr(trans, dmi);
     }
 };
 
@@ -0,0 +1,409 @@
+/*
+ * The Clear BSD License
+ *
+ * Copyright (c) 2015-2021 Arm Limited.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *      * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *
+ *      * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *      * Neither the name of the copyright holder nor the names of its
+ *      contributors may be used to endorse or promote products derived from
+ *      this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ARM_TLM_STATS_H
+#define ARM_TLM_STATS_H
+
+#include <tlm.h>
+#include <iomanip>
+#include <ostream>
+#include <stdint.h>
+
+namespace ARM
+{
+namespace TLM
+{
+
+/**
+ * Socket instrumentation. BaseTargetSocket and BaseInitiatorSocket count
+ * the nb_transport calls passing through them, how they were answered, the
+ * data beats carried and the number of transactions outstanding. Counting
+ * is compiled in only when ARM_TLM_SOCKET_STATS is defined; otherwise
+ * SocketStatistics is an empty type whose query API reports zeros, and the
+ * sockets carry no recording overhead. As it changes the layout of every
+ * socket, ARM_TLM_SOCKET_STATS is a build option of the libraries (the
+ * CMake option of that name, or the socket_stats Conan option) which is
+ * passed on to their users, rather than a macro to define per file.
+ *
+ * Calls are counted per phase class, a protocol specific grouping of phases
+ * (e.g. per channel and VALID/READY for AXI) given by SocketStatsPolicy.
+ */
+
+/** Events a phase represents, combined as a mask by SocketStatsPolicy. */
+enum SocketStatsEvent
+{
+    STATS_EVENT_NONE  = 0,
+    STATS_EVENT_BEGIN = 1, /* A transaction starts. */
+    STATS_EVENT_END   = 2, /* A transaction completes. */
+    STATS_EVENT_BEAT  = 4  /* A data beat is transferred. */
+};
+
+/**
+ * Protocol hooks used to classify phases for socket statistics. A protocol
+ * specialises SocketStatsPolicy for its Types. Without a specialisation,
+ * all calls are counted in a single class and no events are recognised.
+ */
+template <typename Types>
+class SocketStatsPolicy
+{
+public:
+    typedef typename Types::tlm_payload_type PayloadType;
+    typedef typename Types::tlm_phase_type PhaseType;
+
+    /** Number of phase classes. At most SocketStatistics::MAX_PHASE_CLASSES. */
+    static const unsigned phase_class_count = 1;
+
+    /** Class of phase. */
+    static unsigned phase_class(const PhaseType&) { return 0; }
+
+    /** Name of a phase class for printing, or nullptr if it's unused. */
+    static const char* phase_class_name(unsigned) { return "ALL"; }
+
+    /** SocketStatsEvent mask for phase on a port of port_width bits. */
+    static unsigned events(const PayloadType&, const PhaseType&,
+        unsigned /* port_width */)
+    {
+        return STATS_EVENT_NONE;
+    }
+
+    /** Data beats carried by a b_transport of trans. */
+    static unsigned beat_count(const PayloadType&, unsigned /* port_width */)
+    {
+        return 0;
+    }
+};
+
+/** Types and constants shared by both forms of SocketStatistics. */
+class SocketStatisticsTypes
+{
+public:
+    static const unsigned MAX_PHASE_CLASSES = 32;
+
+    /** Is counting compiled in? */
+#ifdef ARM_TLM_SOCKET_STATS
+    static const bool enabled = true;
+#else
+    static const bool enabled = false;
+#endif
+
+    enum Direction
+    {
+        DIRECTION_FW = 0,
+        DIRECTION_BW = 1
+    };
+
+    /** Calls of one phase class and how they were answered. */
+    class CallCounts
+    {
+    public:
+        uint64_t calls;
+        uint64_t accepted;
+        uint64_t updated;
+        uint64_t completed;
+
+        CallCounts() : calls(0), accepted(0), updated(0), completed(0) {}
+
+        CallCounts& operator+= (const CallCounts& rhs)
+        {
+            calls += rhs.calls;
+            accepted += rhs.accepted;
+            updated += rhs.updated;
+            completed += rhs.completed;
+            return *this;
+        }
+    };
+};
+
+#ifdef ARM_TLM_SOCKET_STATS
+
+/** Counters gathered by a socket. */
+class SocketStatistics : public SocketStatisticsTypes
+{
+private:
+    CallCounts counts[2][MAX_PHASE_CLASSES];
+
+    uint64_t b_transport_calls;
+    uint64_t beats;
+    uint64_t transactions;
+
+    unsigned outstanding;
+    unsigned peak_outstanding;
+
+    /** Integral of outstanding over time, in transaction seconds. */
+    double occupancy_integral;
+
+    /** Time outstanding last changed and time counting (re)started. */
+    sc_core::sc_time last_change;
+    sc_core::sc_time start;
+
+    /** Integral of outstanding up to the current time. */
+    double occupancy_to_now() const
+    {
+        return occupancy_integral + outstanding *
+            (sc_core::sc_time_stamp() - last_change).to_seconds();
+    }
+
+    void set_outstanding(unsigned value)
+    {
+        occupancy_integral = occupancy_to_now();
+        last_change = sc_core::sc_time_stamp();
+        outstanding = value;
+        if (outstanding > peak_outstanding)
+            peak_outstanding = outstanding;
+    }
+
+public:
+    SocketStatistics() { reset(); }
+
+    /** Clear all counters and restart rate measurements from now. */
+    void reset()
+    {
+        for (unsigned direction = 0; direction < 2; direction++)
+        {
+            for (unsigned phase_class = 0; phase_class < MAX_PHASE_CLASSES;
+                phase_class++)
+            {
+                counts[direction][phase_class] = CallCounts();
+            }
+        }
+
+        b_transport_calls = 0;
+        beats = 0;
+        transactions = 0;
+        peak_outstanding = outstanding = 0;
+        occupancy_integral = 0;
+        last_change = start = sc_core::sc_time_stamp();
+    }
+
+    /** Count a call of phase_class answered with reply. */
+    void record_call(Direction direction, unsigned phase_class,
+        tlm::tlm_sync_enum reply)
+    {
+        CallCounts& count = counts[direction][phase_class];
+
+        count.calls++;
+        switch (reply)
+        {
+        case tlm::TLM_ACCEPTED: count.accepted++; break;
+        case tlm::TLM_UPDATED: count.updated++; break;
+        case tlm::TLM_COMPLETED: count.completed++; break;
+        }
+    }
+
+    /** Account for a SocketStatsEvent mask. */
+    void record_events(unsigned events)
+    {
+        if (events & STATS_EVENT_BEAT)
+            beats++;
+        if (events & STATS_EVENT_BEGIN)
+        {
+            transactions++;
+            set_outstanding(outstanding + 1);
+        }
+        /* Tolerate completions of transactions begun before a reset. */
+        if ((events & STATS_EVENT_END) && outstanding != 0)
+            set_outstanding(outstanding - 1);
+    }
+
+    /** Count a b_transport carrying beat_count beats. */
+    void record_b_transport(unsigned beat_count)
+    {
+        b_transport_calls++;
+        transactions++;
+        beats += beat_count;
+    }
+
+    const CallCounts& get_calls(Direction direction, unsigned phase_class) const
+    {
+        return counts[direction][phase_class];
+    }
+
+    /** Calls summed over all phase classes. */
+    CallCounts get_total_calls(Direction direction) const
+    {
+        CallCounts total;
+        for (unsigned phase_class = 0; phase_class < MAX_PHASE_CLASSES;
+            phase_class++)
+        {
+            total += counts[direction][phase_class];
+        }
+        return total;
+    }
+
+    uint64_t get_b_transport_calls() const { return b_transport_calls; }
+    uint64_t get_beats() const { return beats; }
+    uint64_t get_transactions() const { return transactions; }
+    unsigned get_outstanding() const { return outstanding; }
+    unsigned get_peak_outstanding() const { return peak_outstanding; }
+
+    /** Simulated time since counting (re)started. */
+    sc_core::sc_time get_elapsed() const
+    {
+        return sc_core::sc_time_stamp() - start;
+    }
+
+    /** Mean number of outstanding transactions since counting started. */
+    double get_average_occupancy() const
+    {
+        double elapsed = get_elapsed().to_seconds();
+        return elapsed > 0 ? occupancy_to_now() / elapsed : outstanding;
+    }
+
+    /** Data beats per simulated second since counting started. */
+    double get_beats_per_second() const
+    {
+        double elapsed = get_elapsed().to_seconds();
+        return elapsed > 0 ? beats / elapsed : 0;
+    }
+};
+
+#else
+
+/** Counters gathered by a socket: none, as counting is not compiled in. */
+class SocketStatistics : public SocketStatisticsTypes
+{
+public:
+    void reset() {}
+
+    void record_call(Direction, unsigned, tlm::tlm_sync_enum) {}
+    void record_events(unsigned) {}
+    void record_b_transport(unsigned) {}
+
+    const CallCounts& get_calls(Direction, unsigned) const
+    {
+        static const CallCounts none;
+        return none;
+    }
+
+    CallCounts get_total_calls(Direction) const { return CallCounts(); }
+
+    uint64_t get_b_transport_calls() const { return 0; }
+    uint64_t get_beats() const { return 0; }
+    uint64_t get_transactions() const { return 0; }
+    unsigned get_outstanding() const { return 0; }
+    unsigned get_peak_outstanding() const { return 0; }
+
+    sc_core::sc_time get_elapsed() const { return sc_core::SC_ZERO_TIME; }
+
+    double get_average_occupancy() const { return 0; }
+    double get_beats_per_second() const { return 0; }
+};
+
+#endif
+
+/** Count a nb_transport call of request answered with reply/reply_phase. */
+template <typename Types>
+inline void socket_stats_record_nb_transport(SocketStatistics& stats,
+    unsigned port_width, SocketStatistics::Direction direction,
+    const typename Types::tlm_payload_type& trans,
+    const typename Types::tlm_phase_type& request,
+    const typename Types::tlm_phase_type& reply_phase,
+    tlm::tlm_sync_enum reply)
+{
+#ifdef ARM_TLM_SOCKET_STATS
+    typedef SocketStatsPolicy<Types> Policy;
+
+    stats.record_call(direction, Policy::phase_class(request), reply);
+    stats.record_events(Policy::events(trans, request, port_width));
+    if (reply == tlm::TLM_UPDATED)
+        stats.record_events(Policy::events(trans, reply_phase, port_width));
+#else
+    (void) stats;
+    (void) port_width;
+    (void) direction;
+    (void) trans;
+    (void) request;
+    (void) reply_phase;
+    (void) reply;
+#endif
+}
+
+/** Count a b_transport call of trans. */
+template <typename Types>
+inline void socket_stats_record_b_transport(SocketStatistics& stats,
+    unsigned port_width, const typename Types::tlm_payload_type& trans)
+{
+#ifdef ARM_TLM_SOCKET_STATS
+    stats.record_b_transport(
+        SocketStatsPolicy<Types>::beat_count(trans, port_width));
+#else
+    (void) stats;
+    (void) port_width;
+    (void) trans;
+#endif
+}
+
+/** Print stats, naming phase classes with the protocol's policy. */
+template <typename Types>
+void socket_stats_print(std::ostream& stream, const char* name,
+    const SocketStatistics& stats)
+{
+    typedef SocketStatsPolicy<Types> Policy;
+    static const char* const direction_names[2] = { "fw", "bw" };
+
+    stream << name << ": transactions: " << stats.get_transactions()
+        << " (b_transport: " << stats.get_b_transport_calls() << ')'
+        << " beats: " << stats.get_beats()
+        << " beats/s: " << stats.get_beats_per_second()
+        << " outstanding now/peak/mean: " << stats.get_outstanding()
+        << '/' << stats.get_peak_outstanding()
+        << '/' << stats.get_average_occupancy() << '\n';
+
+    for (unsigned direction = 0; direction < 2; direction++)
+    {
+        for (unsigned phase_class = 0; phase_class < Policy::phase_class_count;
+            phase_class++)
+        {
+            const SocketStatistics::CallCounts& count = stats.get_calls(
+                SocketStatistics::Direction(direction), phase_class);
+            const char* class_name = Policy::phase_class_name(phase_class);
+
+            if (count.calls == 0 || !class_name)
+                continue;
+
+            stream << name << ": " << direction_names[direction] << ' '
+                << std::left << std::setw(16) << class_name << std::right
+                << " calls: " << count.calls
+                << " accepted/updated/completed: " << count.accepted
+                << '/' << count.updated
+                << '/' << count.completed << '\n';
+        }
+    }
+}
+
+}
+}
+
+#endif /* ARM_TLM_STATS_H */
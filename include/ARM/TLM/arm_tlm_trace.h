@@ -0,0 +1,638 @@
+/*
+ * The Clear BSD License
+ *
+ * Copyright (c) 2015-2021 Arm Limited.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *      * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *
+ *      * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *      * Neither the name of the copyright holder nor the names of its
+ *      contributors may be used to endorse or promote products derived from
+ *      this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ARM_TLM_TRACE_H
+#define ARM_TLM_TRACE_H
+
+#include <stdint.h>
+#include <cassert>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ARM_TLM_TRACE_MMAP
+#endif
+
+namespace ARM
+{
+namespace TLM
+{
+
+/**
+ * Report a trace usage error. This follows the libraries'
+ * runtime_error_assert behaviour: throw a std::runtime_error unless
+ * ARM_TLM_ERRORS_WITH_ASSERT is defined.
+ */
+inline void trace_assert(bool cond, const char* message)
+{
+#ifdef ARM_TLM_ERRORS_WITH_ASSERT
+    assert(cond && message);
+    (void) cond;
+    (void) message;
+#else
+    if (!cond)
+    {
+        std::ostringstream stream;
+        stream << "Trace error: " << message;
+        throw std::runtime_error(stream.str());
+    }
+#endif
+}
+
+/**
+ * One transaction of a replay trace. A trace file is a TraceHeader followed
+ * by record_count records, all in host byte order. The protocol fields are
+ * interpreted by the replaying model, e.g. 'opcode' is an AXI Command or a
+ * CHI ReqOpcode.
+ */
+struct TraceRecord
+{
+    /** Cycle the transaction was issued, counted from the trace start. */
+    uint64_t time;
+    uint64_t address;
+
+    /**
+     * Number of records back to the record whose completion this one waits
+     * for, or 0 for none.
+     */
+    uint32_t dependency;
+
+    /** Transaction ID, where the protocol has one chosen by the requester. */
+    uint16_t id;
+
+    uint8_t opcode;
+
+    /** log2 of the bytes per beat (AXI) or of the transfer size (CHI). */
+    uint8_t size;
+
+    /** Beats minus one and burst type, for AXI. */
+    uint8_t len;
+    uint8_t burst;
+
+    uint8_t reserved[6];
+};
+
+static_assert(sizeof(TraceRecord) == 32, "trace records are 32 bytes");
+
+/** Leading header of a trace file. */
+struct TraceHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t record_count;
+};
+
+static const uint32_t TRACE_VERSION = 1;
+
+inline const char* trace_magic() { return "ARMTLMTR"; }
+
+/**
+ * Writer of trace files, e.g. for converting captured traces. Records are
+ * appended with write() and the header is completed by close().
+ */
+class TraceWriter
+{
+private:
+    std::FILE* file;
+    uint64_t record_count;
+    bool ok;
+
+    /** Forbid copying: the file is owned by the writer. */
+    TraceWriter(const TraceWriter&);
+    TraceWriter& operator= (const TraceWriter&);
+
+    bool write_header()
+    {
+        TraceHeader header;
+        std::memcpy(header.magic, trace_magic(), sizeof(header.magic));
+        header.version = TRACE_VERSION;
+        header.record_size = sizeof(TraceRecord);
+        header.record_count = record_count;
+
+        return std::fwrite(&header, sizeof(header), 1, file) == 1;
+    }
+
+public:
+    TraceWriter() : file(nullptr), record_count(0), ok(false) {}
+    ~TraceWriter() { close(); }
+
+    /** Start a new trace at 'path'. Returns false on an I/O error. */
+    bool open(const char* path)
+    {
+        close();
+
+        file = std::fopen(path, "wb");
+        if (!file)
+            return false;
+
+        record_count = 0;
+        ok = write_header();
+        return ok;
+    }
+
+    void write(const TraceRecord& record)
+    {
+        trace_assert(file != nullptr, "write to a trace writer not open");
+
+        ok = std::fwrite(&record, sizeof(record), 1, file) == 1 && ok;
+        record_count++;
+    }
+
+    uint64_t get_record_count() const { return record_count; }
+
+    /**
+     * Complete the header and close the file. Returns false on an I/O
+     * error.
+     */
+    bool close()
+    {
+        if (!file)
+            return false;
+
+        ok = std::fseek(file, 0, SEEK_SET) == 0 && write_header() && ok;
+        ok = std::fclose(file) == 0 && ok;
+        file = nullptr;
+
+        return ok;
+    }
+};
+
+/**
+ * Sequential reader of trace files. The file is mapped rather than read, and
+ * the kernel is told to read ahead a bounded window beyond the current record
+ * and to drop pages behind it, so traces far larger than memory stream
+ * through a resident set of about two windows.
+ *
+ * Mapping needs POSIX; elsewhere open() always fails.
+ */
+class TraceReader
+{
+private:
+    const uint8_t* map;
+    std::size_t map_length;
+    int fd;
+
+    /** Bytes to read ahead, a multiple of the system page size. */
+    std::size_t read_ahead;
+    std::size_t page_size;
+
+    uint64_t record_count;
+    uint64_t index;
+    TraceRecord current;
+
+    /** File offsets up to which read ahead was requested and pages dropped. */
+    std::size_t prefetched;
+    std::size_t released;
+
+    /** Forbid copying: the mapping is owned by the reader. */
+    TraceReader(const TraceReader&);
+    TraceReader& operator= (const TraceReader&);
+
+    std::size_t record_offset(uint64_t i) const
+    {
+        return sizeof(TraceHeader) + i * sizeof(TraceRecord);
+    }
+
+    /** Keep the read ahead window in front of record 'index'. */
+    void advance_window()
+    {
+#ifdef ARM_TLM_TRACE_MMAP
+        const std::size_t offset = record_offset(index);
+
+        if (offset + read_ahead / 2 >= prefetched && prefetched < map_length)
+        {
+            std::size_t length = read_ahead;
+            if (length > map_length - prefetched)
+                length = map_length - prefetched;
+
+            madvise(const_cast<uint8_t*>(map) + prefetched, length,
+                MADV_WILLNEED);
+            prefetched += length;
+        }
+
+        const std::size_t keep = offset & ~(page_size - 1);
+        if (keep >= released + read_ahead)
+        {
+            madvise(const_cast<uint8_t*>(map) + released, keep - released,
+                MADV_DONTNEED);
+            released = keep;
+        }
+#endif
+    }
+
+    void load_current()
+    {
+        if (index < record_count)
+        {
+            std::memcpy(&current, map + record_offset(index), sizeof(current));
+            advance_window();
+        }
+    }
+
+public:
+    /**
+     * Make a reader with no trace open. 'read_ahead' bytes are requested
+     * ahead of the current record.
+     */
+    explicit TraceReader(std::size_t read_ahead_ = 4 << 20) :
+        map(nullptr),
+        map_length(0),
+        fd(-1),
+        read_ahead(read_ahead_),
+        page_size(4096),
+        record_count(0),
+        index(0),
+        current(),
+        prefetched(0),
+        released(0)
+    {
+#ifdef ARM_TLM_TRACE_MMAP
+        page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#endif
+        read_ahead = (read_ahead + page_size - 1) & ~(page_size - 1);
+        if (read_ahead == 0)
+            read_ahead = page_size;
+    }
+
+    ~TraceReader() { close(); }
+
+    /**
+     * Open the trace at 'path'. Returns false if it cannot be mapped or is
+     * not a trace of this version.
+     */
+    bool open(const char* path)
+    {
+        close();
+
+#ifdef ARM_TLM_TRACE_MMAP
+        fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat status;
+        TraceHeader header;
+        if (fstat(fd, &status) != 0 ||
+            static_cast<uint64_t>(status.st_size) < sizeof(header))
+        {
+            close();
+            return false;
+        }
+
+        map_length = static_cast<std::size_t>(status.st_size);
+        void* data = mmap(nullptr, map_length, PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            map_length = 0;
+            close();
+            return false;
+        }
+        map = static_cast<const uint8_t*>(data);
+
+        std::memcpy(&header, map, sizeof(header));
+        if (std::memcmp(header.magic, trace_magic(),
+                sizeof(header.magic)) != 0 ||
+            header.version != TRACE_VERSION ||
+            header.record_size != sizeof(TraceRecord) ||
+            header.record_count >
+                (map_length - sizeof(header)) / sizeof(TraceRecord))
+        {
+            close();
+            return false;
+        }
+
+        madvise(const_cast<uint8_t*>(map), map_length, MADV_SEQUENTIAL);
+
+        record_count = header.record_count;
+        load_current();
+
+        return true;
+#else
+        (void) path;
+        return false;
+#endif
+    }
+
+    void close()
+    {
+#ifdef ARM_TLM_TRACE_MMAP
+        if (map)
+            munmap(const_cast<uint8_t*>(map), map_length);
+        if (fd >= 0)
+            ::close(fd);
+#endif
+        map = nullptr;
+        map_length = 0;
+        fd = -1;
+        record_count = 0;
+        index = 0;
+        prefetched = 0;
+        released = 0;
+    }
+
+    bool is_open() const { return map != nullptr; }
+
+    uint64_t get_record_count() const { return record_count; }
+
+    /** Index of the current record. */
+    uint64_t get_index() const { return index; }
+
+    bool at_end() const { return index >= record_count; }
+
+    /** The current record. Not valid at_end(). */
+    const TraceRecord& front() const { return current; }
+
+    /** Move on to the next record. */
+    void pop()
+    {
+        trace_assert(!at_end(), "pop past the end of a trace");
+
+        index++;
+        load_current();
+    }
+};
+
+/** How TraceReplay decides when a record may issue. */
+enum TraceMode
+{
+    /** At its recorded time, ignoring dependencies. */
+    TRACE_MODE_ISSUE_TIME,
+
+    /**
+     * Once the record it depends on has completed and the recorded gap since
+     * the previous record has passed since that record actually issued.
+     */
+    TRACE_MODE_DEPENDENCY
+};
+
+/**
+ * Replay scheduling of a trace, shared by the protocol specific replay
+ * models. The model asks can_issue() each cycle, issues the record taken by
+ * issue() and reports its completion with complete().
+ *
+ * Records issue in trace order, with at most 'max_outstanding' in flight.
+ * Outstanding records are held in a table indexed by record index modulo
+ * 'max_outstanding', so a record also waits while the record
+ * 'max_outstanding' before it is still in flight.
+ *
+ * The slip of a transaction is how many cycles after its target time it
+ * actually issued: its recorded time, or in TRACE_MODE_DEPENDENCY the
+ * previous record's actual issue time plus the recorded gap, so a stall is
+ * counted once rather than against every later record. Slips are
+ * summarised, and when a log stream is set, one line is written per
+ * completed transaction:
+ *
+ *     index,trace_time,issue_time,complete_time,slip
+ */
+class TraceReplay
+{
+private:
+    struct Outstanding
+    {
+        uint64_t index;
+        uint64_t trace_time;
+        uint64_t issue_time;
+        uint64_t slip;
+        bool valid;
+    };
+
+    TraceReader reader;
+    TraceMode mode;
+    unsigned max_outstanding;
+    std::ostream* log;
+
+    /** Outstanding records, at index modulo max_outstanding. */
+    std::vector<Outstanding> outstanding;
+    std::size_t outstanding_count;
+
+    /** Recorded and actual issue time of the previous record. */
+    uint64_t last_trace_time;
+    uint64_t last_issue_time;
+
+    uint64_t issued;
+    uint64_t completed;
+    uint64_t late;
+    uint64_t total_slip;
+    uint64_t max_slip;
+    uint64_t total_latency;
+
+    const Outstanding& slot(uint64_t index) const
+    {
+        return outstanding[index % max_outstanding];
+    }
+
+    bool is_outstanding(uint64_t index) const
+    {
+        const Outstanding& entry = slot(index);
+        return entry.valid && entry.index == index;
+    }
+
+    /** Earliest cycle the current record may issue, ignoring other limits. */
+    uint64_t earliest_issue() const
+    {
+        const TraceRecord& record = reader.front();
+
+        if (mode == TRACE_MODE_ISSUE_TIME || issued == 0)
+            return record.time;
+
+        const uint64_t gap = record.time > last_trace_time ?
+            record.time - last_trace_time : 0;
+        return last_issue_time + gap;
+    }
+
+public:
+    explicit TraceReplay(TraceMode mode_ = TRACE_MODE_ISSUE_TIME,
+        unsigned max_outstanding_ = 64,
+        std::size_t read_ahead = 4 << 20) :
+        reader(read_ahead),
+        mode(mode_),
+        max_outstanding(max_outstanding_),
+        log(nullptr),
+        outstanding_count(0),
+        last_trace_time(0),
+        last_issue_time(0),
+        issued(0),
+        completed(0),
+        late(0),
+        total_slip(0),
+        max_slip(0),
+        total_latency(0)
+    {
+        trace_assert(max_outstanding != 0, "max_outstanding must be non-zero");
+        outstanding.resize(max_outstanding, Outstanding());
+    }
+
+    /** Open the trace to replay. Returns false if it cannot be read. */
+    bool open(const char* path) { return reader.open(path); }
+
+    /** Write a line per completed transaction to 'stream', or stop if null. */
+    void set_log(std::ostream* stream) { log = stream; }
+
+    TraceMode get_mode() const { return mode; }
+
+    /** The record the next issue() takes. Not valid once all have issued. */
+    const TraceRecord& front() const { return reader.front(); }
+
+    /** Have all records issued? */
+    bool all_issued() const { return reader.at_end(); }
+
+    /** Have all records issued and completed? */
+    bool is_done() const
+    {
+        return reader.at_end() && outstanding_count == 0;
+    }
+
+    /** May the next record issue at cycle 'now'? */
+    bool can_issue(uint64_t now) const
+    {
+        if (reader.at_end())
+            return false;
+
+        const uint64_t index = reader.get_index();
+        if (slot(index).valid || earliest_issue() > now)
+            return false;
+
+        const TraceRecord& record = reader.front();
+
+        return mode != TRACE_MODE_DEPENDENCY || record.dependency == 0 ||
+            record.dependency > index ||
+            !is_outstanding(index - record.dependency);
+    }
+
+    /**
+     * Take the next record, issuing it at cycle 'now'. Returns its index,
+     * which identifies it to complete().
+     */
+    uint64_t issue(uint64_t now, TraceRecord& record)
+    {
+        trace_assert(!reader.at_end(), "issue past the end of a trace");
+
+        const uint64_t index = reader.get_index();
+        trace_assert(!slot(index).valid,
+            "issue of a record whose slot is busy");
+
+        const uint64_t target = earliest_issue();
+        const uint64_t slip = now > target ? now - target : 0;
+
+        record = reader.front();
+
+        Outstanding& entry = outstanding[index % max_outstanding];
+        entry.index = index;
+        entry.trace_time = record.time;
+        entry.issue_time = now;
+        entry.slip = slip;
+        entry.valid = true;
+        outstanding_count++;
+
+        if (slip != 0)
+            late++;
+        total_slip += slip;
+        if (slip > max_slip)
+            max_slip = slip;
+
+        last_trace_time = record.time;
+        last_issue_time = now;
+        issued++;
+
+        reader.pop();
+        return index;
+    }
+
+    /** Record index 'index' completed at cycle 'now'. */
+    void complete(uint64_t index, uint64_t now)
+    {
+        trace_assert(is_outstanding(index),
+            "completion of a record not outstanding");
+
+        Outstanding& entry = outstanding[index % max_outstanding];
+        total_latency += now - entry.issue_time;
+        completed++;
+
+        if (log)
+        {
+            *log << entry.index << ',' << entry.trace_time << ','
+                << entry.issue_time << ',' << now << ',' << entry.slip << '\n';
+        }
+
+        entry.valid = false;
+        outstanding_count--;
+    }
+
+    uint64_t get_record_count() const { return reader.get_record_count(); }
+    uint64_t get_issued() const { return issued; }
+    uint64_t get_completed() const { return completed; }
+    std::size_t get_outstanding() const { return outstanding_count; }
+
+    /** Number of transactions issued after their recorded time. */
+    uint64_t get_late() const { return late; }
+
+    uint64_t get_max_slip() const { return max_slip; }
+
+    double get_average_slip() const
+    {
+        return issued ? static_cast<double>(total_slip) / issued : 0;
+    }
+
+    /** Mean cycles from issue to completion. */
+    double get_average_latency() const
+    {
+        return completed ? static_cast<double>(total_latency) / completed : 0;
+    }
+
+    /** Print a one line summary of the replay. */
+    void print_summary(std::ostream& stream, const char* name) const
+    {
+        stream << name << ": records: " << issued << '/'
+            << reader.get_record_count()
+            << " completed: " << completed
+            << " late: " << late
+            << " slip mean/max: " << get_average_slip() << '/' << max_slip
+            << " latency mean: " << get_average_latency() << '\n';
+    }
+};
+
+}
+}
+
+#endif /* ARM_TLM_TRACE_H */
@@ -46,15 +46,7 @@
 #include <vector>
 
 #include <ARM/TLM/arm_axi4_payload.h>
-
-#ifdef ARM_TLM_ENABLE_VALGRIND
-#include <valgrind/memcheck.h>
-#else
-#define VALGRIND_CREATE_MEMPOOL(d1, d2, d3) do {} while (0)
-#define VALGRIND_DESTROY_MEMPOOL(d1) do {} while (0)
-#define VALGRIND_MEMPOOL_ALLOC(d1, d2, d3) do {} while (0)
-#define VALGRIND_MEMPOOL_FREE(d1, d2) do {} while (0)
-#endif
+#include <ARM/TLM/arm_tlm_payload_pool.h>
 
 #ifndef ARM_TLM_EXPORT
 #define ARM_TLM_EXPORT
@@ -113,7 +105,7 @@ class PayloadData
 {
 public:
     /** Reference count similar to Payload's reference counting mechanism. */
-    mutable unsigned refcount;
+    mutable TLM::PoolRefCount refcount;
 
     /**
      * If true: the data is longer than 64 bytes and must be allocated and
@@ -237,263 +229,68 @@ public:
  * PayloadData's contain long data) but maintains free lists of objects returned
  * to the pool from which new objects are created.
  */
-class PayloadPool
+class PayloadPool :
+    public TLM::PayloadPoolCore<Payload, PayloadExtensionManager>
 {
 private:
-    /** The unique ID of the next Payload to be created. */
-    uint64_t next_uid;
-
-    /**
-     * Size of the Payload object will all registered extensions. All Payloads
-     * will have the same size.
-     */
-    std::size_t payload_size;
-
-    /**
-     * Set to true once the first Payload is requested. Extensions may not be
-     * registered once pool_fixed becomes true.
-     */
-    bool pool_fixed;
-
-    /** Number of allocated Payloads in existence. */
-    std::size_t allocated_payload_count;
-
-    /** Number of allocated PayloadDatas in existence. */
-    std::size_t allocated_payload_data_count;
-
-    /** LIFO free list of allocated Payload objects. */
-    std::vector<Payload*> payload_pool;
+    /** Storage for PayloadData objects. */
+    TLM::ObjectPool payload_datas;
 
-    /** LIFO free list of allocated PayloadData objects. */
-    std::vector<PayloadData*> payload_data_pool;
-
-    /** ExtensionEntry class holidng an extensuion manager and offset */
-    class ExtensionEntry
+    class PayloadExtensionManagerNop:
+        public PayloadExtensionManager
     {
     public:
-        std::size_t offset;
-        PayloadExtensionManager* manager;
-        ExtensionEntry(std::size_t offset_, PayloadExtensionManager* manager_):
-            offset(offset_),
-            manager(manager_)
-        {}
-        ExtensionEntry(){}
+        std::size_t get_size() { return 0; }
     };
-    /** Map of extension names to ExtensionEntries */
-    std::map<std::string, ExtensionEntry> extension_map;
-
-    /** Debug allocation of new payloads. */
-    bool debug_unique;
-    bool debug_always_free;
 
 public:
     /** Dummy payload for qos accept passing etc.*/
     PayloadData dummy_payload_data;
     Payload dummy_payload;
 
-    /** Registered new/delete for allocations within the pool. */
-    void* (*local_malloc)(size_t size);
-    void (*local_free)(void* ptr);
-
-    /** Return the next unique ID and advance next_id. */
-    uint64_t get_uid() { return next_uid++; }
-
-    /** Return a Payload to the payload free list. */
-    void free_payload(Payload* payload)
-    {
-        for (std::map<std::string, ExtensionEntry>::iterator it =
-            extension_map.begin(); it!=extension_map.end(); ++it)
-        {
-            ExtensionEntry ext = it->second;
-            ext.manager->destroy(
-                reinterpret_cast<char*>(payload) + ext.offset);
-        }
-        VALGRIND_MEMPOOL_FREE(payload, payload);
-        VALGRIND_DESTROY_MEMPOOL(payload);
-        if (debug_always_free)
-        {
-            local_free(payload);
-            allocated_payload_count--;
-
-        } else if (!debug_unique)
-        {
-            payload_pool.push_back(payload);
-        }
-    }
-
-    /** Return a PayloadData to the payload data free list. */
-    void free_payload_data(PayloadData* payload_data)
-    {
-        VALGRIND_MEMPOOL_FREE(payload_data, payload_data);
-        VALGRIND_DESTROY_MEMPOOL(payload_data);
-        if (debug_always_free)
-        {
-            local_free(payload_data);
-            allocated_payload_data_count--;
-
-        } else if (!debug_unique)
-        {
-            payload_data_pool.push_back(payload_data);
-        }
-    }
-
     PayloadPool() :
-        next_uid(1),
-        /* payload_size wil grow as extensions are added. */
-        payload_size(sizeof(Payload)),
-        pool_fixed(false),
-        allocated_payload_count(0),
-        allocated_payload_data_count(0),
-        debug_unique(false),
-        debug_always_free(false),
+        payload_datas(*this, sizeof(PayloadData), debug_mode),
         dummy_payload_data(COMMAND_READ, SIZE_1, 0, BURST_WRAP),
-        dummy_payload(&dummy_payload_data, 0, 0),
-        local_malloc(std::malloc),
-        local_free(std::free)
-    {
-        char* env_val = getenv("ARM_TLM_DEBUG_ALLOC");
-        if (env_val)
-        {
-            debug_unique = (std::string(env_val) == "UNIQUE");
-            debug_always_free = (std::string(env_val) == "ALWAYS_FREE");
-        }
-    }
-
-    /**
-     * Create a new Payload either by allocating a new object or recycling a
-     * Payload from the payload free list.
-     */
-    Payload* new_payload(const Payload* parent = nullptr)
-    {
-        Payload* payload;
-
-        if (payload_pool.empty())
-        {
-            pool_fixed = true;
-            payload = reinterpret_cast<Payload*>(local_malloc(payload_size));
-            allocated_payload_count++;
-        } else
-        {
-            payload = payload_pool.back();
-            payload_pool.pop_back();
-        }
-
-        VALGRIND_CREATE_MEMPOOL(payload, 0, 0);
-        VALGRIND_MEMPOOL_ALLOC(payload, payload, payload_size);
-
-        /* Copy the parent or clear all the payload's data members. */
-        if (parent)
-        {
-            for (std::map<std::string, ExtensionEntry>::iterator it =
-                extension_map.begin(); it!=extension_map.end(); ++it)
-            {
-                ExtensionEntry& ext = it->second;
-
-                ext.manager->copy(
-                    reinterpret_cast<char*>(payload) + ext.offset,
-                    reinterpret_cast<const char*>(parent) + ext.offset);
-            }
-        } else
-        {
-            for (std::map<std::string, ExtensionEntry>::iterator it =
-                extension_map.begin(); it!=extension_map.end(); ++it)
-            {
-                ExtensionEntry ext = it->second;
-                ext.manager->create(
-                    reinterpret_cast<char*>(payload) + ext.offset);
-            }
-        }
-
-        /*
-         * The created payload must still be placement constructed to
-         * initialize its required data members.
-         */
-        return payload;
-    }
+        dummy_payload(&dummy_payload_data, 0, 0)
+    {}
 
     /**
      * Create a new PayloadData either by allocating a new object or recycling a
      * PayloadData from the payload data free list.
+     *
+     * The created payload data must still be placement constructed to
+     * initialize its required data members.
      */
     PayloadData* new_payload_data()
     {
-        PayloadData* payload_data;
-
-        if (payload_data_pool.empty())
-        {
-            payload_data = reinterpret_cast<PayloadData*>(
-                local_malloc(sizeof(PayloadData)));
-            allocated_payload_data_count++;
-        } else
-        {
-            payload_data = payload_data_pool.back();
-            payload_data_pool.pop_back();
-        }
-
-        VALGRIND_CREATE_MEMPOOL(payload_data, 0, 0);
-        VALGRIND_MEMPOOL_ALLOC(payload_data, payload_data, payload_size);
+        return reinterpret_cast<PayloadData*>(payload_datas.allocate());
+    }
 
-        /*
-         * The created payload data must still be placement constructed to
-         * initialize its required data members.
-         */
-        return payload_data;
+    /** Return a PayloadData to the payload data free list. */
+    void free_payload_data(PayloadData* payload_data)
+    {
+        payload_datas.release(payload_data);
     }
 
+    using TLM::PayloadPoolCore<Payload, PayloadExtensionManager>::
+        get_extension_offset;
+
     /**
-     * Register or find an extension's byte offset within Payload objects. The
-     * first call with any particular name will grow payload_size and register
-     * the offset of required extension with extension_map.
-     *
-     * This function can only be called before the PayloadPool has been fixed at
-     * its first Payload creation event.
+     * LEGACY
+     * Find an extension's byte offset within Payload objects, registering an
+     * extension of the given size with no manager if the name is not already
+     * registered.
      */
-
-    class PayloadExtensionManagerNop:
-        public PayloadExtensionManager
-    {
-    public:
-        std::size_t get_size() { return 0; }
-    };
-
     std::size_t get_extension_offset(unsigned size, const char* name)
     {
-        std::map<std::string, ExtensionEntry>::iterator it =
-            extension_map.find(name);
+        std::size_t offset = extensions.find(name);
 
-        if (it == extension_map.end())
+        if (offset == 0)
         {
-            runtime_error_assert(pool_fixed == false);
-            /* 32 bit align the payload_size. */
-            std::size_t extension_offset = (payload_size + 3) & ~3;
-
-            extension_map[name] = ExtensionEntry(extension_offset, new PayloadExtensionManagerNop);
-            payload_size = extension_offset + size;
-
-            return extension_offset;
+            runtime_error_assert(!is_fixed());
+            offset = extensions.add(name, new PayloadExtensionManagerNop, size);
         }
-        return it->second.offset;
-    }
-
-    std::size_t get_extension_offset(const char* name)
-    {
-        std::map<std::string, ExtensionEntry>::iterator it =
-            extension_map.find(name);
-        if (it == extension_map.end())
-            return 0;
-        return it->second.offset;
-    }
-
-    std::size_t register_extension(const char* name, PayloadExtensionManager* manager)
-    {
-        runtime_error_assert(pool_fixed == false);
-        /* 32 bit align the payload_size. */
-        std::size_t extension_offset = (payload_size + 3) & ~3;
-
-        extension_map[name] = ExtensionEntry(extension_offset, manager);
-        payload_size = extension_offset + manager->get_size();
-
-        return extension_offset;
+        return offset;
     }
 
     /** Dump debugging info. */
@@ -501,16 +298,13 @@ public:
 };
 
 /**
- * Global variable. Must not be replicated between code/libraries in the same
- * program.
+ * Make the global pool on request. The pool must not be replicated between
+ * code/libraries in the same program. Initialising it as a function-local
+ * static makes the first request safe from any thread.
  */
-PayloadPool* global_payload_pool = nullptr;
-
-/** Make the global pool on request. */
 PayloadPool* get_global_pool()
 {
-    if (global_payload_pool == nullptr)
-        global_payload_pool = new PayloadPool();
+    static PayloadPool* const global_payload_pool = new PayloadPool();
     return global_payload_pool;
 }
 
@@ -657,8 +451,7 @@ ARM_TLM_EXPORT void Payload::ref() const
 ARM_TLM_EXPORT void Payload::unref() const
 {
     runtime_error_assert(refcount != 0);
-    refcount--;
-    if (refcount == 0)
+    if (--refcount == 0)
         delete this;
 }
 
@@ -1315,16 +1108,8 @@ ARM_TLM_EXPORT std::size_t Payload::register_extension(const char* name,
 
 void PayloadPool::debug(std::ostream& stream)
 {
-    stream << "Payloads free/allocated/in use:     "
-        << payload_pool.size()
-        << '/' << allocated_payload_count
-        << '/' << allocated_payload_count - payload_pool.size() << '\n';
-
-    stream << "PayloadDatas free/allocated/in use: "
-        << payload_data_pool.size()
-        << '/' << allocated_payload_data_count
-        << '/' << allocated_payload_data_count
-            - payload_data_pool.size() << '\n';
+    payloads.debug(stream, "Payloads    ");
+    payload_datas.debug(stream, "PayloadDatas");
 }
 
 ARM_TLM_EXPORT void Payload::debug_payload_pool(std::ostream& stream)
@@ -1332,6 +1117,11 @@ ARM_TLM_EXPORT void Payload::debug_payload_pool(std::ostream& stream)
     get_global_pool()->debug(stream);
 }
 
+ARM_TLM_EXPORT TLM::PoolStatistics Payload::get_payload_pool_statistics()
+{
+    return get_global_pool()->get_statistics();
+}
+
 PayloadData::PayloadData(Command command_, Size size_, uint8_t len_,
     Burst burst_) :
     refcount(1),
@@ -1424,8 +1214,7 @@ void PayloadData::operator delete (void* p)
 void PayloadData::unref()
 {
     runtime_error_assert(refcount != 0);
-    refcount--;
-    if (refcount == 0)
+    if (--refcount == 0)
         delete this;
 }
 
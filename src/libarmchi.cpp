@@ -46,15 +46,7 @@
 #include <vector>
 
 #include <ARM/TLM/arm_chi_payload.h>
-
-#ifdef ARM_TLM_ENABLE_VALGRIND
-#include <valgrind/memcheck.h>
-#else
-#define VALGRIND_CREATE_MEMPOOL(d1, d2, d3) do {} while (0)
-#define VALGRIND_DESTROY_MEMPOOL(d1) do {} while (0)
-#define VALGRIND_MEMPOOL_ALLOC(d1, d2, d3) do {} while (0)
-#define VALGRIND_MEMPOOL_FREE(d1, d2) do {} while (0)
-#endif
+#include <ARM/TLM/arm_tlm_payload_pool.h>
 
 #ifndef ARM_TLM_EXPORT
 #define ARM_TLM_EXPORT
@@ -85,201 +77,103 @@ namespace CHI
 
 ARM_TLM_EXPORT ARM_CHI_TLM_API_VERSION::ARM_CHI_TLM_API_VERSION(){}
 
+const std::size_t Payload::DATA_BYTES;
+const std::size_t Payload::TAG_BYTES;
+
+/**
+ * Layout of a Payload's cold data block: 64 bytes of data followed by 4 bytes
+ * of tags.
+ */
+static const std::size_t DATA_BLOCK_DATA_BYTES = Payload::DATA_BYTES;
+static const std::size_t DATA_BLOCK_TAG_BYTES = Payload::TAG_BYTES;
+static const std::size_t DATA_BLOCK_SIZE =
+    DATA_BLOCK_DATA_BYTES + DATA_BLOCK_TAG_BYTES;
+
 /**
  * Source of all allocated Payloads. The PayloadPool manages the memory of
  * Payloads and issuing unique IDs to Payloads. PayloadPool never deallocates
  * any memory for Payload object but maintains a free list of objects returned
  * to the pool from which new objects are created.
  */
-class PayloadPool
+class PayloadPool :
+    public TLM::PayloadPoolCore<Payload, PayloadExtensionManager>
 {
 private:
-    /** The unique ID of the next Payload to be created. */
-    uint64_t next_uid;
-
-    /**
-     * Size of the Payload object will all registered extensions. All Payloads
-     * will have the same size.
-     */
-    unsigned payload_size;
-
     /**
-     * Set to true once the first Payload is requested. Extensions may not be
-     * registered once pool_fixed becomes true.
+     * Placement of the data blocks of Payloads. For DATA_PLACEMENT_TRAILING,
+     * the data block is the trailing area of each Payload's allocation. For
+     * DATA_PLACEMENT_OUT_OF_LINE, data blocks are allocated from data_blocks.
      */
-    bool pool_fixed;
-
-    /** Number of allocated Payloads in existence. */
-    std::size_t allocated_payload_count;
+    DataPlacement data_placement;
 
-    /** LIFO free list of allocated Payload objects. */
-    std::vector<Payload*> payload_pool;
-
-    /** ExtensionEntry class holidng an extensuion manager and offset */
-    class ExtensionEntry
-    {
-    public:
-        std::size_t offset;
-        PayloadExtensionManager* manager;
-        ExtensionEntry(std::size_t offset_, PayloadExtensionManager* manager_):
-            offset(offset_),
-            manager(manager_)
-        {}
-        ExtensionEntry(){}
-    };
-    /** Map of extension names to ExtensionEntries */
-    std::map<std::string, ExtensionEntry> extension_map;
-
-    /** Debug allocation of new payloads. */
-    bool debug_unique;
-    bool debug_always_free;
+    /** Storage for out-of-line data blocks. */
+    TLM::ObjectPool data_blocks;
 
 public:
+    /** Data block for the dummy payload. */
+    uint8_t dummy_data_block[DATA_BLOCK_SIZE];
+
     /** Dummy payload for credit passing etc.*/
     Payload dummy_payload;
 
-    /** Registered new/delete for allocations within the pool. */
-    void* (*local_malloc)(size_t size);
-    void (*local_free)(void* ptr);
-
-    /** Return the next unique ID and advance next_id. */
-    uint64_t get_uid() { return next_uid++; }
-
-    /** Return a Payload to the payload free list. */
-    void free_payload(Payload* payload)
-    {
-        for (std::map<std::string, ExtensionEntry>::iterator it =
-            extension_map.begin(); it!=extension_map.end(); ++it)
-        {
-            ExtensionEntry ext = it->second;
-            ext.manager->destroy(
-                reinterpret_cast<char*>(payload) + ext.offset);
-        }
-        VALGRIND_MEMPOOL_FREE(payload, payload);
-        VALGRIND_DESTROY_MEMPOOL(payload);
-        if (debug_always_free)
-        {
-            local_free(payload);
-            allocated_payload_count--;
-        } else if (!debug_unique)
-        {
-            payload_pool.push_back(payload);
-        }
-    }
-
     PayloadPool() :
-        next_uid(1),
-        /* payload_size wil grow as extensions are added. */
-        payload_size(sizeof(Payload)),
-        pool_fixed(false),
-        allocated_payload_count(0),
-        debug_unique(false),
-        debug_always_free(false),
-        dummy_payload(0),
-        local_malloc(std::malloc),
-        local_free(std::free)
+        data_placement(DATA_PLACEMENT_TRAILING),
+        data_blocks(*this, DATA_BLOCK_SIZE, debug_mode),
+        dummy_payload(0, dummy_data_block)
     {
-        char* env_val = getenv("ARM_TLM_DEBUG_ALLOC");
-        if (env_val)
-        {
-            debug_unique = (std::string(env_val) == "UNIQUE");
-            debug_always_free = (std::string(env_val) == "ALWAYS_FREE");
-        }
+        set_trailing_size(DATA_BLOCK_SIZE);
     }
 
     /**
-     * Create a new Payload either by allocating a new object or recycling a
-     * Payload from the payload free list.
+     * Get the data block for a Payload allocated with new_payload. This will
+     * either be the trailing block of the Payload's allocation or an
+     * out-of-line block from the data block free list. Dataless Payloads
+     * have no data block.
      */
-    Payload* new_payload(Payload* parent = nullptr)
+    uint8_t* new_data_block(Payload* payload, bool with_data)
     {
-        Payload* payload;
-
-        if (payload_pool.empty())
-        {
-            pool_fixed = true;
-            payload = reinterpret_cast<Payload*>(local_malloc(payload_size));
-            allocated_payload_count++;
-        } else
-        {
-            payload = payload_pool.back();
-            payload_pool.pop_back();
-        }
+        if (!with_data)
+            return nullptr;
 
-        VALGRIND_CREATE_MEMPOOL(payload, 0, 0);
-        VALGRIND_MEMPOOL_ALLOC(payload, payload, payload_size);
+        if (data_placement == DATA_PLACEMENT_TRAILING)
+            return reinterpret_cast<uint8_t*>(get_trailing(payload));
 
-        /* Copy the parent or clear all the payload's data members. */
-        if (parent)
-        {
-            for (std::map<std::string, ExtensionEntry>::iterator it =
-                extension_map.begin(); it!=extension_map.end(); ++it)
-            {
-                ExtensionEntry &ext = it->second;
-
-                ext.manager->copy(
-                    reinterpret_cast<char*>(payload) + ext.offset,
-                    reinterpret_cast<const char*>(parent) + ext.offset);
-            }
-        }
-        else
-        {
-            for (std::map<std::string, ExtensionEntry>::iterator it =
-                extension_map.begin(); it!=extension_map.end(); ++it)
-            {
-                ExtensionEntry ext = it->second;
-                ext.manager->create(
-                    reinterpret_cast<char*>(payload) + ext.offset);
-            }
-        }
+        return reinterpret_cast<uint8_t*>(data_blocks.allocate());
+    }
 
-        /*
-         * The created payload must still be placement constructed to
-         * initialize its required data members.
-         */
-        return payload;
+    /**
+     * Return a Payload's data block. Trailing data blocks are part of their
+     * Payload's allocation and so only out-of-line blocks need to be freed.
+     */
+    void free_data_block(uint8_t* data_block)
+    {
+        if (data_block && data_placement == DATA_PLACEMENT_OUT_OF_LINE)
+            data_blocks.release(data_block);
     }
 
     void copy_response(Payload* dst, Payload* src)
     {
-        for (std::map<std::string, ExtensionEntry>::iterator it =
-            extension_map.begin(); it!=extension_map.end(); ++it)
+        const std::vector<TLM::ExtensionTable<PayloadExtensionManager>::Entry>&
+            entries = extensions.get_entries();
+
+        for (std::size_t i = 0; i < entries.size(); i++)
         {
-            ExtensionEntry ext = it->second;
-            ext.manager->copy_response(
-                reinterpret_cast<char*>(dst) + ext.offset,
-                reinterpret_cast<const char*>(src) + ext.offset);
+            entries[i].manager->copy_response(
+                reinterpret_cast<char*>(dst) + entries[i].offset,
+                reinterpret_cast<const char*>(src) + entries[i].offset);
         }
     }
 
     /**
-     * Register or find an extension's byte offset within Payload objects. The
-     * first call with any particular name will grow payload_size and register
-     * the offset of required extension with extension_map.
-     *
-     * This function can only be called before the PayloadPool has been fixed at
-     * its first Payload creation event.
+     * Select the placement of data blocks. Like extension registration, this
+     * can only be done before the PayloadPool has been fixed.
      */
-
-    std::size_t get_extension_offset(const char* name)
+    void set_data_placement(DataPlacement placement)
     {
-        std::map<std::string, ExtensionEntry>::iterator it =
-            extension_map.find(name);
-        if (it == extension_map.end())
-            return 0;
-        return it->second.offset;
-    }
-
-    std::size_t register_extension(const char* name, PayloadExtensionManager* manager)
-    {
-        runtime_error_assert(pool_fixed == false);
-        /* 32 bit align the payload_size. */
-        std::size_t extension_offset = (payload_size + 3) & ~3;
-
-        extension_map[name] = ExtensionEntry(extension_offset, manager);
-        payload_size = static_cast<unsigned>(extension_offset + manager->get_size());
-
-        return extension_offset;
+        runtime_error_assert(!is_fixed());
+        data_placement = placement;
+        set_trailing_size(placement == DATA_PLACEMENT_TRAILING
+            ? DATA_BLOCK_SIZE : 0);
     }
 
     /** Dump debugging info. */
@@ -287,20 +181,17 @@ public:
 };
 
 /**
- * Global variable. Must not be replicated between code/libraries in the same
- * program.
+ * Make the global pool on request. The pool must not be replicated between
+ * code/libraries in the same program. Initialising it as a function-local
+ * static makes the first request safe from any thread.
  */
-PayloadPool* global_payload_pool = nullptr;
-
-/** Make the global pool on request. */
 PayloadPool* get_global_pool()
 {
-    if (global_payload_pool == nullptr)
-        global_payload_pool = new PayloadPool();
+    static PayloadPool* const global_payload_pool = new PayloadPool();
     return global_payload_pool;
 }
 
-Payload::Payload(uint64_t uid_) :
+Payload::Payload(uint64_t uid_, uint8_t* data_block) :
     refcount(1),
     uid(uid_),
     parent(nullptr),
@@ -308,6 +199,9 @@ Payload::Payload(uint64_t uid_) :
     size(0),
     mem_attr(0),
     lpid(0),
+    data_pull(0),
+    data_source(0),
+    tu(0),
     exclusive(0),
     snoop_me(0),
     endian(0),
@@ -318,19 +212,21 @@ Payload::Payload(uint64_t uid_) :
     ret_to_src(0),
     do_not_go_to_sd(0),
     do_not_data_pull(0),
+    debug_write(0),
     rsvdc(0),
-    data_pull(0),
-    data_source(0),
     mpam(),
-    tu(0),
-    byte_enable(0)
+    byte_enable(0),
+    data(data_block),
+    tag(data_block ? data_block + DATA_BLOCK_DATA_BYTES : nullptr)
 {
-    std::fill(tag, tag + 4, 0);
-    std::fill(data, data + 64, 0);
-
+    if (data_block)
+    {
+        std::fill(tag, tag + DATA_BLOCK_TAG_BYTES, 0);
+        std::fill(data, data + DATA_BLOCK_DATA_BYTES, 0);
+    }
 }
 
-Payload::Payload(Payload* parent_, uint64_t uid_) :
+Payload::Payload(Payload* parent_, uint64_t uid_, uint8_t* data_block) :
     refcount(1),
     uid(uid_),
     parent(parent_),
@@ -338,6 +234,9 @@ Payload::Payload(Payload* parent_, uint64_t uid_) :
     size(parent_->size),
     mem_attr(parent_->mem_attr),
     lpid(parent_->lpid),
+    data_pull(parent_->data_pull),
+    data_source(parent_->data_source),
+    tu(parent_->tu),
     exclusive(parent_->exclusive),
     snoop_me(parent_->snoop_me),
     endian(parent_->endian),
@@ -348,27 +247,33 @@ Payload::Payload(Payload* parent_, uint64_t uid_) :
     ret_to_src(parent_->ret_to_src),
     do_not_go_to_sd(parent_->do_not_go_to_sd),
     do_not_data_pull(parent_->do_not_data_pull),
+    debug_write(parent_->debug_write),
     rsvdc(parent_->rsvdc),
-    data_pull(parent_->data_pull),
-    data_source(parent_->data_source),
     mpam(parent_->mpam),
-    tu(parent_->tu),
-    byte_enable(parent_->byte_enable)
+    byte_enable(parent_->byte_enable),
+    data(data_block),
+    tag(data_block ? data_block + DATA_BLOCK_DATA_BYTES : nullptr)
 {
-    std::copy(parent->tag, parent->tag + 4, tag);
-    std::copy(parent->data, parent->data + 64, data);
+    if (data_block)
+    {
+        std::copy(parent->tag, parent->tag + DATA_BLOCK_TAG_BYTES, tag);
+        std::copy(parent->data, parent->data + DATA_BLOCK_DATA_BYTES, data);
+    }
     parent->ref();
 }
 
 Payload::~Payload()
 {
+    get_global_pool()->free_data_block(data);
     if (parent)
         parent->unref();
 }
 
 Payload::Payload(const Payload&) :
     uid(get_global_pool()->get_uid()),
-    parent(nullptr)
+    parent(nullptr),
+    data(nullptr),
+    tag(nullptr)
 {
     /*
      * This implementation should never be called but sets the const members
@@ -380,7 +285,16 @@ ARM_TLM_EXPORT Payload* Payload::new_payload()
 {
     PayloadPool* pool = get_global_pool();
     Payload* payload = pool->new_payload();
-    new (payload) Payload(pool->get_uid());
+    new (payload) Payload(pool->get_uid(), pool->new_data_block(payload, true));
+
+    return payload;
+}
+
+ARM_TLM_EXPORT Payload* Payload::new_dataless_payload()
+{
+    PayloadPool* pool = get_global_pool();
+    Payload* payload = pool->new_payload();
+    new (payload) Payload(pool->get_uid(), pool->new_data_block(payload, false));
 
     return payload;
 }
@@ -394,7 +308,8 @@ ARM_TLM_EXPORT Payload* Payload::descend()
 {
     PayloadPool* pool = get_global_pool();
     Payload* payload = pool->new_payload(this);
-    new (payload) Payload(this, pool->get_uid());
+    new (payload) Payload(this, pool->get_uid(),
+        pool->new_data_block(payload, data != nullptr));
 
     return payload;
 }
@@ -420,8 +335,7 @@ ARM_TLM_EXPORT void Payload::ref() const
 ARM_TLM_EXPORT void Payload::unref() const
 {
     runtime_error_assert(refcount);
-    refcount--;
-    if (refcount == 0)
+    if (--refcount == 0)
         delete this;
 }
 
@@ -441,12 +355,17 @@ ARM_TLM_EXPORT std::size_t Payload::register_extension(const char* name,
     return get_global_pool()->register_extension(name, manager);
 }
 
+ARM_TLM_EXPORT void Payload::set_data_placement(DataPlacement placement)
+{
+    get_global_pool()->set_data_placement(placement);
+}
+
 void PayloadPool::debug(std::ostream& stream)
 {
-    stream << "Payloads free/allocated/in use:     "
-        << payload_pool.size()
-        << '/' << allocated_payload_count
-        << '/' << allocated_payload_count - payload_pool.size() << '\n';
+    payloads.debug(stream, "Payloads   ");
+
+    if (data_placement == DATA_PLACEMENT_OUT_OF_LINE)
+        data_blocks.debug(stream, "Data blocks");
 }
 
 ARM_TLM_EXPORT void Payload::debug_payload_pool(std::ostream& stream)
@@ -454,5 +373,10 @@ ARM_TLM_EXPORT void Payload::debug_payload_pool(std::ostream& stream)
     get_global_pool()->debug(stream);
 }
 
+ARM_TLM_EXPORT TLM::PoolStatistics Payload::get_payload_pool_statistics()
+{
+    return get_global_pool()->get_statistics();
+}
+
 }
 }
@@ -0,0 +1,552 @@
+/*
+ * The Clear BSD License
+ *
+ * Copyright (c) 2015-2021 Arm Limited.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *
+ *      * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *
+ *      * Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *      * Neither the name of the copyright holder nor the names of its
+ *      contributors may be used to endorse or promote products derived from
+ *      this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cassert>
+#include <sstream>
+#include <stdexcept>
+#include <stdint.h>
+#include <vector>
+
+#include <ARM/TLM/arm_chi_flit.h>
+
+#ifndef ARM_TLM_EXPORT
+#define ARM_TLM_EXPORT
+#endif
+
+#ifdef ARM_TLM_ERRORS_WITH_ASSERT
+/* Force use of assert() for error reporting. */
+#define runtime_error_assert(cond) do { assert(cond); } while (0)
+#else
+/*
+ * Throw a std::runtime_exception for assertions as it may be possible
+ * to catch/handle that that a hard assertion.
+ */
+#define runtime_error_assert(cond) do { \
+    if (!(cond)) \
+    { \
+        std::ostringstream message; \
+        message << "Assertion at: " __FILE__ ":" << __LINE__ << ": " #cond; \
+        throw std::runtime_error(message.str()); \
+    } \
+} while (0)
+#endif
+
+namespace ARM
+{
+namespace CHI
+{
+
+/** Identifiers of flit fields. Fields sharing a position in a flit share an ID. */
+enum FlitFieldId
+{
+    FIELD_QOS,
+    FIELD_TGT_ID,
+    FIELD_SRC_ID,
+    FIELD_TXN_ID,
+    FIELD_RETURN_NID,       /* ReturnNID/StashNID/SLCRepHint */
+    FIELD_STASH_NID_VALID,  /* StashNIDValid/Endian/Deep */
+    FIELD_RETURN_TXN_ID,    /* ReturnTxnID/StashLPIDValid/StashLPID */
+    FIELD_OPCODE,
+    FIELD_SIZE,
+    FIELD_ADDR,
+    FIELD_SNP_ADDR,
+    FIELD_NS,
+    FIELD_LIKELY_SHARED,
+    FIELD_ALLOW_RETRY,
+    FIELD_ORDER,
+    FIELD_PCRD_TYPE,
+    FIELD_MEM_ATTR,
+    FIELD_SNP_ATTR,
+    FIELD_DO_DWT,
+    FIELD_LPID,             /* LPID/PGroupID/StashGroupID/TagGroupID */
+    FIELD_EXCL,             /* Excl/SnoopMe */
+    FIELD_EXP_COMP_ACK,
+    FIELD_TAG_OP,
+    FIELD_TRACE_TAG,
+    FIELD_MPAM,
+    FIELD_REQ_RSVDC,
+    FIELD_RESP_ERR,
+    FIELD_RESP,
+    FIELD_FWD_STATE,        /* FwdState/DataPull/DataSource */
+    FIELD_CBUSY,
+    FIELD_DBID,             /* DBID/PGroupID */
+    FIELD_FWD_NID,
+    FIELD_FWD_TXN_ID,       /* FwdTxnID/StashLPIDValid/StashLPID/VMIDExt */
+    FIELD_DO_NOT_GO_TO_SD,
+    FIELD_RET_TO_SRC,
+    FIELD_HOME_NID,
+    FIELD_CCID,
+    FIELD_DATA_ID,
+    FIELD_TAG,
+    FIELD_TU,
+    FIELD_DAT_RSVDC,
+    FIELD_BE,
+    FIELD_DATA,
+    FIELD_DATA_CHECK,
+    FIELD_POISON
+};
+
+/** Width of a MPAM field: PerfMonGroup, PartID and MPAMNS. */
+static const unsigned MPAM_WIDTH = 11;
+
+/** Mask of the low width bits of a 64 bit value. */
+static inline uint64_t low_mask(unsigned width)
+{
+    return width >= 64 ? ~uint64_t(0) : (uint64_t(1) << width) - 1;
+}
+
+static inline bool is_atomic(uint8_t opcode)
+{
+    return opcode >= REQ_OPCODE_ATOMIC_STORE_ADD && opcode <= REQ_OPCODE_ATOMIC_COMPARE;
+}
+
+static inline bool is_stash(uint8_t opcode)
+{
+    return (opcode >= REQ_OPCODE_WRITE_UNIQUE_FULL_STASH && opcode <= REQ_OPCODE_STASH_ONCE_UNIQUE) ||
+        opcode == REQ_OPCODE_STASH_ONCE_SEP_SHARED || opcode == REQ_OPCODE_STASH_ONCE_SEP_UNIQUE;
+}
+
+/** Odd parity bit for each byte of a beat. */
+static inline uint64_t odd_byte_parity(const uint8_t* data, unsigned bytes)
+{
+    uint64_t parity = 0;
+
+    for (unsigned i = 0; i < bytes; i++)
+    {
+        uint8_t byte = data[i];
+        byte ^= byte >> 4;
+        byte ^= byte >> 2;
+        byte ^= byte >> 1;
+        parity |= uint64_t(~byte & 1) << i;
+    }
+
+    return parity;
+}
+
+ARM_TLM_EXPORT FlitCodec::FlitCodec(const FlitFormat& format_) :
+    format(format_)
+{
+    runtime_error_assert(format.node_id_width >= 7 && format.node_id_width <= 11);
+    runtime_error_assert(format.req_addr_width >= 44 && format.req_addr_width <= 52);
+    runtime_error_assert(format.data_width == 128 || format.data_width == 256 || format.data_width == 512);
+    runtime_error_assert(format.req_rsvdc_width <= 32 && format.dat_rsvdc_width <= 32);
+    runtime_error_assert(!format.mpam || format.issue >= FLIT_ISSUE_D);
+
+    const FlitIssue issue = format.issue;
+    const unsigned nid = format.node_id_width;
+    const unsigned txn_id = issue == FLIT_ISSUE_E ? 12 : issue == FLIT_ISSUE_D ? 10 : 8;
+    const unsigned mpam = format.mpam ? MPAM_WIDTH : 0;
+    const bool has_cbusy = issue >= FLIT_ISSUE_D;
+    const bool has_mte = issue >= FLIT_ISSUE_E;
+
+    for (unsigned channel = 0; channel < 4; channel++)
+        widths[channel] = 0;
+
+    add_field(CHANNEL_REQ, FIELD_QOS, 4);
+    add_field(CHANNEL_REQ, FIELD_TGT_ID, nid);
+    add_field(CHANNEL_REQ, FIELD_SRC_ID, nid);
+    add_field(CHANNEL_REQ, FIELD_TXN_ID, txn_id);
+    add_field(CHANNEL_REQ, FIELD_RETURN_NID, nid);
+    add_field(CHANNEL_REQ, FIELD_STASH_NID_VALID, 1);
+    add_field(CHANNEL_REQ, FIELD_RETURN_TXN_ID, txn_id);
+    add_field(CHANNEL_REQ, FIELD_OPCODE, issue >= FLIT_ISSUE_D ? 7 : 6);
+    add_field(CHANNEL_REQ, FIELD_SIZE, 3);
+    add_field(CHANNEL_REQ, FIELD_ADDR, format.req_addr_width);
+    add_field(CHANNEL_REQ, FIELD_NS, 1);
+    add_field(CHANNEL_REQ, FIELD_LIKELY_SHARED, 1);
+    add_field(CHANNEL_REQ, FIELD_ALLOW_RETRY, 1);
+    add_field(CHANNEL_REQ, FIELD_ORDER, 2);
+    add_field(CHANNEL_REQ, FIELD_PCRD_TYPE, 4);
+    add_field(CHANNEL_REQ, FIELD_MEM_ATTR, 4);
+    add_field(CHANNEL_REQ, FIELD_SNP_ATTR, 1);
+    add_field(CHANNEL_REQ, FIELD_DO_DWT, issue >= FLIT_ISSUE_D ? 1 : 0);
+    add_field(CHANNEL_REQ, FIELD_LPID, has_mte ? 8 : 5);
+    add_field(CHANNEL_REQ, FIELD_EXCL, 1);
+    add_field(CHANNEL_REQ, FIELD_EXP_COMP_ACK, 1);
+    add_field(CHANNEL_REQ, FIELD_TAG_OP, has_mte ? 2 : 0);
+    add_field(CHANNEL_REQ, FIELD_TRACE_TAG, 1);
+    add_field(CHANNEL_REQ, FIELD_MPAM, mpam);
+    add_field(CHANNEL_REQ, FIELD_REQ_RSVDC, format.req_rsvdc_width);
+
+    add_field(CHANNEL_RSP, FIELD_QOS, 4);
+    add_field(CHANNEL_RSP, FIELD_TGT_ID, nid);
+    add_field(CHANNEL_RSP, FIELD_SRC_ID, nid);
+    add_field(CHANNEL_RSP, FIELD_TXN_ID, txn_id);
+    add_field(CHANNEL_RSP, FIELD_OPCODE, issue >= FLIT_ISSUE_D ? 5 : 4);
+    add_field(CHANNEL_RSP, FIELD_RESP_ERR, 2);
+    add_field(CHANNEL_RSP, FIELD_RESP, 3);
+    add_field(CHANNEL_RSP, FIELD_FWD_STATE, 3);
+    add_field(CHANNEL_RSP, FIELD_CBUSY, has_cbusy ? 3 : 0);
+    add_field(CHANNEL_RSP, FIELD_DBID, txn_id);
+    add_field(CHANNEL_RSP, FIELD_PCRD_TYPE, 4);
+    add_field(CHANNEL_RSP, FIELD_TAG_OP, has_mte ? 2 : 0);
+    add_field(CHANNEL_RSP, FIELD_TRACE_TAG, 1);
+
+    add_field(CHANNEL_SNP, FIELD_QOS, 4);
+    add_field(CHANNEL_SNP, FIELD_SRC_ID, nid);
+    add_field(CHANNEL_SNP, FIELD_TXN_ID, txn_id);
+    add_field(CHANNEL_SNP, FIELD_FWD_NID, nid);
+    add_field(CHANNEL_SNP, FIELD_FWD_TXN_ID, txn_id);
+    add_field(CHANNEL_SNP, FIELD_OPCODE, 5);
+    add_field(CHANNEL_SNP, FIELD_SNP_ADDR, format.req_addr_width - 3);
+    add_field(CHANNEL_SNP, FIELD_NS, 1);
+    add_field(CHANNEL_SNP, FIELD_DO_NOT_GO_TO_SD, 1);
+    add_field(CHANNEL_SNP, FIELD_RET_TO_SRC, 1);
+    add_field(CHANNEL_SNP, FIELD_TRACE_TAG, 1);
+    add_field(CHANNEL_SNP, FIELD_MPAM, mpam);
+
+    add_field(CHANNEL_DAT, FIELD_QOS, 4);
+    add_field(CHANNEL_DAT, FIELD_TGT_ID, nid);
+    add_field(CHANNEL_DAT, FIELD_SRC_ID, nid);
+    add_field(CHANNEL_DAT, FIELD_TXN_ID, txn_id);
+    add_field(CHANNEL_DAT, FIELD_HOME_NID, nid);
+    add_field(CHANNEL_DAT, FIELD_OPCODE, issue >= FLIT_ISSUE_C ? 4 : 3);
+    add_field(CHANNEL_DAT, FIELD_RESP_ERR, 2);
+    add_field(CHANNEL_DAT, FIELD_RESP, 3);
+    add_field(CHANNEL_DAT, FIELD_FWD_STATE, has_mte ? 4 : 3);
+    add_field(CHANNEL_DAT, FIELD_CBUSY, has_cbusy ? 3 : 0);
+    add_field(CHANNEL_DAT, FIELD_DBID, txn_id);
+    add_field(CHANNEL_DAT, FIELD_CCID, 2);
+    add_field(CHANNEL_DAT, FIELD_DATA_ID, 2);
+    add_field(CHANNEL_DAT, FIELD_TAG_OP, has_mte ? 2 : 0);
+    add_field(CHANNEL_DAT, FIELD_TAG, has_mte ? format.data_width / 32 : 0);
+    add_field(CHANNEL_DAT, FIELD_TU, has_mte ? format.data_width / 128 : 0);
+    add_field(CHANNEL_DAT, FIELD_TRACE_TAG, 1);
+    add_field(CHANNEL_DAT, FIELD_DAT_RSVDC, format.dat_rsvdc_width);
+    add_field(CHANNEL_DAT, FIELD_BE, format.data_width / 8);
+    add_field(CHANNEL_DAT, FIELD_DATA, format.data_width);
+    add_field(CHANNEL_DAT, FIELD_DATA_CHECK, format.data_check ? format.data_width / 8 : 0);
+    add_field(CHANNEL_DAT, FIELD_POISON, format.poison ? format.data_width / 64 : 0);
+
+    for (unsigned channel = 0; channel < 4; channel++)
+        runtime_error_assert(widths[channel] <= FLIT_MAX_WORDS * 64);
+}
+
+void FlitCodec::add_field(Channel channel, unsigned id, unsigned width)
+{
+    /* Fields not present in this format are simply left out of the layout. */
+    if (width == 0)
+        return;
+
+    Field field;
+    field.id = static_cast<uint16_t>(id);
+    field.width = static_cast<uint16_t>(width);
+    field.offset = static_cast<uint16_t>(widths[channel]);
+
+    layouts[channel].push_back(field);
+    widths[channel] += width;
+}
+
+/** Value of a scalar (<= 64 bit) field. */
+static uint64_t encode_field(unsigned id, const Payload& payload, const Phase& phase,
+    unsigned beat_offset, unsigned beat_bytes)
+{
+    switch (id)
+    {
+    case FIELD_QOS: return phase.qos;
+    case FIELD_TGT_ID: return phase.tgt_id;
+    case FIELD_SRC_ID: return phase.src_id;
+    case FIELD_TXN_ID: return phase.txn_id;
+    case FIELD_RETURN_NID: return phase.return_nid;
+    case FIELD_STASH_NID_VALID:
+        if (is_stash(phase.raw_opcode))
+            return payload.stash_nid_valid;
+        if (is_atomic(phase.raw_opcode))
+            return payload.endian;
+        return payload.deep;
+    case FIELD_RETURN_TXN_ID: return phase.return_txn_id;
+    case FIELD_OPCODE: return phase.raw_opcode;
+    case FIELD_SIZE: return payload.size;
+    case FIELD_ADDR: return payload.address;
+    case FIELD_SNP_ADDR: return payload.address >> 3;
+    case FIELD_NS: return payload.ns;
+    case FIELD_LIKELY_SHARED: return payload.likely_shared;
+    case FIELD_ALLOW_RETRY: return phase.allow_retry;
+    case FIELD_ORDER: return phase.order;
+    case FIELD_PCRD_TYPE: return phase.pcrd_type;
+    case FIELD_MEM_ATTR: return payload.mem_attr;
+    case FIELD_SNP_ATTR: return phase.snp_attr;
+    case FIELD_DO_DWT: return phase.do_dwt;
+    case FIELD_LPID: return payload.lpid;
+    case FIELD_EXCL:
+        return is_atomic(phase.raw_opcode) ? payload.snoop_me : payload.exclusive;
+    case FIELD_EXP_COMP_ACK: return phase.exp_comp_ack;
+    case FIELD_TAG_OP: return phase.tag_op;
+    case FIELD_MPAM:
+        return (payload.mpam.perf_mon_group & 0x1) |
+            uint64_t(payload.mpam.part_id & 0x1ff) << 1 |
+            uint64_t(payload.mpam.mpam_ns & 0x1) << 10;
+    case FIELD_REQ_RSVDC:
+    case FIELD_DAT_RSVDC:
+        return payload.rsvdc;
+    case FIELD_RESP_ERR: return phase.resp_err;
+    case FIELD_RESP: return phase.resp;
+    case FIELD_FWD_STATE:
+        if (phase.channel == CHANNEL_RSP)
+            return phase.raw_opcode == RSP_OPCODE_SNP_RESP ?
+                uint64_t(payload.data_pull) : uint64_t(phase.fwd_state);
+        switch (phase.raw_opcode)
+        {
+        case DAT_OPCODE_COMP_DATA:
+        case DAT_OPCODE_DATA_SEP_RESP:
+            return payload.data_source;
+        case DAT_OPCODE_SNP_RESP_DATA:
+        case DAT_OPCODE_SNP_RESP_DATA_PTL:
+            return payload.data_pull;
+        default:
+            return phase.fwd_state;
+        }
+    case FIELD_CBUSY: return phase.c_busy;
+    case FIELD_DBID: return phase.dbid;
+    case FIELD_FWD_NID: return phase.fwd_nid;
+    case FIELD_FWD_TXN_ID: return phase.fwd_txn_id;
+    case FIELD_DO_NOT_GO_TO_SD: return payload.do_not_go_to_sd;
+    case FIELD_RET_TO_SRC: return payload.ret_to_src;
+    case FIELD_HOME_NID: return phase.home_nid;
+    case FIELD_CCID: return payload.address >> 4;
+    case FIELD_DATA_ID: return phase.data_id;
+    case FIELD_TAG:
+    {
+        runtime_error_assert(payload.tag);
+        uint64_t tag = 0;
+        for (unsigned i = 0; i < beat_bytes / DATA_ID_BYTES; i++)
+            tag |= uint64_t(payload.tag[beat_offset / DATA_ID_BYTES + i] & 0xf) << (i * 4);
+        return tag;
+    }
+    case FIELD_TU: return payload.tu >> (beat_offset / DATA_ID_BYTES);
+    case FIELD_BE: return payload.byte_enable >> beat_offset;
+    case FIELD_DATA_CHECK: return odd_byte_parity(payload.data + beat_offset, beat_bytes);
+    case FIELD_TRACE_TAG:
+    case FIELD_POISON:
+    default:
+        return 0;
+    }
+}
+
+/** Store a decoded scalar (<= 64 bit) field. */
+static void decode_field(unsigned id, uint64_t value, Payload& payload, Phase& phase,
+    unsigned beat_offset, unsigned beat_bytes)
+{
+    switch (id)
+    {
+    case FIELD_QOS: phase.qos = value; break;
+    case FIELD_TGT_ID: phase.tgt_id = value; break;
+    case FIELD_SRC_ID: phase.src_id = value; break;
+    case FIELD_TXN_ID: phase.txn_id = value; break;
+    case FIELD_RETURN_NID: phase.return_nid = value; break;
+    case FIELD_STASH_NID_VALID:
+        if (is_stash(phase.raw_opcode))
+            payload.stash_nid_valid = value;
+        else if (is_atomic(phase.raw_opcode))
+            payload.endian = value;
+        else
+            payload.deep = value;
+        break;
+    case FIELD_RETURN_TXN_ID: phase.return_txn_id = value; break;
+    case FIELD_OPCODE: phase.raw_opcode = value; break;
+    case FIELD_SIZE: payload.size = static_cast<uint8_t>(value); break;
+    case FIELD_ADDR: payload.address = value; break;
+    case FIELD_SNP_ADDR: payload.address = value << 3; break;
+    case FIELD_NS: payload.ns = value; break;
+    case FIELD_LIKELY_SHARED: payload.likely_shared = value; break;
+    case FIELD_ALLOW_RETRY: phase.allow_retry = value; break;
+    case FIELD_ORDER: phase.order = static_cast<Order>(value); break;
+    case FIELD_PCRD_TYPE: phase.pcrd_type = value; break;
+    case FIELD_MEM_ATTR: payload.mem_attr = static_cast<uint8_t>(value); break;
+    case FIELD_SNP_ATTR: phase.snp_attr = value; break;
+    case FIELD_DO_DWT: phase.do_dwt = value; break;
+    case FIELD_LPID: payload.lpid = value; break;
+    case FIELD_EXCL:
+        if (is_atomic(phase.raw_opcode))
+            payload.snoop_me = value;
+        else
+            payload.exclusive = value;
+        break;
+    case FIELD_EXP_COMP_ACK: phase.exp_comp_ack = value; break;
+    case FIELD_TAG_OP: phase.tag_op = static_cast<TagOp>(value); break;
+    case FIELD_MPAM:
+        payload.mpam = Mpam(value >> 10 & 0x1, value >> 1 & 0x1ff, value & 0x1);
+        break;
+    case FIELD_REQ_RSVDC:
+    case FIELD_DAT_RSVDC:
+        payload.rsvdc = value;
+        break;
+    case FIELD_RESP_ERR: phase.resp_err = static_cast<RespErr>(value); break;
+    case FIELD_RESP: phase.resp = static_cast<Resp>(value); break;
+    case FIELD_FWD_STATE:
+        if (phase.channel == CHANNEL_RSP)
+        {
+            if (phase.raw_opcode == RSP_OPCODE_SNP_RESP)
+                payload.data_pull = static_cast<uint8_t>(value);
+            else
+                phase.fwd_state = static_cast<Resp>(value);
+            break;
+        }
+        switch (phase.raw_opcode)
+        {
+        case DAT_OPCODE_COMP_DATA:
+        case DAT_OPCODE_DATA_SEP_RESP:
+            payload.data_source = value;
+            break;
+        case DAT_OPCODE_SNP_RESP_DATA:
+        case DAT_OPCODE_SNP_RESP_DATA_PTL:
+            payload.data_pull = static_cast<uint8_t>(value);
+            break;
+        default:
+            phase.fwd_state = static_cast<Resp>(value);
+        }
+        break;
+    case FIELD_CBUSY: phase.c_busy = value; break;
+    case FIELD_DBID: phase.dbid = value; break;
+    case FIELD_FWD_NID: phase.fwd_nid = value; break;
+    case FIELD_FWD_TXN_ID: phase.fwd_txn_id = value; break;
+    case FIELD_DO_NOT_GO_TO_SD: payload.do_not_go_to_sd = value; break;
+    case FIELD_RET_TO_SRC: payload.ret_to_src = value; break;
+    case FIELD_HOME_NID: phase.home_nid = value; break;
+    case FIELD_DATA_ID: phase.data_id = value; break;
+    case FIELD_TAG:
+    {
+        uint8_t* const tag = payload.get_tag();
+        for (unsigned i = 0; i < beat_bytes / DATA_ID_BYTES; i++)
+            tag[beat_offset / DATA_ID_BYTES + i] = value >> (i * 4) & 0xf;
+        break;
+    }
+    case FIELD_TU:
+    {
+        const unsigned shift = beat_offset / DATA_ID_BYTES;
+        const uint64_t mask = low_mask(beat_bytes / DATA_ID_BYTES) << shift;
+        payload.tu = (payload.tu & ~mask) | ((value << shift) & mask);
+        break;
+    }
+    case FIELD_BE:
+    {
+        const uint64_t mask = low_mask(beat_bytes) << beat_offset;
+        payload.byte_enable = (payload.byte_enable & ~mask) | ((value << beat_offset) & mask);
+        break;
+    }
+    case FIELD_CCID:
+    case FIELD_TRACE_TAG:
+    case FIELD_DATA_CHECK:
+    case FIELD_POISON:
+    default:
+        break;
+    }
+}
+
+ARM_TLM_EXPORT void FlitCodec::encode(const Payload& payload, const Phase& phase, uint64_t* flit) const
+{
+    const std::vector<Field>& layout = layouts[phase.channel];
+    const unsigned beat_bytes = format.data_width / 8;
+    const unsigned beat_offset = data_id_byte_offset(phase.data_id) & ~(beat_bytes - 1) & (CACHE_LINE_BYTES - 1);
+
+    for (unsigned i = 0; i < get_flit_words(phase.channel); i++)
+        flit[i] = 0;
+
+    for (std::vector<Field>::const_iterator field = layout.begin(); field != layout.end(); ++field)
+    {
+        if (field->id == FIELD_DATA)
+        {
+            /* Pack data 8 bytes at a time. */
+            runtime_error_assert(payload.data);
+            const uint8_t* data = payload.data + beat_offset;
+            for (unsigned word = 0; word < beat_bytes / 8; word++)
+            {
+                uint64_t value = 0;
+                for (unsigned byte = 0; byte < 8; byte++)
+                    value |= uint64_t(data[word * 8 + byte]) << (byte * 8);
+                flit_insert_bits(flit, field->offset + word * 64, 64, value);
+            }
+        } else
+        {
+            flit_insert_bits(flit, field->offset, field->width,
+                encode_field(field->id, payload, phase, beat_offset, beat_bytes));
+        }
+    }
+}
+
+ARM_TLM_EXPORT void FlitCodec::decode(Channel channel, const uint64_t* flit, Payload& payload, Phase& phase) const
+{
+    const std::vector<Field>& layout = layouts[channel];
+    const unsigned beat_bytes = format.data_width / 8;
+
+    phase.channel = channel;
+
+    /* Opcode and DataID select the meaning of other fields so decode them first. */
+    for (std::vector<Field>::const_iterator field = layout.begin(); field != layout.end(); ++field)
+    {
+        if (field->id == FIELD_OPCODE)
+            phase.raw_opcode = flit_extract_bits(flit, field->offset, field->width);
+        else if (field->id == FIELD_DATA_ID)
+            phase.data_id = flit_extract_bits(flit, field->offset, field->width);
+    }
+
+    const unsigned beat_offset = data_id_byte_offset(phase.data_id) & ~(beat_bytes - 1) & (CACHE_LINE_BYTES - 1);
+
+    for (std::vector<Field>::const_iterator field = layout.begin(); field != layout.end(); ++field)
+    {
+        if (field->id == FIELD_DATA)
+        {
+            uint8_t* data = payload.get_data() + beat_offset;
+            for (unsigned word = 0; word < beat_bytes / 8; word++)
+            {
+                const uint64_t value = flit_extract_bits(flit, field->offset + word * 64, 64);
+                for (unsigned byte = 0; byte < 8; byte++)
+                    data[word * 8 + byte] = value >> (byte * 8);
+            }
+        } else
+        {
+            decode_field(field->id, flit_extract_bits(flit, field->offset, field->width),
+                payload, phase, beat_offset, beat_bytes);
+        }
+    }
+}
+
+ARM_TLM_EXPORT void FlitCodec::decode_header(Channel channel, const uint64_t* flit, Phase& phase) const
+{
+    const std::vector<Field>& layout = layouts[channel];
+
+    phase.channel = channel;
+
+    for (std::vector<Field>::const_iterator field = layout.begin(); field != layout.end(); ++field)
+    {
+        if (field->id == FIELD_OPCODE)
+            phase.raw_opcode = flit_extract_bits(flit, field->offset, field->width);
+        else if (field->id == FIELD_TXN_ID)
+            phase.txn_id = flit_extract_bits(flit, field->offset, field->width);
+    }
+}
+
+}
+}
@@ -38,6 +38,8 @@ class AmbaTlmDemoRecipe(ConanFile):
         cmake = CMake(self)
         cmake.configure()
         cmake.build()
+        if can_run(self):
+            cmake.test()
 
     def layout(self):
         cmake_layout(self)
@@ -50,5 +52,17 @@ class AmbaTlmDemoRecipe(ConanFile):
             cmd = os.path.join(self.cpp.build.bindir, "AXITransactorExample")
             self.run(cmd, env="conanrun")
 
+            cmd = os.path.join(self.cpp.build.bindir, "AXITrafficEngineExample")
+            self.run(cmd, env="conanrun")
+
+            cmd = os.path.join(self.cpp.build.bindir, "AXITraceReplayExample")
+            self.run(cmd, env="conanrun")
+
             cmd = os.path.join(self.cpp.build.bindir, "CHITrafficExample")
             self.run(cmd, env="conanrun")
+
+            cmd = os.path.join(self.cpp.build.bindir, "CHITraceReplayExample")
+            self.run(cmd, env="conanrun")
+
+            cmd = os.path.join(self.cpp.build.bindir, "CHIBridgeExample")
+            self.run(cmd, env="conanrun")
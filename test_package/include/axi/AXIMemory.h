@@ -1,13 +1,55 @@
 #ifndef ARM_AXI_MEMORY_H
 #define ARM_AXI_MEMORY_H
 
-#include <map>
+#include <vector>
 #include <stdint.h>
 
 #include <ARM/TLM/arm_axi4.h>
+#include <ARM/TLM/arm_tlm_memory.h>
 
-#define MEMORY_SIZE (0x10000)
+#define MEMORY_PAGE_SIZE (0x1000)
+#define MEMORY_FILL (0xdf)
+#define MEMORY_LT_BEAT_LATENCY (sc_core::sc_time(1, sc_core::SC_NS))
 
+/* Timing and capacity of an AXIMemory. */
+struct AXIMemoryConfig
+{
+    /* Read and write transactions accepted before AR/AW READY is held. */
+    unsigned max_reads;
+    unsigned max_writes;
+
+    /* Cycles from AR to the first R beat, and from the last of AW/W to B. */
+    unsigned read_latency;
+    unsigned write_latency;
+
+    /* Interleave R beats of reads with different IDs. */
+    bool read_interleave;
+
+    std::size_t page_size;
+    bool huge_pages;
+
+    AXIMemoryConfig() :
+        max_reads(8),
+        max_writes(8),
+        read_latency(1),
+        write_latency(1),
+        read_interleave(true),
+        page_size(MEMORY_PAGE_SIZE),
+        huge_pages(false)
+    {}
+};
+
+/*
+ * Pipelined AXI slave over a sparse backing store.
+ *
+ * Up to max_reads reads and max_writes writes are outstanding at once; beyond
+ * that AR/AW READY is held until a transaction completes. AW and W progress
+ * independently, so write data may arrive before its address. Responses to
+ * the same ID are returned in order, while reads with different IDs have
+ * their R beats interleaved (least recently served first) unless
+ * read_interleave is clear. R and B each move one beat per cycle when the
+ * upstream returns READY at once.
+ */
 class AXIMemory : public sc_core::sc_module
 {
 protected:
@@ -20,24 +62,73 @@ protected:
         ACK
     };
 
-    /* Backing store for memory. */
-    uint8_t mem_data[MEMORY_SIZE];
+    /* Sparse backing store covering the whole address space. */
+    ARM::TLM::SparseMemory memory;
+
+    /* Staging for transactions which straddle backing store pages. */
+    std::vector<uint8_t> scratch;
+
+    /* An accepted read. */
+    struct ReadEntry
+    {
+        ARM::AXI::PayloadRef payload;
+
+        /* Cycle from which R beats may be sent. */
+        uint64_t ready_cycle;
 
-    /* Incoming queues per channel. */
-    std::deque<ARM::AXI::Payload*> aw_queue;
-    std::deque<ARM::AXI::Payload*> w_queue;
-    std::deque<ARM::AXI::Payload*> ar_queue;
+        /* Cycle the last R beat was sent, for interleaving. */
+        uint64_t last_served;
+
+        unsigned beats_sent;
+    };
+
+    /* An accepted write. */
+    struct WriteEntry
+    {
+        ARM::AXI::PayloadRef payload;
+
+        /* Cycle from which B may be sent, once data_done. */
+        uint64_t ready_cycle;
+
+        /* The last W beat has been received. */
+        bool data_done;
+    };
+
+    const AXIMemoryConfig config;
+
+    /* Outstanding transactions, oldest first. */
+    std::vector<ReadEntry> reads;
+    std::vector<WriteEntry> writes;
+
+    /* AR/AW whose READY is held until there is room for them. */
+    ARM::AXI::PayloadRef ar_stalled;
+    ARM::AXI::PayloadRef aw_stalled;
+
+    /* Writes whose last W beat arrived before the AW was accepted. */
+    std::vector<ARM::AXI::PayloadRef> w_early;
+
+    /* Read whose R beats must be completed before another starts. */
+    const ARM::AXI::Payload* r_locked;
 
     /* Current state of each bw channel. */
     ChannelState b_state;
     ChannelState r_state;
 
-    /* Outgoing communications to send at negedge. */
-    ARM::AXI::Payload* b_outgoing;
-    ARM::AXI::Payload* r_outgoing;
+    uint64_t cycle;
 
-    /* Number of beats (of r_outgoing) already sent. */
-    unsigned r_beat_count;
+    void accept_read(ARM::AXI::Payload& payload);
+    void accept_write(ARM::AXI::Payload& payload);
+    void write_data_done(ARM::AXI::Payload& payload);
+
+    /* Pick the read to send an R beat for, or nullptr. */
+    ReadEntry* select_read();
+
+    void send_read_beat();
+    void send_write_response();
+
+    /* Copy a transaction's data between the payload and backing store. */
+    void read_memory(ARM::AXI::Payload& payload);
+    void write_memory(const ARM::AXI::Payload& payload);
 
     void clock_posedge();
     void clock_negedge();
@@ -45,8 +136,28 @@ protected:
     tlm::tlm_sync_enum nb_transport_fw(ARM::AXI::Payload& payload,
         ARM::AXI::Phase& phase);
 
+    /* Loosely-timed access, annotating MEMORY_LT_BEAT_LATENCY per beat. */
+    void b_transport(ARM::AXI::Payload& payload, sc_core::sc_time& delay);
+
+    /* Untimed access to the backing store. */
+    unsigned transport_dbg(ARM::AXI::Payload& payload);
+
+    /* Grant DMI to the backing store page containing the address. */
+    bool get_direct_mem_ptr(ARM::AXI::Payload& payload, tlm::tlm_dmi& dmi);
+
 public:
-    explicit AXIMemory(sc_core::sc_module_name name);
+    AXIMemory(sc_core::sc_module_name name, unsigned port_width = 128,
+        const AXIMemoryConfig& config = AXIMemoryConfig());
+
+    /*
+     * Back part of the address space with an image file, either privately
+     * (copy-on-write) or shared (writes persist to the file).
+     */
+    void map_image(uint64_t address, const char* path, bool shared = false);
+
+    /* Save or restore the contents of the whole backing store. */
+    void save_snapshot(const char* path) const;
+    void restore_snapshot(const char* path);
 
     ARM::AXI::SimpleTargetSocket<AXIMemory> target;
 
@@ -2,32 +2,59 @@
 #define ARM_AXI_MONITOR_H
 
 #include <map>
+#include <string>
+#include <vector>
 
 #include <ARM/TLM/arm_axi4.h>
 
-class AXIMonitor : public sc_core::sc_module
+/*
+ * Printer of AXI transactions. An AXITap can be attached to any ARM AXI
+ * socket as an observer (and detached again) during simulation to monitor a
+ * link without splicing in an AXIMonitor.
+ */
+class AXITap : public ARM::TLM::SocketObserver<ARM::AXI::ProtocolType>
 {
 protected:
-    SC_HAS_PROCESS(AXIMonitor);
+    std::string tap_name;
 
     /* Beat-sized data for data printing. */
-    uint8_t* beat_data;
+    std::vector<uint8_t> beat_data;
 
     /* Map of burst counts for observed Payloads. */
-    std::map<ARM::AXI::Payload*, unsigned> payload_burst_index;
+    std::map<const ARM::AXI::Payload*, unsigned> payload_burst_index;
+
+public:
+    AXITap(const std::string& name, unsigned port_width = 128);
+
+    void print_payload(const ARM::AXI::Payload& payload,
+        ARM::AXI::Phase sent_phase, tlm::tlm_sync_enum reply,
+        ARM::AXI::Phase reply_phase);
+
+    void observe_nb_transport(const char* socket_name, bool fw,
+        const ARM::AXI::Payload& payload, const ARM::AXI::Phase& phase_before,
+        tlm::tlm_sync_enum reply, const ARM::AXI::Phase& phase_after);
+};
+
+class AXIMonitor : public sc_core::sc_module
+{
+protected:
+    SC_HAS_PROCESS(AXIMonitor);
+
+    /* Printer for the transactions passing through. */
+    AXITap tap;
 
     tlm::tlm_sync_enum nb_transport_fw(ARM::AXI::Payload& payload,
         ARM::AXI::Phase& phase);
     tlm::tlm_sync_enum nb_transport_bw(ARM::AXI::Payload& payload,
         ARM::AXI::Phase& phase);
 
-    void print_payload(ARM::AXI::Payload& payload,
-        ARM::AXI::Phase sent_phase, tlm::tlm_sync_enum reply,
-        ARM::AXI::Phase reply_phase);
+    /* Debug transport and DMI pass straight through the monitor. */
+    unsigned transport_dbg(ARM::AXI::Payload& payload);
+    bool get_direct_mem_ptr(ARM::AXI::Payload& payload, tlm::tlm_dmi& dmi);
+    void invalidate_direct_mem_ptr(sc_dt::uint64 start, sc_dt::uint64 end);
 
 public:
     AXIMonitor(sc_core::sc_module_name name, unsigned port_width = 128);
-    ~AXIMonitor();
 
     ARM::AXI::SimpleTargetSocket<AXIMonitor> target;
     ARM::AXI::SimpleInitiatorSocket<AXIMonitor> initiator;
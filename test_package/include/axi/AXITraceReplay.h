@@ -0,0 +1,54 @@
+#ifndef ARM_AXI_TRACE_REPLAY_H
+#define ARM_AXI_TRACE_REPLAY_H
+
+#include <unordered_map>
+
+#include <ARM/TLM/arm_tlm_trace.h>
+
+#include "AXITrafficGenerator.h"
+
+/*
+ * Replays an ARM::TLM trace file as AXI traffic, using the traffic
+ * generator's channel handshakes.
+ *
+ * Each record's opcode is an ARM::AXI::Command (read or write) and its id,
+ * address, size, len and burst give the transaction. Records issue in trace
+ * order, at most one read and one write per cycle, at their recorded cycle
+ * or once their dependency has completed depending on the mode. A record is
+ * issued when it is handed to an idle AW/AR queue, so a stalled channel shows
+ * as slip. A transaction completes on its B or last R beat.
+ */
+class AXITraceReplay : public AXITrafficGenerator
+{
+protected:
+    SC_HAS_PROCESS(AXITraceReplay);
+
+    ARM::TLM::TraceReplay replay;
+
+    /* Issued transactions and the index of their trace record. */
+    std::unordered_map<const ARM::AXI::Payload*, uint64_t> in_flight;
+
+    /* Current cycle, counting the first clock edge as cycle 0. */
+    uint64_t cycle;
+
+    void replay_posedge();
+
+    /* Issue the next record if its channel is free. */
+    bool issue_record();
+
+    void transaction_done(ARM::AXI::Payload& payload) override;
+
+public:
+    AXITraceReplay(sc_core::sc_module_name name, const char* path,
+        ARM::TLM::TraceMode mode = ARM::TLM::TRACE_MODE_ISSUE_TIME,
+        unsigned max_outstanding = 64);
+
+    /* Write a line per completed transaction to 'stream'. */
+    void set_log(std::ostream* stream) { replay.set_log(stream); }
+
+    const ARM::TLM::TraceReplay& get_replay() const { return replay; }
+
+    bool is_done() const { return replay.is_done(); }
+};
+
+#endif /* ARM_AXI_TRACE_REPLAY_H */
@@ -0,0 +1,233 @@
+#ifndef ARM_AXI_TRAFFIC_ENGINE_H
+#define ARM_AXI_TRAFFIC_ENGINE_H
+
+#include <deque>
+#include <vector>
+#include <stdint.h>
+
+#include <ARM/TLM/arm_axi4.h>
+
+/* Widest beat the engine generates data for: 1024 bits. */
+#define TRAFFIC_ENGINE_MAX_BEAT_BYTES (128)
+
+/* Transactions generated ahead of being issued, to find a read and a write to issue together. */
+#define TRAFFIC_ENGINE_LOOKAHEAD (4)
+
+/* One transaction shape in a descriptor's mix. */
+struct AXITrafficShape
+{
+    ARM::AXI::SizeEnum size;
+    uint8_t len;
+    ARM::AXI::BurstEnum burst;
+
+    /* Relative frequency of this shape. */
+    unsigned weight;
+};
+
+/* Compact description of a stream of traffic. */
+struct AXITrafficDescriptor
+{
+    enum AddressPattern
+    {
+        ADDRESS_SEQUENTIAL, /* each transaction follows on from the last */
+        ADDRESS_STRIDE,     /* each transaction starts 'stride' after the last */
+        ADDRESS_RANDOM      /* uniformly random, aligned to the transaction */
+    };
+
+    enum DataPattern
+    {
+        DATA_CONSTANT,      /* 'data_value' repeated */
+        DATA_INCREMENT,     /* a byte counter running through each transaction */
+        DATA_ADDRESS,       /* each 8 byte word holds its own address */
+        DATA_RANDOM         /* pseudo-random from 'seed' */
+    };
+
+    /*
+     * Addresses generated lie in [base, base + range), wrapping. Both must be
+     * multiples of 4KB so that no transaction runs past the end.
+     */
+    uint64_t base;
+    uint64_t range;
+    AddressPattern address_pattern;
+    uint64_t stride;
+
+    /*
+     * Weighted mix of transaction shapes; an empty mix means 4 beats of 16
+     * bytes, or of the port width if that is narrower. INCR shapes may cover
+     * at most 4KB and WRAP shapes 2, 4, 8 or 16 beats.
+     */
+    std::vector<AXITrafficShape> shapes;
+
+    /* Percentage of transactions which are reads. */
+    unsigned read_percent;
+
+    /* Transactions to generate, or 0 to run for ever. */
+    uint64_t count;
+
+    /* AXI IDs used, 0 to id_count - 1, and outstanding limits. */
+    unsigned id_count;
+    unsigned max_outstanding_per_id;
+    unsigned max_outstanding;
+
+    /*
+     * Target bandwidth in bytes per cycle, or 0 for as fast as the channels
+     * allow. Up to 'burst_bytes' of unused bandwidth may be saved up.
+     */
+    double bytes_per_cycle;
+    uint64_t burst_bytes;
+
+    DataPattern data_pattern;
+    uint64_t data_value;
+
+    uint64_t seed;
+
+    AXITrafficDescriptor() :
+        base(0),
+        range(0x100000),
+        address_pattern(ADDRESS_SEQUENTIAL),
+        stride(0x40),
+        read_percent(50),
+        count(0),
+        id_count(4),
+        max_outstanding_per_id(4),
+        max_outstanding(16),
+        bytes_per_cycle(0),
+        burst_bytes(4096),
+        data_pattern(DATA_INCREMENT),
+        data_value(0),
+        seed(1)
+    {}
+};
+
+/*
+ * Streaming traffic generator. Transactions are generated one at a time from
+ * an AXITrafficDescriptor as the outstanding limits and the bandwidth target
+ * allow. Transactions in flight are held in fixed tables sized by those
+ * limits and released as soon as they complete, or with the engine, so memory
+ * use does not grow with the length of a run.
+ *
+ * Channel handling follows AXITrafficGenerator: VALIDs are sent at negedge
+ * and READYs returned immediately clear the channel at the next posedge. The
+ * oldest read and the oldest write generated are issued on AR and AW
+ * independently, so each may go in the same cycle and neither waits for the
+ * other's channel.
+ */
+class AXITrafficEngine : public sc_core::sc_module
+{
+protected:
+    SC_HAS_PROCESS(AXITrafficEngine);
+
+    enum ChannelState
+    {
+        CLEAR,
+        REQ,
+        ACK
+    };
+
+    /*
+     * Transactions in flight in one direction, owned until they complete.
+     * Responses to an ID return in order, so each ID has a ring of
+     * max_outstanding_per_id slots.
+     */
+    struct InFlightTable
+    {
+        std::vector<ARM::AXI::PayloadRef> slots;
+        std::vector<unsigned> first;
+        std::vector<unsigned> count;
+    };
+
+    const AXITrafficDescriptor desc;
+    const unsigned port_width_bytes;
+
+    /* Sum of the shape weights. */
+    unsigned total_weight;
+
+    /* Shape used when the descriptor gives none. */
+    AXITrafficShape default_shape;
+
+    /* Transactions generated but not yet issued, oldest first. */
+    std::deque<ARM::AXI::PayloadRef> upcoming;
+
+    InFlightTable reads;
+    InFlightTable writes;
+
+    /* Writes issued on AW whose data is still to be sent. */
+    std::deque<ARM::AXI::PayloadRef> w_queue;
+    unsigned w_beat_count;
+
+    /* Acknowledgements to send at negedge. */
+    std::deque<ARM::AXI::PayloadRef> wack_queue;
+    std::deque<ARM::AXI::PayloadRef> rack_queue;
+
+    ChannelState aw_state;
+    ChannelState w_state;
+    ChannelState ar_state;
+
+    /* Outstanding transactions in total and per ID. */
+    unsigned outstanding;
+    std::vector<unsigned> outstanding_per_id;
+    unsigned next_id;
+
+    /* Bandwidth saved up, in bytes; may go negative after a large transaction. */
+    double tokens;
+
+    uint64_t next_address;
+    uint64_t random_state;
+
+    uint64_t generated;
+    uint64_t completed;
+    uint64_t bytes_completed;
+
+    uint64_t random();
+
+    /* Generate the next transaction from the descriptor onto 'upcoming'. */
+    void generate();
+
+    /* Check a transaction shape can be generated for this port. */
+    bool check_shape(const AXITrafficShape& shape) const;
+
+    /*
+     * Issue the oldest upcoming transaction with the given command if its
+     * channel and the limits allow.
+     */
+    void issue(ARM::AXI::Command command);
+
+    /* Pick an ID below its outstanding limit, or return false. */
+    bool allocate_id(uint32_t& id);
+
+    void fill_beat(ARM::AXI::Payload& payload, unsigned beat, uint8_t* data);
+
+    /* Add an issued transaction to its in-flight table. */
+    void track(InFlightTable& table, const ARM::AXI::PayloadRef& payload);
+
+    /*
+     * Take a completed transaction out of its in-flight table, returning a
+     * null PayloadRef if it is not the oldest in flight on its ID.
+     */
+    ARM::AXI::PayloadRef retire(InFlightTable& table, ARM::AXI::Payload& payload);
+
+    void complete(ARM::AXI::Payload& payload);
+
+    void clock_posedge();
+    void clock_negedge();
+
+    tlm::tlm_sync_enum nb_transport_bw(ARM::AXI::Payload& payload,
+        ARM::AXI::Phase& phase);
+
+public:
+    AXITrafficEngine(sc_core::sc_module_name name,
+        const AXITrafficDescriptor& desc, unsigned port_width = 128);
+
+    uint64_t get_generated() const { return generated; }
+    uint64_t get_completed() const { return completed; }
+    uint64_t get_bytes_completed() const { return bytes_completed; }
+
+    /* All of a finite descriptor's transactions have completed. */
+    bool is_done() const;
+
+    ARM::AXI::SimpleInitiatorSocket<AXITrafficEngine> initiator;
+
+    sc_core::sc_in<bool> clock;
+};
+
+#endif /* ARM_AXI_TRAFFIC_ENGINE_H */
@@ -2,6 +2,7 @@
 #define ARM_AXI_TRAFFICGENERATOR_H
 
 #include <deque>
+#include <unordered_map>
 
 #include <ARM/TLM/arm_axi4.h>
 
@@ -18,12 +19,12 @@ protected:
     };
 
     /* Outgoing queues per channel. */
-    std::deque<ARM::AXI::Payload*> aw_queue;
-    std::deque<ARM::AXI::Payload*> w_queue;
-    std::deque<ARM::AXI::Payload*> ar_queue;
-    std::deque<ARM::AXI::Payload*> cr_queue;
-    std::deque<ARM::AXI::Payload*> wack_queue;
-    std::deque<ARM::AXI::Payload*> rack_queue;
+    std::deque<ARM::AXI::PayloadRef> aw_queue;
+    std::deque<ARM::AXI::PayloadRef> w_queue;
+    std::deque<ARM::AXI::PayloadRef> ar_queue;
+    std::deque<ARM::AXI::PayloadRef> cr_queue;
+    std::deque<ARM::AXI::PayloadRef> wack_queue;
+    std::deque<ARM::AXI::PayloadRef> rack_queue;
 
     /* Current state of each fw channel. */
     ChannelState aw_state;
@@ -32,9 +33,15 @@ protected:
     ChannelState cr_state;
 
     /* Incoming communications to push at posedge. */
-    ARM::AXI::Payload* cr_incoming;
-    ARM::AXI::Payload* wack_incoming;
-    ARM::AXI::Payload* rack_incoming;
+    ARM::AXI::PayloadRef cr_incoming;
+    ARM::AXI::PayloadRef wack_incoming;
+    ARM::AXI::PayloadRef rack_incoming;
+
+    /* Snoop payload held until its CR is accepted. */
+    ARM::AXI::PayloadRef cr_outgoing;
+
+    /* Transactions issued on AR or AW, held until their last R beat or B. */
+    std::unordered_map<const ARM::AXI::Payload*, ARM::AXI::PayloadRef> in_flight;
 
     /* Number of beats (of the front Payload of w_queue) already sent. */
     unsigned w_beat_count;
@@ -42,9 +49,15 @@ protected:
     void clock_posedge();
     void clock_negedge();
 
+    /* Take a completed transaction out of in_flight, or return null. */
+    ARM::AXI::PayloadRef retire(ARM::AXI::Payload& payload);
+
     tlm::tlm_sync_enum nb_transport_bw(ARM::AXI::Payload& payload,
         ARM::AXI::Phase& phase);
 
+    /* Called on a write's B or a read's last R beat. */
+    virtual void transaction_done(ARM::AXI::Payload&) {}
+
 public:
     explicit AXITrafficGenerator(sc_core::sc_module_name name);
 
@@ -2,6 +2,7 @@
 #define ARM_AXI_TRANSACTORS_H
 
 #include <map>
+#include <vector>
 
 #include <ARM/TLM/arm_axi4.h>
 #include <tlm_utils/simple_target_socket.h>
@@ -18,32 +19,20 @@ enum TransPortState
 class axi_tlm_extension : public tlm::tlm_extension<axi_tlm_extension>
 {
 public:
-    ARM::AXI::Payload* arm_payload;
+    ARM::AXI::PayloadRef arm_payload;
 
     explicit axi_tlm_extension(ARM::AXI::Payload* arm_payload_ = nullptr) :
         arm_payload(arm_payload_)
-    {
-        if (arm_payload)
-            arm_payload->ref();
-    }
-
-    virtual ~axi_tlm_extension()
-    {
-        if (arm_payload)
-            arm_payload->unref();
-    }
+    {}
 
     virtual tlm::tlm_extension_base* clone() const
     {
-        return new axi_tlm_extension(arm_payload);
+        return new axi_tlm_extension(arm_payload.get());
     }
 
     virtual void copy_from ( const tlm_extension_base &extension)
     {
-        if (arm_payload)
-            arm_payload->unref();
         arm_payload = static_cast<axi_tlm_extension const &>(extension).arm_payload;
-        arm_payload->ref();
     }
 };
 
@@ -79,6 +68,10 @@ protected:
     TransPortState state_r;
     TransPortState state_b;
 
+    /* Debug transport data and strobes, kept at the size of the largest burst seen. */
+    std::vector<uint8_t> dbg_data;
+    std::vector<uint8_t> dbg_strobes;
+
 protected:
     bool process_req();
 
@@ -87,6 +80,9 @@ protected:
 
     virtual tlm::tlm_sync_enum initiator_nb_transport_fw(tlm::tlm_generic_payload& gen_payload,
         tlm::tlm_phase& gen_phase, sc_core::sc_time& t) = 0;
+    virtual unsigned initiator_transport_dbg(tlm::tlm_generic_payload& gen_payload) = 0;
+    virtual bool initiator_get_direct_mem_ptr(tlm::tlm_generic_payload& gen_payload,
+        tlm::tlm_dmi& dmi) = 0;
 
     void clock_posedge();
     void clock_negedge();
@@ -99,6 +95,9 @@ public:
         ARM::AXI::Phase& arm_phase);
     tlm::tlm_sync_enum nb_transport_bw(tlm::tlm_generic_payload& gen_payload,
         tlm::tlm_phase& gen_phase, sc_core::sc_time& t);
+    unsigned transport_dbg(ARM::AXI::Payload& arm_payload);
+    bool get_direct_mem_ptr(ARM::AXI::Payload& arm_payload, tlm::tlm_dmi& dmi);
+    void invalidate_direct_mem_ptr(sc_dt::uint64 start, sc_dt::uint64 end);
 
     ARM::AXI::SimpleTargetSocket<TransAXIToGenericImp> target;
     sc_core::sc_in<bool> clock;
@@ -133,6 +132,7 @@ protected:
 
     virtual tlm::tlm_sync_enum target_nb_transport_bw(tlm::tlm_generic_payload& gen_payload,
         tlm::tlm_phase& gen_phase, sc_core::sc_time& t) = 0;
+    virtual void target_invalidate_direct_mem_ptr(sc_dt::uint64 start, sc_dt::uint64 end) = 0;
 
     void clock_posedge();
     void clock_negedge();
@@ -145,6 +145,9 @@ public:
         tlm::tlm_phase& gen_phase, sc_core::sc_time& t);
     tlm::tlm_sync_enum nb_transport_bw(ARM::AXI::Payload& arm_payload,
         ARM::AXI::Phase& arm_phase);
+    unsigned transport_dbg(tlm::tlm_generic_payload& gen_payload);
+    bool get_direct_mem_ptr(tlm::tlm_generic_payload& gen_payload, tlm::tlm_dmi& dmi);
+    void invalidate_direct_mem_ptr(sc_dt::uint64 start, sc_dt::uint64 end);
 
     ARM::AXI::SimpleInitiatorSocket<TransGenericToAXIImp> initiator;
     sc_core::sc_in<bool> clock;
@@ -157,12 +160,21 @@ protected:
     tlm::tlm_sync_enum initiator_nb_transport_fw(tlm::tlm_generic_payload& gen_payload,
         tlm::tlm_phase& gen_phase, sc_core::sc_time& t)
     { return initiator->nb_transport_fw(gen_payload, gen_phase, t); }
+    unsigned initiator_transport_dbg(tlm::tlm_generic_payload& gen_payload)
+    { return initiator->transport_dbg(gen_payload); }
+    bool initiator_get_direct_mem_ptr(tlm::tlm_generic_payload& gen_payload,
+        tlm::tlm_dmi& dmi)
+    { return initiator->get_direct_mem_ptr(gen_payload, dmi); }
 
 public:
     TransAXIToGeneric(sc_core::sc_module_name name, ARM::TLM::Protocol protocol) :
         TransAXIToGenericImp(name, protocol, DataWidth),
         initiator("initiator")
-    { initiator.register_nb_transport_bw(this, &TransAXIToGenericImp::nb_transport_bw); }
+    {
+        initiator.register_nb_transport_bw(this, &TransAXIToGenericImp::nb_transport_bw);
+        initiator.register_invalidate_direct_mem_ptr(this,
+            &TransAXIToGenericImp::invalidate_direct_mem_ptr);
+    }
 
     tlm_utils::simple_initiator_socket<TransAXIToGenericImp, DataWidth, tlm::tlm_base_protocol_types> initiator;
 };
@@ -174,12 +186,18 @@ protected:
     tlm::tlm_sync_enum target_nb_transport_bw(tlm::tlm_generic_payload& gen_payload,
         tlm::tlm_phase& gen_phase, sc_core::sc_time& t)
     { return target->nb_transport_bw(gen_payload, gen_phase, t); }
+    void target_invalidate_direct_mem_ptr(sc_dt::uint64 start, sc_dt::uint64 end)
+    { target->invalidate_direct_mem_ptr(start, end); }
 
 public:
     TransGenericToAXI(sc_core::sc_module_name name, ARM::TLM::Protocol protocol) :
         TransGenericToAXIImp(name, protocol, DataWidth),
         target("target")
-    { target.register_nb_transport_fw(this, &TransGenericToAXIImp::nb_transport_fw); }
+    {
+        target.register_nb_transport_fw(this, &TransGenericToAXIImp::nb_transport_fw);
+        target.register_transport_dbg(this, &TransGenericToAXIImp::transport_dbg);
+        target.register_get_direct_mem_ptr(this, &TransGenericToAXIImp::get_direct_mem_ptr);
+    }
 
     tlm_utils::simple_target_socket<TransGenericToAXIImp, DataWidth, tlm::tlm_base_protocol_types> target;
 };
@@ -0,0 +1,182 @@
+#ifndef ARM_AXI_WIDTH_CONVERTER_H
+#define ARM_AXI_WIDTH_CONVERTER_H
+
+#include <deque>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+#include <ARM/TLM/arm_axi4.h>
+
+/* Widest AXI data channel: 1024 bits. */
+#define WIDTH_CONVERTER_MAX_BEAT_BYTES (128)
+
+/*
+ * Data width converter between an AXI target port and an AXI initiator port
+ * of different widths, e.g. to connect 64-bit peripherals to a 512-bit
+ * fabric.
+ *
+ * Transactions whose SIZE fits the initiator port (everything, when upsizing)
+ * are forwarded as the same payload. Wider transactions are split into INCR
+ * bursts of initiator port SIZE descended from the original payload, and
+ * beats are repacked between the two widths with the raw beat interfaces.
+ * Their write responses are merged: the completion, persist and tag match
+ * parts are each sent on once every child has given them.
+ *
+ * On ACE ports a transaction is kept until the target port's RACK/WACK for
+ * it, which is passed on for every payload sent to the initiator port.
+ *
+ * Every channel keeps its own VALID/READY handshake on both sides, so any
+ * number of transactions can be in flight. A side's READY is held back while
+ * the beats it produced are still queued for the other side. Conversion state
+ * is recycled between transactions so no allocation is made per beat.
+ */
+class AXIWidthConverter : public sc_core::sc_module
+{
+protected:
+    SC_HAS_PROCESS(AXIWidthConverter);
+
+    /* Conversion state of one transaction. */
+    struct Transaction
+    {
+        ARM::AXI::PayloadRef payload;
+
+        /*
+         * Payloads sent to the initiator port: the transaction's own payload,
+         * or the bursts descended from it when it is split.
+         */
+        std::vector<ARM::AXI::PayloadRef> children;
+        bool split;
+
+        /* Next W/R beat to convert: child index and beat within it. */
+        unsigned data_child;
+        unsigned data_beat;
+
+        /* Next beat of the transaction's own payload to write out. */
+        unsigned payload_beat;
+
+        /*
+         * Number of children whose completion, persist and match B responses
+         * have been received, and whether the transaction needs the last two.
+         */
+        unsigned b_count;
+        unsigned persist_count;
+        unsigned match_count;
+        bool expects_persist;
+        bool expects_match;
+
+        /* Every tag match so far has passed. */
+        bool tag_match;
+
+        /* Worst response seen for the current read beat or the write. */
+        ARM::AXI::Resp resp;
+
+        /* Target port beat being assembled from split read data. */
+        uint8_t beat[WIDTH_CONVERTER_MAX_BEAT_BYTES];
+    };
+
+    /* A VALID to send on a channel. */
+    struct Beat
+    {
+        ARM::AXI::PayloadRef payload;
+        ARM::AXI::Phase phase;
+    };
+
+    /* One channel in one direction. */
+    struct Channel
+    {
+        std::deque<Beat> queue;
+
+        /* A VALID has been sent and its READY is still to come. */
+        bool busy;
+
+        /*
+         * The incoming VALID whose READY is held back until the queue
+         * drains, and the READY to give it.
+         */
+        ARM::AXI::PayloadRef stalled;
+        ARM::AXI::Phase stalled_ready;
+
+        Channel() :
+            busy(false),
+            stalled_ready(ARM::AXI::PHASE_UNINITIALIZED)
+        {}
+    };
+
+    /* log2 of the initiator port width in bytes. */
+    const ARM::AXI::Size initiator_size;
+
+    /* Completed transactions are acknowledged with RACK/WACK. */
+    const bool completion_ack;
+
+    /* Channels towards the initiator port. */
+    Channel aw;
+    Channel w;
+    Channel ar;
+
+    /* Channels towards the target port. */
+    Channel r;
+    Channel b;
+
+    /*
+     * Every transaction allocated, and those free for reuse. Transactions in
+     * flight are indexed by their own payload and by each of their children.
+     */
+    std::vector<Transaction*> transactions;
+    std::vector<Transaction*> free_transactions;
+    std::unordered_map<const ARM::AXI::Payload*, Transaction*> active;
+
+    Transaction* new_transaction(ARM::AXI::Payload& payload);
+    void retire_transaction(Transaction* trans);
+
+    /* The transaction in flight a payload belongs to, or null. */
+    Transaction* find_transaction(const ARM::AXI::Payload& payload) const;
+
+    bool needs_split(const ARM::AXI::Payload& payload) const;
+    void add_children(Transaction* trans, uint64_t start, uint64_t end);
+
+    /* Address of the next initiator port beat of a split transaction. */
+    uint64_t child_beat_address(const Transaction* trans) const;
+
+    /*
+     * Repack data between the two widths, queueing the resulting beats on
+     * 'channel' if it is given.
+     */
+    void convert_write_beat(Transaction* trans, Channel* channel);
+    void convert_read_beat(Transaction* trans, Channel* channel);
+
+    /* Send queued beats until a channel stalls, then release its sender. */
+    void send_fw(Channel& channel);
+    void send_bw(Channel& channel);
+
+    /*
+     * READY an incoming VALID now if the beats it queued on 'channel' have all
+     * been sent, else once they have.
+     */
+    tlm::tlm_sync_enum accept(Channel& channel, ARM::AXI::Payload& payload,
+        ARM::AXI::Phase& phase, ARM::AXI::Phase ready);
+
+    tlm::tlm_sync_enum nb_transport_fw(ARM::AXI::Payload& payload,
+        ARM::AXI::Phase& phase);
+    tlm::tlm_sync_enum nb_transport_bw(ARM::AXI::Payload& payload,
+        ARM::AXI::Phase& phase);
+
+    /* Split transactions issue each child in turn. */
+    void b_transport(ARM::AXI::Payload& payload, sc_core::sc_time& delay);
+    unsigned transport_dbg(ARM::AXI::Payload& payload);
+
+    /* DMI does not depend on the port width so passes straight through. */
+    bool get_direct_mem_ptr(ARM::AXI::Payload& payload, tlm::tlm_dmi& dmi);
+    void invalidate_direct_mem_ptr(sc_dt::uint64 start, sc_dt::uint64 end);
+
+public:
+    AXIWidthConverter(sc_core::sc_module_name name, unsigned target_width,
+        unsigned initiator_width,
+        ARM::TLM::Protocol protocol = ARM::TLM::PROTOCOL_ACE);
+    ~AXIWidthConverter();
+
+    ARM::AXI::SimpleTargetSocket<AXIWidthConverter> target;
+    ARM::AXI::SimpleInitiatorSocket<AXIWidthConverter> initiator;
+};
+
+#endif /* ARM_AXI_WIDTH_CONVERTER_H */
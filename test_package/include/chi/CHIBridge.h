@@ -0,0 +1,116 @@
+#ifndef ARM_CHI_BRIDGE_MODEL_H
+#define ARM_CHI_BRIDGE_MODEL_H
+
+#include <ARM/TLM/arm_chi.h>
+#include <ARM/TLM/arm_chi_bridge.h>
+#include <ARM/TLM/arm_chi_flit.h>
+
+#include "CHIUtilities.h"
+
+#include <cstdint>
+#include <vector>
+
+/*
+ * One end of a CHI link between two SystemC kernels in separate processes, over an ARM::CHI::BridgeLink. A
+ * CHIBridgeTarget takes the place of the home node for the requester in one process and a CHIBridgeInitiator the
+ * place of the requester for the home node in the other.
+ *
+ * Each end is a link partner of its local node, with the link credit flow control of a LinkChannel per channel. Flits
+ * received from the local node are packed onto the bridge while it has room, and only then is their link credit
+ * returned, so a full bridge holds the sender back. Flits from the bridge are decoded into local Payloads and sent on
+ * to the local node once they are due and the channel has room for them.
+ *
+ * Flits are matched to the Payload they belong to as the nodes do, by TxnID: responses on the requester side by the
+ * TxnID of the request, snoop responses on the home side by the TxnID of the snoop, and write data and CompAck on the
+ * home side by the DBID given in the response they follow. Payloads are held for this until their ID is reused. New
+ * requests and snoops are decoded into new Payloads. Debug transport and DMI do not cross the bridge, nor do forwarded
+ * (DCT and DMT) flits between other nodes.
+ */
+class CHIBridge : public sc_core::sc_module
+{
+protected:
+    SC_HAS_PROCESS(CHIBridge);
+
+    /* TxnIDs and DBIDs the flit formats can carry: 12 bits. */
+    static const unsigned MAX_TXN_IDS = 4096;
+
+    ARM::CHI::BridgeLink& link;
+    const ARM::CHI::BridgeSide side;
+    const ARM::CHI::FlitCodec codec;
+
+    CHIChannelState channels[CHI_NUM_CHANNELS];
+
+    /*
+     * Payloads flits from the bridge are decoded into, by TxnID: the requests sent on the requester side, the snoops
+     * sent on the home side. Also on the home side, requests by the DBID given to them.
+     */
+    std::vector<ARM::CHI::PayloadRef> txn_payloads;
+    std::vector<ARM::CHI::PayloadRef> dbid_payloads;
+
+    /* Current cycle, counting the first clock edge as cycle 0. */
+    uint64_t cycle = 0;
+
+    void clock_posedge();
+    void clock_negedge();
+
+    /* Decode flits due by this cycle onto the local channels while they have room. */
+    void receive_bridge_flits();
+
+    /* Pack flits received from the local node onto the bridge while it has room. */
+    void send_bridge_flits();
+
+    /* Remember the Payload of a flit from the local node for the flits which will refer to it. */
+    void track_payload(const CHIFlit& flit);
+
+    /* The Payload a flit from the bridge is to be decoded into, or null if it is for no known transaction. */
+    ARM::CHI::PayloadRef find_payload(const ARM::CHI::Phase& header);
+
+    /* Take a flit or link credit from the local node. */
+    tlm::tlm_sync_enum receive_local(ARM::CHI::Payload& payload, ARM::CHI::Phase& phase);
+
+    /* Send a flit or link credit to the local node. */
+    virtual tlm::tlm_sync_enum send_local(ARM::CHI::Payload& payload, ARM::CHI::Phase& phase) = 0;
+
+    /* The peer no longer waits for this end once simulation stops. */
+    void end_of_simulation() override;
+
+    CHIBridge(const sc_core::sc_module_name& name, ARM::CHI::BridgeLink& link, ARM::CHI::BridgeSide side,
+            unsigned data_width_bits, const ARM::CHI::LinkConfig& link_config);
+
+public:
+    ~CHIBridge();
+
+    sc_core::sc_in<bool> clock;
+};
+
+/* Requester side end of a bridge, taking the place of the home node. */
+class CHIBridgeTarget : public CHIBridge
+{
+protected:
+    tlm::tlm_sync_enum nb_transport_fw(ARM::CHI::Payload& payload, ARM::CHI::Phase& phase);
+
+    tlm::tlm_sync_enum send_local(ARM::CHI::Payload& payload, ARM::CHI::Phase& phase) override;
+
+public:
+    CHIBridgeTarget(const sc_core::sc_module_name& name, ARM::CHI::BridgeLink& link, unsigned data_width_bits = 128,
+            const ARM::CHI::LinkConfig& link_config = ARM::CHI::LinkConfig());
+
+    ARM::CHI::SimpleTargetSocket<CHIBridgeTarget> target;
+};
+
+/* Home side end of a bridge, taking the place of the requester. */
+class CHIBridgeInitiator : public CHIBridge
+{
+protected:
+    tlm::tlm_sync_enum nb_transport_bw(ARM::CHI::Payload& payload, ARM::CHI::Phase& phase);
+
+    tlm::tlm_sync_enum send_local(ARM::CHI::Payload& payload, ARM::CHI::Phase& phase) override;
+
+public:
+    CHIBridgeInitiator(const sc_core::sc_module_name& name, ARM::CHI::BridgeLink& link,
+            unsigned data_width_bits = 128, const ARM::CHI::LinkConfig& link_config = ARM::CHI::LinkConfig());
+
+    ARM::CHI::SimpleInitiatorSocket<CHIBridgeInitiator> initiator;
+};
+
+#endif // ARM_CHI_BRIDGE_MODEL_H
@@ -2,26 +2,115 @@
 #define ARM_CHI_MEMORY_H
 
 #include <ARM/TLM/arm_chi.h>
+#include <ARM/TLM/arm_tlm_memory.h>
 
 #include "CHIUtilities.h"
 
 #include <cstdint>
+#include <deque>
+#include <vector>
 
+/* Capacity, throughput and timing of a CHIMemory. */
+struct CHIMemoryConfig
+{
+    /* Number of trackers, and so of transactions which can be outstanding at once. */
+    unsigned max_transactions = 16;
+
+    /* Flits retired from each incoming channel per cycle. */
+    unsigned req_per_cycle = 1;
+    unsigned rsp_per_cycle = 1;
+    unsigned dat_per_cycle = 1;
+
+    /* Cycles from a read request to its first CompData, and from a request or write data to its response. */
+    unsigned read_latency = 2;
+    unsigned response_latency = 1;
+
+    /* Flits and credits moved per cycle on each channel, and credit depth. */
+    ARM::CHI::LinkConfig link;
+
+    size_t page_size = 0x1000;
+    bool huge_pages = false;
+};
+
+/*
+ * Combined home and subordinate node over a sparse backing store. With no other caches behind it, coherent requests
+ * are completed without snooping: ReadShared and friends are granted UniqueClean, CMOs complete at once and atomics are
+ * performed on the backing store.
+ *
+ * Each request is given a tracker (its DBID) until it completes. With none free a retryable request gets a RetryAck,
+ * then a PCrdGrant once a tracker is released. Responses and read data pass through fixed latency pipelines on their
+ * own channels. Each is held back separately by its channel, so CompData waits at the head of its pipeline until the
+ * ReadReceipt of its read has been sent to the requester, and a tracker is kept until all its CompData has left the
+ * pipeline.
+ */
 class CHIMemory : public sc_core::sc_module
 {
 protected:
     SC_HAS_PROCESS(CHIMemory);
 
-    static const size_t MEMORY_SIZE = 0x10000;
+    static const uint8_t MEMORY_FILL = 0xdf;
+
+    /* An outstanding transaction, indexed by its DBID. */
+    struct Tracker
+    {
+        bool in_use = false;
+
+        ARM::CHI::PayloadRef payload;
+
+        /* The request, to address responses to. */
+        ARM::CHI::Phase req_phase;
+
+        /* Write data flits still to be received. */
+        unsigned data_remaining = 0;
+
+        /* Read or atomic data flits still in the pipeline. */
+        unsigned data_in_flight = 0;
+
+        /*
+         * RSP flits which must have been sent before read data is queued, so that it cannot overtake the ReadReceipt.
+         * All ones while the ReadReceipt is still in the pipeline.
+         */
+        uint64_t receipt_after = 0;
+
+        /* A CompAck is still to be received. */
+        bool comp_ack_pending = false;
+    };
 
-    /* Backing store for memory. */
-    uint8_t mem_data[MEMORY_SIZE];
+    /* A flit to send once the cycle it is due arrives. */
+    struct Scheduled
+    {
+        uint64_t due;
+        CHIFlit flit;
+
+        /* Tracker this is the ReadReceipt or (read or atomic) CompData of, or -1. */
+        int tracker;
+    };
+
+    /* Sparse backing store covering the whole address space. */
+    ARM::TLM::SparseMemory memory;
 
     CHIChannelState channels[CHI_NUM_CHANNELS];
 
-    /* Track the number of write data beats remaining for in-progress writes, indexed by DBID. 0 indicates an unused
-     * DBID. */
-    std::vector<uint8_t> write_data_beats_remaining;
+    const CHIMemoryConfig config;
+
+    std::vector<Tracker> trackers;
+    std::vector<uint16_t> free_dbids;
+
+    /* Free trackers set aside for requesters which have been granted a P-Credit. */
+    unsigned dbids_reserved = 0;
+
+    /* Requests sent RetryAck, in order, waiting for a PCrdGrant. */
+    std::deque<CHIFlit> pcrd_waiting;
+
+    /* Response and read data pipelines. */
+    std::deque<Scheduled> rsp_pipeline;
+    std::deque<Scheduled> dat_pipeline;
+
+    /* RSP flits queued on the channel, and sent from it. */
+    uint64_t rsp_queued = 0;
+    uint64_t rsp_sent = 0;
+
+    uint64_t cycle = 0;
 
     unsigned data_width_bytes;
 
@@ -31,17 +120,55 @@ protected:
     void send_link_credit(ARM::CHI::Channel channel);
     void send_flit(CHIChannelState& channel);
 
-    void handle_read_req(const CHIFlit& req_flit);
-    void handle_write_req(const CHIFlit& req_flit);
+    void handle_req(const CHIFlit& req_flit);
+    void handle_read_req(uint16_t dbid);
+    void handle_dataless_req(uint16_t dbid);
+    void handle_write_req(uint16_t dbid);
+    void handle_atomic_req(uint16_t dbid);
 
+    void handle_comp_ack(uint16_t dbid);
     void handle_write_dat(const CHIFlit& dat_flit);
 
-    uint16_t allocate_dbid_for_write(const CHIFlit& req_flit);
+    /* Commit a write, or perform an atomic, once all its data has been received. */
+    void complete_write(uint16_t dbid);
+    void complete_atomic(uint16_t dbid);
+
+    /* Queue a flit on a pipeline to be sent 'latency' cycles from now. */
+    void schedule(std::deque<Scheduled>& pipeline, unsigned latency, const ARM::CHI::PayloadRef& payload,
+            const ARM::CHI::Phase& phase, int tracker = -1);
+
+    /* Move flits which have become due onto a channel. */
+    void issue_due(std::deque<Scheduled>& pipeline, ARM::CHI::Channel channel);
+
+    /*
+     * Allocate a tracker for a request. Returns false, having scheduled a RetryAck, if there is none free for it.
+     */
+    bool allocate_tracker(const CHIFlit& req_flit, uint16_t& dbid);
+
+    /* Release a tracker if nothing more is expected of its transaction. */
+    void try_release(uint16_t dbid);
 
     tlm::tlm_sync_enum nb_transport_fw(ARM::CHI::Payload& payload, ARM::CHI::Phase& phase);
 
+    /* Untimed access to the backing store, one cache line at a time. */
+    unsigned transport_dbg(ARM::CHI::Payload& payload);
+
+    /* Grant DMI to the backing store page containing the address. */
+    bool get_direct_mem_ptr(ARM::CHI::Payload& payload, tlm::tlm_dmi& dmi);
+
 public:
-    explicit CHIMemory(const sc_core::sc_module_name& name, unsigned data_width_bits = 128);
+    explicit CHIMemory(const sc_core::sc_module_name& name, unsigned data_width_bits = 128,
+            const CHIMemoryConfig& config = CHIMemoryConfig());
+
+    /*
+     * Back part of the address space with an image file, either privately
+     * (copy-on-write) or shared (writes persist to the file).
+     */
+    void map_image(uint64_t address, const char* path, bool shared = false);
+
+    /* Save or restore the contents of the whole backing store. */
+    void save_snapshot(const char* path) const;
+    void restore_snapshot(const char* path);
 
     ARM::CHI::SimpleTargetSocket<CHIMemory> target;
 
@@ -2,25 +2,49 @@
 #define ARM_CHI_MONITOR_H
 
 #include <map>
+#include <string>
 
 #include <ARM/TLM/arm_chi.h>
 
-class CHIMonitor : public sc_core::sc_module
+/*
+ * Printer of CHI flits. A CHITap can be attached to any ARM CHI socket as an
+ * observer (and detached again) during simulation to monitor a link without
+ * splicing in a CHIMonitor.
+ */
+class CHITap : public ARM::TLM::SocketObserver<ARM::CHI::ProtocolType>
 {
 protected:
-    SC_HAS_PROCESS(CHIMonitor);
+    std::string tap_name;
 
     unsigned data_width_bytes;
 
-    /* Map of burst counts for observed Payloads. */
-    std::map<ARM::CHI::Payload*, unsigned> payload_burst_index;
+public:
+    CHITap(const std::string& name, unsigned data_width_bits = 128);
+
+    void print_payload(bool fw, const ARM::CHI::Payload& payload, const ARM::CHI::Phase& phase);
+
+    void observe_nb_transport(const char* socket_name, bool fw,
+        const ARM::CHI::Payload& payload, const ARM::CHI::Phase& phase_before,
+        tlm::tlm_sync_enum reply, const ARM::CHI::Phase& phase_after);
+};
+
+class CHIMonitor : public sc_core::sc_module
+{
+protected:
+    SC_HAS_PROCESS(CHIMonitor);
+
+    /* Printer for the flits passing through. */
+    CHITap tap;
 
     tlm::tlm_sync_enum nb_transport_fw(ARM::CHI::Payload& payload,
         ARM::CHI::Phase& phase);
     tlm::tlm_sync_enum nb_transport_bw(ARM::CHI::Payload& payload,
         ARM::CHI::Phase& phase);
 
-    void print_payload(bool fw, const ARM::CHI::Payload& payload, const ARM::CHI::Phase& phase);
+    /* Debug transport and DMI pass straight through the monitor. */
+    unsigned transport_dbg(ARM::CHI::Payload& payload);
+    bool get_direct_mem_ptr(ARM::CHI::Payload& payload, tlm::tlm_dmi& dmi);
+    void invalidate_direct_mem_ptr(sc_dt::uint64 start, sc_dt::uint64 end);
 
 public:
     CHIMonitor(const sc_core::sc_module_name& name, unsigned data_width_bits = 128);
@@ -0,0 +1,49 @@
+#ifndef ARM_CHI_TRACE_REPLAY_H
+#define ARM_CHI_TRACE_REPLAY_H
+
+#include <ARM/TLM/arm_tlm_trace.h>
+
+#include "CHITrafficGenerator.h"
+
+#include <unordered_map>
+
+/*
+ * Replays an ARM::TLM trace file as CHI requests, using the traffic generator's link handling.
+ *
+ * Each record's opcode is an ARM::CHI::ReqOpcode the generator can issue (a read, dataless request or write), and
+ * its address and size give the request; TxnIDs are allocated by the generator. Records issue in trace order, at
+ * most one per cycle, at their recorded cycle or once their dependency has completed depending on the mode, with up to
+ * the generator's max_outstanding in flight. A record is issued when it is handed to an empty request queue, so a lack
+ * of REQ link credit shows as slip.
+ */
+class CHITraceReplay : public CHITrafficGenerator
+{
+protected:
+    SC_HAS_PROCESS(CHITraceReplay);
+
+    ARM::TLM::TraceReplay replay;
+
+    /* Issued transactions and the index of their trace record. */
+    std::unordered_map<const ARM::CHI::Payload*, uint64_t> in_flight;
+
+    /* Current cycle, counting the first clock edge as cycle 0. */
+    uint64_t cycle = ~uint64_t(0);
+
+    void replay_posedge();
+
+    void transaction_done(ARM::CHI::Payload& payload, const sc_core::sc_time& latency) override;
+
+public:
+    CHITraceReplay(const sc_core::sc_module_name& name, const char* path, unsigned data_width_bits = 128,
+            ARM::TLM::TraceMode mode = ARM::TLM::TRACE_MODE_ISSUE_TIME,
+            const CHITrafficGeneratorConfig& config = CHITrafficGeneratorConfig());
+
+    /* Write a line per completed transaction to 'stream'. */
+    void set_log(std::ostream* stream) { replay.set_log(stream); }
+
+    const ARM::TLM::TraceReplay& get_replay() const { return replay; }
+
+    bool is_done() const { return replay.is_done(); }
+};
+
+#endif // ARM_CHI_TRACE_REPLAY_H
@@ -5,28 +5,121 @@
 
 #include "CHIUtilities.h"
 
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <vector>
+
+/* TxnIDs a requester may use: 0 to 1023. */
+static const unsigned CHI_MAX_TXN_IDS = 1024;
+
+/* Outstanding transaction limit and link configuration of a CHITrafficGenerator. */
+struct CHITrafficGeneratorConfig
+{
+    /* Transactions outstanding at once, each holding a TxnID. At most CHI_MAX_TXN_IDS. */
+    unsigned max_outstanding = 64;
+
+    /* Flits and credits moved per cycle on each channel, and credit depth. */
+    ARM::CHI::LinkConfig link;
+};
+
+/*
+ * Request node issuing reads, dataless requests and writes added with add_payload.
+ *
+ * Each transaction holds an entry of the transaction table, indexed by its TxnID, from when its request is sent until
+ * it completes; requests wait for a free TxnID beyond max_outstanding. A request given a RetryAck is resent without
+ * allowing retry once a PCrdGrant of its P-Credit type has been received. Read data is counted in, write data is sent
+ * on DBIDResp, and a CompAck is sent for requests which expect one once they complete. Latency is measured from the
+ * request leaving the link to the transaction completing.
+ */
 class CHITrafficGenerator : public sc_core::sc_module
 {
 protected:
     SC_HAS_PROCESS(CHITrafficGenerator);
 
+    /* An outstanding transaction, indexed by its TxnID. */
+    struct Transaction
+    {
+        bool in_use = false;
+
+        ARM::CHI::PayloadRef payload;
+
+        /* The request, to resend after a retry. */
+        ARM::CHI::Phase req_phase;
+
+        /* Read data flits still to be received. */
+        unsigned data_remaining = 0;
+
+        /* A DBIDResp, and a Comp (or CompData or RespSepData), are still to be received. */
+        bool dbid_pending = false;
+        bool comp_pending = false;
+
+        /* Target and TxnID of the CompAck. */
+        uint16_t home_nid = 0;
+        uint16_t dbid = 0;
+
+        sc_core::sc_time issue_time;
+    };
+
     CHIChannelState channels[CHI_NUM_CHANNELS];
+
+    const CHITrafficGeneratorConfig config;
+
+    /* Requests added with add_payload not yet given a TxnID. */
+    std::deque<CHIFlit> pending_requests;
+
+    std::vector<Transaction> transactions;
+    std::vector<uint16_t> free_txn_ids;
+
+    /* TxnIDs of requests given a RetryAck, in order, and PCrdGrants not yet used, per P-Credit type. */
+    std::deque<uint16_t> retry_waiting;
+    unsigned pcrd_grants[16] = {};
+
     unsigned data_width_bytes;
-    uint16_t txn_id = 0;
+
+    /* Latency of completed transactions. */
+    uint64_t completed = 0;
+    sc_core::sc_time total_latency;
+    sc_core::sc_time min_latency;
+    sc_core::sc_time max_latency;
 
     void clock_posedge();
     void clock_negedge();
 
+    void handle_rsp(const CHIFlit& rsp_flit);
+    void handle_dat(const CHIFlit& dat_flit);
     void handle_dbid_resp(const CHIFlit& dbid_flit);
 
+    /* Send a CompAck if needed and retire a transaction once nothing more is expected of it. */
+    void try_complete(uint16_t txn_id);
+
+    /* Look up the transaction a response is for. */
+    Transaction* find_transaction(const CHIFlit& flit);
+
+    /* Called once a transaction has completed, with its latency. */
+    virtual void transaction_done(ARM::CHI::Payload&, const sc_core::sc_time& /* latency */) {}
+
     tlm::tlm_sync_enum nb_transport_bw(ARM::CHI::Payload& payload, ARM::CHI::Phase& phase);
 
 public:
-    explicit CHITrafficGenerator(const sc_core::sc_module_name& name, unsigned data_width_bits = 128);
+    explicit CHITrafficGenerator(const sc_core::sc_module_name& name, unsigned data_width_bits = 128,
+            const CHITrafficGeneratorConfig& config = CHITrafficGeneratorConfig());
 
     /* Add a payload to the traffic queue. */
     void add_payload(ARM::CHI::ReqOpcode req_opcode, uint64_t address, ARM::CHI::Size size);
 
+    /* Requests not yet completed, including those still waiting for a TxnID. */
+    size_t get_outstanding() const;
+
+    uint64_t get_completed() const { return completed; }
+
+    sc_core::sc_time get_average_latency() const;
+    const sc_core::sc_time& get_min_latency() const { return min_latency; }
+    const sc_core::sc_time& get_max_latency() const { return max_latency; }
+
+    /* Print the number of transactions completed and their latency. */
+    void print_latency(std::ostream& stream) const;
+
     ARM::CHI::SimpleInitiatorSocket<CHITrafficGenerator> initiator;
 
     sc_core::sc_in<bool> clock;
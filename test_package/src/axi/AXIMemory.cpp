@@ -1,104 +1,248 @@
-#include <cstring>
+#include <utility>
 
 #include "AXIMemory.h"
 
-void AXIMemory::clock_posedge()
+void AXIMemory::read_memory(ARM::AXI::Payload& payload)
 {
-    if (b_state == ACK)
-        b_state = CLEAR;
-
-    if (r_state == ACK)
-        r_state = CLEAR;
+    const uint64_t addr = payload.get_base_address();
+    const std::size_t length = payload.get_data_length();
 
-    /* Is there a read still to perform? */
-    if (!r_outgoing && !ar_queue.empty())
+    const uint8_t* data = memory.find_span(addr, length);
+    if (!data)
     {
-        r_outgoing = ar_queue.front();
-        ar_queue.pop_front();
-        r_beat_count = r_outgoing->get_beat_count();
-
-        /* Populate read data in one go. */
-        uint64_t addr = r_outgoing->get_base_address();
-        sc_assert(addr + r_outgoing->get_data_length() <= MEMORY_SIZE);
-        r_outgoing->read_in(&mem_data[addr]);
+        scratch.resize(length);
+        memory.read(addr, scratch.data(), length);
+        data = scratch.data();
     }
 
-    /* Is there a write to respond to? */
-    if (!b_outgoing && !aw_queue.empty() && !w_queue.empty())
+    payload.read_in(data);
+}
+
+void AXIMemory::write_memory(const ARM::AXI::Payload& payload)
+{
+    const uint64_t addr = payload.get_base_address();
+    const std::size_t length = payload.get_data_length();
+
+    uint8_t* data = memory.get_span(addr, length);
+    if (data)
     {
-        sc_assert(aw_queue.front() == w_queue.front());
-        b_outgoing = w_queue.front();
-        aw_queue.pop_front();
-        w_queue.pop_front();
+        payload.write_out(data);
+        return;
+    }
 
-        b_outgoing->set_resp(ARM::AXI::RESP_OKAY);
+    /* Strobed-off bytes keep their old value. */
+    scratch.resize(length);
+    memory.read(addr, scratch.data(), length);
+    payload.write_out(scratch.data());
+    memory.write(addr, scratch.data(), length);
+}
 
-        /* Write write data into backing store all in one go. */
-        uint64_t addr = b_outgoing->get_base_address();
-        sc_assert(addr + b_outgoing->get_data_length() <= MEMORY_SIZE);
-        b_outgoing->write_out(&mem_data[addr]);
+void AXIMemory::accept_read(ARM::AXI::Payload& payload)
+{
+    ReadEntry entry;
+    entry.payload = ARM::AXI::PayloadRef(payload);
+    entry.ready_cycle = cycle + config.read_latency;
+    entry.last_served = 0;
+    entry.beats_sent = 0;
 
-        /* Unref for the w_queue beat ref call. */
-        b_outgoing->unref();
-    }
+    reads.push_back(std::move(entry));
 }
 
-void AXIMemory::clock_negedge()
+void AXIMemory::accept_write(ARM::AXI::Payload& payload)
 {
-    if (r_state == CLEAR && r_outgoing)
+    WriteEntry entry;
+    entry.payload = ARM::AXI::PayloadRef(payload);
+    entry.ready_cycle = cycle + config.write_latency;
+    entry.data_done = false;
+
+    /* Has the write data already been received? */
+    for (auto it = w_early.begin(); it != w_early.end(); ++it)
     {
-        ARM::AXI::Phase phase = ARM::AXI::R_VALID;
+        if (it->get() == &payload)
+        {
+            entry.data_done = true;
+            w_early.erase(it);
+            break;
+        }
+    }
 
-        r_beat_count--;
-        if (r_beat_count == 0)
-            phase = ARM::AXI::R_VALID_LAST;
+    writes.push_back(std::move(entry));
+}
 
-        r_state = REQ;
-        tlm::tlm_sync_enum reply = target.nb_transport_bw(*r_outgoing, phase);
-        if (reply == tlm::TLM_UPDATED)
+void AXIMemory::write_data_done(ARM::AXI::Payload& payload)
+{
+    for (WriteEntry& entry : writes)
+    {
+        if (entry.payload.get() == &payload && !entry.data_done)
         {
-            sc_assert(phase == ARM::AXI::R_READY);
-            r_state = ACK;
+            entry.data_done = true;
+            entry.ready_cycle = cycle + config.write_latency;
+            return;
         }
+    }
+
+    w_early.emplace_back(payload);
+}
 
-        /* Unref for the ar_queue.push_back() ref. */
-        if (r_beat_count == 0)
+AXIMemory::ReadEntry* AXIMemory::select_read()
+{
+    if (r_locked)
+    {
+        for (ReadEntry& entry : reads)
         {
-            r_outgoing->unref();
-            r_outgoing = nullptr;
+            if (entry.payload.get() == r_locked)
+                return &entry;
         }
     }
 
-    if (b_outgoing)
+    ReadEntry* best = nullptr;
+    for (std::size_t i = 0; i < reads.size(); i++)
     {
-        ARM::AXI::Phase phase = ARM::AXI::B_VALID;
+        ReadEntry& entry = reads[i];
+        if (entry.ready_cycle > cycle)
+            continue;
 
-        b_state = REQ;
-        tlm::tlm_sync_enum reply = target.nb_transport_bw(*b_outgoing, phase);
-        if (reply == tlm::TLM_UPDATED)
-        {
-            sc_assert(phase == ARM::AXI::B_READY);
-            b_state = ACK;
-        }
+        /* Reads with the same ID complete in order. */
+        bool blocked = false;
+        for (std::size_t j = 0; j < i && !blocked; j++)
+            blocked = reads[j].payload->id == entry.payload->id;
+        if (blocked)
+            continue;
+
+        if (!best || entry.last_served < best->last_served)
+            best = &entry;
+    }
+
+    return best;
+}
+
+void AXIMemory::send_read_beat()
+{
+    ReadEntry* entry = select_read();
+    if (!entry)
+        return;
+
+    /* Populate read data in one go on the first beat. */
+    if (entry->beats_sent == 0)
+        read_memory(*entry->payload);
+
+    entry->beats_sent++;
+    entry->last_served = cycle;
+
+    ARM::AXI::PayloadRef payload = entry->payload;
+    ARM::AXI::Phase phase = ARM::AXI::R_VALID;
+
+    if (entry->beats_sent == payload->get_beat_count())
+    {
+        phase = ARM::AXI::R_VALID_LAST;
+        reads.erase(reads.begin() + (entry - reads.data()));
+        r_locked = nullptr;
+    }
+    else if (!config.read_interleave)
+    {
+        r_locked = payload.get();
+    }
+
+    r_state = REQ;
+    tlm::tlm_sync_enum reply = target.nb_transport_bw(*payload, phase);
+    if (reply == tlm::TLM_UPDATED)
+    {
+        sc_assert(phase == ARM::AXI::R_READY);
+        r_state = ACK;
+    }
+}
+
+void AXIMemory::send_write_response()
+{
+    auto it = writes.begin();
+    for (; it != writes.end(); ++it)
+    {
+        if (!it->data_done || it->ready_cycle > cycle)
+            continue;
+
+        /* Writes with the same ID complete in order. */
+        bool blocked = false;
+        for (auto older = writes.begin(); older != it && !blocked; ++older)
+            blocked = older->payload->id == it->payload->id;
+        if (!blocked)
+            break;
+    }
+
+    if (it == writes.end())
+        return;
+
+    ARM::AXI::PayloadRef payload = std::move(it->payload);
+    writes.erase(it);
+
+    /* Write write data into backing store all in one go. */
+    write_memory(*payload);
+    payload->set_resp(ARM::AXI::RESP_OKAY);
 
-        /* Unref for a aw_queue.push_back() ref. */
-        b_outgoing->unref();
-        b_outgoing = nullptr;
+    ARM::AXI::Phase phase = ARM::AXI::B_VALID;
+
+    b_state = REQ;
+    tlm::tlm_sync_enum reply = target.nb_transport_bw(*payload, phase);
+    if (reply == tlm::TLM_UPDATED)
+    {
+        sc_assert(phase == ARM::AXI::B_READY);
+        b_state = ACK;
     }
 }
 
+void AXIMemory::clock_posedge()
+{
+    cycle++;
+
+    if (b_state == ACK)
+        b_state = CLEAR;
+
+    if (r_state == ACK)
+        r_state = CLEAR;
+}
+
+void AXIMemory::clock_negedge()
+{
+    /* Accept held addresses once completions have made room. */
+    if (ar_stalled && reads.size() < config.max_reads)
+    {
+        ARM::AXI::PayloadRef payload = std::move(ar_stalled);
+        accept_read(*payload);
+
+        ARM::AXI::Phase phase = ARM::AXI::AR_READY;
+        target.nb_transport_bw(*payload, phase);
+    }
+
+    if (aw_stalled && writes.size() < config.max_writes)
+    {
+        ARM::AXI::PayloadRef payload = std::move(aw_stalled);
+        accept_write(*payload);
+
+        ARM::AXI::Phase phase = ARM::AXI::AW_READY;
+        target.nb_transport_bw(*payload, phase);
+    }
+
+    if (r_state == CLEAR)
+        send_read_beat();
+
+    if (b_state == CLEAR)
+        send_write_response();
+}
+
 tlm::tlm_sync_enum AXIMemory::nb_transport_fw(ARM::AXI::Payload& payload, ARM::AXI::Phase& phase)
 {
     switch (phase)
     {
     case ARM::AXI::AW_VALID:
-        aw_queue.push_back(&payload);
-        payload.ref();
+        if (writes.size() >= config.max_writes)
+        {
+            aw_stalled = ARM::AXI::PayloadRef(payload);
+            return tlm::TLM_ACCEPTED;
+        }
+        accept_write(payload);
         phase = ARM::AXI::AW_READY;
         return tlm::TLM_UPDATED;
     case ARM::AXI::W_VALID_LAST:
-        w_queue.push_back(&payload);
-        payload.ref();
+        write_data_done(payload);
         phase = ARM::AXI::W_READY;
         return tlm::TLM_UPDATED;
     case ARM::AXI::W_VALID:
@@ -108,8 +252,12 @@ tlm::tlm_sync_enum AXIMemory::nb_transport_fw(ARM::AXI::Payload& payload, ARM::A
         b_state = ACK;
         return tlm::TLM_ACCEPTED;
     case ARM::AXI::AR_VALID:
-        ar_queue.push_back(&payload);
-        payload.ref();
+        if (reads.size() >= config.max_reads)
+        {
+            ar_stalled = ARM::AXI::PayloadRef(payload);
+            return tlm::TLM_ACCEPTED;
+        }
+        accept_read(payload);
         phase = ARM::AXI::AR_READY;
         return tlm::TLM_UPDATED;
     case ARM::AXI::R_READY:
@@ -124,17 +272,82 @@ tlm::tlm_sync_enum AXIMemory::nb_transport_fw(ARM::AXI::Payload& payload, ARM::A
     }
 }
 
-AXIMemory::AXIMemory(sc_core::sc_module_name name) :
+void AXIMemory::b_transport(ARM::AXI::Payload& payload, sc_core::sc_time& delay)
+{
+    if (payload.get_command() == ARM::AXI::COMMAND_WRITE)
+    {
+        write_memory(payload);
+        payload.set_resp(ARM::AXI::RESP_OKAY);
+    }
+    else
+    {
+        read_memory(payload);
+    }
+
+    delay += MEMORY_LT_BEAT_LATENCY * payload.get_beat_count();
+}
+
+unsigned AXIMemory::transport_dbg(ARM::AXI::Payload& payload)
+{
+    if (payload.get_command() == ARM::AXI::COMMAND_WRITE)
+        write_memory(payload);
+    else
+        read_memory(payload);
+
+    return static_cast<unsigned>(payload.get_data_length());
+}
+
+bool AXIMemory::get_direct_mem_ptr(ARM::AXI::Payload& payload, tlm::tlm_dmi& dmi)
+{
+    const uint64_t base = memory.get_page_base(payload.get_address());
+
+    dmi.set_dmi_ptr(memory.get_page(base));
+    dmi.set_start_address(base);
+    dmi.set_end_address(base + memory.get_page_size() - 1);
+    dmi.allow_read_write();
+    dmi.set_read_latency(MEMORY_LT_BEAT_LATENCY);
+    dmi.set_write_latency(MEMORY_LT_BEAT_LATENCY);
+
+    return true;
+}
+
+void AXIMemory::map_image(uint64_t address, const char* path, bool shared)
+{
+    if (!memory.map_file(address, path, shared))
+        SC_REPORT_ERROR(name(), "cannot map image file");
+}
+
+void AXIMemory::save_snapshot(const char* path) const
+{
+    if (!memory.save_snapshot(path))
+        SC_REPORT_ERROR(name(), "cannot save snapshot");
+}
+
+void AXIMemory::restore_snapshot(const char* path)
+{
+    if (!memory.restore_snapshot(path))
+        SC_REPORT_ERROR(name(), "cannot restore snapshot");
+
+    /* Pages granted through DMI have been freed. */
+    target.invalidate_direct_mem_ptr(0, ~sc_dt::uint64(0));
+}
+
+AXIMemory::AXIMemory(sc_core::sc_module_name name, unsigned port_width,
+    const AXIMemoryConfig& config_) :
     sc_core::sc_module(name),
+    memory(config_.page_size, MEMORY_FILL, config_.huge_pages),
+    config(config_),
+    r_locked(nullptr),
     b_state(CLEAR),
     r_state(CLEAR),
-    b_outgoing(nullptr),
-    r_outgoing(nullptr),
+    cycle(0),
     target("target", *this, &AXIMemory::nb_transport_fw,
-        ARM::TLM::PROTOCOL_ACE, 128),
+        ARM::TLM::PROTOCOL_ACE, port_width),
     clock("clock")
 {
-    memset(mem_data, 0xdf, MEMORY_SIZE);
+    target.register_b_transport(&AXIMemory::b_transport);
+    target.register_transport_dbg(&AXIMemory::transport_dbg);
+    target.register_get_direct_mem_ptr(&AXIMemory::get_direct_mem_ptr);
 
     SC_METHOD(clock_posedge);
     sensitive << clock.pos();
@@ -10,7 +10,7 @@ tlm::tlm_sync_enum AXIMonitor::nb_transport_fw(ARM::AXI::Payload& payload, ARM::
     ARM::AXI::Phase prev_phase = phase;
     tlm::tlm_sync_enum reply = initiator.nb_transport_fw(payload, phase);
 
-    print_payload(payload, prev_phase, reply, phase);
+    tap.print_payload(payload, prev_phase, reply, phase);
 
     return reply;
 }
@@ -20,12 +20,39 @@ tlm::tlm_sync_enum AXIMonitor::nb_transport_bw(ARM::AXI::Payload& payload, ARM::
     ARM::AXI::Phase prev_phase = phase;
     tlm::tlm_sync_enum reply = target.nb_transport_bw(payload, phase);
 
-    print_payload(payload, prev_phase, reply, phase);
+    tap.print_payload(payload, prev_phase, reply, phase);
 
     return reply;
 }
 
-void AXIMonitor::print_payload(ARM::AXI::Payload& payload, ARM::AXI::Phase phase,
+unsigned AXIMonitor::transport_dbg(ARM::AXI::Payload& payload)
+{
+    return initiator.transport_dbg(payload);
+}
+
+bool AXIMonitor::get_direct_mem_ptr(ARM::AXI::Payload& payload, tlm::tlm_dmi& dmi)
+{
+    return initiator->get_direct_mem_ptr(payload, dmi);
+}
+
+void AXIMonitor::invalidate_direct_mem_ptr(sc_dt::uint64 start, sc_dt::uint64 end)
+{
+    target.invalidate_direct_mem_ptr(start, end);
+}
+
+AXITap::AXITap(const std::string& name, unsigned port_width) :
+    tap_name(name),
+    beat_data(port_width >> 3)
+{}
+
+void AXITap::observe_nb_transport(const char* /* socket_name */, bool /* fw */,
+    const ARM::AXI::Payload& payload, const ARM::AXI::Phase& phase_before,
+    tlm::tlm_sync_enum reply, const ARM::AXI::Phase& phase_after)
+{
+    print_payload(payload, phase_before, reply, phase_after);
+}
+
+void AXITap::print_payload(const ARM::AXI::Payload& payload, ARM::AXI::Phase phase,
     tlm::tlm_sync_enum reply, ARM::AXI::Phase /* reply_phase */)
 {
     std::ostringstream stream;
@@ -146,7 +173,7 @@ void AXIMonitor::print_payload(ARM::AXI::Payload& payload, ARM::AXI::Phase phase
         payload_burst_index[&payload] = 0;
     }
 
-    stream << sc_core::sc_time_stamp() << ' ' << name() << ": "
+    stream << sc_core::sc_time_stamp() << ' ' << tap_name << ": "
         << phase_name << ' ';
 
     if (show_addr)
@@ -189,14 +216,14 @@ void AXIMonitor::print_payload(ARM::AXI::Payload& payload, ARM::AXI::Phase phase
         switch (payload.get_command())
         {
         case ARM::AXI::COMMAND_WRITE:
-            payload.write_out_beat(burst_index, beat_data);
+            payload.write_out_beat(burst_index, beat_data.data());
             byte_strobe = payload.write_out_beat_strobe(burst_index);
             break;
         case ARM::AXI::COMMAND_READ:
-            payload.read_out_beat(burst_index, beat_data);
+            payload.read_out_beat(burst_index, beat_data.data());
             break;
         case ARM::AXI::COMMAND_SNOOP:
-            payload.snoop_out_beat(burst_index, beat_data);
+            payload.snoop_out_beat(burst_index, beat_data.data());
             break;
         default:
             assert(0);
@@ -234,15 +261,14 @@ void AXIMonitor::print_payload(ARM::AXI::Payload& payload, ARM::AXI::Phase phase
 
 AXIMonitor::AXIMonitor(sc_core::sc_module_name name, unsigned port_width) :
     sc_core::sc_module(name),
-    beat_data(new uint8_t[port_width >> 3]),
+    tap(this->name(), port_width),
     target("target", *this, &AXIMonitor::nb_transport_fw, ARM::TLM::PROTOCOL_ACE,
         port_width),
     initiator("initiator", *this, &AXIMonitor::nb_transport_bw, ARM::TLM::PROTOCOL_ACE,
         port_width)
-{}
-
-AXIMonitor::~AXIMonitor()
 {
-    delete[] beat_data;
+    target.register_transport_dbg(&AXIMonitor::transport_dbg);
+    target.register_get_direct_mem_ptr(&AXIMonitor::get_direct_mem_ptr);
+    initiator.register_invalidate_direct_mem_ptr(&AXIMonitor::invalidate_direct_mem_ptr);
 }
 
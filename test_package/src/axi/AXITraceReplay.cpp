@@ -0,0 +1,80 @@
+#include <utility>
+
+#include "AXITraceReplay.h"
+
+bool AXITraceReplay::issue_record()
+{
+    const ARM::TLM::TraceRecord& next = replay.front();
+    std::deque<ARM::AXI::PayloadRef>* queue;
+
+    switch (next.opcode)
+    {
+    case ARM::AXI::COMMAND_WRITE: queue = &aw_queue; break;
+    case ARM::AXI::COMMAND_READ: queue = &ar_queue; break;
+    default: queue = nullptr;
+    }
+
+    if (queue && !queue->empty())
+        return false;
+
+    ARM::TLM::TraceRecord record;
+    const uint64_t index = replay.issue(cycle, record);
+
+    /* The generator's write data is a 128-bit beat. */
+    if (!queue || record.size > ARM::AXI::SIZE_16)
+    {
+        SC_REPORT_ERROR(name(), "trace record is not a read or write this port can carry");
+        replay.complete(index, cycle);
+        return true;
+    }
+
+    ARM::AXI::PayloadRef payload(ARM::AXI::Payload::new_payload(
+        ARM::AXI::CommandEnum(record.opcode), record.address, ARM::AXI::SizeEnum(record.size),
+        record.len, ARM::AXI::BurstEnum(record.burst)), ARM::TLM::ADOPT_REF);
+
+    payload->id = record.id;
+    payload->cache = ARM::AXI::CacheBitEnum() | ARM::AXI::CACHE_AW_B;
+
+    in_flight.emplace(payload.get(), index);
+    queue->push_back(std::move(payload));
+
+    return true;
+}
+
+void AXITraceReplay::replay_posedge()
+{
+    cycle++;
+
+    while (replay.can_issue(cycle) && issue_record())
+    {
+    }
+}
+
+void AXITraceReplay::transaction_done(ARM::AXI::Payload& payload)
+{
+    const auto entry = in_flight.find(&payload);
+    if (entry == in_flight.end())
+    {
+        SC_REPORT_ERROR(name(), "response for a transaction not issued");
+        return;
+    }
+
+    replay.complete(entry->second, cycle);
+    in_flight.erase(entry);
+}
+
+AXITraceReplay::AXITraceReplay(sc_core::sc_module_name name, const char* path,
+    ARM::TLM::TraceMode mode, unsigned max_outstanding) :
+    AXITrafficGenerator(name),
+    replay(mode, max_outstanding),
+    cycle(~uint64_t(0))
+{
+    SC_METHOD(replay_posedge);
+    sensitive << clock.pos();
+    dont_initialize();
+
+    in_flight.reserve(max_outstanding);
+
+    if (!replay.open(path))
+        SC_REPORT_ERROR(this->name(), "cannot open trace");
+}
@@ -0,0 +1,100 @@
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <unistd.h>
+
+#include "AXITraceReplay.h"
+#include "AXIMemory.h"
+
+/* A trace file made under TMPDIR (or /tmp) and removed when the example exits. */
+struct TraceFile
+{
+    std::string path;
+
+    TraceFile()
+    {
+        const char* dir = std::getenv("TMPDIR");
+        std::string name = std::string(dir && *dir ? dir : "/tmp") + "/AXITraceReplayExample.XXXXXX";
+
+        int fd = mkstemp(&name[0]);
+        if (fd >= 0)
+        {
+            close(fd);
+            path = name;
+        }
+    }
+
+    ~TraceFile()
+    {
+        if (!path.empty())
+            std::remove(path.c_str());
+    }
+};
+
+/* Write a trace of bursts every 3 cycles, each read of a line depending on the write to it. */
+static bool write_trace(const std::string& trace_path)
+{
+    ARM::TLM::TraceWriter writer;
+    if (trace_path.empty() || !writer.open(trace_path.c_str()))
+    {
+        std::cerr << "cannot write trace " << trace_path << std::endl;
+        return false;
+    }
+
+    for (unsigned i = 0; i < 512; i++)
+    {
+        ARM::TLM::TraceRecord record = ARM::TLM::TraceRecord();
+
+        record.time = i * 3;
+        record.address = 0x80000000 + (i / 2) * 64;
+        record.dependency = i % 2;
+        record.id = i % 4;
+        record.opcode = i % 2 ? ARM::AXI::COMMAND_READ : ARM::AXI::COMMAND_WRITE;
+        record.size = ARM::AXI::SIZE_16;
+        record.len = 3;
+        record.burst = ARM::AXI::BURST_INCR;
+
+        writer.write(record);
+    }
+
+    return writer.close();
+}
+
+int sc_main(int, char**)
+{
+    sc_core::sc_clock clk("clk", 2, sc_core::SC_NS, 0.5);
+
+    TraceFile trace;
+    if (!write_trace(trace.path))
+        return 1;
+
+    /* Replay the same trace against a memory in each mode. */
+    AXIMemoryConfig config;
+    config.read_latency = 8;
+    config.write_latency = 4;
+
+    AXITraceReplay timed("timed", trace.path.c_str(), ARM::TLM::TRACE_MODE_ISSUE_TIME);
+    AXITraceReplay dependent("dependent", trace.path.c_str(), ARM::TLM::TRACE_MODE_DEPENDENCY);
+    AXIMemory timed_mem("timed_mem", 128, config);
+    AXIMemory dependent_mem("dependent_mem", 128, config);
+
+    timed.clock.bind(clk);
+    dependent.clock.bind(clk);
+    timed_mem.clock.bind(clk);
+    dependent_mem.clock.bind(clk);
+
+    timed.initiator.bind(timed_mem.target);
+    dependent.initiator.bind(dependent_mem.target);
+
+    while (!timed.is_done() || !dependent.is_done())
+        sc_core::sc_start(1000, sc_core::SC_NS);
+
+    timed.get_replay().print_summary(std::cout, timed.name());
+    dependent.get_replay().print_summary(std::cout, dependent.name());
+
+    ARM::AXI::Payload::debug_payload_pool(std::cout);
+
+    return 0;
+}
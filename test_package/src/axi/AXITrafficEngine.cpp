@@ -0,0 +1,442 @@
+#include <cstring>
+#include <utility>
+
+#include "AXITrafficEngine.h"
+
+uint64_t AXITrafficEngine::random()
+{
+    /* xorshift64*: cheap and the same on every platform. */
+    random_state ^= random_state >> 12;
+    random_state ^= random_state << 25;
+    random_state ^= random_state >> 27;
+    return random_state * UINT64_C(0x2545f4914f6cdd1d);
+}
+
+void AXITrafficEngine::generate()
+{
+    AXITrafficShape shape = default_shape;
+
+    if (total_weight != 0)
+    {
+        unsigned pick = unsigned(random() % total_weight);
+        for (const AXITrafficShape& candidate : desc.shapes)
+        {
+            if (pick < candidate.weight)
+            {
+                shape = candidate;
+                break;
+            }
+            pick -= candidate.weight;
+        }
+    }
+
+    const ARM::AXI::Command command = random() % 100 < desc.read_percent ?
+        ARM::AXI::COMMAND_READ : ARM::AXI::COMMAND_WRITE;
+    const uint64_t beat_bytes = uint64_t(1) << shape.size;
+    const uint64_t bytes = beat_bytes * (shape.len + 1);
+
+    uint64_t offset;
+    switch (desc.address_pattern)
+    {
+    case AXITrafficDescriptor::ADDRESS_SEQUENTIAL:
+        offset = next_address;
+        next_address += bytes;
+        break;
+    case AXITrafficDescriptor::ADDRESS_STRIDE:
+        offset = next_address;
+        next_address += desc.stride;
+        break;
+    default:
+        offset = random();
+        break;
+    }
+
+    uint64_t address = desc.base + offset % desc.range;
+
+    /*
+     * WRAP bursts start aligned to the beat, and INCR bursts must not cross
+     * 4KB. With a 4KB aligned range this also keeps them inside it.
+     */
+    address &= ~(beat_bytes - 1);
+    if (shape.burst == ARM::AXI::BURST_INCR && (address & 0xfff) + bytes > 0x1000)
+        address = (address | 0xfff) + 1 - bytes;
+
+    ARM::AXI::PayloadRef payload(ARM::AXI::Payload::new_payload(command, address,
+        shape.size, shape.len, shape.burst), ARM::TLM::ADOPT_REF);
+    payload->cache = ARM::AXI::CacheBitEnum() | ARM::AXI::CACHE_AW_B;
+
+    upcoming.push_back(std::move(payload));
+}
+
+bool AXITrafficEngine::check_shape(const AXITrafficShape& shape) const
+{
+    const unsigned beats = shape.len + 1u;
+
+    if ((1u << shape.size) > port_width_bytes)
+        return false;
+
+    switch (shape.burst)
+    {
+    case ARM::AXI::BURST_INCR:
+        return (beats << shape.size) <= 0x1000;
+    case ARM::AXI::BURST_WRAP:
+        return beats == 2 || beats == 4 || beats == 8 || beats == 16;
+    default:
+        return beats <= 16;
+    }
+}
+
+bool AXITrafficEngine::allocate_id(uint32_t& id)
+{
+    for (unsigned i = 0; i < desc.id_count; i++)
+    {
+        unsigned candidate = (next_id + i) % desc.id_count;
+        if (outstanding_per_id[candidate] < desc.max_outstanding_per_id)
+        {
+            id = candidate;
+            next_id = (candidate + 1) % desc.id_count;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void AXITrafficEngine::fill_beat(ARM::AXI::Payload& payload, unsigned beat, uint8_t* data)
+{
+    const unsigned beat_bytes = unsigned(payload.get_beat_data_length());
+    const uint64_t aligned = payload.get_address() & ~uint64_t(beat_bytes - 1);
+
+    uint64_t address = aligned;
+    switch (payload.get_burst())
+    {
+    case ARM::AXI::BURST_FIXED:
+        break;
+    case ARM::AXI::BURST_WRAP:
+    {
+        const uint64_t total = uint64_t(beat_bytes) * payload.get_beat_count();
+        const uint64_t lower = aligned & ~(total - 1);
+        address = lower + ((aligned - lower + uint64_t(beat) * beat_bytes) & (total - 1));
+        break;
+    }
+    default:
+        address = aligned + uint64_t(beat) * beat_bytes;
+        break;
+    }
+
+    for (unsigned i = 0; i < beat_bytes; i++)
+    {
+        const uint64_t byte_address = address + i;
+
+        switch (desc.data_pattern)
+        {
+        case AXITrafficDescriptor::DATA_CONSTANT:
+            data[i] = uint8_t(desc.data_value >> (8 * (byte_address & 7)));
+            break;
+        case AXITrafficDescriptor::DATA_INCREMENT:
+            data[i] = uint8_t(beat * beat_bytes + i);
+            break;
+        case AXITrafficDescriptor::DATA_ADDRESS:
+            data[i] = uint8_t((byte_address & ~uint64_t(7)) >> (8 * (byte_address & 7)));
+            break;
+        default:
+            if ((i & 7) == 0)
+            {
+                const uint64_t value = random();
+                for (unsigned j = i; j < beat_bytes && j < i + 8; j++)
+                    data[j] = uint8_t(value >> (8 * (j - i)));
+            }
+            break;
+        }
+    }
+}
+
+void AXITrafficEngine::track(InFlightTable& table, const ARM::AXI::PayloadRef& payload)
+{
+    const unsigned id = payload->id;
+    const unsigned depth = desc.max_outstanding_per_id;
+
+    table.slots[id * depth + (table.first[id] + table.count[id]) % depth] = payload;
+    table.count[id]++;
+}
+
+ARM::AXI::PayloadRef AXITrafficEngine::retire(InFlightTable& table,
+    ARM::AXI::Payload& payload)
+{
+    const unsigned id = payload.id;
+    const unsigned depth = desc.max_outstanding_per_id;
+
+    if (id >= desc.id_count || table.count[id] == 0 ||
+        table.slots[id * depth + table.first[id]].get() != &payload)
+    {
+        return ARM::AXI::PayloadRef();
+    }
+
+    ARM::AXI::PayloadRef retired = std::move(table.slots[id * depth + table.first[id]]);
+    table.first[id] = (table.first[id] + 1) % depth;
+    table.count[id]--;
+
+    return retired;
+}
+
+void AXITrafficEngine::complete(ARM::AXI::Payload& payload)
+{
+    outstanding--;
+    outstanding_per_id[payload.id]--;
+
+    completed++;
+    bytes_completed += payload.get_data_length();
+}
+
+bool AXITrafficEngine::is_done() const
+{
+    return desc.count != 0 && completed == desc.count;
+}
+
+void AXITrafficEngine::issue(const ARM::AXI::Command command)
+{
+    std::deque<ARM::AXI::PayloadRef>::iterator next = upcoming.begin();
+    while (next != upcoming.end() && (*next)->get_command() != command)
+        ++next;
+
+    uint32_t id;
+    if (next == upcoming.end() || outstanding >= desc.max_outstanding || tokens < 0 ||
+        (command == ARM::AXI::COMMAND_READ ? ar_state : aw_state) != CLEAR ||
+        !allocate_id(id))
+    {
+        return;
+    }
+
+    ARM::AXI::PayloadRef payload = std::move(*next);
+    upcoming.erase(next);
+
+    payload->id = id;
+    outstanding++;
+    outstanding_per_id[id]++;
+    generated++;
+
+    if (desc.bytes_per_cycle > 0)
+        tokens -= double(payload->get_data_length());
+
+    if (command == ARM::AXI::COMMAND_READ)
+    {
+        ARM::AXI::Phase phase = ARM::AXI::AR_VALID;
+
+        track(reads, payload);
+
+        ar_state = REQ;
+        tlm::tlm_sync_enum reply = initiator.nb_transport_fw(*payload, phase);
+        if (reply == tlm::TLM_UPDATED)
+        {
+            sc_assert(phase == ARM::AXI::AR_READY);
+            ar_state = ACK;
+        }
+    }
+    else
+    {
+        ARM::AXI::Payload* write = payload.get();
+        ARM::AXI::Phase phase = ARM::AXI::AW_VALID;
+
+        track(writes, payload);
+        w_queue.push_back(std::move(payload));
+
+        aw_state = REQ;
+        tlm::tlm_sync_enum reply = initiator.nb_transport_fw(*write, phase);
+        if (reply == tlm::TLM_UPDATED)
+        {
+            sc_assert(phase == ARM::AXI::AW_READY);
+            aw_state = ACK;
+        }
+    }
+}
+
+void AXITrafficEngine::clock_posedge()
+{
+    if (aw_state == ACK)
+        aw_state = CLEAR;
+
+    if (w_state == ACK)
+        w_state = CLEAR;
+
+    if (ar_state == ACK)
+        ar_state = CLEAR;
+}
+
+void AXITrafficEngine::clock_negedge()
+{
+    /* Save up bandwidth, to a limit, while the rate is capped. */
+    if (desc.bytes_per_cycle > 0)
+    {
+        tokens += desc.bytes_per_cycle;
+        if (tokens > double(desc.burst_bytes))
+            tokens = double(desc.burst_bytes);
+    }
+
+    /* Look ahead for a read and a write to issue. */
+    while (upcoming.size() < TRAFFIC_ENGINE_LOOKAHEAD &&
+        (desc.count == 0 || generated + upcoming.size() < desc.count))
+    {
+        generate();
+    }
+
+    issue(ARM::AXI::COMMAND_READ);
+    issue(ARM::AXI::COMMAND_WRITE);
+
+    /* Send write beat WVALID */
+    if (w_state == CLEAR && !w_queue.empty())
+    {
+        ARM::AXI::Payload* payload = w_queue.front().get();
+        ARM::AXI::Phase phase = ARM::AXI::W_VALID;
+
+        uint8_t data_beat[TRAFFIC_ENGINE_MAX_BEAT_BYTES];
+        fill_beat(*payload, w_beat_count, data_beat);
+        w_beat_count++;
+        payload->write_in_beat(data_beat);
+
+        if (w_beat_count == payload->get_beat_count())
+        {
+            phase = ARM::AXI::W_VALID_LAST;
+            w_queue.pop_front();
+            w_beat_count = 0;
+        }
+
+        w_state = REQ;
+        tlm::tlm_sync_enum reply = initiator.nb_transport_fw(*payload, phase);
+        if (reply == tlm::TLM_UPDATED)
+        {
+            sc_assert(phase == ARM::AXI::W_READY);
+            w_state = ACK;
+        }
+    }
+
+    /* Send WACK */
+    if (!wack_queue.empty())
+    {
+        ARM::AXI::Phase phase = ARM::AXI::WACK;
+        ARM::AXI::PayloadRef payload = std::move(wack_queue.front());
+
+        wack_queue.pop_front();
+
+        tlm::tlm_sync_enum reply = initiator.nb_transport_fw(*payload, phase);
+        sc_assert(reply == tlm::TLM_ACCEPTED);
+    }
+
+    /* Send RACK */
+    if (!rack_queue.empty())
+    {
+        ARM::AXI::Phase phase = ARM::AXI::RACK;
+        ARM::AXI::PayloadRef payload = std::move(rack_queue.front());
+
+        rack_queue.pop_front();
+
+        tlm::tlm_sync_enum reply = initiator.nb_transport_fw(*payload, phase);
+        sc_assert(reply == tlm::TLM_ACCEPTED);
+    }
+}
+
+tlm::tlm_sync_enum AXITrafficEngine::nb_transport_bw(ARM::AXI::Payload& payload,
+    ARM::AXI::Phase& phase)
+{
+    switch (phase)
+    {
+    case ARM::AXI::AW_READY:
+        aw_state = ACK;
+        return tlm::TLM_ACCEPTED;
+    case ARM::AXI::W_READY:
+        w_state = ACK;
+        return tlm::TLM_ACCEPTED;
+    case ARM::AXI::B_VALID:
+    {
+        ARM::AXI::PayloadRef write = retire(writes, payload);
+        if (!write)
+        {
+            SC_REPORT_ERROR(name(), "write response for a transaction not in flight");
+            return tlm::TLM_ACCEPTED;
+        }
+
+        complete(payload);
+        wack_queue.push_back(std::move(write));
+        phase = ARM::AXI::B_READY;
+        return tlm::TLM_UPDATED;
+    }
+    case ARM::AXI::AR_READY:
+        ar_state = ACK;
+        return tlm::TLM_ACCEPTED;
+    case ARM::AXI::R_VALID_LAST:
+    {
+        ARM::AXI::PayloadRef read = retire(reads, payload);
+        if (!read)
+        {
+            SC_REPORT_ERROR(name(), "read data for a transaction not in flight");
+            return tlm::TLM_ACCEPTED;
+        }
+
+        complete(payload);
+        rack_queue.push_back(std::move(read));
+    }
+    /* Fall through */
+    case ARM::AXI::R_VALID:
+        phase = ARM::AXI::R_READY;
+        return tlm::TLM_UPDATED;
+    default:
+        SC_REPORT_ERROR(name(), "unrecognised phase");
+        return tlm::TLM_ACCEPTED;
+    }
+}
+
+AXITrafficEngine::AXITrafficEngine(sc_core::sc_module_name name,
+    const AXITrafficDescriptor& desc_, unsigned port_width) :
+    sc_module(name),
+    desc(desc_),
+    port_width_bytes(port_width / 8),
+    total_weight(0),
+    default_shape{ARM::AXI::SIZE_16, 3, ARM::AXI::BURST_INCR, 1},
+    w_beat_count(0),
+    aw_state(CLEAR),
+    w_state(CLEAR),
+    ar_state(CLEAR),
+    outstanding(0),
+    outstanding_per_id(desc_.id_count),
+    next_id(0),
+    tokens(0),
+    next_address(0),
+    random_state(desc_.seed ? desc_.seed : 1),
+    generated(0),
+    completed(0),
+    bytes_completed(0),
+    initiator("initiator", *this, &AXITrafficEngine::nb_transport_bw,
+        ARM::TLM::PROTOCOL_ACE, port_width),
+    clock("clock")
+{
+    /* Narrow the default beat to fit the port. */
+    while ((1u << default_shape.size) > port_width_bytes && default_shape.size > ARM::AXI::SIZE_1)
+        default_shape.size = ARM::AXI::SizeEnum(default_shape.size - 1);
+
+    for (const AXITrafficShape& shape : desc.shapes)
+    {
+        if (!check_shape(shape))
+            SC_REPORT_ERROR(name, "transaction shape wider than the port or not a legal burst");
+        total_weight += shape.weight;
+    }
+
+    if (desc.id_count == 0 || desc.range == 0)
+        SC_REPORT_ERROR(name, "descriptor needs at least one ID and a non-empty range");
+
+    if ((desc.base & 0xfff) != 0 || (desc.range & 0xfff) != 0)
+        SC_REPORT_ERROR(name, "descriptor base and range must be multiples of 4KB");
+
+    for (InFlightTable* table : {&reads, &writes})
+    {
+        table->slots.resize(desc.id_count * desc.max_outstanding_per_id);
+        table->first.resize(desc.id_count);
+        table->count.resize(desc.id_count);
+    }
+
+    SC_METHOD(clock_posedge);
+    sensitive << clock.pos();
+    dont_initialize();
+
+    SC_METHOD(clock_negedge);
+    sensitive << clock.neg();
+    dont_initialize();
+}
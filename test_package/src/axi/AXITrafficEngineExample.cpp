@@ -0,0 +1,43 @@
+#include <iostream>
+
+#include "AXITrafficEngine.h"
+#include "AXIMonitor.h"
+#include "AXIMemory.h"
+
+int sc_main(int, char**)
+{
+    sc_core::sc_clock clk("clk", 2, sc_core::SC_NS, 0.5);
+
+    /* A rate-limited mix of random reads and writes over 1MB. */
+    AXITrafficDescriptor desc;
+    desc.base = 0x80000000;
+    desc.range = 0x100000;
+    desc.address_pattern = AXITrafficDescriptor::ADDRESS_RANDOM;
+    desc.shapes.push_back(AXITrafficShape{ARM::AXI::SIZE_16, 3, ARM::AXI::BURST_INCR, 3});
+    desc.shapes.push_back(AXITrafficShape{ARM::AXI::SIZE_16, 3, ARM::AXI::BURST_WRAP, 1});
+    desc.shapes.push_back(AXITrafficShape{ARM::AXI::SIZE_8, 0, ARM::AXI::BURST_INCR, 1});
+    desc.read_percent = 70;
+    desc.count = 10000;
+    desc.bytes_per_cycle = 12;
+    desc.data_pattern = AXITrafficDescriptor::DATA_ADDRESS;
+
+    AXITrafficEngine engine("engine", desc);
+    AXIMonitor mon("mon");
+    AXIMemory mem("mem");
+
+    engine.clock.bind(clk);
+    mem.clock.bind(clk);
+
+    engine.initiator.bind(mon.target);
+    mon.initiator.bind(mem.target);
+
+    while (!engine.is_done())
+        sc_core::sc_start(1000, sc_core::SC_NS);
+
+    std::cout << engine.get_completed() << " transactions, " << engine.get_bytes_completed() << " bytes in "
+        << sc_core::sc_time_stamp() << std::endl;
+
+    ARM::AXI::Payload::debug_payload_pool(std::cout);
+
+    return 0;
+}
@@ -3,6 +3,7 @@
 #include "AXITrafficGenerator.h"
 #include "AXIMonitor.h"
 #include "AXIMemory.h"
+#include "AXIWidthConverter.h"
 
 void add_payloads_to_tg(AXITrafficGenerator& tg)
 {
@@ -26,13 +27,16 @@ int sc_main(int, char**)
 
     AXITrafficGenerator tg("tg");
     AXIMonitor mon("mon");
-    AXIMemory mem("mem");
+    /* The 128-bit generator reaches a 64-bit memory through a downsizer. */
+    AXIWidthConverter conv("conv", 128, 64);
+    AXIMemory mem("mem", 64);
 
     tg.clock.bind(clk);
     mem.clock.bind(clk);
 
     tg.initiator.bind(mon.target);
-    mon.initiator.bind(mem.target);
+    mon.initiator.bind(conv.target);
+    conv.initiator.bind(mem.target);
 
     add_payloads_to_tg(tg);
 
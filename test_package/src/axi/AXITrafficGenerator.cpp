@@ -1,4 +1,5 @@
 #include <cstring>
+#include <utility>
 
 #include "AXITrafficGenerator.h"
 
@@ -18,20 +19,17 @@ void AXITrafficGenerator::clock_posedge()
 
     if (cr_incoming)
     {
-        cr_queue.push_back(cr_incoming);
-        cr_incoming = nullptr;
+        cr_queue.push_back(std::move(cr_incoming));
     }
 
     if (rack_incoming)
     {
-        rack_queue.push_back(rack_incoming);
-        rack_incoming = nullptr;
+        rack_queue.push_back(std::move(rack_incoming));
     }
 
     if (wack_incoming)
     {
-        wack_queue.push_back(wack_incoming);
-        wack_incoming = nullptr;
+        wack_queue.push_back(std::move(wack_incoming));
     }
 }
 
@@ -40,10 +38,11 @@ void AXITrafficGenerator::clock_negedge()
     /* Send next payload AWVALID */
     if (aw_state == CLEAR && !aw_queue.empty())
     {
-        ARM::AXI::Payload* payload = aw_queue.front();
+        ARM::AXI::Payload* payload = aw_queue.front().get();
         ARM::AXI::Phase phase = ARM::AXI::AW_VALID;
 
-        w_queue.push_back(payload);
+        in_flight[payload] = aw_queue.front();
+        w_queue.push_back(std::move(aw_queue.front()));
         aw_queue.pop_front();
 
         aw_state = REQ;
@@ -58,9 +57,10 @@ void AXITrafficGenerator::clock_negedge()
     /* Send next payload ARVALID */
     if (ar_state == CLEAR && !ar_queue.empty())
     {
-        ARM::AXI::Payload* payload = ar_queue.front();
+        ARM::AXI::Payload* payload = ar_queue.front().get();
         ARM::AXI::Phase phase = ARM::AXI::AR_VALID;
 
+        in_flight[payload] = std::move(ar_queue.front());
         ar_queue.pop_front();
 
         ar_state = REQ;
@@ -75,7 +75,7 @@ void AXITrafficGenerator::clock_negedge()
     /* Send write beat WVALID */
     if (w_state == CLEAR && !w_queue.empty())
     {
-        ARM::AXI::Payload* payload = w_queue.front();
+        ARM::AXI::Payload* payload = w_queue.front().get();
         ARM::AXI::Phase phase = ARM::AXI::W_VALID;
 
         /* Example beat data using the beat count as data */
@@ -104,17 +104,17 @@ void AXITrafficGenerator::clock_negedge()
     if (cr_state == CLEAR && !cr_queue.empty())
     {
         ARM::AXI::Phase phase = ARM::AXI::CR_VALID;
-        ARM::AXI::Payload* payload = cr_queue.front();
 
+        cr_outgoing = std::move(cr_queue.front());
         cr_queue.pop_front();
 
         cr_state = REQ;
-        tlm::tlm_sync_enum reply = initiator.nb_transport_fw(*payload, phase);
+        tlm::tlm_sync_enum reply = initiator.nb_transport_fw(*cr_outgoing, phase);
         if (reply == tlm::TLM_UPDATED)
         {
             sc_assert(phase == ARM::AXI::CR_READY);
             cr_state = ACK;
-            payload->unref();
+            cr_outgoing.reset();
         }
     }
 
@@ -122,31 +122,39 @@ void AXITrafficGenerator::clock_negedge()
     if (!wack_queue.empty())
     {
         ARM::AXI::Phase phase = ARM::AXI::WACK;
-        ARM::AXI::Payload* payload = wack_queue.front();
+        ARM::AXI::PayloadRef payload = std::move(wack_queue.front());
 
         wack_queue.pop_front();
 
         tlm::tlm_sync_enum reply = initiator.nb_transport_fw(*payload, phase);
         sc_assert(reply == tlm::TLM_ACCEPTED);
-
-        payload->unref();
     }
 
     /* Send RACK */
     if (!rack_queue.empty())
     {
         ARM::AXI::Phase phase = ARM::AXI::RACK;
-        ARM::AXI::Payload* payload = rack_queue.front();
+        ARM::AXI::PayloadRef payload = std::move(rack_queue.front());
 
         rack_queue.pop_front();
 
         tlm::tlm_sync_enum reply = initiator.nb_transport_fw(*payload, phase);
         sc_assert(reply == tlm::TLM_ACCEPTED);
-
-        payload->unref();
     }
 }
 
+ARM::AXI::PayloadRef AXITrafficGenerator::retire(ARM::AXI::Payload& payload)
+{
+    std::unordered_map<const ARM::AXI::Payload*, ARM::AXI::PayloadRef>::iterator it =
+        in_flight.find(&payload);
+    if (it == in_flight.end())
+        return ARM::AXI::PayloadRef();
+
+    ARM::AXI::PayloadRef retired = std::move(it->second);
+    in_flight.erase(it);
+    return retired;
+}
+
 tlm::tlm_sync_enum AXITrafficGenerator::nb_transport_bw(ARM::AXI::Payload& payload,
     ARM::AXI::Phase& phase)
 {
@@ -159,7 +167,13 @@ tlm::tlm_sync_enum AXITrafficGenerator::nb_transport_bw(ARM::AXI::Payload& paylo
         w_state = ACK;
         return tlm::TLM_ACCEPTED;
     case ARM::AXI::B_VALID:
-        wack_incoming = &payload;
+        wack_incoming = retire(payload);
+        if (!wack_incoming)
+        {
+            SC_REPORT_ERROR(name(), "write response for a transaction not in flight");
+            return tlm::TLM_ACCEPTED;
+        }
+        transaction_done(payload);
         phase = ARM::AXI::B_READY;
         return tlm::TLM_UPDATED;
     case ARM::AXI::AR_READY:
@@ -167,20 +181,25 @@ tlm::tlm_sync_enum AXITrafficGenerator::nb_transport_bw(ARM::AXI::Payload& paylo
         return tlm::TLM_ACCEPTED;
     case ARM::AXI::R_VALID_LAST:
         /* Move to RACK queue after last beat. */
-        rack_incoming = &payload;
+        rack_incoming = retire(payload);
+        if (!rack_incoming)
+        {
+            SC_REPORT_ERROR(name(), "read data for a transaction not in flight");
+            return tlm::TLM_ACCEPTED;
+        }
+        transaction_done(payload);
     /* Fall through */
     case ARM::AXI::R_VALID:
         phase = ARM::AXI::R_READY;
         return tlm::TLM_UPDATED;
     case ARM::AXI::AC_VALID:
-        cr_incoming = &payload;
         /* Keep the AC payload to use with CR response. */
-        payload.ref();
+        cr_incoming = ARM::AXI::PayloadRef(payload);
         phase = ARM::AXI::AC_READY;
         return tlm::TLM_UPDATED;
     case ARM::AXI::CR_READY:
         cr_state = ACK;
-        payload.unref();
+        cr_outgoing.reset();
         return tlm::TLM_ACCEPTED;
     default:
         SC_REPORT_ERROR(name(), "unrecognised phase");
@@ -194,9 +213,6 @@ AXITrafficGenerator::AXITrafficGenerator(sc_core::sc_module_name name) :
     w_state(CLEAR),
     ar_state(CLEAR),
     cr_state(CLEAR),
-    cr_incoming(nullptr),
-    wack_incoming(nullptr),
-    rack_incoming(nullptr),
     w_beat_count(0),
     initiator("initiator", *this, &AXITrafficGenerator::nb_transport_bw,
         ARM::TLM::PROTOCOL_ACE, 128),
@@ -214,17 +230,18 @@ AXITrafficGenerator::AXITrafficGenerator(sc_core::sc_module_name name) :
 void AXITrafficGenerator::add_payload(ARM::AXI::Command command, uint64_t address, ARM::AXI::Size size,
     uint8_t len, ARM::AXI::Burst burst)
 {
-    ARM::AXI::Payload* payload = ARM::AXI::Payload::new_payload(command, address, size, len, burst);
+    ARM::AXI::PayloadRef payload(ARM::AXI::Payload::new_payload(command, address, size, len, burst),
+        ARM::TLM::ADOPT_REF);
 
     payload->cache = ARM::AXI::CacheBitEnum() | ARM::AXI::CACHE_AW_B;
 
     switch (payload->get_command())
     {
     case ARM::AXI::COMMAND_WRITE:
-        aw_queue.push_back(payload);
+        aw_queue.push_back(std::move(payload));
         break;
     case ARM::AXI::COMMAND_READ:
-        ar_queue.push_back(payload);
+        ar_queue.push_back(std::move(payload));
         break;
     default: SC_REPORT_ERROR(name(), "can only generate read and write traffic");
     }
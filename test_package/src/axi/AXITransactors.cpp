@@ -3,6 +3,7 @@
 #include <iostream>
 #include <iomanip>
 #include <assert.h>
+#include <vector>
 
 #include <tlm_utils/peq_with_cb_and_phase.h>
 
@@ -147,7 +148,7 @@ void TransAXIToGenericImp::nb_transport_bw_untimed(tlm::tlm_generic_payload& gen
         {
             axi_tlm_extension* arm_ext;
             gen_payload.get_extension(arm_ext);
-            rsp_payload = arm_ext->arm_payload;
+            rsp_payload = arm_ext->arm_payload.get();
 
             assert(rsp_payload);
             rsp_gen_payload = &gen_payload;
@@ -261,6 +262,83 @@ void TransAXIToGenericImp::clock_negedge()
 
 }
 
+unsigned TransAXIToGenericImp::transport_dbg(ARM::AXI::Payload& arm_payload)
+{
+    uint64_t address = arm_payload.get_base_address();
+    unsigned length = static_cast<unsigned>(arm_payload.get_data_length());
+    if (dbg_data.size() < length)
+    {
+        dbg_data.resize(length);
+        dbg_strobes.resize(length / 8 + 1);
+    }
+
+    uint8_t* data = dbg_data.data();
+    uint8_t* byte_strobes = dbg_strobes.data();
+
+    tlm::tlm_generic_payload gen_payload;
+    gen_payload.set_data_ptr(data);
+
+    if (arm_payload.get_command() != ARM::AXI::COMMAND_WRITE)
+    {
+        gen_payload.set_command(tlm::TLM_READ_COMMAND);
+        gen_payload.set_address(address);
+        gen_payload.set_data_length(length);
+
+        unsigned count = initiator_transport_dbg(gen_payload);
+        if (count == length)
+            arm_payload.read_in(data);
+        return count;
+    }
+
+    arm_payload.write_out(data);
+    arm_payload.write_out_strobes(byte_strobes);
+
+    /*
+     * Debug transport has no byte enables, so pass on each run of strobed
+     * bytes as a separate write.
+     */
+    gen_payload.set_command(tlm::TLM_WRITE_COMMAND);
+
+    unsigned i = 0;
+    while (i < length)
+    {
+        if ((byte_strobes[i / 8] & (0x1 << (i % 8))) == 0)
+        {
+            i++;
+            continue;
+        }
+
+        unsigned run_start = i;
+        while (i < length && (byte_strobes[i / 8] & (0x1 << (i % 8))) != 0)
+            i++;
+
+        gen_payload.set_address(address + run_start);
+        gen_payload.set_data_ptr(data + run_start);
+        gen_payload.set_data_length(i - run_start);
+
+        if (initiator_transport_dbg(gen_payload) != i - run_start)
+            return run_start;
+    }
+
+    return length;
+}
+
+bool TransAXIToGenericImp::get_direct_mem_ptr(ARM::AXI::Payload& arm_payload, tlm::tlm_dmi& dmi)
+{
+    tlm::tlm_generic_payload gen_payload;
+
+    gen_payload.set_address(arm_payload.get_address());
+    gen_payload.set_command(arm_payload.get_command() == ARM::AXI::COMMAND_WRITE ?
+        tlm::TLM_WRITE_COMMAND : tlm::TLM_READ_COMMAND);
+
+    return initiator_get_direct_mem_ptr(gen_payload, dmi);
+}
+
+void TransAXIToGenericImp::invalidate_direct_mem_ptr(sc_dt::uint64 start, sc_dt::uint64 end)
+{
+    target.invalidate_direct_mem_ptr(start, end);
+}
+
 TransAXIToGenericImp::TransAXIToGenericImp(sc_core::sc_module_name name, ARM::TLM::Protocol protocol, unsigned width) :
     sc_core::sc_module(name),
     peq(this, &TransAXIToGenericImp::nb_transport_bw_untimed),
@@ -275,6 +353,9 @@ TransAXIToGenericImp::TransAXIToGenericImp(sc_core::sc_module_name name, ARM::TL
     target("target", *this, &TransAXIToGenericImp::nb_transport_fw, protocol, width),
     clock("clock")
 {
+    target.register_transport_dbg(&TransAXIToGenericImp::transport_dbg);
+    target.register_get_direct_mem_ptr(&TransAXIToGenericImp::get_direct_mem_ptr);
+
     SC_METHOD(clock_posedge);
     sensitive << clock.pos();
     dont_initialize();
@@ -330,7 +411,7 @@ void TransGenericToAXIImp::nb_transport_fw_untimed(tlm::tlm_generic_payload& gen
             gen_payload.get_extension(arm_ext);
             ARM::AXI::Payload* parent_payload = nullptr;
             if (arm_ext != nullptr)
-                parent_payload = arm_ext->arm_payload;
+                parent_payload = arm_ext->arm_payload.get();
 
             ARM::AXI::Command command = gen_payload.is_read() ?
                 ARM::AXI::COMMAND_READ : ARM::AXI::COMMAND_WRITE;
@@ -531,6 +612,37 @@ void TransGenericToAXIImp::clock_negedge()
     }
 }
 
+unsigned TransGenericToAXIImp::transport_dbg(tlm::tlm_generic_payload& gen_payload)
+{
+    if (gen_payload.is_write())
+    {
+        return ARM::AXI::debug_write(initiator, gen_payload.get_address(),
+            gen_payload.get_data_ptr(), gen_payload.get_data_length());
+    }
+    else if (gen_payload.is_read())
+    {
+        return ARM::AXI::debug_read(initiator, gen_payload.get_address(),
+            gen_payload.get_data_ptr(), gen_payload.get_data_length());
+    }
+
+    return 0;
+}
+
+bool TransGenericToAXIImp::get_direct_mem_ptr(tlm::tlm_generic_payload& gen_payload, tlm::tlm_dmi& dmi)
+{
+    ARM::AXI::Command command = gen_payload.is_write() ?
+        ARM::AXI::COMMAND_WRITE : ARM::AXI::COMMAND_READ;
+    ARM::AXI::PayloadRef arm_payload(ARM::AXI::Payload::new_payload(command,
+        gen_payload.get_address(), ARM::AXI::SIZE_1, 0), ARM::TLM::ADOPT_REF);
+
+    return initiator->get_direct_mem_ptr(*arm_payload, dmi);
+}
+
+void TransGenericToAXIImp::invalidate_direct_mem_ptr(sc_dt::uint64 start, sc_dt::uint64 end)
+{
+    target_invalidate_direct_mem_ptr(start, end);
+}
+
 TransGenericToAXIImp::TransGenericToAXIImp(sc_core::sc_module_name name, ARM::TLM::Protocol protocol, unsigned width) :
     sc_core::sc_module(name),
     peq(this, &TransGenericToAXIImp::nb_transport_fw_untimed),
@@ -544,6 +656,8 @@ TransGenericToAXIImp::TransGenericToAXIImp(sc_core::sc_module_name name, ARM::TL
     initiator("initiator", *this, &TransGenericToAXIImp::nb_transport_bw, protocol, width),
     clock("clock")
 {
+    initiator.register_invalidate_direct_mem_ptr(&TransGenericToAXIImp::invalidate_direct_mem_ptr);
+
     SC_METHOD(clock_posedge);
     sensitive << clock.pos();
     dont_initialize();
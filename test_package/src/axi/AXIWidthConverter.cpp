@@ -0,0 +1,638 @@
+#include <algorithm>
+#include <utility>
+
+#include "AXIWidthConverter.h"
+
+/* log2 of a port width in bytes, or SIZE_MASK if it is not an AXI width. */
+static ARM::AXI::Size width_to_size(unsigned width)
+{
+    for (unsigned size = ARM::AXI::SIZE_1; size <= ARM::AXI::SIZE_128; size++)
+    {
+        if ((8u << size) == width)
+            return ARM::AXI::SizeEnum(size);
+    }
+
+    return ARM::AXI::SIZE_MASK;
+}
+
+/* The response reporting the worse outcome of 'a' and 'b'. */
+static ARM::AXI::Resp worse_resp(ARM::AXI::Resp a, ARM::AXI::Resp b)
+{
+    return b.mask(ARM::AXI::RESP_R_BASE_MASK) >
+        a.mask(ARM::AXI::RESP_R_BASE_MASK) ? b : a;
+}
+
+/*
+ * Strobes of 'bytes' (at most 64) bytes from 'offset' in a byte strobe array.
+ * 'offset' is a multiple of 'bytes'.
+ */
+static uint64_t gather_strobe(const uint8_t* strobe, unsigned offset,
+    unsigned bytes)
+{
+    if (bytes < 8)
+        return (strobe[offset / 8] >> (offset % 8)) & ((1u << bytes) - 1);
+
+    uint64_t gathered = 0;
+    for (unsigned i = 0; i < bytes / 8; i++)
+        gathered |= uint64_t(strobe[offset / 8 + i]) << (8 * i);
+
+    return gathered;
+}
+
+/* Whether a write asks for a persist B response as well as a completion. */
+static bool expects_persist(const ARM::AXI::Payload& payload)
+{
+    if (payload.snoop != ARM::AXI::SNOOP_AW_CMO &&
+        payload.snoop != ARM::AXI::SNOOP_AW_WRITE_PTL_CMO &&
+        payload.snoop != ARM::AXI::SNOOP_AW_WRITE_FULL_CMO)
+    {
+        return false;
+    }
+
+    return payload.cmo == ARM::AXI::CMO_CLEAN_SHARED_PERSIST ||
+        payload.cmo == ARM::AXI::CMO_CLEAN_SHARED_DEEP_PERSIST;
+}
+
+/*
+ * The B phase carrying the given parts of a write response, or
+ * PHASE_UNINITIALIZED if there are none.
+ */
+static ARM::AXI::Phase b_phase(bool comp, bool persist, bool match)
+{
+    if (persist)
+    {
+        return comp ? ARM::AXI::B_VALID_COMP_PERSIST :
+            ARM::AXI::B_VALID_PERSIST;
+    }
+    if (match)
+    {
+        return comp ? ARM::AXI::B_VALID_COMP_TAGMATCH :
+            ARM::AXI::B_VALID_TAGMATCH;
+    }
+
+    return comp ? ARM::AXI::B_VALID_COMP : ARM::AXI::PHASE_UNINITIALIZED;
+}
+
+AXIWidthConverter::Transaction* AXIWidthConverter::new_transaction(
+    ARM::AXI::Payload& payload)
+{
+    Transaction* trans;
+    if (free_transactions.empty())
+    {
+        trans = new Transaction;
+        transactions.push_back(trans);
+    }
+    else
+    {
+        trans = free_transactions.back();
+        free_transactions.pop_back();
+    }
+
+    trans->payload = ARM::AXI::PayloadRef(payload);
+    trans->split = needs_split(payload);
+    trans->data_child = 0;
+    trans->data_beat = 0;
+    trans->payload_beat = 0;
+    trans->b_count = 0;
+    trans->persist_count = 0;
+    trans->match_count = 0;
+    trans->expects_persist =
+        payload.get_command() == ARM::AXI::COMMAND_WRITE &&
+        expects_persist(payload);
+    trans->expects_match = payload.get_command() == ARM::AXI::COMMAND_WRITE &&
+        payload.tag_op == ARM::AXI::TAG_OP_MATCH;
+    trans->tag_match = true;
+    trans->resp = ARM::AXI::RESP_OKAY;
+
+    active[&payload] = trans;
+
+    if (!trans->split)
+    {
+        trans->children.push_back(trans->payload);
+        return trans;
+    }
+
+    if (payload.atop != ARM::AXI::ATOP_NON_ATOMIC)
+        SC_REPORT_ERROR(name(),
+            "atomic transaction wider than the initiator port");
+
+    const uint64_t beat_bytes = uint64_t(1) << payload.get_size();
+    const uint64_t total_bytes = beat_bytes * payload.get_beat_count();
+    const uint64_t address = payload.get_address();
+
+    switch (payload.get_burst())
+    {
+    case ARM::AXI::BURST_WRAP:
+    {
+        /* Up to the wrap boundary, then back round from its bottom. */
+        uint64_t base = address & ~(total_bytes - 1);
+        add_children(trans, address, base + total_bytes);
+        add_children(trans, base, address);
+        break;
+    }
+    case ARM::AXI::BURST_FIXED:
+        for (unsigned beat = 0; beat < payload.get_beat_count(); beat++)
+        {
+            add_children(trans, address,
+                (address & ~(beat_bytes - 1)) + beat_bytes);
+        }
+        break;
+    default:
+        add_children(trans, address,
+            (address & ~(beat_bytes - 1)) + total_bytes);
+        break;
+    }
+
+    for (const ARM::AXI::PayloadRef& child : trans->children)
+        active[child.get()] = trans;
+
+    return trans;
+}
+
+void AXIWidthConverter::retire_transaction(Transaction* trans)
+{
+    active.erase(trans->payload.get());
+    for (const ARM::AXI::PayloadRef& child : trans->children)
+        active.erase(child.get());
+
+    trans->payload.reset();
+    trans->children.clear();
+    free_transactions.push_back(trans);
+}
+
+AXIWidthConverter::Transaction* AXIWidthConverter::find_transaction(
+    const ARM::AXI::Payload& payload) const
+{
+    std::unordered_map<const ARM::AXI::Payload*,
+        Transaction*>::const_iterator it = active.find(&payload);
+
+    return it == active.end() ? nullptr : it->second;
+}
+
+bool AXIWidthConverter::needs_split(const ARM::AXI::Payload& payload) const
+{
+    return payload.get_size() > initiator_size;
+}
+
+void AXIWidthConverter::add_children(Transaction* trans, uint64_t start,
+    uint64_t end)
+{
+    const uint64_t child_bytes = uint64_t(1) << initiator_size;
+
+    /* INCR bursts of at most 256 beats. */
+    while (start < end)
+    {
+        uint64_t aligned = start & ~(child_bytes - 1);
+        uint64_t beats = std::min<uint64_t>((end - aligned) / child_bytes, 256);
+
+        trans->children.emplace_back(trans->payload->descend(
+            trans->payload->get_command(), start, initiator_size,
+            uint8_t(beats - 1), ARM::AXI::BURST_INCR), ARM::TLM::ADOPT_REF);
+
+        start = aligned + beats * child_bytes;
+    }
+}
+
+uint64_t AXIWidthConverter::child_beat_address(const Transaction* trans) const
+{
+    const uint64_t child_bytes = uint64_t(1) << initiator_size;
+    const ARM::AXI::Payload* child = trans->children[trans->data_child].get();
+
+    return (child->get_address() & ~(child_bytes - 1)) +
+        trans->data_beat * child_bytes;
+}
+
+void AXIWidthConverter::convert_write_beat(Transaction* trans, Channel* channel)
+{
+    const ARM::AXI::Payload& payload = *trans->payload;
+    const ARM::AXI::Size size = payload.get_size();
+    const uint64_t beat_bytes = uint64_t(1) << size;
+    const unsigned child_bytes = 1u << initiator_size;
+
+    uint8_t data[WIDTH_CONVERTER_MAX_BEAT_BYTES];
+    uint8_t strobe[WIDTH_CONVERTER_MAX_BEAT_BYTES / 8];
+    payload.write_out_beat_raw(size, trans->payload_beat, data);
+    payload.write_out_beat_raw_strobe(size, trans->payload_beat, strobe);
+    trans->payload_beat++;
+
+    /* Hand out the beat's lanes to initiator port beats up to its end. */
+    bool beat_done = false;
+    while (!beat_done)
+    {
+        ARM::AXI::Payload* child = trans->children[trans->data_child].get();
+        uint64_t address = child_beat_address(trans);
+        unsigned offset = unsigned(address & (beat_bytes - 1));
+
+        child->write_in_beat_raw(initiator_size, data + offset,
+            gather_strobe(strobe, offset, child_bytes));
+        beat_done = ((address + child_bytes) & (beat_bytes - 1)) == 0;
+
+        ARM::AXI::Phase phase = ARM::AXI::W_VALID;
+        if (++trans->data_beat == child->get_beat_count())
+        {
+            phase = ARM::AXI::W_VALID_LAST;
+            trans->data_child++;
+            trans->data_beat = 0;
+        }
+
+        if (channel)
+            channel->queue.push_back(Beat{ARM::AXI::PayloadRef(*child), phase});
+    }
+}
+
+void AXIWidthConverter::convert_read_beat(Transaction* trans, Channel* channel)
+{
+    ARM::AXI::Payload& payload = *trans->payload;
+    const ARM::AXI::Size size = payload.get_size();
+    const uint64_t beat_bytes = uint64_t(1) << size;
+    const unsigned child_bytes = 1u << initiator_size;
+
+    ARM::AXI::Payload* child = trans->children[trans->data_child].get();
+    uint64_t address = child_beat_address(trans);
+    unsigned offset = unsigned(address & (beat_bytes - 1));
+
+    child->read_out_beat_raw(initiator_size, trans->data_beat,
+        trans->beat + offset);
+    trans->resp = worse_resp(trans->resp,
+        child->read_out_beat_resp(trans->data_beat));
+
+    if (++trans->data_beat == child->get_beat_count())
+    {
+        trans->data_child++;
+        trans->data_beat = 0;
+    }
+
+    /* Wait for the rest of the target port beat. */
+    if (((address + child_bytes) & (beat_bytes - 1)) != 0)
+        return;
+
+    payload.read_in_beat_raw(size, trans->beat, trans->resp);
+    trans->resp = ARM::AXI::RESP_OKAY;
+
+    if (channel)
+    {
+        ARM::AXI::Phase phase =
+            payload.get_beats_complete() == payload.get_beat_count() ?
+            ARM::AXI::R_VALID_LAST : ARM::AXI::R_VALID;
+        channel->queue.push_back(Beat{trans->payload, phase});
+    }
+}
+
+void AXIWidthConverter::send_fw(Channel& channel)
+{
+    while (!channel.busy && !channel.queue.empty())
+    {
+        Beat beat = std::move(channel.queue.front());
+        channel.queue.pop_front();
+
+        channel.busy = true;
+        if (initiator.nb_transport_fw(*beat.payload, beat.phase) ==
+            tlm::TLM_UPDATED)
+        {
+            channel.busy = false;
+        }
+    }
+
+    if (channel.queue.empty() && channel.stalled)
+    {
+        ARM::AXI::PayloadRef payload = std::move(channel.stalled);
+        ARM::AXI::Phase phase = channel.stalled_ready;
+        target.nb_transport_bw(*payload, phase);
+    }
+}
+
+void AXIWidthConverter::send_bw(Channel& channel)
+{
+    while (!channel.busy && !channel.queue.empty())
+    {
+        Beat beat = std::move(channel.queue.front());
+        channel.queue.pop_front();
+
+        channel.busy = true;
+        if (target.nb_transport_bw(*beat.payload, beat.phase) ==
+            tlm::TLM_UPDATED)
+        {
+            channel.busy = false;
+        }
+    }
+
+    if (channel.queue.empty() && channel.stalled)
+    {
+        ARM::AXI::PayloadRef payload = std::move(channel.stalled);
+        ARM::AXI::Phase phase = channel.stalled_ready;
+        initiator.nb_transport_fw(*payload, phase);
+    }
+}
+
+tlm::tlm_sync_enum AXIWidthConverter::accept(Channel& channel,
+    ARM::AXI::Payload& payload, ARM::AXI::Phase& phase, ARM::AXI::Phase ready)
+{
+    if (channel.queue.empty())
+    {
+        phase = ready;
+        return tlm::TLM_UPDATED;
+    }
+
+    channel.stalled = ARM::AXI::PayloadRef(payload);
+    channel.stalled_ready = ready;
+    return tlm::TLM_ACCEPTED;
+}
+
+tlm::tlm_sync_enum AXIWidthConverter::nb_transport_fw(
+    ARM::AXI::Payload& payload, ARM::AXI::Phase& phase)
+{
+    switch (phase)
+    {
+    case ARM::AXI::AW_VALID:
+    case ARM::AXI::AR_VALID:
+    {
+        bool write = phase == ARM::AXI::AW_VALID;
+        Channel& channel = (write ? aw : ar);
+        Transaction* trans = new_transaction(payload);
+
+        for (const ARM::AXI::PayloadRef& child : trans->children)
+            channel.queue.push_back(Beat{child, phase});
+
+        send_fw(channel);
+        return accept(channel, payload, phase,
+            write ? ARM::AXI::AW_READY : ARM::AXI::AR_READY);
+    }
+    case ARM::AXI::W_VALID:
+    case ARM::AXI::W_VALID_LAST:
+    {
+        Transaction* trans = find_transaction(payload);
+        if (!trans || trans->payload.get() != &payload)
+        {
+            SC_REPORT_ERROR(name(), "write data before write address");
+            return tlm::TLM_ACCEPTED;
+        }
+
+        if (trans->split)
+            convert_write_beat(trans, &w);
+        else
+            w.queue.push_back(Beat{trans->payload, phase});
+
+        send_fw(w);
+        return accept(w, payload, phase, ARM::AXI::W_READY);
+    }
+    case ARM::AXI::B_READY:
+        b.busy = false;
+        send_bw(b);
+        return tlm::TLM_ACCEPTED;
+    case ARM::AXI::R_READY:
+        r.busy = false;
+        send_bw(r);
+        return tlm::TLM_ACCEPTED;
+    case ARM::AXI::RACK:
+    case ARM::AXI::WACK:
+    {
+        Transaction* trans = find_transaction(payload);
+        if (!trans || trans->payload.get() != &payload)
+        {
+            SC_REPORT_ERROR(name(), "acknowledge for unknown transaction");
+            return tlm::TLM_ACCEPTED;
+        }
+
+        /* Acknowledge every payload the initiator port completed. */
+        for (const ARM::AXI::PayloadRef& child : trans->children)
+        {
+            ARM::AXI::Phase ack = phase;
+            initiator.nb_transport_fw(*child, ack);
+        }
+
+        retire_transaction(trans);
+        return tlm::TLM_ACCEPTED;
+    }
+    default:
+        SC_REPORT_ERROR(name(), "unsupported phase");
+        return tlm::TLM_ACCEPTED;
+    }
+}
+
+tlm::tlm_sync_enum AXIWidthConverter::nb_transport_bw(
+    ARM::AXI::Payload& payload, ARM::AXI::Phase& phase)
+{
+    switch (phase)
+    {
+    case ARM::AXI::AW_READY:
+        aw.busy = false;
+        send_fw(aw);
+        return tlm::TLM_ACCEPTED;
+    case ARM::AXI::W_READY:
+        w.busy = false;
+        send_fw(w);
+        return tlm::TLM_ACCEPTED;
+    case ARM::AXI::AR_READY:
+        ar.busy = false;
+        send_fw(ar);
+        return tlm::TLM_ACCEPTED;
+    case ARM::AXI::R_VALID:
+    case ARM::AXI::R_VALID_LAST:
+    {
+        /* Children of one transaction return data in order. */
+        Transaction* trans = find_transaction(payload);
+        if (!trans ||
+            trans->payload->get_command() != ARM::AXI::COMMAND_READ ||
+            trans->children[trans->data_child].get() != &payload)
+        {
+            SC_REPORT_ERROR(name(), "read data for unknown transaction");
+            return tlm::TLM_ACCEPTED;
+        }
+
+        if (trans->split)
+        {
+            convert_read_beat(trans, &r);
+        }
+        else
+        {
+            r.queue.push_back(Beat{trans->payload, phase});
+            if (phase == ARM::AXI::R_VALID_LAST)
+                trans->data_child++;
+        }
+
+        if (trans->data_child == trans->children.size() && !completion_ack)
+            retire_transaction(trans);
+
+        send_bw(r);
+        return accept(r, payload, phase, ARM::AXI::R_READY);
+    }
+    case ARM::AXI::B_VALID:
+    case ARM::AXI::B_VALID_PERSIST:
+    case ARM::AXI::B_VALID_COMP_PERSIST:
+    case ARM::AXI::B_VALID_TAGMATCH:
+    case ARM::AXI::B_VALID_COMP_TAGMATCH:
+    {
+        Transaction* trans = find_transaction(payload);
+        if (!trans || trans->payload->get_command() != ARM::AXI::COMMAND_WRITE)
+        {
+            SC_REPORT_ERROR(name(), "write response for unknown transaction");
+            return tlm::TLM_ACCEPTED;
+        }
+
+        const unsigned children = unsigned(trans->children.size());
+        bool comp_done = false;
+        bool persist_done = false;
+        bool match_done = false;
+
+        if (phase != ARM::AXI::B_VALID_PERSIST &&
+            phase != ARM::AXI::B_VALID_TAGMATCH)
+        {
+            trans->resp = worse_resp(trans->resp, payload.get_resp());
+            comp_done = ++trans->b_count == children;
+        }
+        if (phase == ARM::AXI::B_VALID_PERSIST ||
+            phase == ARM::AXI::B_VALID_COMP_PERSIST)
+        {
+            persist_done = ++trans->persist_count == children;
+        }
+        if (phase == ARM::AXI::B_VALID_TAGMATCH ||
+            phase == ARM::AXI::B_VALID_COMP_TAGMATCH)
+        {
+            trans->tag_match = trans->tag_match && payload.tag_match;
+            match_done = ++trans->match_count == children;
+        }
+
+        if (trans->split)
+        {
+            if (comp_done)
+                trans->payload->set_resp(trans->resp);
+            if (match_done)
+                trans->payload->tag_match = trans->tag_match;
+        }
+
+        /* Each part goes to the target port once every child has given it. */
+        ARM::AXI::Phase response = b_phase(comp_done, persist_done, match_done);
+        if (response != ARM::AXI::PHASE_UNINITIALIZED)
+            b.queue.push_back(Beat{trans->payload, response});
+
+        if (!completion_ack && trans->b_count == children &&
+            (!trans->expects_persist || trans->persist_count == children) &&
+            (!trans->expects_match || trans->match_count == children))
+        {
+            retire_transaction(trans);
+        }
+
+        /* Write responses are bounded by the transactions in flight. */
+        send_bw(b);
+        phase = ARM::AXI::B_READY;
+        return tlm::TLM_UPDATED;
+    }
+    default:
+        SC_REPORT_ERROR(name(), "unsupported phase");
+        return tlm::TLM_ACCEPTED;
+    }
+}
+
+void AXIWidthConverter::b_transport(ARM::AXI::Payload& payload,
+    sc_core::sc_time& delay)
+{
+    if (!needs_split(payload))
+    {
+        initiator.b_transport(payload, delay);
+        return;
+    }
+
+    Transaction* trans = new_transaction(payload);
+    bool write = payload.get_command() == ARM::AXI::COMMAND_WRITE;
+
+    if (write)
+    {
+        for (unsigned beat = 0; beat < payload.get_beat_count(); beat++)
+            convert_write_beat(trans, nullptr);
+    }
+
+    for (const ARM::AXI::PayloadRef& child : trans->children)
+    {
+        initiator.b_transport(*child, delay);
+        if (write)
+            trans->resp = worse_resp(trans->resp, child->get_resp());
+    }
+
+    if (write)
+    {
+        payload.set_resp(trans->resp);
+    }
+    else
+    {
+        while (trans->data_child < trans->children.size())
+            convert_read_beat(trans, nullptr);
+    }
+
+    retire_transaction(trans);
+}
+
+unsigned AXIWidthConverter::transport_dbg(ARM::AXI::Payload& payload)
+{
+    if (!needs_split(payload))
+        return initiator.transport_dbg(payload);
+
+    Transaction* trans = new_transaction(payload);
+    bool write = payload.get_command() == ARM::AXI::COMMAND_WRITE;
+    bool complete = true;
+
+    if (write)
+    {
+        for (unsigned beat = 0; beat < payload.get_beat_count(); beat++)
+            convert_write_beat(trans, nullptr);
+    }
+
+    for (const ARM::AXI::PayloadRef& child : trans->children)
+    {
+        if (initiator.transport_dbg(*child) < child->get_data_length())
+            complete = false;
+    }
+
+    if (complete && !write)
+    {
+        while (trans->data_child < trans->children.size())
+            convert_read_beat(trans, nullptr);
+    }
+
+    retire_transaction(trans);
+
+    return complete ? static_cast<unsigned>(payload.get_data_length()) : 0;
+}
+
+bool AXIWidthConverter::get_direct_mem_ptr(ARM::AXI::Payload& payload,
+    tlm::tlm_dmi& dmi)
+{
+    return initiator.get_direct_mem_ptr(payload, dmi);
+}
+
+void AXIWidthConverter::invalidate_direct_mem_ptr(sc_dt::uint64 start,
+    sc_dt::uint64 end)
+{
+    target.invalidate_direct_mem_ptr(start, end);
+}
+
+AXIWidthConverter::AXIWidthConverter(sc_core::sc_module_name name,
+    unsigned target_width, unsigned initiator_width,
+    ARM::TLM::Protocol protocol) :
+    sc_core::sc_module(name),
+    initiator_size(width_to_size(initiator_width)),
+    completion_ack(protocol == ARM::TLM::PROTOCOL_ACE ||
+        protocol == ARM::TLM::PROTOCOL_ACE5),
+    target("target", *this, &AXIWidthConverter::nb_transport_fw, protocol,
+        target_width),
+    initiator("initiator", *this, &AXIWidthConverter::nb_transport_bw, protocol,
+        initiator_width)
+{
+    if (width_to_size(target_width) == ARM::AXI::SIZE_MASK ||
+        initiator_size == ARM::AXI::SIZE_MASK)
+    {
+        SC_REPORT_ERROR(this->name(),
+            "port widths must be powers of two from 8 to 1024 bits");
+    }
+
+    target.register_b_transport(&AXIWidthConverter::b_transport);
+    target.register_transport_dbg(&AXIWidthConverter::transport_dbg);
+    target.register_get_direct_mem_ptr(&AXIWidthConverter::get_direct_mem_ptr);
+    initiator.register_invalidate_direct_mem_ptr(
+        &AXIWidthConverter::invalidate_direct_mem_ptr);
+}
+
+AXIWidthConverter::~AXIWidthConverter()
+{
+    for (Transaction* trans : transactions)
+        delete trans;
+}
@@ -0,0 +1,247 @@
+#include <utility>
+
+#include "CHIBridge.h"
+
+/* Does a response from the home node give the DBID later write data or CompAck is sent to? */
+static bool gives_dbid(const ARM::CHI::Phase& phase)
+{
+    if (phase.channel == ARM::CHI::CHANNEL_DAT)
+    {
+        return phase.dat_opcode == ARM::CHI::DAT_OPCODE_COMP_DATA ||
+            phase.dat_opcode == ARM::CHI::DAT_OPCODE_DATA_SEP_RESP;
+    }
+
+    switch (phase.rsp_opcode)
+    {
+    case ARM::CHI::RSP_OPCODE_COMP:
+    case ARM::CHI::RSP_OPCODE_COMP_DBID_RESP:
+    case ARM::CHI::RSP_OPCODE_DBID_RESP:
+    case ARM::CHI::RSP_OPCODE_DBID_RESP_ORD:
+    case ARM::CHI::RSP_OPCODE_RESP_SEP_DATA:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/* Is a flit from the requester a response to a snoop, rather than write data or a CompAck? */
+static bool is_snoop_response(const ARM::CHI::Phase& phase)
+{
+    if (phase.channel == ARM::CHI::CHANNEL_DAT)
+    {
+        return phase.dat_opcode == ARM::CHI::DAT_OPCODE_SNP_RESP_DATA ||
+            phase.dat_opcode == ARM::CHI::DAT_OPCODE_SNP_RESP_DATA_PTL ||
+            phase.dat_opcode == ARM::CHI::DAT_OPCODE_SNP_RESP_DATA_FWDED;
+    }
+
+    return phase.rsp_opcode == ARM::CHI::RSP_OPCODE_SNP_RESP ||
+        phase.rsp_opcode == ARM::CHI::RSP_OPCODE_SNP_RESP_FWDED;
+}
+
+void CHIBridge::track_payload(const CHIFlit& flit)
+{
+    const ARM::CHI::Phase& phase = flit.phase;
+
+    if (side == ARM::CHI::BRIDGE_SIDE_REQUESTER)
+    {
+        if (phase.channel == ARM::CHI::CHANNEL_REQ)
+            txn_payloads[phase.txn_id] = flit.payload;
+    }
+    else if (phase.channel == ARM::CHI::CHANNEL_SNP)
+    {
+        txn_payloads[phase.txn_id] = flit.payload;
+    }
+    else if (gives_dbid(phase))
+    {
+        dbid_payloads[phase.dbid] = flit.payload;
+    }
+}
+
+ARM::CHI::PayloadRef CHIBridge::find_payload(const ARM::CHI::Phase& header)
+{
+    if (side == ARM::CHI::BRIDGE_SIDE_REQUESTER)
+    {
+        switch (header.channel)
+        {
+        case ARM::CHI::CHANNEL_SNP:
+            return ARM::CHI::PayloadRef(ARM::CHI::Payload::new_payload(), ARM::TLM::ADOPT_REF);
+        case ARM::CHI::CHANNEL_RSP:
+            /* A PCrdGrant is for no transaction in particular. */
+            if (header.rsp_opcode == ARM::CHI::RSP_OPCODE_PCRD_GRANT)
+                return ARM::CHI::PayloadRef(ARM::CHI::Payload::new_dataless_payload(), ARM::TLM::ADOPT_REF);
+            return txn_payloads[header.txn_id];
+        default:
+            return txn_payloads[header.txn_id];
+        }
+    }
+
+    switch (header.channel)
+    {
+    case ARM::CHI::CHANNEL_REQ:
+        return ARM::CHI::PayloadRef(ARM::CHI::Payload::new_payload(), ARM::TLM::ADOPT_REF);
+    default:
+        return is_snoop_response(header) ? txn_payloads[header.txn_id] : dbid_payloads[header.txn_id];
+    }
+}
+
+void CHIBridge::receive_bridge_flits()
+{
+    ARM::CHI::BridgeQueue& queue = link.rx_queue(side);
+
+    while (!queue.empty())
+    {
+        const ARM::CHI::BridgeFlit& bridge_flit = queue.front();
+        CHIChannelState& channel = channels[bridge_flit.channel];
+
+        /* Flits are delivered in order, so a full channel holds back those behind it. */
+        if (bridge_flit.due > cycle || channel.tx_full())
+            break;
+
+        ARM::CHI::Phase phase;
+        codec.decode_header(bridge_flit.channel, bridge_flit.words, phase);
+
+        ARM::CHI::PayloadRef payload = find_payload(phase);
+        if (payload)
+        {
+            codec.decode(bridge_flit.channel, bridge_flit.words, *payload, phase);
+            channel.push_tx(std::move(payload), phase);
+        }
+        else
+        {
+            SC_REPORT_ERROR(name(), "flit for unknown transaction received over bridge");
+        }
+
+        queue.pop();
+    }
+}
+
+void CHIBridge::send_bridge_flits()
+{
+    ARM::CHI::BridgeQueue& queue = link.tx_queue(side);
+
+    for (const auto channel : {ARM::CHI::CHANNEL_REQ, ARM::CHI::CHANNEL_RSP, ARM::CHI::CHANNEL_DAT,
+             ARM::CHI::CHANNEL_SNP})
+    {
+        CHIChannelState& state = channels[channel];
+
+        /* Only consuming a flit returns its link credit, so a full bridge holds back the local node. */
+        while (!state.rx_empty() && queue.space() != 0)
+        {
+            const CHIFlit& flit = state.rx_front();
+            ARM::CHI::BridgeFlit& bridge_flit = queue.back();
+
+            track_payload(flit);
+
+            bridge_flit.due = cycle + link.get_latency();
+            bridge_flit.channel = channel;
+            codec.encode(*flit.payload, flit.phase, bridge_flit.words);
+
+            queue.push();
+            state.pop_rx();
+        }
+    }
+}
+
+void CHIBridge::clock_posedge()
+{
+    /* Wait until the peer has sent every flit due this cycle. */
+    link.wait_ready(side, cycle);
+
+    receive_bridge_flits();
+    send_bridge_flits();
+
+    cycle++;
+    link.publish(side, cycle);
+}
+
+void CHIBridge::clock_negedge()
+{
+    /* Try to issue credits and send flits to the local node. */
+    for (const auto channel : {ARM::CHI::CHANNEL_REQ, ARM::CHI::CHANNEL_RSP, ARM::CHI::CHANNEL_DAT,
+             ARM::CHI::CHANNEL_SNP})
+    {
+        channels[channel].send_flits(channel, [this](ARM::CHI::Payload& payload, ARM::CHI::Phase& phase) {
+            return send_local(payload, phase);
+        });
+    }
+}
+
+tlm::tlm_sync_enum CHIBridge::receive_local(ARM::CHI::Payload& payload, ARM::CHI::Phase& phase)
+{
+    if (!channels[phase.channel].receive_flit(payload, phase))
+        SC_REPORT_ERROR(name(), "flit on inactive channel received");
+
+    return tlm::TLM_ACCEPTED;
+}
+
+void CHIBridge::end_of_simulation()
+{
+    link.close(side);
+}
+
+CHIBridge::CHIBridge(const sc_core::sc_module_name& name, ARM::CHI::BridgeLink& link_,
+        const ARM::CHI::BridgeSide side_, const unsigned data_width_bits, const ARM::CHI::LinkConfig& link_config) :
+    sc_core::sc_module(name),
+    link(link_),
+    side(side_),
+    codec(ARM::CHI::FlitFormat(ARM::CHI::FLIT_ISSUE_E, 7, data_width_bits)),
+    txn_payloads(MAX_TXN_IDS),
+    dbid_payloads(side_ == ARM::CHI::BRIDGE_SIDE_HOME ? MAX_TXN_IDS : 0),
+    clock("clock")
+{
+    SC_METHOD(clock_posedge);
+    sensitive << clock.pos();
+    dont_initialize();
+
+    SC_METHOD(clock_negedge);
+    sensitive << clock.neg();
+    dont_initialize();
+
+    for (CHIChannelState& channel : channels)
+        channel.configure(link_config);
+
+    /* Receive what the local node sends: requests and their data from a requester, snoops from a home node. */
+    channels[ARM::CHI::CHANNEL_RSP].enable_rx();
+    channels[ARM::CHI::CHANNEL_DAT].enable_rx();
+    if (side == ARM::CHI::BRIDGE_SIDE_REQUESTER)
+        channels[ARM::CHI::CHANNEL_REQ].enable_rx();
+    else
+        channels[ARM::CHI::CHANNEL_SNP].enable_rx();
+}
+
+CHIBridge::~CHIBridge()
+{
+    link.close(side);
+}
+
+tlm::tlm_sync_enum CHIBridgeTarget::nb_transport_fw(ARM::CHI::Payload& payload, ARM::CHI::Phase& phase)
+{
+    return receive_local(payload, phase);
+}
+
+tlm::tlm_sync_enum CHIBridgeTarget::send_local(ARM::CHI::Payload& payload, ARM::CHI::Phase& phase)
+{
+    return target.nb_transport_bw(payload, phase);
+}
+
+CHIBridgeTarget::CHIBridgeTarget(const sc_core::sc_module_name& name, ARM::CHI::BridgeLink& link,
+        const unsigned data_width_bits, const ARM::CHI::LinkConfig& link_config) :
+    CHIBridge(name, link, ARM::CHI::BRIDGE_SIDE_REQUESTER, data_width_bits, link_config),
+    target("target", *this, &CHIBridgeTarget::nb_transport_fw, ARM::TLM::PROTOCOL_CHI_E, data_width_bits)
+{}
+
+tlm::tlm_sync_enum CHIBridgeInitiator::nb_transport_bw(ARM::CHI::Payload& payload, ARM::CHI::Phase& phase)
+{
+    return receive_local(payload, phase);
+}
+
+tlm::tlm_sync_enum CHIBridgeInitiator::send_local(ARM::CHI::Payload& payload, ARM::CHI::Phase& phase)
+{
+    return initiator.nb_transport_fw(payload, phase);
+}
+
+CHIBridgeInitiator::CHIBridgeInitiator(const sc_core::sc_module_name& name, ARM::CHI::BridgeLink& link,
+        const unsigned data_width_bits, const ARM::CHI::LinkConfig& link_config) :
+    CHIBridge(name, link, ARM::CHI::BRIDGE_SIDE_HOME, data_width_bits, link_config),
+    initiator("initiator", *this, &CHIBridgeInitiator::nb_transport_bw, ARM::TLM::PROTOCOL_CHI_E, data_width_bits)
+{}
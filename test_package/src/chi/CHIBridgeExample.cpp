@@ -0,0 +1,111 @@
+#include <iostream>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "CHIBridge.h"
+#include "CHIMemory.h"
+#include "CHITrafficGenerator.h"
+
+/*
+ * The requester and the memory are simulated by separate SystemC kernels in two processes, joined by a bridge over
+ * shared memory. The link is made before fork() so both processes share it; each then elaborates and runs its own
+ * part of the platform.
+ */
+
+static const unsigned data_width_bits = 256;
+
+/* Cycles a flit takes to cross the bridge, and so how far each process may run ahead of the other. */
+static const unsigned bridge_latency = 4;
+
+static void add_payloads_to_tg(CHITrafficGenerator& tg)
+{
+    for (uint64_t line = 0; line < 32; line++)
+    {
+        tg.add_payload(ARM::CHI::REQ_OPCODE_WRITE_NO_SNP_FULL, 0x00010000 + line * 0x40, ARM::CHI::SIZE_64);
+        tg.add_payload(ARM::CHI::REQ_OPCODE_READ_NO_SNP, 0x00010000 + line * 0x40, ARM::CHI::SIZE_64);
+    }
+
+    /* Coherent requests, completed with a CompAck, and a copy back. */
+    tg.add_payload(ARM::CHI::REQ_OPCODE_READ_SHARED, 0x00007000, ARM::CHI::SIZE_64);
+    tg.add_payload(ARM::CHI::REQ_OPCODE_CLEAN_UNIQUE, 0x00007000, ARM::CHI::SIZE_64);
+    tg.add_payload(ARM::CHI::REQ_OPCODE_WRITE_BACK_FULL, 0x00007000, ARM::CHI::SIZE_64);
+}
+
+static int run_requester(ARM::CHI::BridgeLink& link)
+{
+    sc_core::sc_clock clk("clk", 2, sc_core::SC_NS, 0.5);
+
+    CHITrafficGenerator tg("tg", data_width_bits);
+    CHIBridgeTarget bridge("bridge", link, data_width_bits);
+
+    tg.clock.bind(clk);
+    bridge.clock.bind(clk);
+
+    tg.initiator.bind(bridge.target);
+
+    add_payloads_to_tg(tg);
+
+    sc_core::sc_start(2000, sc_core::SC_NS);
+
+    tg.print_latency(std::cout);
+
+    ARM::CHI::Payload::debug_payload_pool(std::cout);
+
+    return tg.get_outstanding() == 0 ? 0 : 1;
+}
+
+static int run_memory(ARM::CHI::BridgeLink& link)
+{
+    sc_core::sc_clock clk("clk", 2, sc_core::SC_NS, 0.5);
+
+    CHIBridgeInitiator bridge("bridge", link, data_width_bits);
+    CHIMemory mem("mem", data_width_bits);
+
+    bridge.clock.bind(clk);
+    mem.clock.bind(clk);
+
+    bridge.initiator.bind(mem.target);
+
+    sc_core::sc_start(2000, sc_core::SC_NS);
+
+    return 0;
+}
+
+int sc_main(int, char**)
+{
+    ARM::CHI::BridgeLink* const link = ARM::CHI::BridgeLink::create_shared(bridge_latency);
+    if (!link)
+    {
+        std::cerr << "cannot map bridge link" << std::endl;
+        return 1;
+    }
+
+    const pid_t memory_pid = fork();
+    if (memory_pid < 0)
+    {
+        std::cerr << "cannot fork memory process" << std::endl;
+        return 1;
+    }
+
+    if (memory_pid == 0)
+    {
+        const int status = run_memory(*link);
+        ARM::CHI::BridgeLink::destroy_shared(link);
+        return status;
+    }
+
+    int status = run_requester(*link);
+
+    int memory_status;
+    if (waitpid(memory_pid, &memory_status, 0) != memory_pid || !WIFEXITED(memory_status) ||
+        WEXITSTATUS(memory_status) != 0)
+    {
+        status = 1;
+    }
+
+    ARM::CHI::BridgeLink::destroy_shared(link);
+
+    return status;
+}
@@ -2,54 +2,54 @@
 
 #include "CHIUtilities.h"
 
-#include <algorithm>
 #include <cstdint>
 #include <cstring>
+#include <utility>
 
 void CHIMemory::clock_posedge()
 {
-    if (!channels[ARM::CHI::CHANNEL_REQ].rx_queue.empty())
+    cycle++;
+
+    CHIChannelState& req_channel = channels[ARM::CHI::CHANNEL_REQ];
+
+    for (unsigned i = 0; i < config.req_per_cycle && !req_channel.rx_empty(); i++)
     {
-        const CHIFlit req_flit = channels[ARM::CHI::CHANNEL_REQ].rx_queue.front();
-        channels[ARM::CHI::CHANNEL_REQ].rx_queue.pop_front();
+        const CHIFlit req_flit = std::move(req_channel.rx_front());
+        req_channel.pop_rx();
 
-        switch (req_flit.phase.req_opcode)
-        {
-        case ARM::CHI::REQ_OPCODE_READ_NO_SNP:
-            handle_read_req(req_flit);
-            break;
-        case ARM::CHI::REQ_OPCODE_WRITE_NO_SNP_PTL:
-        case ARM::CHI::REQ_OPCODE_WRITE_NO_SNP_FULL:
-            handle_write_req(req_flit);
-            break;
-        default:
-            SC_REPORT_ERROR(name(), "unexpected request opcode received");
-        }
+        handle_req(req_flit);
     }
 
-    if (!channels[ARM::CHI::CHANNEL_RSP].rx_queue.empty())
+    CHIChannelState& rsp_channel = channels[ARM::CHI::CHANNEL_RSP];
+
+    for (unsigned i = 0; i < config.rsp_per_cycle && !rsp_channel.rx_empty(); i++)
     {
-        const CHIFlit rsp_flit = channels[ARM::CHI::CHANNEL_RSP].rx_queue.front();
+        const CHIFlit rsp_flit = std::move(rsp_channel.rx_front());
+        rsp_channel.pop_rx();
 
         switch (rsp_flit.phase.rsp_opcode)
         {
         case ARM::CHI::RSP_OPCODE_COMP_ACK:
-            /* ignore the CompAck */
+            /* CompAck carries the DBID as its TxnID. */
+            handle_comp_ack(rsp_flit.phase.txn_id);
             break;
         default:
             SC_REPORT_ERROR(name(), "unexpected opcode response received");
         }
     }
 
-    if (!channels[ARM::CHI::CHANNEL_DAT].rx_queue.empty())
+    CHIChannelState& dat_channel = channels[ARM::CHI::CHANNEL_DAT];
+
+    for (unsigned i = 0; i < config.dat_per_cycle && !dat_channel.rx_empty(); i++)
     {
-        const CHIFlit dat_flit = channels[ARM::CHI::CHANNEL_DAT].rx_queue.front();
-        channels[ARM::CHI::CHANNEL_DAT].rx_queue.pop_front();
+        const CHIFlit dat_flit = std::move(dat_channel.rx_front());
+        dat_channel.pop_rx();
 
         switch (dat_flit.phase.dat_opcode)
         {
         case ARM::CHI::DAT_OPCODE_NON_COPY_BACK_WR_DATA:
         case ARM::CHI::DAT_OPCODE_NCB_WR_DATA_COMP_ACK:
+        case ARM::CHI::DAT_OPCODE_COPY_BACK_WR_DATA:
         case ARM::CHI::DAT_OPCODE_WRITE_DATA_CANCEL:
             handle_write_dat(dat_flit);
             break;
@@ -59,10 +59,13 @@ void CHIMemory::clock_posedge()
     }
 
     /* The other channels are inactive and cannot receive flits, so no need to process them. */
+
+    issue_due(rsp_pipeline, ARM::CHI::CHANNEL_RSP);
+    issue_due(dat_pipeline, ARM::CHI::CHANNEL_DAT);
 }
 
-static ARM::CHI::Phase make_response_phase(
-        const ARM::CHI::Phase& fw_phase, const ARM::CHI::RspOpcode rsp_opcode, const unsigned dbid = 0)
+static ARM::CHI::Phase make_response_phase(const ARM::CHI::Phase& fw_phase, const ARM::CHI::RspOpcode rsp_opcode,
+        const unsigned dbid = 0, const ARM::CHI::Resp resp = ARM::CHI::RESP_I)
 {
     ARM::CHI::Phase rsp_phase;
 
@@ -75,11 +78,14 @@ static ARM::CHI::Phase make_response_phase(
     rsp_phase.home_nid = fw_phase.tgt_id;
     rsp_phase.rsp_opcode = rsp_opcode;
     rsp_phase.dbid = dbid;
+    rsp_phase.resp = resp;
 
     return rsp_phase;
 }
 
-static ARM::CHI::Phase make_read_data_phase(const ARM::CHI::Phase& fw_phase, const ARM::CHI::DatOpcode dat_opcode)
+static ARM::CHI::Phase make_read_data_phase(
+        const ARM::CHI::Phase& fw_phase, const ARM::CHI::DatOpcode dat_opcode, const unsigned dbid,
+        const ARM::CHI::Resp resp)
 {
     ARM::CHI::Phase dat_phase;
 
@@ -91,106 +97,520 @@ static ARM::CHI::Phase make_read_data_phase(const ARM::CHI::Phase& fw_phase, con
     dat_phase.txn_id = fw_phase.txn_id;
     dat_phase.home_nid = fw_phase.tgt_id;
     dat_phase.dat_opcode = dat_opcode;
-    dat_phase.resp = ARM::CHI::RESP_UC;
-    dat_phase.dbid = 0;
+    dat_phase.resp = resp;
+    dat_phase.dbid = dbid;
 
     return dat_phase;
 }
 
-void CHIMemory::handle_read_req(const CHIFlit& req_flit)
+static ARM::CHI::Phase make_tag_match_phase(const ARM::CHI::Phase& fw_phase)
+{
+    ARM::CHI::Phase rsp_phase;
+
+    rsp_phase.channel = ARM::CHI::CHANNEL_RSP;
+
+    rsp_phase.qos = fw_phase.qos;
+    rsp_phase.tgt_id = fw_phase.src_id;
+    rsp_phase.src_id = fw_phase.tgt_id;
+    rsp_phase.rsp_opcode = ARM::CHI::RSP_OPCODE_TAG_MATCH;
+    rsp_phase.resp = ARM::CHI::RESP_I; /* Fail */
+
+    return rsp_phase;
+}
+
+static ARM::CHI::Phase make_retry_phase(const ARM::CHI::Phase& fw_phase, const ARM::CHI::RspOpcode rsp_opcode)
+{
+    ARM::CHI::Phase rsp_phase;
+
+    rsp_phase.channel = ARM::CHI::CHANNEL_RSP;
+
+    rsp_phase.qos = fw_phase.qos;
+    rsp_phase.tgt_id = fw_phase.src_id;
+    rsp_phase.src_id = fw_phase.tgt_id;
+    rsp_phase.rsp_opcode = rsp_opcode;
+    rsp_phase.pcrd_type = 0;
+
+    /* Only a RetryAck identifies the transaction; a PCrdGrant is not tied to one. */
+    if (rsp_opcode == ARM::CHI::RSP_OPCODE_RETRY_ACK)
+        rsp_phase.txn_id = fw_phase.txn_id;
+
+    return rsp_phase;
+}
+
+static bool is_atomic(const ARM::CHI::ReqOpcode opcode)
+{
+    return opcode >= ARM::CHI::REQ_OPCODE_ATOMIC_STORE_ADD && opcode <= ARM::CHI::REQ_OPCODE_ATOMIC_COMPARE;
+}
+
+void CHIMemory::handle_req(const CHIFlit& req_flit)
+{
+    void (CHIMemory::*handler)(uint16_t);
+
+    switch (req_flit.phase.req_opcode)
+    {
+    case ARM::CHI::REQ_OPCODE_READ_NO_SNP:
+    case ARM::CHI::REQ_OPCODE_READ_ONCE:
+    case ARM::CHI::REQ_OPCODE_READ_ONCE_CLEAN_INVALID:
+    case ARM::CHI::REQ_OPCODE_READ_ONCE_MAKE_INVALID:
+    case ARM::CHI::REQ_OPCODE_READ_SHARED:
+    case ARM::CHI::REQ_OPCODE_READ_CLEAN:
+    case ARM::CHI::REQ_OPCODE_READ_NOT_SHARED_DIRTY:
+    case ARM::CHI::REQ_OPCODE_READ_UNIQUE:
+    case ARM::CHI::REQ_OPCODE_READ_PREFER_UNIQUE:
+    case ARM::CHI::REQ_OPCODE_MAKE_READ_UNIQUE:
+        handler = &CHIMemory::handle_read_req;
+        break;
+    case ARM::CHI::REQ_OPCODE_CLEAN_SHARED:
+    case ARM::CHI::REQ_OPCODE_CLEAN_SHARED_PERSIST:
+    case ARM::CHI::REQ_OPCODE_CLEAN_INVALID:
+    case ARM::CHI::REQ_OPCODE_MAKE_INVALID:
+    case ARM::CHI::REQ_OPCODE_CLEAN_UNIQUE:
+    case ARM::CHI::REQ_OPCODE_MAKE_UNIQUE:
+    case ARM::CHI::REQ_OPCODE_EVICT:
+    case ARM::CHI::REQ_OPCODE_STASH_ONCE_SHARED:
+    case ARM::CHI::REQ_OPCODE_STASH_ONCE_UNIQUE:
+    case ARM::CHI::REQ_OPCODE_WRITE_NO_SNP_ZERO:
+    case ARM::CHI::REQ_OPCODE_WRITE_UNIQUE_ZERO:
+        handler = &CHIMemory::handle_dataless_req;
+        break;
+    case ARM::CHI::REQ_OPCODE_WRITE_NO_SNP_PTL:
+    case ARM::CHI::REQ_OPCODE_WRITE_NO_SNP_FULL:
+    case ARM::CHI::REQ_OPCODE_WRITE_UNIQUE_PTL:
+    case ARM::CHI::REQ_OPCODE_WRITE_UNIQUE_FULL:
+    case ARM::CHI::REQ_OPCODE_WRITE_UNIQUE_PTL_STASH:
+    case ARM::CHI::REQ_OPCODE_WRITE_UNIQUE_FULL_STASH:
+    case ARM::CHI::REQ_OPCODE_WRITE_BACK_PTL:
+    case ARM::CHI::REQ_OPCODE_WRITE_BACK_FULL:
+    case ARM::CHI::REQ_OPCODE_WRITE_CLEAN_PTL:
+    case ARM::CHI::REQ_OPCODE_WRITE_CLEAN_FULL:
+    case ARM::CHI::REQ_OPCODE_WRITE_EVICT_FULL:
+    case ARM::CHI::REQ_OPCODE_WRITE_EVICT_OR_EVICT:
+        handler = &CHIMemory::handle_write_req;
+        break;
+    case ARM::CHI::REQ_OPCODE_PREFETCH_TGT:
+        /* No response is given to a PrefetchTgt. */
+        return;
+    default:
+        if (!is_atomic(req_flit.phase.req_opcode))
+        {
+            SC_REPORT_ERROR(name(), "unexpected request opcode received");
+            return;
+        }
+        handler = &CHIMemory::handle_atomic_req;
+    }
+
+    uint16_t dbid;
+    if (allocate_tracker(req_flit, dbid))
+        (this->*handler)(dbid);
+}
+
+void CHIMemory::handle_read_req(const uint16_t dbid)
 {
-    static_assert(MEMORY_SIZE % CHI_CACHE_LINE_SIZE_BYTES == 0, "");
+    Tracker& tracker = trackers[dbid];
+    const ARM::CHI::Phase& req_phase = tracker.req_phase;
 
-    if (req_flit.phase.order != ARM::CHI::ORDER_NO_ORDER)
+    /* Ordered reads get a ReadReceipt, which their CompData is held back behind in issue_due. */
+    if (req_phase.order != ARM::CHI::ORDER_NO_ORDER)
     {
-        channels[ARM::CHI::CHANNEL_RSP].tx_queue.emplace_back(
-                req_flit.payload, make_response_phase(req_flit.phase, ARM::CHI::RSP_OPCODE_READ_RECEIPT));
+        schedule(rsp_pipeline, config.response_latency, tracker.payload,
+                make_response_phase(req_phase, ARM::CHI::RSP_OPCODE_READ_RECEIPT), dbid);
+        tracker.receipt_after = ~uint64_t(0);
     }
 
     /* Fill all the response data in one go.  We don't need to be precise and can fill in the whole "cache line".  The
      * requester will pick out the bytes it needs later. */
-    memcpy(req_flit.payload.data,
-            mem_data + (req_flit.payload.address & CHI_CACHE_LINE_ADDRESS_MASK) % MEMORY_SIZE,
+    memory.read(tracker.payload->address & CHI_CACHE_LINE_ADDRESS_MASK, tracker.payload->get_data(),
             CHI_CACHE_LINE_SIZE_BYTES);
 
+    /* With no other caches to snoop, ReadOnce* leave the requester without a copy and the rest get it unique. */
+    ARM::CHI::Resp resp = ARM::CHI::RESP_UC;
+
+    switch (req_phase.req_opcode)
+    {
+    case ARM::CHI::REQ_OPCODE_READ_ONCE:
+    case ARM::CHI::REQ_OPCODE_READ_ONCE_CLEAN_INVALID:
+    case ARM::CHI::REQ_OPCODE_READ_ONCE_MAKE_INVALID:
+        resp = ARM::CHI::RESP_I;
+        break;
+    default:
+        break;
+    }
+
     /* Generate and queue read data beats.  These do need to be precise. */
-    ARM::CHI::Phase dat_phase = make_read_data_phase(req_flit.phase, ARM::CHI::DAT_OPCODE_COMP_DATA);
+    ARM::CHI::Phase dat_phase = make_read_data_phase(req_phase, ARM::CHI::DAT_OPCODE_COMP_DATA, dbid, resp);
+    const ARM::CHI::DataIdRange data_ids = ARM::CHI::transaction_data_ids(*tracker.payload, data_width_bytes);
 
-    for (auto data_id : transaction_data_ids(req_flit.payload, data_width_bytes))
+    for (auto data_id : data_ids)
     {
         dat_phase.data_id = data_id;
-        channels[ARM::CHI::CHANNEL_DAT].tx_queue.emplace_back(req_flit.payload, dat_phase);
+        schedule(dat_pipeline, config.read_latency, tracker.payload, dat_phase, dbid);
     }
+
+    tracker.data_in_flight = data_ids.size();
+    tracker.comp_ack_pending = req_phase.exp_comp_ack;
 }
 
-static ARM::CHI::Phase make_tag_match_phase(const ARM::CHI::Phase& fw_phase)
+void CHIMemory::handle_dataless_req(const uint16_t dbid)
 {
-    ARM::CHI::Phase rsp_phase;
+    Tracker& tracker = trackers[dbid];
+    const ARM::CHI::Phase& req_phase = tracker.req_phase;
 
-    rsp_phase.channel = ARM::CHI::CHANNEL_RSP;
+    ARM::CHI::Resp resp = ARM::CHI::RESP_I;
 
-    rsp_phase.qos = fw_phase.qos;
-    rsp_phase.tgt_id = fw_phase.src_id;
-    rsp_phase.src_id = fw_phase.tgt_id;
-    rsp_phase.rsp_opcode = ARM::CHI::RSP_OPCODE_TAG_MATCH;
-    rsp_phase.resp = ARM::CHI::RESP_I; /* Fail */
+    switch (req_phase.req_opcode)
+    {
+    case ARM::CHI::REQ_OPCODE_CLEAN_UNIQUE:
+    case ARM::CHI::REQ_OPCODE_MAKE_UNIQUE:
+        resp = ARM::CHI::RESP_UC;
+        break;
+    case ARM::CHI::REQ_OPCODE_WRITE_NO_SNP_ZERO:
+    case ARM::CHI::REQ_OPCODE_WRITE_UNIQUE_ZERO:
+    {
+        uint8_t* const cache_line =
+                memory.get_span(tracker.payload->address & CHI_CACHE_LINE_ADDRESS_MASK, CHI_CACHE_LINE_SIZE_BYTES);
+        const uint64_t be = ARM::CHI::transaction_valid_bytes_mask(*tracker.payload);
 
-    return rsp_phase;
+        for (unsigned i = 0; i < CHI_CACHE_LINE_SIZE_BYTES; i++)
+        {
+            if ((be >> i & 1) != 0)
+                cache_line[i] = 0;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+
+    /* Write*Zero and CMOs have nothing to wait for before completing. */
+    schedule(rsp_pipeline, config.response_latency, tracker.payload,
+            make_response_phase(req_phase, ARM::CHI::RSP_OPCODE_COMP, dbid, resp));
+
+    tracker.comp_ack_pending = req_phase.exp_comp_ack;
+    try_release(dbid);
 }
 
-void CHIMemory::handle_write_req(const CHIFlit& req_flit)
+void CHIMemory::handle_write_req(const uint16_t dbid)
 {
-    channels[ARM::CHI::CHANNEL_RSP].tx_queue.emplace_back(
-            req_flit.payload,
-            make_response_phase(req_flit.phase, ARM::CHI::RSP_OPCODE_DBID_RESP, allocate_dbid_for_write(req_flit)));
+    Tracker& tracker = trackers[dbid];
+    const ARM::CHI::Phase& req_phase = tracker.req_phase;
+
+    ARM::CHI::RspOpcode rsp_opcode = ARM::CHI::RSP_OPCODE_DBID_RESP;
+
+    switch (req_phase.req_opcode)
+    {
+    case ARM::CHI::REQ_OPCODE_WRITE_BACK_PTL:
+    case ARM::CHI::REQ_OPCODE_WRITE_BACK_FULL:
+    case ARM::CHI::REQ_OPCODE_WRITE_CLEAN_PTL:
+    case ARM::CHI::REQ_OPCODE_WRITE_CLEAN_FULL:
+    case ARM::CHI::REQ_OPCODE_WRITE_EVICT_FULL:
+    case ARM::CHI::REQ_OPCODE_WRITE_EVICT_OR_EVICT:
+        /* Copy backs are complete as soon as they are accepted. */
+        rsp_opcode = ARM::CHI::RSP_OPCODE_COMP_DBID_RESP;
+        break;
+    default:
+        break;
+    }
 
-    if (req_flit.phase.tag_op == ARM::CHI::TAG_OP_MATCH)
-        channels[ARM::CHI::CHANNEL_RSP].tx_queue.emplace_back(req_flit.payload, make_tag_match_phase(req_flit.phase));
+    schedule(rsp_pipeline, config.response_latency, tracker.payload,
+            make_response_phase(req_phase, rsp_opcode, dbid));
+
+    if (req_phase.tag_op == ARM::CHI::TAG_OP_MATCH)
+        schedule(rsp_pipeline, config.response_latency, tracker.payload, make_tag_match_phase(req_phase));
 
     /* Now we wait for write data beats to accumulate separately before committing the write. */
+    tracker.data_remaining = ARM::CHI::transaction_data_ids(*tracker.payload, data_width_bytes).size();
+    tracker.comp_ack_pending = req_phase.exp_comp_ack;
+}
+
+void CHIMemory::handle_atomic_req(const uint16_t dbid)
+{
+    Tracker& tracker = trackers[dbid];
+
+    schedule(rsp_pipeline, config.response_latency, tracker.payload,
+            make_response_phase(tracker.req_phase, ARM::CHI::RSP_OPCODE_DBID_RESP, dbid));
+
+    tracker.data_remaining = ARM::CHI::transaction_data_ids(*tracker.payload, data_width_bytes).size();
+}
+
+bool CHIMemory::allocate_tracker(const CHIFlit& req_flit, uint16_t& dbid)
+{
+    if (req_flit.phase.allow_retry)
+    {
+        /* Free trackers beyond those reserved for P-Credit holders are first come, first served. */
+        if (free_dbids.size() <= dbids_reserved)
+        {
+            schedule(rsp_pipeline, config.response_latency, req_flit.payload,
+                    make_retry_phase(req_flit.phase, ARM::CHI::RSP_OPCODE_RETRY_ACK));
+            pcrd_waiting.push_back(req_flit);
+            return false;
+        }
+    }
+    else if (dbids_reserved > 0)
+    {
+        /* A retried request spending its P-Credit. */
+        dbids_reserved--;
+    }
+    else if (free_dbids.empty())
+    {
+        SC_REPORT_ERROR(name(), "request without P-Credit received with no tracker free");
+        return false;
+    }
+
+    dbid = free_dbids.back();
+    free_dbids.pop_back();
+
+    Tracker& tracker = trackers[dbid];
+    tracker.in_use = true;
+    tracker.payload = req_flit.payload;
+    tracker.req_phase = req_flit.phase;
+    tracker.data_remaining = 0;
+    tracker.data_in_flight = 0;
+    tracker.receipt_after = 0;
+    tracker.comp_ack_pending = false;
+
+    return true;
 }
 
-uint16_t CHIMemory::allocate_dbid_for_write(const CHIFlit& req_flit)
+void CHIMemory::try_release(const uint16_t dbid)
 {
-    auto it = std::find(write_data_beats_remaining.begin(), write_data_beats_remaining.end(), 0);
+    Tracker& tracker = trackers[dbid];
 
-    if (it == write_data_beats_remaining.end())
-        it = write_data_beats_remaining.insert(it, 0);
+    if (tracker.data_remaining != 0 || tracker.data_in_flight != 0 || tracker.comp_ack_pending)
+        return;
 
-    const unsigned size_bytes = 1 << req_flit.payload.size;
-    const unsigned beat_count = size_bytes <= data_width_bytes ? 1 : data_width_bytes / size_bytes;
+    tracker.in_use = false;
+    tracker.payload.reset();
+    free_dbids.push_back(dbid);
 
-    *it = beat_count;
+    /* Hand the tracker to the oldest retried requester. */
+    if (!pcrd_waiting.empty())
+    {
+        const CHIFlit retried = std::move(pcrd_waiting.front());
+        pcrd_waiting.pop_front();
 
-    return it - write_data_beats_remaining.begin();
+        schedule(rsp_pipeline, config.response_latency, retried.payload,
+                make_retry_phase(retried.phase, ARM::CHI::RSP_OPCODE_PCRD_GRANT));
+        dbids_reserved++;
+    }
+}
+
+void CHIMemory::handle_comp_ack(const uint16_t dbid)
+{
+    if (dbid >= trackers.size() || !trackers[dbid].comp_ack_pending)
+    {
+        SC_REPORT_ERROR(name(), "CompAck with invalid DBID received");
+        return;
+    }
+
+    trackers[dbid].comp_ack_pending = false;
+    try_release(dbid);
 }
 
 void CHIMemory::handle_write_dat(const CHIFlit& dat_flit)
 {
-    if (dat_flit.phase.dbid >= write_data_beats_remaining.size())
+    /* Write data carries the DBID it was given as its TxnID. */
+    const uint16_t dbid = dat_flit.phase.txn_id;
+
+    if (dbid >= trackers.size() || trackers[dbid].data_remaining == 0)
+    {
         SC_REPORT_ERROR(name(), "write data with invalid DBID received");
+        return;
+    }
 
-    uint8_t& data_beats_remaining = write_data_beats_remaining[dat_flit.phase.dbid];
+    Tracker& tracker = trackers[dbid];
 
-    data_beats_remaining--;
+    if (dat_flit.phase.dat_opcode == ARM::CHI::DAT_OPCODE_NCB_WR_DATA_COMP_ACK)
+        tracker.comp_ack_pending = false;
 
-    if (data_beats_remaining == 0)
+    tracker.data_remaining--;
+
+    if (tracker.data_remaining == 0)
     {
         /* All write data has been received, we can now commit the write. */
+        if (is_atomic(tracker.req_phase.req_opcode))
+            complete_atomic(dbid);
+        else
+            complete_write(dbid);
+
+        try_release(dbid);
+    }
+}
 
-        static_assert(MEMORY_SIZE % CHI_CACHE_LINE_SIZE_BYTES == 0, "");
+void CHIMemory::complete_write(const uint16_t dbid)
+{
+    Tracker& tracker = trackers[dbid];
 
-        const uint64_t be = dat_flit.payload.byte_enable & transaction_valid_bytes_mask(dat_flit.payload);
-        uint8_t* const cache_line = mem_data + (dat_flit.payload.address & CHI_CACHE_LINE_ADDRESS_MASK) % MEMORY_SIZE;
+    const uint64_t be = tracker.payload->byte_enable & ARM::CHI::transaction_valid_bytes_mask(*tracker.payload);
+    uint8_t* const cache_line =
+            memory.get_span(tracker.payload->address & CHI_CACHE_LINE_ADDRESS_MASK, CHI_CACHE_LINE_SIZE_BYTES);
 
-        for (unsigned i = 0; i < CHI_CACHE_LINE_SIZE_BYTES; i++)
+    for (unsigned i = 0; i < CHI_CACHE_LINE_SIZE_BYTES; i++)
+    {
+        if ((be >> i & 1) != 0)
+            cache_line[i] = tracker.payload->data[i];
+    }
+
+    switch (tracker.req_phase.req_opcode)
+    {
+    case ARM::CHI::REQ_OPCODE_WRITE_NO_SNP_PTL:
+    case ARM::CHI::REQ_OPCODE_WRITE_NO_SNP_FULL:
+    case ARM::CHI::REQ_OPCODE_WRITE_UNIQUE_PTL:
+    case ARM::CHI::REQ_OPCODE_WRITE_UNIQUE_FULL:
+    case ARM::CHI::REQ_OPCODE_WRITE_UNIQUE_PTL_STASH:
+    case ARM::CHI::REQ_OPCODE_WRITE_UNIQUE_FULL_STASH:
+        schedule(rsp_pipeline, config.response_latency, tracker.payload,
+                make_response_phase(tracker.req_phase, ARM::CHI::RSP_OPCODE_COMP, dbid));
+        break;
+    default:
+        /* Copy backs were completed by their CompDBIDResp. */
+        break;
+    }
+}
+
+/* Read or write an atomic operand of up to 8 bytes in the given endianness. */
+static uint64_t load_operand(const uint8_t* data, const unsigned bytes, const bool big_endian)
+{
+    uint64_t value = 0;
+
+    for (unsigned i = 0; i < bytes; i++)
+        value |= uint64_t(data[big_endian ? bytes - 1 - i : i]) << (8 * i);
+
+    return value;
+}
+
+static void store_operand(uint8_t* data, const unsigned bytes, const bool big_endian, const uint64_t value)
+{
+    for (unsigned i = 0; i < bytes; i++)
+        data[big_endian ? bytes - 1 - i : i] = uint8_t(value >> (8 * i));
+}
+
+static uint64_t atomic_operation(const unsigned op, const uint64_t old_value, const uint64_t operand,
+        const unsigned bytes)
+{
+    /* Sign extend for the signed comparisons. */
+    const unsigned shift = 64 - 8 * bytes;
+    const int64_t old_signed = int64_t(old_value << shift) >> shift;
+    const int64_t operand_signed = int64_t(operand << shift) >> shift;
+
+    switch (op)
+    {
+    case 0: /* ADD */
+        return old_value + operand;
+    case 1: /* CLR */
+        return old_value & ~operand;
+    case 2: /* EOR */
+        return old_value ^ operand;
+    case 3: /* SET */
+        return old_value | operand;
+    case 4: /* SMAX */
+        return old_signed > operand_signed ? old_value : operand;
+    case 5: /* SMIN */
+        return old_signed < operand_signed ? old_value : operand;
+    case 6: /* UMAX */
+        return old_value > operand ? old_value : operand;
+    default: /* UMIN */
+        return old_value < operand ? old_value : operand;
+    }
+}
+
+void CHIMemory::complete_atomic(const uint16_t dbid)
+{
+    Tracker& tracker = trackers[dbid];
+    ARM::CHI::Payload& payload = *tracker.payload;
+    const ARM::CHI::ReqOpcode opcode = tracker.req_phase.req_opcode;
+
+    uint8_t* const cache_line = memory.get_span(payload.address & CHI_CACHE_LINE_ADDRESS_MASK, CHI_CACHE_LINE_SIZE_BYTES);
+
+    /* AtomicCompare's outbound data is twice the size of the value it operates on. */
+    const bool compare = opcode == ARM::CHI::REQ_OPCODE_ATOMIC_COMPARE;
+    const ARM::CHI::SizeEnum size = static_cast<ARM::CHI::SizeEnum>(payload.size - (compare ? 1 : 0));
+    const unsigned bytes = 1u << size;
+    const unsigned offset = payload.address & (CHI_CACHE_LINE_SIZE_BYTES - 1) & ~(bytes - 1);
+
+    uint8_t old_value[CHI_CACHE_LINE_SIZE_BYTES / 2];
+    memcpy(old_value, cache_line + offset, bytes);
+
+    if (compare)
+    {
+        /* The compare value is in the addressed half of the outbound data, the swap value in the other. */
+        if (memcmp(old_value, payload.data + offset, bytes) == 0)
+            memcpy(cache_line + offset, payload.data + (offset ^ bytes), bytes);
+    }
+    else if (opcode == ARM::CHI::REQ_OPCODE_ATOMIC_SWAP)
+    {
+        memcpy(cache_line + offset, payload.data + offset, bytes);
+    }
+    else
+    {
+        const uint64_t old_operand = load_operand(old_value, bytes, payload.endian);
+        const uint64_t operand = load_operand(payload.data + offset, bytes, payload.endian);
+
+        store_operand(cache_line + offset, bytes, payload.endian,
+                atomic_operation(opcode & 7, old_operand, operand, bytes));
+    }
+
+    if (opcode <= ARM::CHI::REQ_OPCODE_ATOMIC_STORE_UMIN)
+    {
+        schedule(rsp_pipeline, config.response_latency, tracker.payload,
+                make_response_phase(tracker.req_phase, ARM::CHI::RSP_OPCODE_COMP, dbid));
+        return;
+    }
+
+    /* Return the original value as the inbound data. */
+    memcpy(payload.get_data() + offset, old_value, bytes);
+
+    ARM::CHI::Phase dat_phase =
+            make_read_data_phase(tracker.req_phase, ARM::CHI::DAT_OPCODE_COMP_DATA, dbid, ARM::CHI::RESP_I);
+
+    /* The tracker, and so the DBID, is kept until all of this has been sent. */
+    const ARM::CHI::DataIdRange data_ids = ARM::CHI::transaction_data_ids(payload.address, size, data_width_bytes);
+
+    for (auto data_id : data_ids)
+    {
+        dat_phase.data_id = data_id;
+        schedule(dat_pipeline, config.response_latency, tracker.payload, dat_phase, dbid);
+    }
+
+    tracker.data_in_flight = data_ids.size();
+}
+
+void CHIMemory::schedule(std::deque<Scheduled>& pipeline, const unsigned latency,
+        const ARM::CHI::PayloadRef& payload, const ARM::CHI::Phase& phase, const int tracker)
+{
+    /* Latencies are counted from the posedge the request was handled at. Keep the pipeline in order of due cycle. */
+    uint64_t due = cycle + latency;
+    if (!pipeline.empty() && pipeline.back().due > due)
+        due = pipeline.back().due;
+
+    pipeline.push_back(Scheduled{due, CHIFlit(payload, phase), tracker});
+}
+
+void CHIMemory::issue_due(std::deque<Scheduled>& pipeline, const ARM::CHI::Channel channel)
+{
+    /* A full channel, or read data whose ReadReceipt has not been sent yet, holds the rest of the pipeline back. */
+    while (!pipeline.empty() && pipeline.front().due <= cycle && !channels[channel].tx_full())
+    {
+        Scheduled& scheduled = pipeline.front();
+        const int dbid = scheduled.tracker;
+
+        if (channel == ARM::CHI::CHANNEL_DAT && dbid >= 0 && rsp_sent < trackers[dbid].receipt_after)
+            break;
+
+        channels[channel].push_tx(std::move(scheduled.flit));
+        pipeline.pop_front();
+
+        if (channel == ARM::CHI::CHANNEL_RSP)
         {
-            if ((be >> i & 1) != 0)
-                cache_line[i] = dat_flit.payload.data[i];
-        }
+            rsp_queued++;
 
-        channels[ARM::CHI::CHANNEL_RSP].tx_queue.emplace_back(
-                dat_flit.payload, make_response_phase(dat_flit.phase, ARM::CHI::RSP_OPCODE_COMP));
+            /* The ReadReceipt is sent once every RSP flit queued up to and including it has been. */
+            if (dbid >= 0)
+                trackers[dbid].receipt_after = rsp_queued;
+        }
+        else if (dbid >= 0 && --trackers[dbid].data_in_flight == 0)
+        {
+            try_release(dbid);
+        }
     }
 }
 
@@ -200,6 +620,8 @@ void CHIMemory::clock_negedge()
     for (const auto channel : {ARM::CHI::CHANNEL_REQ, ARM::CHI::CHANNEL_RSP, ARM::CHI::CHANNEL_DAT})
     {
         channels[channel].send_flits(channel, [this](ARM::CHI::Payload& payload, ARM::CHI::Phase& phase) {
+            if (phase.channel == ARM::CHI::CHANNEL_RSP && !phase.lcrd)
+                rsp_sent++;
             return target.nb_transport_bw(payload, phase);
         });
     }
@@ -213,14 +635,78 @@ tlm::tlm_sync_enum CHIMemory::nb_transport_fw(ARM::CHI::Payload& payload, ARM::C
     return tlm::TLM_ACCEPTED;
 }
 
-CHIMemory::CHIMemory(const sc_core::sc_module_name& name, const unsigned data_width_bits) :
+unsigned CHIMemory::transport_dbg(ARM::CHI::Payload& payload)
+{
+    const uint64_t line_address = payload.address & CHI_CACHE_LINE_ADDRESS_MASK;
+
+    if (!payload.debug_write)
+    {
+        memory.read(line_address, payload.get_data(), CHI_CACHE_LINE_SIZE_BYTES);
+    }
+    else
+    {
+        uint8_t* const cache_line = memory.get_span(line_address, CHI_CACHE_LINE_SIZE_BYTES);
+
+        for (unsigned i = 0; i < CHI_CACHE_LINE_SIZE_BYTES; i++)
+        {
+            if ((payload.byte_enable >> i & 1) != 0)
+                cache_line[i] = payload.data[i];
+        }
+    }
+
+    return CHI_CACHE_LINE_SIZE_BYTES;
+}
+
+bool CHIMemory::get_direct_mem_ptr(ARM::CHI::Payload& payload, tlm::tlm_dmi& dmi)
+{
+    const uint64_t base = memory.get_page_base(payload.address);
+
+    dmi.set_dmi_ptr(memory.get_page(base));
+    dmi.set_start_address(base);
+    dmi.set_end_address(base + memory.get_page_size() - 1);
+    dmi.allow_read_write();
+
+    return true;
+}
+
+void CHIMemory::map_image(uint64_t address, const char* path, bool shared)
+{
+    if (!memory.map_file(address, path, shared))
+        SC_REPORT_ERROR(name(), "cannot map image file");
+}
+
+void CHIMemory::save_snapshot(const char* path) const
+{
+    if (!memory.save_snapshot(path))
+        SC_REPORT_ERROR(name(), "cannot save snapshot");
+}
+
+void CHIMemory::restore_snapshot(const char* path)
+{
+    if (!memory.restore_snapshot(path))
+        SC_REPORT_ERROR(name(), "cannot restore snapshot");
+
+    /* Pages granted through DMI have been freed. */
+    target.invalidate_direct_mem_ptr(0, ~sc_dt::uint64(0));
+}
+
+CHIMemory::CHIMemory(const sc_core::sc_module_name& name, const unsigned data_width_bits,
+        const CHIMemoryConfig& config_) :
     sc_core::sc_module(name),
-    write_data_beats_remaining(10),
+    memory(config_.page_size, MEMORY_FILL, config_.huge_pages),
+    config(config_),
+    trackers(config_.max_transactions),
     data_width_bytes{data_width_bits / 8},
     target("target", *this, &CHIMemory::nb_transport_fw, ARM::TLM::PROTOCOL_CHI_E, data_width_bits),
     clock("clock")
 {
-    memset(mem_data, 0xdf, MEMORY_SIZE);
+    /* Hand out low DBIDs first. */
+    free_dbids.reserve(config.max_transactions);
+    for (unsigned dbid = config.max_transactions; dbid > 0; dbid--)
+        free_dbids.push_back(dbid - 1);
+
+    target.register_transport_dbg(&CHIMemory::transport_dbg);
+    target.register_get_direct_mem_ptr(&CHIMemory::get_direct_mem_ptr);
 
     SC_METHOD(clock_posedge);
     sensitive << clock.pos();
@@ -230,6 +716,9 @@ CHIMemory::CHIMemory(const sc_core::sc_module_name& name, const unsigned data_wi
     sensitive << clock.neg();
     dont_initialize();
 
+    for (CHIChannelState& channel : channels)
+        channel.configure(config.link);
+
     /* We will need to issue link credits to our peer so that they can ... */
     for (const auto channel : {
                  ARM::CHI::CHANNEL_REQ, /* ... send requests (e.g. ReadNoSnp) */
@@ -237,7 +726,7 @@ CHIMemory::CHIMemory(const sc_core::sc_module_name& name, const unsigned data_wi
                  ARM::CHI::CHANNEL_DAT, /* ... send write data (e.g. NonCopyBackWrData) */
          })
     {
-        channels[channel].rx_credits_available = CHI_MAX_LINK_CREDITS;
+        channels[channel].enable_rx();
     }
 }
 
@@ -9,17 +9,32 @@
 tlm::tlm_sync_enum CHIMonitor::nb_transport_fw(ARM::CHI::Payload& payload, ARM::CHI::Phase& phase)
 {
     initiator.nb_transport_fw(payload, phase);
-    print_payload(true, payload, phase);
+    tap.print_payload(true, payload, phase);
     return tlm::TLM_ACCEPTED;
 }
 
 tlm::tlm_sync_enum CHIMonitor::nb_transport_bw(ARM::CHI::Payload& payload, ARM::CHI::Phase& phase)
 {
     target.nb_transport_bw(payload, phase);
-    print_payload(false, payload, phase);
+    tap.print_payload(false, payload, phase);
     return tlm::TLM_ACCEPTED;
 }
 
+unsigned CHIMonitor::transport_dbg(ARM::CHI::Payload& payload)
+{
+    return initiator.transport_dbg(payload);
+}
+
+bool CHIMonitor::get_direct_mem_ptr(ARM::CHI::Payload& payload, tlm::tlm_dmi& dmi)
+{
+    return initiator->get_direct_mem_ptr(payload, dmi);
+}
+
+void CHIMonitor::invalidate_direct_mem_ptr(sc_dt::uint64 start, sc_dt::uint64 end)
+{
+    target.invalidate_direct_mem_ptr(start, end);
+}
+
 template <typename T, size_t N>
 static const char* enum_value_to_string(T value, const char* const (&names)[N])
 {
@@ -261,11 +276,23 @@ static bool rsp_opcode_has_resp_err(const ARM::CHI::RspOpcode rsp_opcode)
     }
 }
 
-void CHIMonitor::print_payload(const bool fw, const ARM::CHI::Payload& payload, const ARM::CHI::Phase& phase)
+CHITap::CHITap(const std::string& name, unsigned data_width_bits) :
+    tap_name(name),
+    data_width_bytes(data_width_bits / 8)
+{}
+
+void CHITap::observe_nb_transport(const char* /* socket_name */, bool fw,
+    const ARM::CHI::Payload& payload, const ARM::CHI::Phase& phase_before,
+    tlm::tlm_sync_enum /* reply */, const ARM::CHI::Phase& /* phase_after */)
+{
+    print_payload(fw, payload, phase_before);
+}
+
+void CHITap::print_payload(const bool fw, const ARM::CHI::Payload& payload, const ARM::CHI::Phase& phase)
 {
     std::ostringstream stream;
 
-    stream << sc_core::sc_time_stamp() << ' ' << name() << ": " << channel_to_string(phase.channel);
+    stream << sc_core::sc_time_stamp() << ' ' << tap_name << ": " << channel_to_string(phase.channel);
 
     if (phase.lcrd) {
         stream << (fw ? " ---->   " : "    <----");
@@ -322,10 +349,10 @@ void CHIMonitor::print_payload(const bool fw, const ARM::CHI::Payload& payload,
             stream << ' ' << resp_err_to_string(phase.resp_err);
 
         if (print_data) {
-            const unsigned data_offset = phase.data_id * 128 / 8;
+            const unsigned data_offset = ARM::CHI::data_id_byte_offset(phase.data_id);
             const uint8_t* const beat_data = payload.data + data_offset;
 
-            const uint64_t valid_mask = transaction_valid_bytes_mask(payload) >> data_offset;
+            const uint64_t valid_mask = ARM::CHI::transaction_valid_bytes_mask(payload) >> data_offset;
             const uint64_t enable_mask = (!fw ? ~uint64_t(0) : payload.byte_enable) >> data_offset & valid_mask;
 
             stream << std::uppercase << std::hex << std::setfill('0');
@@ -351,7 +378,11 @@ void CHIMonitor::print_payload(const bool fw, const ARM::CHI::Payload& payload,
 
 CHIMonitor::CHIMonitor(const sc_core::sc_module_name& name, unsigned data_width_bits) :
     sc_core::sc_module(name),
-    data_width_bytes(data_width_bits / 8),
+    tap(this->name(), data_width_bits),
     target("target", *this, &CHIMonitor::nb_transport_fw, ARM::TLM::PROTOCOL_CHI_E, data_width_bits),
     initiator("initiator", *this, &CHIMonitor::nb_transport_bw, ARM::TLM::PROTOCOL_CHI_E, data_width_bits)
-{}
+{
+    target.register_transport_dbg(&CHIMonitor::transport_dbg);
+    target.register_get_direct_mem_ptr(&CHIMonitor::get_direct_mem_ptr);
+    initiator.register_invalidate_direct_mem_ptr(&CHIMonitor::invalidate_direct_mem_ptr);
+}
@@ -0,0 +1,50 @@
+#include "CHITraceReplay.h"
+
+void CHITraceReplay::replay_posedge()
+{
+    cycle++;
+
+    if (!pending_requests.empty() || !replay.can_issue(cycle))
+        return;
+
+    ARM::TLM::TraceRecord record;
+    const uint64_t index = replay.issue(cycle, record);
+
+    if (record.size > ARM::CHI::SIZE_64)
+    {
+        SC_REPORT_ERROR(name(), "trace record size is larger than a cache line");
+        replay.complete(index, cycle);
+        return;
+    }
+
+    add_payload(ARM::CHI::ReqOpcodeEnum(record.opcode), record.address, ARM::CHI::SizeEnum(record.size));
+    in_flight.emplace(pending_requests.back().payload.get(), index);
+}
+
+void CHITraceReplay::transaction_done(ARM::CHI::Payload& payload, const sc_core::sc_time&)
+{
+    const auto entry = in_flight.find(&payload);
+    if (entry == in_flight.end())
+    {
+        SC_REPORT_ERROR(name(), "completion for a transaction not issued");
+        return;
+    }
+
+    replay.complete(entry->second, cycle);
+    in_flight.erase(entry);
+}
+
+CHITraceReplay::CHITraceReplay(const sc_core::sc_module_name& name, const char* const path,
+        const unsigned data_width_bits, const ARM::TLM::TraceMode mode, const CHITrafficGeneratorConfig& config) :
+    CHITrafficGenerator(name, data_width_bits, config),
+    replay(mode, config.max_outstanding)
+{
+    SC_METHOD(replay_posedge);
+    sensitive << clock.pos();
+    dont_initialize();
+
+    in_flight.reserve(config.max_outstanding);
+
+    if (!replay.open(path))
+        SC_REPORT_ERROR(this->name(), "cannot open trace");
+}
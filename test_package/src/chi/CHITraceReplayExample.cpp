@@ -0,0 +1,98 @@
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <unistd.h>
+
+#include "CHITraceReplay.h"
+#include "CHIMemory.h"
+
+/* A trace file made under TMPDIR (or /tmp) and removed when the example exits. */
+struct TraceFile
+{
+    std::string path;
+
+    TraceFile()
+    {
+        const char* dir = std::getenv("TMPDIR");
+        std::string name = std::string(dir && *dir ? dir : "/tmp") + "/CHITraceReplayExample.XXXXXX";
+
+        int fd = mkstemp(&name[0]);
+        if (fd >= 0)
+        {
+            close(fd);
+            path = name;
+        }
+    }
+
+    ~TraceFile()
+    {
+        if (!path.empty())
+            std::remove(path.c_str());
+    }
+};
+
+/* Write a trace of a cache line request every 2 cycles, each read of a line depending on the write to it. */
+static bool write_trace(const std::string& trace_path)
+{
+    ARM::TLM::TraceWriter writer;
+    if (trace_path.empty() || !writer.open(trace_path.c_str()))
+    {
+        std::cerr << "cannot write trace " << trace_path << std::endl;
+        return false;
+    }
+
+    for (unsigned i = 0; i < 512; i++)
+    {
+        ARM::TLM::TraceRecord record = ARM::TLM::TraceRecord();
+
+        record.time = i * 2;
+        record.address = 0x00010000 + (i / 2) * 64;
+        record.dependency = i % 2;
+        record.opcode = i % 2 ? ARM::CHI::REQ_OPCODE_READ_NO_SNP : ARM::CHI::REQ_OPCODE_WRITE_NO_SNP_FULL;
+        record.size = ARM::CHI::SIZE_64;
+
+        writer.write(record);
+    }
+
+    return writer.close();
+}
+
+int sc_main(int, char**)
+{
+    static const unsigned data_width_bits = 256;
+
+    sc_core::sc_clock clk("clk", 2, sc_core::SC_NS, 0.5);
+
+    TraceFile trace;
+    if (!write_trace(trace.path))
+        return 1;
+
+    /* Replay the same trace against a memory in each mode. */
+    CHITrafficGeneratorConfig config;
+    config.max_outstanding = 16;
+
+    CHITraceReplay timed("timed", trace.path.c_str(), data_width_bits, ARM::TLM::TRACE_MODE_ISSUE_TIME, config);
+    CHITraceReplay dependent("dependent", trace.path.c_str(), data_width_bits, ARM::TLM::TRACE_MODE_DEPENDENCY, config);
+    CHIMemory timed_mem("timed_mem", data_width_bits);
+    CHIMemory dependent_mem("dependent_mem", data_width_bits);
+
+    timed.clock.bind(clk);
+    dependent.clock.bind(clk);
+    timed_mem.clock.bind(clk);
+    dependent_mem.clock.bind(clk);
+
+    timed.initiator.bind(timed_mem.target);
+    dependent.initiator.bind(dependent_mem.target);
+
+    while (!timed.is_done() || !dependent.is_done())
+        sc_core::sc_start(1000, sc_core::SC_NS);
+
+    timed.get_replay().print_summary(std::cout, timed.name());
+    dependent.get_replay().print_summary(std::cout, dependent.name());
+
+    ARM::CHI::Payload::debug_payload_pool(std::cout);
+
+    return 0;
+}
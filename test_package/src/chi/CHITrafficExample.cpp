@@ -18,6 +18,11 @@ void add_payloads_to_tg(CHITrafficGenerator& tg)
     tg.add_payload(ARM::CHI::REQ_OPCODE_WRITE_NO_SNP_PTL, 0x00002000, ARM::CHI::SIZE_32);
     tg.add_payload(ARM::CHI::REQ_OPCODE_READ_NO_SNP,  0x00006000, ARM::CHI::SIZE_64);
     tg.add_payload(ARM::CHI::REQ_OPCODE_WRITE_NO_SNP_PTL, 0x00001000, ARM::CHI::SIZE_64);
+
+    /* Coherent requests, completed with a CompAck, and a copy back. */
+    tg.add_payload(ARM::CHI::REQ_OPCODE_READ_SHARED,  0x00007000, ARM::CHI::SIZE_64);
+    tg.add_payload(ARM::CHI::REQ_OPCODE_CLEAN_UNIQUE, 0x00007000, ARM::CHI::SIZE_64);
+    tg.add_payload(ARM::CHI::REQ_OPCODE_WRITE_BACK_FULL, 0x00007000, ARM::CHI::SIZE_64);
 }
 
 int sc_main(int, char**)
@@ -40,6 +45,8 @@ int sc_main(int, char**)
 
     sc_core::sc_start(2000, sc_core::SC_NS);
 
+    tg.print_latency(std::cout);
+
     ARM::CHI::Payload::debug_payload_pool(std::cout);
 
     return 0;
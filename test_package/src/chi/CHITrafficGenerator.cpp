@@ -1,49 +1,209 @@
 #include <cstring>
+#include <utility>
 
 #include "CHITrafficGenerator.h"
 
-void CHITrafficGenerator::clock_posedge()
+enum RequestKind
+{
+    REQUEST_READ,
+    REQUEST_DATALESS,
+    REQUEST_WRITE,
+    REQUEST_UNSUPPORTED
+};
+
+static RequestKind request_kind(const ARM::CHI::ReqOpcode req_opcode)
+{
+    switch (req_opcode)
+    {
+    case ARM::CHI::REQ_OPCODE_READ_NO_SNP:
+    case ARM::CHI::REQ_OPCODE_READ_ONCE:
+    case ARM::CHI::REQ_OPCODE_READ_ONCE_CLEAN_INVALID:
+    case ARM::CHI::REQ_OPCODE_READ_ONCE_MAKE_INVALID:
+    case ARM::CHI::REQ_OPCODE_READ_SHARED:
+    case ARM::CHI::REQ_OPCODE_READ_CLEAN:
+    case ARM::CHI::REQ_OPCODE_READ_NOT_SHARED_DIRTY:
+    case ARM::CHI::REQ_OPCODE_READ_UNIQUE:
+    case ARM::CHI::REQ_OPCODE_READ_PREFER_UNIQUE:
+    case ARM::CHI::REQ_OPCODE_MAKE_READ_UNIQUE:
+        return REQUEST_READ;
+    case ARM::CHI::REQ_OPCODE_CLEAN_SHARED:
+    case ARM::CHI::REQ_OPCODE_CLEAN_SHARED_PERSIST:
+    case ARM::CHI::REQ_OPCODE_CLEAN_INVALID:
+    case ARM::CHI::REQ_OPCODE_MAKE_INVALID:
+    case ARM::CHI::REQ_OPCODE_CLEAN_UNIQUE:
+    case ARM::CHI::REQ_OPCODE_MAKE_UNIQUE:
+    case ARM::CHI::REQ_OPCODE_EVICT:
+    case ARM::CHI::REQ_OPCODE_WRITE_NO_SNP_ZERO:
+    case ARM::CHI::REQ_OPCODE_WRITE_UNIQUE_ZERO:
+        return REQUEST_DATALESS;
+    case ARM::CHI::REQ_OPCODE_WRITE_NO_SNP_PTL:
+    case ARM::CHI::REQ_OPCODE_WRITE_NO_SNP_FULL:
+    case ARM::CHI::REQ_OPCODE_WRITE_UNIQUE_PTL:
+    case ARM::CHI::REQ_OPCODE_WRITE_UNIQUE_FULL:
+    case ARM::CHI::REQ_OPCODE_WRITE_BACK_PTL:
+    case ARM::CHI::REQ_OPCODE_WRITE_BACK_FULL:
+    case ARM::CHI::REQ_OPCODE_WRITE_CLEAN_PTL:
+    case ARM::CHI::REQ_OPCODE_WRITE_CLEAN_FULL:
+    case ARM::CHI::REQ_OPCODE_WRITE_EVICT_FULL:
+        return REQUEST_WRITE;
+    default:
+        return REQUEST_UNSUPPORTED;
+    }
+}
+
+/* Requests which leave the requester holding the line must be acknowledged with a CompAck. */
+static bool expects_comp_ack(const ARM::CHI::ReqOpcode req_opcode)
 {
-    if (!channels[ARM::CHI::CHANNEL_RSP].rx_queue.empty())
+    switch (req_opcode)
     {
-        const CHIFlit rsp_flit = channels[ARM::CHI::CHANNEL_RSP].rx_queue.front();
-        channels[ARM::CHI::CHANNEL_RSP].rx_queue.pop_front();
+    case ARM::CHI::REQ_OPCODE_READ_SHARED:
+    case ARM::CHI::REQ_OPCODE_READ_CLEAN:
+    case ARM::CHI::REQ_OPCODE_READ_NOT_SHARED_DIRTY:
+    case ARM::CHI::REQ_OPCODE_READ_UNIQUE:
+    case ARM::CHI::REQ_OPCODE_READ_PREFER_UNIQUE:
+    case ARM::CHI::REQ_OPCODE_MAKE_READ_UNIQUE:
+    case ARM::CHI::REQ_OPCODE_CLEAN_UNIQUE:
+    case ARM::CHI::REQ_OPCODE_MAKE_UNIQUE:
+        return true;
+    default:
+        return false;
+    }
+}
 
-        switch (rsp_flit.phase.rsp_opcode)
+void CHITrafficGenerator::clock_posedge()
+{
+    const unsigned line_beats = CHI_CACHE_LINE_SIZE_BYTES / data_width_bytes;
+
+    for (unsigned i = 0; i < config.link.flits_per_cycle; i++)
+    {
+        /* A DBIDResp queues a line's worth of write data and a completion may queue a CompAck, so only take a
+         * response when there is room for them. */
+        if (channels[ARM::CHI::CHANNEL_RSP].rx_empty() ||
+            channels[ARM::CHI::CHANNEL_DAT].tx_space() < line_beats || channels[ARM::CHI::CHANNEL_RSP].tx_full())
         {
-        case ARM::CHI::RSP_OPCODE_COMP_DBID_RESP:
-        case ARM::CHI::RSP_OPCODE_DBID_RESP:
-        case ARM::CHI::RSP_OPCODE_DBID_RESP_ORD:
-            handle_dbid_resp(rsp_flit);
             break;
-        case ARM::CHI::RSP_OPCODE_COMP:
-            /* ignore a separate Comp */
-            break;
-        default:
-            SC_REPORT_ERROR(name(), "unexpected response opcode received");
         }
+
+        const CHIFlit rsp_flit = std::move(channels[ARM::CHI::CHANNEL_RSP].rx_front());
+        channels[ARM::CHI::CHANNEL_RSP].pop_rx();
+
+        handle_rsp(rsp_flit);
     }
 
-    if (!channels[ARM::CHI::CHANNEL_DAT].rx_queue.empty())
+    for (unsigned i = 0; i < config.link.flits_per_cycle; i++)
     {
-        const CHIFlit dat_flit = channels[ARM::CHI::CHANNEL_DAT].rx_queue.front();
-        channels[ARM::CHI::CHANNEL_DAT].rx_queue.pop_front();
+        if (channels[ARM::CHI::CHANNEL_DAT].rx_empty() || channels[ARM::CHI::CHANNEL_RSP].tx_full())
+            break;
+
+        const CHIFlit dat_flit = std::move(channels[ARM::CHI::CHANNEL_DAT].rx_front());
+        channels[ARM::CHI::CHANNEL_DAT].pop_rx();
 
-        switch (dat_flit.phase.dat_opcode)
+        handle_dat(dat_flit);
+    }
+
+    /* The other channels are inactive and cannot receive flits, so no need to process them. */
+}
+
+CHITrafficGenerator::Transaction* CHITrafficGenerator::find_transaction(const CHIFlit& flit)
+{
+    if (flit.phase.txn_id >= transactions.size() || !transactions[flit.phase.txn_id].in_use)
+    {
+        SC_REPORT_ERROR(name(), "response with invalid TxnID received");
+        return nullptr;
+    }
+
+    return &transactions[flit.phase.txn_id];
+}
+
+void CHITrafficGenerator::handle_rsp(const CHIFlit& rsp_flit)
+{
+    /* A PCrdGrant is not tied to a transaction and a ReadReceipt needs no action. */
+    switch (rsp_flit.phase.rsp_opcode)
+    {
+    case ARM::CHI::RSP_OPCODE_PCRD_GRANT:
+        pcrd_grants[rsp_flit.phase.pcrd_type]++;
+        return;
+    case ARM::CHI::RSP_OPCODE_READ_RECEIPT:
+        return;
+    default:
+        break;
+    }
+
+    Transaction* const trans = find_transaction(rsp_flit);
+    if (!trans)
+        return;
+
+    switch (rsp_flit.phase.rsp_opcode)
+    {
+    case ARM::CHI::RSP_OPCODE_RETRY_ACK:
+        /* Resend once a P-Credit of the given type is granted, this time without allowing a retry. */
+        trans->req_phase.allow_retry = false;
+        trans->req_phase.pcrd_type = rsp_flit.phase.pcrd_type;
+        retry_waiting.push_back(rsp_flit.phase.txn_id);
+        return;
+    case ARM::CHI::RSP_OPCODE_COMP_DBID_RESP:
+        trans->comp_pending = false;
+        /* Fall through */
+    case ARM::CHI::RSP_OPCODE_DBID_RESP:
+    case ARM::CHI::RSP_OPCODE_DBID_RESP_ORD:
+        if (!trans->dbid_pending)
         {
-        case ARM::CHI::DAT_OPCODE_COMP_DATA:
-        case ARM::CHI::DAT_OPCODE_DATA_SEP_RESP:
-            /* ignore returned read data */
-            break;
-        default:
-            SC_REPORT_ERROR(name(), "unexpected read data opcode received");
+            SC_REPORT_ERROR(name(), "unexpected DBIDResp received");
+            return;
         }
+        handle_dbid_resp(rsp_flit);
+        trans->dbid_pending = false;
+        break;
+    case ARM::CHI::RSP_OPCODE_COMP:
+    case ARM::CHI::RSP_OPCODE_RESP_SEP_DATA:
+        trans->comp_pending = false;
+        break;
+    default:
+        SC_REPORT_ERROR(name(), "unexpected response opcode received");
+        return;
     }
 
-    /* The other channels are inactive and cannot receive flits, so no need to process them. */
+    trans->home_nid = rsp_flit.phase.src_id;
+    trans->dbid = rsp_flit.phase.dbid;
+
+    try_complete(rsp_flit.phase.txn_id);
+}
+
+void CHITrafficGenerator::handle_dat(const CHIFlit& dat_flit)
+{
+    switch (dat_flit.phase.dat_opcode)
+    {
+    case ARM::CHI::DAT_OPCODE_COMP_DATA:
+    case ARM::CHI::DAT_OPCODE_DATA_SEP_RESP:
+        break;
+    default:
+        SC_REPORT_ERROR(name(), "unexpected read data opcode received");
+        return;
+    }
+
+    Transaction* const trans = find_transaction(dat_flit);
+    if (!trans)
+        return;
+
+    if (trans->data_remaining == 0)
+    {
+        SC_REPORT_ERROR(name(), "unexpected read data received");
+        return;
+    }
+
+    /* Returned read data is otherwise ignored. */
+    trans->data_remaining--;
+    if (dat_flit.phase.dat_opcode == ARM::CHI::DAT_OPCODE_COMP_DATA)
+        trans->comp_pending = false;
+
+    trans->home_nid = dat_flit.phase.home_nid;
+    trans->dbid = dat_flit.phase.dbid;
+
+    try_complete(dat_flit.phase.txn_id);
 }
 
-static ARM::CHI::Phase make_write_data_phase(const ARM::CHI::Phase& dbid_phase, const ARM::CHI::DatOpcode dat_opcode)
+static ARM::CHI::Phase make_write_data_phase(const ARM::CHI::Phase& dbid_phase, const ARM::CHI::DatOpcode dat_opcode,
+        const ARM::CHI::Resp resp)
 {
     ARM::CHI::Phase dat_phase;
 
@@ -54,7 +214,7 @@ static ARM::CHI::Phase make_write_data_phase(const ARM::CHI::Phase& dbid_phase,
     dat_phase.src_id = dbid_phase.tgt_id;
     dat_phase.txn_id = dbid_phase.dbid;
     dat_phase.dat_opcode = dat_opcode;
-    dat_phase.resp = ARM::CHI::RESP_I;
+    dat_phase.resp = resp;
 
     return dat_phase;
 }
@@ -62,25 +222,137 @@ static ARM::CHI::Phase make_write_data_phase(const ARM::CHI::Phase& dbid_phase,
 void CHITrafficGenerator::handle_dbid_resp(const CHIFlit& dbid_flit)
 {
     /* Exemplar write data, filled with TxnID.  Data can be over filled, BE indicates which bytes are really enabled. */
-    dbid_flit.payload.byte_enable = transaction_valid_bytes_mask(dbid_flit.payload);
-    memset(dbid_flit.payload.data, dbid_flit.phase.txn_id, CHI_CACHE_LINE_SIZE_BYTES);
+    dbid_flit.payload->byte_enable = ARM::CHI::transaction_valid_bytes_mask(*dbid_flit.payload);
+    memset(dbid_flit.payload->get_data(), dbid_flit.phase.txn_id, CHI_CACHE_LINE_SIZE_BYTES);
+
+    /* Copy backs pass on the line's state: dirty, except for WriteEvictFull of a clean line. */
+    ARM::CHI::DatOpcode dat_opcode = ARM::CHI::DAT_OPCODE_COPY_BACK_WR_DATA;
+    ARM::CHI::Resp resp = ARM::CHI::RESP_UD_PD;
+
+    switch (transactions[dbid_flit.phase.txn_id].req_phase.req_opcode)
+    {
+    case ARM::CHI::REQ_OPCODE_WRITE_BACK_PTL:
+    case ARM::CHI::REQ_OPCODE_WRITE_BACK_FULL:
+    case ARM::CHI::REQ_OPCODE_WRITE_CLEAN_PTL:
+    case ARM::CHI::REQ_OPCODE_WRITE_CLEAN_FULL:
+        break;
+    case ARM::CHI::REQ_OPCODE_WRITE_EVICT_FULL:
+        resp = ARM::CHI::RESP_UC;
+        break;
+    default:
+        dat_opcode = ARM::CHI::DAT_OPCODE_NON_COPY_BACK_WR_DATA;
+        resp = ARM::CHI::RESP_I;
+    }
 
     /* Generate and queue write data beats. */
-    ARM::CHI::Phase dat_phase = make_write_data_phase(dbid_flit.phase, ARM::CHI::DAT_OPCODE_NON_COPY_BACK_WR_DATA);
+    ARM::CHI::Phase dat_phase = make_write_data_phase(dbid_flit.phase, dat_opcode, resp);
 
-    for (const auto data_id : transaction_data_ids(dbid_flit.payload, data_width_bytes))
+    for (const auto data_id : ARM::CHI::transaction_data_ids(*dbid_flit.payload, data_width_bytes))
     {
         dat_phase.data_id = data_id;
-        channels[ARM::CHI::CHANNEL_DAT].tx_queue.emplace_back(dbid_flit.payload, dat_phase);
+        channels[ARM::CHI::CHANNEL_DAT].push_tx(dbid_flit.payload, dat_phase);
+    }
+}
+
+void CHITrafficGenerator::try_complete(const uint16_t txn_id)
+{
+    Transaction& trans = transactions[txn_id];
+
+    if (trans.data_remaining != 0 || trans.dbid_pending || trans.comp_pending)
+        return;
+
+    if (trans.req_phase.exp_comp_ack)
+    {
+        ARM::CHI::Phase ack_phase;
+
+        ack_phase.channel = ARM::CHI::CHANNEL_RSP;
+        ack_phase.qos = trans.req_phase.qos;
+        ack_phase.src_id = trans.req_phase.src_id;
+        ack_phase.tgt_id = trans.home_nid;
+        ack_phase.txn_id = trans.dbid;
+        ack_phase.rsp_opcode = ARM::CHI::RSP_OPCODE_COMP_ACK;
+
+        channels[ARM::CHI::CHANNEL_RSP].push_tx(trans.payload, ack_phase);
     }
+
+    const sc_core::sc_time latency = sc_core::sc_time_stamp() - trans.issue_time;
+
+    if (completed == 0 || latency < min_latency)
+        min_latency = latency;
+    if (latency > max_latency)
+        max_latency = latency;
+    total_latency += latency;
+    completed++;
+
+    /* The TxnID may be reused as soon as the transaction is complete. */
+    const ARM::CHI::PayloadRef payload = std::move(trans.payload);
+    trans.in_use = false;
+    free_txn_ids.push_back(txn_id);
+
+    transaction_done(*payload, latency);
 }
 
 void CHITrafficGenerator::clock_negedge()
 {
+    CHIChannelState& req_channel = channels[ARM::CHI::CHANNEL_REQ];
+
+    /* Resend retried requests, oldest first, as P-Credits are granted for them. */
+    while (!retry_waiting.empty() && !req_channel.tx_full())
+    {
+        const Transaction& trans = transactions[retry_waiting.front()];
+        unsigned& grants = pcrd_grants[trans.req_phase.pcrd_type];
+
+        if (grants == 0)
+            break;
+
+        grants--;
+        req_channel.push_tx(trans.payload, trans.req_phase);
+        retry_waiting.pop_front();
+    }
+
+    /* Give queued requests a TxnID as one is free and the link has room for them. */
+    while (!pending_requests.empty() && !free_txn_ids.empty() && !req_channel.tx_full())
+    {
+        CHIFlit& req_flit = pending_requests.front();
+        const uint16_t txn_id = free_txn_ids.back();
+        free_txn_ids.pop_back();
+
+        req_flit.phase.txn_id = txn_id;
+
+        Transaction& trans = transactions[txn_id];
+        trans.in_use = true;
+        trans.payload = req_flit.payload;
+        trans.req_phase = req_flit.phase;
+        trans.data_remaining = 0;
+        trans.dbid_pending = false;
+        trans.comp_pending = true;
+        trans.home_nid = req_flit.phase.tgt_id;
+        trans.dbid = 0;
+
+        switch (request_kind(req_flit.phase.req_opcode))
+        {
+        case REQUEST_READ:
+            trans.data_remaining = ARM::CHI::transaction_data_ids(*req_flit.payload, data_width_bytes).size();
+            break;
+        case REQUEST_WRITE:
+            trans.dbid_pending = true;
+            break;
+        default:
+            break;
+        }
+
+        req_channel.push_tx(std::move(req_flit));
+        pending_requests.pop_front();
+    }
+
     /* Try to issue credits and send transactions on active channels. */
     for (const auto channel : {ARM::CHI::CHANNEL_REQ, ARM::CHI::CHANNEL_RSP, ARM::CHI::CHANNEL_DAT})
     {
         channels[channel].send_flits(channel, [this](ARM::CHI::Payload& payload, ARM::CHI::Phase& phase) {
+            /* Latency runs from the first time a request is sent; a resent request does not allow retry. */
+            if (phase.channel == ARM::CHI::CHANNEL_REQ && !phase.lcrd && phase.allow_retry)
+                transactions[phase.txn_id].issue_time = sc_core::sc_time_stamp();
+
             return initiator.nb_transport_fw(payload, phase);
         });
     }
@@ -94,8 +366,11 @@ tlm::tlm_sync_enum CHITrafficGenerator::nb_transport_bw(ARM::CHI::Payload& paylo
     return tlm::TLM_ACCEPTED;
 }
 
-CHITrafficGenerator::CHITrafficGenerator(const sc_core::sc_module_name& name, const unsigned data_width_bits) :
+CHITrafficGenerator::CHITrafficGenerator(const sc_core::sc_module_name& name, const unsigned data_width_bits,
+        const CHITrafficGeneratorConfig& config_) :
     sc_module(name),
+    config(config_),
+    transactions(config_.max_outstanding),
     data_width_bytes{data_width_bits / 8},
     initiator("initiator", *this, &CHITrafficGenerator::nb_transport_bw, ARM::TLM::PROTOCOL_CHI_E, data_width_bits),
     clock("clock")
@@ -108,33 +383,66 @@ CHITrafficGenerator::CHITrafficGenerator(const sc_core::sc_module_name& name, co
     sensitive << clock.neg();
     dont_initialize();
 
+    if (config.max_outstanding == 0 || config.max_outstanding > CHI_MAX_TXN_IDS)
+        SC_REPORT_ERROR(this->name(), "max_outstanding must be from 1 to 1024");
+
+    /* Hand out low TxnIDs first. */
+    for (unsigned txn_id = config.max_outstanding; txn_id > 0; txn_id--)
+        free_txn_ids.push_back(txn_id - 1);
+
+    for (CHIChannelState& channel : channels)
+        channel.configure(config.link);
+
     /* We will need to issue link credits to our peer so that they can ... */
     for (const auto channel : {
                  ARM::CHI::CHANNEL_RSP, /* ... send responses (e.g. DBIDResp */
                  ARM::CHI::CHANNEL_DAT, /* ... send write data (e.g. CompData) */
          })
     {
-        channels[channel].rx_credits_available = CHI_MAX_LINK_CREDITS;
+        channels[channel].enable_rx();
     }
 }
 
 void CHITrafficGenerator::add_payload(
         const ARM::CHI::ReqOpcode req_opcode, const uint64_t address, const ARM::CHI::Size size)
 {
-    ARM::CHI::Payload& req_payload = *ARM::CHI::Payload::new_payload();
+    if (request_kind(req_opcode) == REQUEST_UNSUPPORTED)
+    {
+        SC_REPORT_ERROR(name(), "can only generate read, dataless and write requests");
+        return;
+    }
+
+    /* Dataless requests never carry data so do not need a data block. */
+    ARM::CHI::PayloadRef req_payload(request_kind(req_opcode) == REQUEST_DATALESS ?
+            ARM::CHI::Payload::new_dataless_payload() : ARM::CHI::Payload::new_payload(), ARM::TLM::ADOPT_REF);
     ARM::CHI::Phase req_phase;
 
+    /* The TxnID is allocated when the request is sent. */
     req_phase.tgt_id = 2;
     req_phase.src_id = 1;
-    req_phase.txn_id = txn_id++;
     req_phase.req_opcode = req_opcode;
     req_phase.order = ARM::CHI::ORDER_NO_ORDER;
+    req_phase.exp_comp_ack = expects_comp_ack(req_opcode);
 
-    req_payload.address = address;
-    req_payload.size = size;
-    req_payload.mem_attr = ARM::CHI::MEM_ATTR_NORMAL_WB_A;
+    req_payload->address = address;
+    req_payload->size = size;
+    req_payload->mem_attr = ARM::CHI::MEM_ATTR_NORMAL_WB_A;
 
-    channels[ARM::CHI::CHANNEL_REQ].tx_queue.emplace_back(req_payload, req_phase);
+    pending_requests.emplace_back(std::move(req_payload), req_phase);
+}
 
-    req_payload.unref();
+size_t CHITrafficGenerator::get_outstanding() const
+{
+    return pending_requests.size() + transactions.size() - free_txn_ids.size();
+}
+
+sc_core::sc_time CHITrafficGenerator::get_average_latency() const
+{
+    return completed ? total_latency / double(completed) : sc_core::SC_ZERO_TIME;
+}
+
+void CHITrafficGenerator::print_latency(std::ostream& stream) const
+{
+    stream << name() << ": completed: " << completed << " latency min/mean/max: " << min_latency << '/'
+           << get_average_latency() << '/' << max_latency << '\n';
 }
@@ -0,0 +1,353 @@
+#include <cstdint>
+#include <cstring>
+
+#include <ARM/TLM/arm_chi.h>
+#include <ARM/TLM/arm_chi_flit.h>
+
+#include "TestUtilities.h"
+
+static const ARM::CHI::FlitIssue issues[] = {ARM::CHI::FLIT_ISSUE_B, ARM::CHI::FLIT_ISSUE_C, ARM::CHI::FLIT_ISSUE_D,
+    ARM::CHI::FLIT_ISSUE_E};
+
+static const unsigned data_widths[] = {128, 256, 512};
+
+/* Largest value of a field width bits wide. */
+static uint64_t max_value(unsigned width)
+{
+    return (uint64_t(1) << width) - 1;
+}
+
+/* TxnID width of each issue. */
+static unsigned txn_id_width(ARM::CHI::FlitIssue issue)
+{
+    return issue == ARM::CHI::FLIT_ISSUE_E ? 12 : issue == ARM::CHI::FLIT_ISSUE_D ? 10 : 8;
+}
+
+/* Formats with and without the optional fields, and with the narrowest and widest node IDs and addresses. */
+static ARM::CHI::FlitFormat make_format(ARM::CHI::FlitIssue issue, unsigned data_width, bool options)
+{
+    ARM::CHI::FlitFormat format(issue, options ? 11 : 7, data_width, options ? 52 : 44);
+
+    if (options)
+    {
+        format.req_rsvdc_width = 32;
+        format.dat_rsvdc_width = 32;
+        format.mpam = issue >= ARM::CHI::FLIT_ISSUE_D;
+        format.data_check = true;
+        format.poison = true;
+    }
+
+    return format;
+}
+
+static void test_req(const ARM::CHI::FlitCodec& codec)
+{
+    const ARM::CHI::FlitFormat& format = codec.get_format();
+    const unsigned txn_id_bits = txn_id_width(format.issue);
+
+    ARM::CHI::PayloadRef payload(ARM::CHI::Payload::new_payload(), ARM::TLM::ADOPT_REF);
+    payload->address = max_value(format.req_addr_width) & ~uint64_t(0x3f);
+    payload->size = ARM::CHI::SIZE_64;
+    payload->mem_attr = ARM::CHI::MEM_ATTR_NORMAL_WB_A;
+    payload->lpid = 0x15;
+    payload->ns = true;
+    payload->likely_shared = true;
+    payload->exclusive = true;
+    payload->rsvdc = 0xdeadbeef & max_value(format.req_rsvdc_width);
+    if (format.mpam)
+        payload->mpam = ARM::CHI::Mpam(1, 0x1a5, 1);
+
+    ARM::CHI::Phase phase;
+    phase.channel = ARM::CHI::CHANNEL_REQ;
+    phase.req_opcode = ARM::CHI::REQ_OPCODE_READ_SHARED;
+    phase.qos = 0xf;
+    phase.src_id = max_value(format.node_id_width);
+    phase.tgt_id = 0x45;
+    phase.txn_id = max_value(txn_id_bits);
+    phase.return_nid = 0x12;
+    phase.return_txn_id = max_value(txn_id_bits) - 1;
+    phase.allow_retry = true;
+    phase.order = ARM::CHI::ORDER_REQUEST_ORDER;
+    phase.pcrd_type = 0xa;
+    phase.snp_attr = true;
+    phase.exp_comp_ack = true;
+
+    uint64_t flit[ARM::CHI::FLIT_MAX_WORDS];
+    codec.encode(*payload, phase, flit);
+
+    ARM::CHI::PayloadRef decoded(ARM::CHI::Payload::new_payload(), ARM::TLM::ADOPT_REF);
+    ARM::CHI::Phase decoded_phase;
+    codec.decode(ARM::CHI::CHANNEL_REQ, flit, *decoded, decoded_phase);
+
+    CHECK(decoded_phase.channel == ARM::CHI::CHANNEL_REQ);
+    CHECK(decoded_phase.req_opcode == ARM::CHI::REQ_OPCODE_READ_SHARED);
+    CHECK(decoded_phase.qos == phase.qos);
+    CHECK(decoded_phase.src_id == phase.src_id);
+    CHECK(decoded_phase.tgt_id == phase.tgt_id);
+    CHECK(decoded_phase.txn_id == phase.txn_id);
+    CHECK(decoded_phase.return_nid == phase.return_nid);
+    CHECK(decoded_phase.return_txn_id == phase.return_txn_id);
+    CHECK(decoded_phase.allow_retry);
+    CHECK(decoded_phase.order == ARM::CHI::ORDER_REQUEST_ORDER);
+    CHECK(decoded_phase.pcrd_type == phase.pcrd_type);
+    CHECK(decoded_phase.snp_attr);
+    CHECK(decoded_phase.exp_comp_ack);
+
+    CHECK(decoded->address == payload->address);
+    CHECK(decoded->size == ARM::CHI::SIZE_64);
+    CHECK(decoded->mem_attr == ARM::CHI::MEM_ATTR_NORMAL_WB_A);
+    CHECK(decoded->lpid == payload->lpid);
+    CHECK(decoded->ns);
+    CHECK(decoded->likely_shared);
+    CHECK(decoded->exclusive);
+    CHECK(decoded->rsvdc == payload->rsvdc);
+    if (format.mpam)
+    {
+        CHECK(decoded->mpam.mpam_ns == 1);
+        CHECK(decoded->mpam.part_id == 0x1a5);
+        CHECK(decoded->mpam.perf_mon_group == 1);
+    }
+
+    /* The header alone gives what is needed to find the transaction a flit belongs to. */
+    ARM::CHI::Phase header;
+    codec.decode_header(ARM::CHI::CHANNEL_REQ, flit, header);
+    CHECK(header.channel == ARM::CHI::CHANNEL_REQ);
+    CHECK(header.req_opcode == ARM::CHI::REQ_OPCODE_READ_SHARED);
+    CHECK(header.txn_id == phase.txn_id);
+}
+
+static void test_rsp(const ARM::CHI::FlitCodec& codec)
+{
+    const ARM::CHI::FlitFormat& format = codec.get_format();
+    const unsigned txn_id_bits = txn_id_width(format.issue);
+
+    ARM::CHI::PayloadRef payload(ARM::CHI::Payload::new_dataless_payload(), ARM::TLM::ADOPT_REF);
+
+    ARM::CHI::Phase phase;
+    phase.channel = ARM::CHI::CHANNEL_RSP;
+    phase.rsp_opcode = ARM::CHI::RSP_OPCODE_COMP_DBID_RESP;
+    phase.qos = 0x3;
+    phase.src_id = 0x21;
+    phase.tgt_id = max_value(format.node_id_width);
+    phase.txn_id = 0x5a & max_value(txn_id_bits);
+    phase.resp_err = ARM::CHI::RESP_ERR_NDERR;
+    phase.resp = ARM::CHI::RESP_UC;
+    phase.fwd_state = ARM::CHI::RESP_SC;
+    phase.dbid = max_value(txn_id_bits);
+    phase.pcrd_type = 0x5;
+    if (format.issue >= ARM::CHI::FLIT_ISSUE_D)
+        phase.c_busy = 0x6;
+    if (format.issue >= ARM::CHI::FLIT_ISSUE_E)
+        phase.tag_op = ARM::CHI::TAG_OP_UPDATE;
+
+    uint64_t flit[ARM::CHI::FLIT_MAX_WORDS];
+    codec.encode(*payload, phase, flit);
+
+    ARM::CHI::PayloadRef decoded(ARM::CHI::Payload::new_dataless_payload(), ARM::TLM::ADOPT_REF);
+    ARM::CHI::Phase decoded_phase;
+    codec.decode(ARM::CHI::CHANNEL_RSP, flit, *decoded, decoded_phase);
+
+    CHECK(decoded_phase.channel == ARM::CHI::CHANNEL_RSP);
+    CHECK(decoded_phase.rsp_opcode == ARM::CHI::RSP_OPCODE_COMP_DBID_RESP);
+    CHECK(decoded_phase.qos == phase.qos);
+    CHECK(decoded_phase.src_id == phase.src_id);
+    CHECK(decoded_phase.tgt_id == phase.tgt_id);
+    CHECK(decoded_phase.txn_id == phase.txn_id);
+    CHECK(decoded_phase.resp_err == ARM::CHI::RESP_ERR_NDERR);
+    CHECK(decoded_phase.resp == ARM::CHI::RESP_UC);
+    CHECK(decoded_phase.fwd_state == ARM::CHI::RESP_SC);
+    CHECK(decoded_phase.dbid == phase.dbid);
+    CHECK(decoded_phase.pcrd_type == phase.pcrd_type);
+    CHECK(decoded_phase.c_busy == phase.c_busy);
+    CHECK(decoded_phase.tag_op == phase.tag_op);
+
+    /* RSP opcodes are 5 bits wide from issue D and 4 bits before: the widest opcode of each must survive. */
+    const unsigned opcode_width = format.issue >= ARM::CHI::FLIT_ISSUE_D ? 5 : 4;
+    phase.rsp_opcode = ARM::CHI::RspOpcode(max_value(opcode_width));
+    codec.encode(*payload, phase, flit);
+    codec.decode(ARM::CHI::CHANNEL_RSP, flit, *decoded, decoded_phase);
+    CHECK(decoded_phase.raw_opcode == max_value(opcode_width));
+}
+
+static void test_snp(const ARM::CHI::FlitCodec& codec)
+{
+    const ARM::CHI::FlitFormat& format = codec.get_format();
+    const unsigned txn_id_bits = txn_id_width(format.issue);
+
+    ARM::CHI::PayloadRef payload(ARM::CHI::Payload::new_payload(), ARM::TLM::ADOPT_REF);
+    payload->address = max_value(format.req_addr_width) & ~uint64_t(0x3f);
+    payload->ns = true;
+    payload->do_not_go_to_sd = true;
+    payload->ret_to_src = true;
+    if (format.mpam)
+        payload->mpam = ARM::CHI::Mpam(0, 0x0ff, 1);
+
+    ARM::CHI::Phase phase;
+    phase.channel = ARM::CHI::CHANNEL_SNP;
+    phase.snp_opcode = ARM::CHI::SNP_OPCODE_SNP_UNIQUE_FWD;
+    phase.qos = 0xc;
+    phase.src_id = max_value(format.node_id_width);
+    phase.txn_id = max_value(txn_id_bits);
+    phase.fwd_nid = 0x33;
+    phase.fwd_txn_id = 0x17;
+
+    uint64_t flit[ARM::CHI::FLIT_MAX_WORDS];
+    codec.encode(*payload, phase, flit);
+
+    ARM::CHI::PayloadRef decoded(ARM::CHI::Payload::new_payload(), ARM::TLM::ADOPT_REF);
+    ARM::CHI::Phase decoded_phase;
+    codec.decode(ARM::CHI::CHANNEL_SNP, flit, *decoded, decoded_phase);
+
+    CHECK(decoded_phase.channel == ARM::CHI::CHANNEL_SNP);
+    CHECK(decoded_phase.snp_opcode == ARM::CHI::SNP_OPCODE_SNP_UNIQUE_FWD);
+    CHECK(decoded_phase.qos == phase.qos);
+    CHECK(decoded_phase.src_id == phase.src_id);
+    CHECK(decoded_phase.txn_id == phase.txn_id);
+    CHECK(decoded_phase.fwd_nid == phase.fwd_nid);
+    CHECK(decoded_phase.fwd_txn_id == phase.fwd_txn_id);
+
+    /* Snoops address a line by its upper bits: the low 3 address bits are not carried. */
+    CHECK(decoded->address == payload->address);
+    CHECK(decoded->ns);
+    CHECK(decoded->do_not_go_to_sd);
+    CHECK(decoded->ret_to_src);
+    if (format.mpam)
+    {
+        CHECK(decoded->mpam.mpam_ns == 0);
+        CHECK(decoded->mpam.part_id == 0x0ff);
+        CHECK(decoded->mpam.perf_mon_group == 1);
+    }
+
+    payload->address |= 0x7;
+    codec.encode(*payload, phase, flit);
+    codec.decode(ARM::CHI::CHANNEL_SNP, flit, *decoded, decoded_phase);
+    CHECK(decoded->address == (payload->address & ~uint64_t(0x7)));
+}
+
+static void test_dat(const ARM::CHI::FlitCodec& codec)
+{
+    const ARM::CHI::FlitFormat& format = codec.get_format();
+    const unsigned txn_id_bits = txn_id_width(format.issue);
+    const unsigned beat_bytes = format.data_width / 8;
+    const bool has_mte = format.issue >= ARM::CHI::FLIT_ISSUE_E;
+
+    ARM::CHI::PayloadRef payload(ARM::CHI::Payload::new_payload(), ARM::TLM::ADOPT_REF);
+    payload->address = 0x12340;
+    payload->byte_enable = 0xfedcba9876543210;
+    payload->rsvdc = 0x5eed & max_value(format.dat_rsvdc_width);
+    payload->tu = 0xa;
+    for (unsigned i = 0; i < ARM::CHI::Payload::DATA_BYTES; i++)
+        payload->data[i] = uint8_t(i * 37 + 11);
+    for (unsigned i = 0; i < ARM::CHI::Payload::TAG_BYTES; i++)
+        payload->tag[i] = uint8_t(i * 5 + 3) & 0xf;
+
+    ARM::CHI::PayloadRef decoded(ARM::CHI::Payload::new_payload(), ARM::TLM::ADOPT_REF);
+    decoded->byte_enable = 0;
+    decoded->tu = 0;
+
+    /* Send each beat of the line, as the DataID of each flit selects. */
+    for (unsigned data_id = 0; data_id < 4; data_id += beat_bytes / 16)
+    {
+        ARM::CHI::Phase phase;
+        phase.channel = ARM::CHI::CHANNEL_DAT;
+        phase.dat_opcode = ARM::CHI::DAT_OPCODE_COMP_DATA;
+        phase.qos = 0x7;
+        phase.src_id = 0x0a;
+        phase.tgt_id = max_value(format.node_id_width);
+        phase.txn_id = max_value(txn_id_bits);
+        phase.home_nid = 0x2b;
+        phase.resp_err = ARM::CHI::RESP_ERR_EXOK;
+        phase.resp = ARM::CHI::RESP_SC;
+        phase.dbid = 0x44;
+        phase.data_id = data_id;
+        if (format.issue >= ARM::CHI::FLIT_ISSUE_D)
+            phase.c_busy = 0x5;
+        if (has_mte)
+            phase.tag_op = ARM::CHI::TAG_OP_TRANSFER;
+
+        uint64_t flit[ARM::CHI::FLIT_MAX_WORDS];
+        codec.encode(*payload, phase, flit);
+
+        ARM::CHI::Phase decoded_phase;
+        codec.decode(ARM::CHI::CHANNEL_DAT, flit, *decoded, decoded_phase);
+
+        CHECK(decoded_phase.channel == ARM::CHI::CHANNEL_DAT);
+        CHECK(decoded_phase.dat_opcode == ARM::CHI::DAT_OPCODE_COMP_DATA);
+        CHECK(decoded_phase.qos == phase.qos);
+        CHECK(decoded_phase.src_id == phase.src_id);
+        CHECK(decoded_phase.tgt_id == phase.tgt_id);
+        CHECK(decoded_phase.txn_id == phase.txn_id);
+        CHECK(decoded_phase.home_nid == phase.home_nid);
+        CHECK(decoded_phase.resp_err == ARM::CHI::RESP_ERR_EXOK);
+        CHECK(decoded_phase.resp == ARM::CHI::RESP_SC);
+        CHECK(decoded_phase.dbid == phase.dbid);
+        CHECK(decoded_phase.data_id == data_id);
+        CHECK(decoded_phase.c_busy == phase.c_busy);
+        CHECK(decoded_phase.tag_op == phase.tag_op);
+        CHECK(decoded->rsvdc == payload->rsvdc);
+
+        /* Only the beat carried is written. */
+        const unsigned offset = data_id * 16;
+        CHECK(std::memcmp(decoded->data + offset, payload->data + offset, beat_bytes) == 0);
+        if (offset + beat_bytes < ARM::CHI::Payload::DATA_BYTES)
+            CHECK(decoded->byte_enable >> (offset + beat_bytes) == 0);
+    }
+
+    CHECK(std::memcmp(decoded->data, payload->data, ARM::CHI::Payload::DATA_BYTES) == 0);
+    CHECK(decoded->byte_enable == payload->byte_enable);
+    if (has_mte)
+    {
+        CHECK(std::memcmp(decoded->tag, payload->tag, ARM::CHI::Payload::TAG_BYTES) == 0);
+        CHECK(decoded->tu == payload->tu);
+    }
+}
+
+static void test_format_errors()
+{
+    ARM::CHI::FlitFormat format;
+
+    /* MPAM fields only exist from issue D. */
+    format.issue = ARM::CHI::FLIT_ISSUE_C;
+    format.mpam = true;
+    CHECK_THROWS(ARM::CHI::FlitCodec codec(format));
+
+    format = ARM::CHI::FlitFormat(ARM::CHI::FLIT_ISSUE_E, 7, 64);
+    CHECK_THROWS(ARM::CHI::FlitCodec codec(format));
+
+    format = ARM::CHI::FlitFormat(ARM::CHI::FLIT_ISSUE_E, 12);
+    CHECK_THROWS(ARM::CHI::FlitCodec codec(format));
+
+    format = ARM::CHI::FlitFormat(ARM::CHI::FLIT_ISSUE_E, 7, 128, 53);
+    CHECK_THROWS(ARM::CHI::FlitCodec codec(format));
+}
+
+int sc_main(int, char**)
+{
+    for (const ARM::CHI::FlitIssue issue : issues)
+    {
+        for (const unsigned data_width : data_widths)
+        {
+            for (const bool options : {false, true})
+            {
+                const ARM::CHI::FlitCodec codec(make_format(issue, data_width, options));
+
+                for (const auto channel : {ARM::CHI::CHANNEL_REQ, ARM::CHI::CHANNEL_RSP, ARM::CHI::CHANNEL_SNP,
+                         ARM::CHI::CHANNEL_DAT})
+                {
+                    CHECK(codec.get_flit_words(channel) <= ARM::CHI::FLIT_MAX_WORDS);
+                }
+
+                test_req(codec);
+                test_rsp(codec);
+                test_snp(codec);
+                test_dat(codec);
+            }
+        }
+    }
+
+    test_format_errors();
+
+    CHECK(ARM::CHI::Payload::get_payload_pool_statistics().in_use == 0);
+
+    return 0;
+}
@@ -0,0 +1,290 @@
+#include <cstdint>
+#include <vector>
+
+#include <ARM/TLM/arm_chi.h>
+#include <ARM/TLM/arm_chi_link.h>
+
+#include "TestUtilities.h"
+
+/* What one send_flits call passed to the peer. */
+struct Cycle
+{
+    unsigned credits = 0;
+    std::vector<ARM::CHI::Phase> flits;
+};
+
+static Cycle send_cycle(ARM::CHI::LinkChannel& link, ARM::CHI::Channel channel)
+{
+    Cycle cycle;
+
+    link.send_flits(channel, [&cycle, channel](ARM::CHI::Payload&, ARM::CHI::Phase& phase) {
+        CHECK(phase.channel == channel);
+
+        if (phase.lcrd)
+            cycle.credits++;
+        else
+            cycle.flits.push_back(phase);
+
+        return tlm::TLM_ACCEPTED;
+    });
+
+    return cycle;
+}
+
+/* Give a channel credits as its peer would. */
+static void grant_credits(ARM::CHI::LinkChannel& link, ARM::CHI::Channel channel, unsigned credits)
+{
+    for (; credits > 0; credits--)
+    {
+        ARM::CHI::Phase phase;
+        phase.channel = channel;
+        phase.lcrd = true;
+
+        CHECK(link.receive_flit(*ARM::CHI::Payload::get_dummy(), phase));
+    }
+}
+
+static void push_flit(ARM::CHI::LinkChannel& link, ARM::CHI::Channel channel, uint16_t txn_id, uint8_t data_id = 0)
+{
+    ARM::CHI::Phase phase;
+    phase.channel = channel;
+    phase.txn_id = txn_id;
+    phase.data_id = data_id;
+
+    link.push_tx(ARM::CHI::PayloadRef(ARM::CHI::Payload::new_payload(), ARM::TLM::ADOPT_REF), phase);
+}
+
+static void test_credit_issue()
+{
+    ARM::CHI::LinkConfig config(2, 5);
+    ARM::CHI::LinkChannel link(config);
+
+    /* Nothing is sent before receiving is enabled. */
+    CHECK(!link.is_rx_enabled());
+    CHECK(send_cycle(link, ARM::CHI::CHANNEL_REQ).credits == 0);
+
+    /* Enabling issues the full credit depth, flits_per_cycle at a time. */
+    link.enable_rx();
+    CHECK(link.is_rx_enabled());
+    CHECK(send_cycle(link, ARM::CHI::CHANNEL_REQ).credits == 2);
+    CHECK(send_cycle(link, ARM::CHI::CHANNEL_REQ).credits == 2);
+    CHECK(send_cycle(link, ARM::CHI::CHANNEL_REQ).credits == 1);
+    CHECK(send_cycle(link, ARM::CHI::CHANNEL_REQ).credits == 0);
+
+    /* The receive queue takes exactly credit_depth flits. */
+    for (uint16_t txn_id = 0; txn_id < 5; txn_id++)
+    {
+        ARM::CHI::PayloadRef payload(ARM::CHI::Payload::new_payload(), ARM::TLM::ADOPT_REF);
+        ARM::CHI::Phase phase;
+        phase.channel = ARM::CHI::CHANNEL_REQ;
+        phase.txn_id = txn_id;
+        CHECK(link.receive_flit(*payload, phase));
+    }
+    CHECK(link.rx_size() == 5);
+
+    {
+        ARM::CHI::PayloadRef payload(ARM::CHI::Payload::new_payload(), ARM::TLM::ADOPT_REF);
+        ARM::CHI::Phase phase;
+        phase.channel = ARM::CHI::CHANNEL_REQ;
+        CHECK_THROWS(link.receive_flit(*payload, phase));
+    }
+
+    /* Consuming a flit frees its credit to be returned. */
+    CHECK(link.rx_front().phase.txn_id == 0);
+    link.pop_rx();
+    CHECK(link.rx_front().phase.txn_id == 1);
+    CHECK(send_cycle(link, ARM::CHI::CHANNEL_REQ).credits == 1);
+    CHECK(send_cycle(link, ARM::CHI::CHANNEL_REQ).credits == 0);
+
+    while (!link.rx_empty())
+        link.pop_rx();
+    CHECK(send_cycle(link, ARM::CHI::CHANNEL_REQ).credits == 2);
+    CHECK(send_cycle(link, ARM::CHI::CHANNEL_REQ).credits == 2);
+    CHECK(send_cycle(link, ARM::CHI::CHANNEL_REQ).credits == 0);
+}
+
+static void test_credit_return_batch()
+{
+    ARM::CHI::LinkConfig config(4, 8);
+    config.credit_return_batch = 3;
+    ARM::CHI::LinkChannel link(config);
+
+    link.enable_rx();
+    CHECK(send_cycle(link, ARM::CHI::CHANNEL_RSP).credits == 4);
+    CHECK(send_cycle(link, ARM::CHI::CHANNEL_RSP).credits == 4);
+    CHECK(send_cycle(link, ARM::CHI::CHANNEL_RSP).credits == 0);
+
+    for (uint16_t txn_id = 0; txn_id < 8; txn_id++)
+    {
+        ARM::CHI::Phase phase;
+        phase.channel = ARM::CHI::CHANNEL_RSP;
+        phase.txn_id = txn_id;
+        CHECK(link.receive_flit(*ARM::CHI::Payload::get_dummy(), phase));
+    }
+
+    /* Freed credits are held until a batch is ready. */
+    link.pop_rx();
+    link.pop_rx();
+    CHECK(send_cycle(link, ARM::CHI::CHANNEL_RSP).credits == 0);
+    link.pop_rx();
+    CHECK(send_cycle(link, ARM::CHI::CHANNEL_RSP).credits == 3);
+    CHECK(send_cycle(link, ARM::CHI::CHANNEL_RSP).credits == 0);
+
+    /* A batch larger than flits_per_cycle is returned over several cycles. */
+    for (unsigned i = 0; i < 5; i++)
+        link.pop_rx();
+    CHECK(link.rx_empty());
+    CHECK(send_cycle(link, ARM::CHI::CHANNEL_RSP).credits == 4);
+    CHECK(send_cycle(link, ARM::CHI::CHANNEL_RSP).credits == 1);
+    CHECK(send_cycle(link, ARM::CHI::CHANNEL_RSP).credits == 0);
+}
+
+static void test_tx_credits()
+{
+    ARM::CHI::LinkChannel link(ARM::CHI::LinkConfig(2));
+
+    for (uint16_t txn_id = 0; txn_id < 5; txn_id++)
+        push_flit(link, ARM::CHI::CHANNEL_REQ, txn_id);
+    CHECK(link.tx_size() == 5);
+    CHECK(link.tx_space() == ARM::CHI::LINK_QUEUE_DEPTH - 5);
+
+    /* Flits wait for credits. */
+    CHECK(send_cycle(link, ARM::CHI::CHANNEL_REQ).flits.empty());
+
+    /* No more than flits_per_cycle are sent in a cycle, nor more than the credits held. */
+    grant_credits(link, ARM::CHI::CHANNEL_REQ, 3);
+    Cycle cycle = send_cycle(link, ARM::CHI::CHANNEL_REQ);
+    CHECK(cycle.flits.size() == 2);
+    CHECK(cycle.flits[0].txn_id == 0 && cycle.flits[1].txn_id == 1);
+
+    cycle = send_cycle(link, ARM::CHI::CHANNEL_REQ);
+    CHECK(cycle.flits.size() == 1);
+    CHECK(cycle.flits[0].txn_id == 2);
+
+    CHECK(send_cycle(link, ARM::CHI::CHANNEL_REQ).flits.empty());
+    CHECK(link.tx_size() == 2);
+
+    grant_credits(link, ARM::CHI::CHANNEL_REQ, 4);
+    cycle = send_cycle(link, ARM::CHI::CHANNEL_REQ);
+    CHECK(cycle.flits.size() == 2);
+    CHECK(cycle.flits[0].txn_id == 3 && cycle.flits[1].txn_id == 4);
+    CHECK(link.tx_empty());
+
+    /* A channel not enabled to receive refuses flits, though it still takes credits. */
+    ARM::CHI::Phase phase;
+    phase.channel = ARM::CHI::CHANNEL_REQ;
+    CHECK(!link.receive_flit(*ARM::CHI::Payload::get_dummy(), phase));
+
+    /* The credits left over still send later flits. */
+    push_flit(link, ARM::CHI::CHANNEL_REQ, 5);
+    push_flit(link, ARM::CHI::CHANNEL_REQ, 6);
+    push_flit(link, ARM::CHI::CHANNEL_REQ, 7);
+    CHECK(send_cycle(link, ARM::CHI::CHANNEL_REQ).flits.size() == 2);
+    CHECK(send_cycle(link, ARM::CHI::CHANNEL_REQ).flits.empty());
+
+    grant_credits(link, ARM::CHI::CHANNEL_REQ, 1);
+    cycle = send_cycle(link, ARM::CHI::CHANNEL_REQ);
+    CHECK(cycle.flits.size() == 1 && cycle.flits[0].txn_id == 7);
+}
+
+/* Send DAT flits with the given DataIDs, returning how many went in each cycle. */
+static std::vector<unsigned> send_dat(unsigned flits_per_cycle, bool lane_parity, const std::vector<uint8_t>& data_ids)
+{
+    ARM::CHI::LinkConfig config(flits_per_cycle);
+    config.lane_parity = lane_parity;
+    ARM::CHI::LinkChannel link(config);
+
+    grant_credits(link, ARM::CHI::CHANNEL_DAT, unsigned(data_ids.size()));
+    for (std::size_t i = 0; i < data_ids.size(); i++)
+        push_flit(link, ARM::CHI::CHANNEL_DAT, uint16_t(i), data_ids[i]);
+
+    std::vector<unsigned> sent;
+    uint16_t next_txn_id = 0;
+
+    while (!link.tx_empty())
+    {
+        const Cycle cycle = send_cycle(link, ARM::CHI::CHANNEL_DAT);
+        CHECK(!cycle.flits.empty());
+
+        /* Flits are never reordered. */
+        for (const ARM::CHI::Phase& phase : cycle.flits)
+            CHECK(phase.txn_id == next_txn_id++);
+
+        sent.push_back(unsigned(cycle.flits.size()));
+    }
+
+    return sent;
+}
+
+static void test_lane_parity()
+{
+    typedef std::vector<unsigned> Counts;
+
+    /* One flit for each half of the line fits either half's lanes. */
+    CHECK(send_dat(2, true, {0, 2, 1, 3}) == Counts({2, 2}));
+    CHECK(send_dat(4, true, {0, 1, 2, 3}) == Counts({4}));
+
+    /* A flit with no lane left for its half waits for the next cycle, and holds back the flits behind it. */
+    CHECK(send_dat(4, true, {0, 1, 0, 2}) == Counts({2, 2}));
+    CHECK(send_dat(2, true, {2, 3, 0, 1}) == Counts({1, 2, 1}));
+
+    /* With an odd lane count the lower half has one more lane than the upper half. */
+    CHECK(send_dat(3, true, {0, 2, 1, 0}) == Counts({3, 1}));
+    CHECK(send_dat(3, true, {2, 3, 2}) == Counts({1, 1, 1}));
+
+    /* Without lane parity flits fill the lanes in order. */
+    CHECK(send_dat(2, false, {2, 3, 0, 1}) == Counts({2, 2}));
+    CHECK(send_dat(3, false, {2, 3, 2}) == Counts({3}));
+
+    /* Lane parity applies to DAT only. */
+    ARM::CHI::LinkConfig config(2);
+    config.lane_parity = true;
+    ARM::CHI::LinkChannel link(config);
+
+    grant_credits(link, ARM::CHI::CHANNEL_RSP, 2);
+    push_flit(link, ARM::CHI::CHANNEL_RSP, 0, 2);
+    push_flit(link, ARM::CHI::CHANNEL_RSP, 1, 2);
+    CHECK(send_cycle(link, ARM::CHI::CHANNEL_RSP).flits.size() == 2);
+}
+
+static void test_config_errors()
+{
+    ARM::CHI::LinkConfig config(1);
+    config.lane_parity = true;
+    CHECK_THROWS(ARM::CHI::LinkChannel link(config));
+
+    CHECK_THROWS(ARM::CHI::LinkChannel link(ARM::CHI::LinkConfig(0)));
+    CHECK_THROWS(ARM::CHI::LinkChannel link(ARM::CHI::LinkConfig(ARM::CHI::LINK_MAX_LANES + 1)));
+    CHECK_THROWS(ARM::CHI::LinkChannel link(ARM::CHI::LinkConfig(1, 0)));
+    CHECK_THROWS(ARM::CHI::LinkChannel link(ARM::CHI::LinkConfig(1, ARM::CHI::LINK_QUEUE_DEPTH + 1)));
+
+    config = ARM::CHI::LinkConfig(1, 4);
+    config.credit_return_batch = 5;
+    CHECK_THROWS(ARM::CHI::LinkChannel link(config));
+    config.credit_return_batch = 0;
+    CHECK_THROWS(ARM::CHI::LinkChannel link(config));
+
+    /* The widest and deepest links are allowed. */
+    ARM::CHI::LinkChannel wide(ARM::CHI::LinkConfig(ARM::CHI::LINK_MAX_LANES, ARM::CHI::LINK_QUEUE_DEPTH));
+
+    /* A channel cannot be reconfigured once receiving. */
+    ARM::CHI::LinkChannel link;
+    link.configure(ARM::CHI::LinkConfig(2, 8));
+    link.enable_rx();
+    CHECK(link.get_config().credit_depth == 8);
+    CHECK_THROWS(link.configure(ARM::CHI::LinkConfig(2, 4)));
+}
+
+int sc_main(int, char**)
+{
+    test_credit_issue();
+    test_credit_return_batch();
+    test_tx_credits();
+    test_lane_parity();
+    test_config_errors();
+
+    /* Queued and received flits hold their payloads only while in the link. */
+    CHECK(ARM::CHI::Payload::get_payload_pool_statistics().in_use == 0);
+
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include <utility>
+#include <vector>
+
+#include <ARM/TLM/arm_axi4.h>
+
+#include "TestUtilities.h"
+
+/* Counts the references taken to it. */
+struct Counted
+{
+    int refs = 1;
+
+    void ref() { refs++; }
+    void unref() { refs--; }
+};
+
+typedef ARM::TLM::PayloadRef<Counted> CountedRef;
+
+static void test_counting()
+{
+    Counted counted;
+
+    {
+        CountedRef adopted(&counted, ARM::TLM::ADOPT_REF);
+        CHECK(counted.refs == 1);
+
+        CountedRef copy(adopted);
+        CHECK(counted.refs == 2);
+        CHECK(copy == adopted);
+
+        /* Moves transfer the reference without touching the count. */
+        CountedRef moved(std::move(copy));
+        CHECK(counted.refs == 2);
+        CHECK(!copy);
+        CHECK(moved.get() == &counted);
+
+        CountedRef assigned;
+        assigned = moved;
+        CHECK(counted.refs == 3);
+        assigned = std::move(moved);
+        CHECK(counted.refs == 2);
+        CHECK(!moved);
+
+        /* Self assignment keeps the reference. */
+        const CountedRef& self = assigned;
+        assigned = self;
+        CHECK(counted.refs == 2);
+
+        assigned.reset();
+        CHECK(counted.refs == 1);
+        CHECK(!assigned);
+
+        Counted* const released = adopted.release();
+        CHECK(released == &counted && !adopted);
+        CHECK(counted.refs == 1);
+        released->unref();
+    }
+
+    CHECK(counted.refs == 0);
+
+    counted.refs = 1;
+    {
+        CountedRef taken(counted);
+        CHECK(counted.refs == 2);
+    }
+    CHECK(counted.refs == 1);
+}
+
+static void test_containers()
+{
+    Counted counted;
+
+    {
+        std::vector<CountedRef> refs;
+        for (int i = 0; i < 100; i++)
+            refs.emplace_back(&counted);
+
+        /* Growing the vector moves rather than copies. */
+        CHECK(counted.refs == 101);
+
+        refs.erase(refs.begin(), refs.begin() + 50);
+        CHECK(counted.refs == 51);
+    }
+
+    CHECK(counted.refs == 1);
+}
+
+static void test_pool()
+{
+    const std::size_t in_use = ARM::AXI::Payload::get_payload_pool_statistics().in_use;
+
+    {
+        ARM::AXI::PayloadRef payload(ARM::AXI::Payload::new_payload(ARM::AXI::COMMAND_READ, 0x1000,
+            ARM::AXI::SIZE_16, 3), ARM::TLM::ADOPT_REF);
+        CHECK(ARM::AXI::Payload::get_payload_pool_statistics().in_use == in_use + 1);
+
+        std::vector<ARM::AXI::PayloadRef> refs(10, payload);
+        CHECK(ARM::AXI::Payload::get_payload_pool_statistics().in_use == in_use + 1);
+    }
+
+    /* The last reference returns the payload to the pool. */
+    CHECK(ARM::AXI::Payload::get_payload_pool_statistics().in_use == in_use);
+}
+
+int sc_main(int, char**)
+{
+    test_counting();
+    test_containers();
+    test_pool();
+
+    return 0;
+}
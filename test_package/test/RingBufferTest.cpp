@@ -0,0 +1,161 @@
+#include <memory>
+#include <utility>
+
+#include <ARM/TLM/arm_tlm_ring_buffer.h>
+
+#include "TestUtilities.h"
+
+/* Counts live instances and the copies made of them. */
+struct Tracked
+{
+    static int live;
+    static int copies;
+
+    int value;
+
+    explicit Tracked(int value_) : value(value_) { live++; }
+    Tracked(const Tracked& other) : value(other.value) { live++; copies++; }
+    Tracked(Tracked&& other) : value(other.value) { other.value = -1; live++; }
+    ~Tracked() { live--; }
+
+    Tracked& operator= (const Tracked&) = delete;
+};
+
+int Tracked::live = 0;
+int Tracked::copies = 0;
+
+typedef ARM::TLM::RingBuffer<Tracked, 4> Buffer;
+
+static void test_full()
+{
+    Buffer buffer;
+
+    CHECK(Buffer::capacity() == 4);
+    CHECK(buffer.empty() && !buffer.full() && buffer.size() == 0);
+
+    for (int i = 0; i < 4; i++)
+    {
+        CHECK(!buffer.full());
+        buffer.emplace_back(i);
+        CHECK(buffer.size() == std::size_t(i + 1));
+        CHECK(buffer.back().value == i);
+    }
+
+    CHECK(buffer.full() && !buffer.empty());
+    CHECK(Tracked::live == 4);
+
+    /* Pushing to a full buffer is refused and leaves it as it was. */
+    CHECK_THROWS(buffer.emplace_back(4));
+    CHECK_THROWS(buffer.push_back(Tracked(5)));
+    CHECK(buffer.size() == 4);
+    CHECK(buffer.front().value == 0 && buffer.back().value == 3);
+    CHECK(Tracked::live == 4);
+
+    /* Popping one makes room for one. */
+    buffer.pop_front();
+    CHECK(!buffer.full() && buffer.size() == 3);
+    CHECK(Tracked::live == 3);
+    buffer.emplace_back(4);
+    CHECK(buffer.full());
+    CHECK(buffer.front().value == 1 && buffer.back().value == 4);
+
+    buffer.clear();
+    CHECK(buffer.empty() && buffer.size() == 0);
+    CHECK(Tracked::live == 0);
+
+    /* An empty buffer has no front or back to take. */
+    CHECK_THROWS(buffer.front());
+    CHECK_THROWS(buffer.back());
+    CHECK_THROWS(buffer.pop_front());
+    CHECK_THROWS(buffer.take_front());
+
+    const Buffer& const_buffer = buffer;
+    CHECK_THROWS(const_buffer.front());
+}
+
+static void test_wrap_around()
+{
+    Buffer buffer;
+    int pushed = 0;
+    int popped = 0;
+
+    /* Push and pop varying numbers of entries so the slots wrap many times over, from every offset. */
+    for (int round = 0; round < 50; round++)
+    {
+        for (int push = 1 + round % 4; push > 0 && !buffer.full(); push--)
+            buffer.emplace_back(pushed++);
+
+        CHECK(buffer.size() == std::size_t(pushed - popped));
+        CHECK(buffer.full() == (pushed - popped == 4));
+        CHECK(buffer.back().value == pushed - 1);
+
+        const int pop = 1 + (round * 3) % (pushed - popped);
+        for (int i = 0; i < pop; i++)
+        {
+            CHECK(buffer.front().value == popped);
+            CHECK(buffer.take_front().value == popped);
+            popped++;
+        }
+
+        CHECK(Tracked::live == pushed - popped);
+    }
+
+    CHECK(pushed > int(4 * Buffer::capacity()));
+
+    /* Entries left are destroyed with the buffer. */
+    while (buffer.size() < Buffer::capacity())
+        buffer.emplace_back(pushed++);
+    CHECK(Tracked::live == 4);
+}
+
+static void test_moves()
+{
+    Tracked::copies = 0;
+
+    {
+        Buffer buffer;
+
+        /* Entries are moved in and out without being copied. */
+        Tracked item(7);
+        buffer.push_back(std::move(item));
+        CHECK(item.value == -1);
+        buffer.emplace_back(8);
+
+        Tracked taken = buffer.take_front();
+        CHECK(taken.value == 7);
+        CHECK(Tracked::copies == 0);
+
+        /* Pushing a const entry copies it. */
+        const Tracked original(9);
+        buffer.push_back(original);
+        CHECK(Tracked::copies == 1);
+        CHECK(original.value == 9 && buffer.back().value == 9);
+    }
+
+    CHECK(Tracked::live == 0);
+
+    /* Move-only entries. */
+    ARM::TLM::RingBuffer<std::unique_ptr<int>, 2> pointers;
+    for (int i = 0; i < 5; i++)
+    {
+        pointers.push_back(std::unique_ptr<int>(new int(i)));
+        pointers.emplace_back(new int(i + 100));
+        CHECK(pointers.full());
+
+        std::unique_ptr<int> first = pointers.take_front();
+        CHECK(*first == i);
+        CHECK(*pointers.front() == i + 100);
+        pointers.pop_front();
+        CHECK(pointers.empty());
+    }
+}
+
+int sc_main(int, char**)
+{
+    test_full();
+    test_wrap_around();
+    CHECK(Tracked::live == 0);
+    test_moves();
+
+    return 0;
+}
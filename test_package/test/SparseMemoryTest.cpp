@@ -0,0 +1,245 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <ARM/TLM/arm_tlm_memory.h>
+
+#include "TestUtilities.h"
+
+static const std::size_t page_size = 64;
+static const uint8_t fill = 0xa5;
+
+/* Pattern byte for an address, distinct from the fill. */
+static uint8_t pattern(uint64_t address, uint8_t seed = 0)
+{
+    const uint8_t value = uint8_t(address * 7 + (address >> 8) + seed);
+    return value == fill ? 0 : value;
+}
+
+static void write_pattern(ARM::TLM::SparseMemory& memory, uint64_t address, std::size_t length, uint8_t seed = 0)
+{
+    std::vector<uint8_t> data(length);
+    for (std::size_t i = 0; i < length; i++)
+        data[i] = pattern(address + i, seed);
+
+    memory.write(address, data.data(), length);
+}
+
+static bool has_pattern(const ARM::TLM::SparseMemory& memory, uint64_t address, std::size_t length, uint8_t seed = 0)
+{
+    std::vector<uint8_t> data(length);
+    memory.read(address, data.data(), length);
+
+    for (std::size_t i = 0; i < length; i++)
+    {
+        if (data[i] != pattern(address + i, seed))
+            return false;
+    }
+
+    return true;
+}
+
+static bool has_fill(const ARM::TLM::SparseMemory& memory, uint64_t address, std::size_t length)
+{
+    std::vector<uint8_t> data(length);
+    memory.read(address, data.data(), length);
+
+    for (std::size_t i = 0; i < length; i++)
+    {
+        if (data[i] != fill)
+            return false;
+    }
+
+    return true;
+}
+
+static void test_page_boundaries()
+{
+    ARM::TLM::SparseMemory memory(page_size, fill);
+
+    CHECK(memory.get_page_size() == page_size);
+    CHECK(memory.get_page_count() == 0);
+    CHECK(memory.get_page_base(0x1234) == 0x1200);
+    CHECK(memory.get_page_base(0x123f) == 0x1200);
+    CHECK(memory.get_page_base(0x1240) == 0x1240);
+
+    /* Untouched memory reads as the fill without allocating pages. */
+    CHECK(has_fill(memory, 0x1000, 3 * page_size));
+    CHECK(memory.find_page(0x1000) == nullptr);
+    CHECK(memory.get_page_count() == 0);
+
+    /* A write from the middle of one page to the middle of the third touches three pages. */
+    write_pattern(memory, 0x1030, 2 * page_size);
+    CHECK(memory.get_page_count() == 3);
+    CHECK(has_pattern(memory, 0x1030, 2 * page_size));
+    CHECK(has_fill(memory, 0x1000, 0x30));
+    CHECK(has_fill(memory, 0x10b0, 0x10));
+    CHECK(memory.find_page(0x10c0) == nullptr);
+
+    /* Reads across the edges of the written range mix data and fill. */
+    uint8_t edge[2];
+    memory.read(0x102f, edge, 2);
+    CHECK(edge[0] == fill && edge[1] == pattern(0x1030));
+    memory.read(0x10af, edge, 2);
+    CHECK(edge[0] == pattern(0x10af) && edge[1] == fill);
+
+    /* Single bytes on either side of a page boundary. */
+    write_pattern(memory, 0x203f, 2, 1);
+    CHECK(memory.get_page_count() == 5);
+    CHECK(memory.get_page_base(0x203f) != memory.get_page_base(0x2040));
+    CHECK(memory.find_page(0x2000)[page_size - 1] == pattern(0x203f, 1));
+    CHECK(memory.find_page(0x2040)[0] == pattern(0x2040, 1));
+
+    /* Spans are only given within a page. */
+    CHECK(memory.get_span(0x3000, page_size) != nullptr);
+    CHECK(memory.get_span(0x3001, page_size) == nullptr);
+    CHECK(memory.get_span(0x303f, 1) == memory.get_page(0x3000) + page_size - 1);
+    CHECK(memory.find_span(0x1030, 0x10) == memory.find_page(0x1000) + 0x30);
+    CHECK(memory.find_span(0x1030, 0x11) == nullptr);
+    CHECK(memory.find_span(0x4000, 1) == nullptr);
+
+    /* Pages stay where they are as others are allocated. */
+    const uint8_t* const page = memory.find_page(0x1040);
+    for (uint64_t address = 0x10000; address < 0x10000 + 64 * page_size; address += page_size)
+        memory.get_page(address);
+    CHECK(memory.find_page(0x1040) == page);
+    CHECK(has_pattern(memory, 0x1030, 2 * page_size));
+}
+
+static void test_address_extremes()
+{
+    ARM::TLM::SparseMemory memory(page_size, fill);
+
+    /* The top of the address space, and pages which collide in the translation cache. */
+    const uint64_t top = ~uint64_t(0) - page_size + 1;
+    write_pattern(memory, top, page_size, 2);
+    write_pattern(memory, 0, page_size, 3);
+    write_pattern(memory, uint64_t(64) * page_size, page_size, 4);
+    write_pattern(memory, uint64_t(1) << 40, page_size, 5);
+
+    CHECK(has_pattern(memory, top, page_size, 2));
+    CHECK(has_pattern(memory, 0, page_size, 3));
+    CHECK(has_pattern(memory, uint64_t(64) * page_size, page_size, 4));
+    CHECK(has_pattern(memory, uint64_t(1) << 40, page_size, 5));
+    CHECK(memory.get_page_count() == 4);
+
+    memory.clear();
+    CHECK(memory.get_page_count() == 0);
+    CHECK(memory.find_page(0) == nullptr);
+    CHECK(has_fill(memory, top, page_size));
+}
+
+static const char* const snapshot_path = "SparseMemoryTest.snapshot";
+
+static void test_snapshot()
+{
+    ARM::TLM::SparseMemory memory(page_size, fill);
+
+    write_pattern(memory, 0x1030, 2 * page_size, 6);
+    write_pattern(memory, uint64_t(1) << 48, page_size, 7);
+    CHECK(memory.save_snapshot(snapshot_path));
+
+    /* Changes after the snapshot, to pages in it and to new ones, are undone by restoring it. */
+    write_pattern(memory, 0x1000, 4 * page_size, 8);
+    write_pattern(memory, 0x9000, page_size, 9);
+    CHECK(memory.restore_snapshot(snapshot_path));
+
+    CHECK(memory.get_page_count() == 4);
+    CHECK(has_fill(memory, 0x1000, 0x30));
+    CHECK(has_pattern(memory, 0x1030, 2 * page_size, 6));
+    CHECK(has_fill(memory, 0x10b0, 0x50));
+    CHECK(has_pattern(memory, uint64_t(1) << 48, page_size, 7));
+    CHECK(memory.find_page(0x9000) == nullptr);
+
+    /* Restoring into another store gives the same contents. */
+    ARM::TLM::SparseMemory copy(page_size, fill);
+    write_pattern(copy, 0x5000, page_size);
+    CHECK(copy.restore_snapshot(snapshot_path));
+    CHECK(copy.get_page_count() == 4);
+    CHECK(has_pattern(copy, 0x1030, 2 * page_size, 6));
+    CHECK(has_pattern(copy, uint64_t(1) << 48, page_size, 7));
+    CHECK(copy.find_page(0x5000) == nullptr);
+
+    /* A snapshot of another page size, or a missing file, is refused and leaves the store as it was. */
+    ARM::TLM::SparseMemory other(2 * page_size, fill);
+    write_pattern(other, 0x5000, page_size);
+    CHECK(!other.restore_snapshot(snapshot_path));
+    CHECK(has_pattern(other, 0x5000, page_size));
+
+    CHECK(std::remove(snapshot_path) == 0);
+    CHECK(!memory.restore_snapshot(snapshot_path));
+    CHECK(has_pattern(memory, 0x1030, 2 * page_size, 6));
+
+    /* An empty store saves an empty snapshot. */
+    ARM::TLM::SparseMemory empty(page_size, fill);
+    CHECK(empty.save_snapshot(snapshot_path));
+    CHECK(memory.restore_snapshot(snapshot_path));
+    CHECK(memory.get_page_count() == 0);
+    CHECK(has_fill(memory, 0x1030, 2 * page_size));
+    CHECK(std::remove(snapshot_path) == 0);
+}
+
+#ifdef ARM_TLM_MEMORY_MMAP
+static const char* const image_path = "SparseMemoryTest.image";
+
+static void test_file_region_snapshot()
+{
+    /* An image of four pages. */
+    {
+        std::vector<uint8_t> image(4 * page_size);
+        for (std::size_t i = 0; i < image.size(); i++)
+            image[i] = pattern(0x100000 + i, 10);
+
+        std::FILE* file = std::fopen(image_path, "wb");
+        CHECK(file);
+        CHECK(std::fwrite(image.data(), 1, image.size(), file) == image.size());
+        CHECK(std::fclose(file) == 0);
+    }
+
+    ARM::TLM::SparseMemory memory(page_size, fill);
+    CHECK(memory.map_file(0x100000, image_path));
+    CHECK(has_pattern(memory, 0x100000, 4 * page_size, 10));
+    CHECK(memory.get_page_count() == 0);
+
+    /* Only the written page of the private region is saved. */
+    write_pattern(memory, 0x100050, 0x20, 11);
+    CHECK(memory.save_snapshot(snapshot_path));
+
+    memory.clear();
+    CHECK(has_pattern(memory, 0x100000, 4 * page_size, 10));
+
+    CHECK(memory.restore_snapshot(snapshot_path));
+    CHECK(has_pattern(memory, 0x100000, 0x50, 10));
+    CHECK(has_pattern(memory, 0x100050, 0x20, 11));
+    CHECK(has_pattern(memory, 0x100070, 4 * page_size - 0x70, 10));
+    CHECK(memory.get_page_count() == 0);
+
+    /* The image file itself is untouched. */
+    ARM::TLM::SparseMemory image(page_size, fill);
+    CHECK(image.map_file(0x100000, image_path));
+    CHECK(has_pattern(image, 0x100000, 4 * page_size, 10));
+
+    CHECK(std::remove(snapshot_path) == 0);
+    CHECK(std::remove(image_path) == 0);
+}
+#endif
+
+static void test_page_size_errors()
+{
+    CHECK_THROWS(ARM::TLM::SparseMemory memory(32));
+    CHECK_THROWS(ARM::TLM::SparseMemory memory(4095));
+}
+
+int sc_main(int, char**)
+{
+    test_page_boundaries();
+    test_address_extremes();
+    test_snapshot();
+#ifdef ARM_TLM_MEMORY_MMAP
+    test_file_region_snapshot();
+#endif
+    test_page_size_errors();
+
+    return 0;
+}
@@ -0,0 +1,33 @@
+#ifndef ARM_TLM_TEST_UTILITIES_H
+#define ARM_TLM_TEST_UTILITIES_H
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+/* Checks which, unlike assert, stay in release builds. A failed check ends the test with a non-zero status. */
+#define CHECK(cond) \
+do { \
+    if (!(cond)) \
+    { \
+        std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #cond << std::endl; \
+        std::exit(1); \
+    } \
+} while (0)
+
+/* Check that an expression reports a library error by throwing std::runtime_error. */
+#define CHECK_THROWS(expr) \
+do { \
+    bool thrown = false; \
+    try \
+    { \
+        expr; \
+    } \
+    catch (const std::runtime_error&) \
+    { \
+        thrown = true; \
+    } \
+    CHECK(thrown && "expected " #expr " to throw"); \
+} while (0)
+
+#endif // ARM_TLM_TEST_UTILITIES_H